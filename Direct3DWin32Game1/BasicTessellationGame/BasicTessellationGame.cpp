@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "BasicTessellationGame/BasicTessellationGame.h"
+#include "Common/HillFunction.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -17,18 +18,55 @@ void BasicTessellationGame::AddObjects()
 	m_objects.push_back(new TessellationHill());
 }
 
+TessellationHill::TessellationHill()
+	: m_tessellator(m - 1, n - 1, width, depth)
+{
+}
+
+void TessellationHill::Update(DX::StepTimer const& timer)
+{
+	UINT numViewports = 1;
+	D3D11_VIEWPORT viewport;
+	m_d3dContext->RSGetViewports(&numViewports, &viewport);
+
+	const UINT patchCount = m_tessellator.Update(*m_world, *m_view, *m_proj, viewport.Height, m_controlPoints, m_patchFactors);
+	m_indexCount = 4 * patchCount;
+
+	if (patchCount > 0)
+	{
+		D3D11_MAPPED_SUBRESOURCE mappedData;
+		HRESULT hr = m_d3dContext->Map(m_indexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+		DX::ThrowIfFailed(hr);
+		memcpy(mappedData.pData, m_controlPoints.data(), sizeof(UINT) * m_indexCount);
+		m_d3dContext->Unmap(m_indexBuffer.Get(), 0);
+
+		hr = m_d3dContext->Map(m_patchFactorBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+		DX::ThrowIfFailed(hr);
+		memcpy(mappedData.pData, m_patchFactors.data(), sizeof(PatchTessFactors) * patchCount);
+		m_d3dContext->Unmap(m_patchFactorBuffer.Get(), 0);
+	}
+
+	Super::Update(timer);
+}
+
 void TessellationHill::Render()
 {
+	// Nothing of the hill is on screen.
+	if (m_indexCount == 0)
+		return;
+
 	m_d3dContext->IASetInputLayout(m_inputLayout.Get());
 	UINT stride = sizeof(VertexType);
 	UINT offset = 0;
 	m_d3dContext->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
+	m_d3dContext->IASetIndexBuffer(m_indexBuffer.Get(), m_indexFormat, 0);
 	m_d3dContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_4_CONTROL_POINT_PATCHLIST);
 
 	m_d3dContext->VSSetShader(m_vertexShader.Get(), nullptr, 0);
 
 	m_d3dContext->HSSetShader(m_hullShader.Get(), nullptr, 0);
 	m_d3dContext->HSSetConstantBuffers(1, 1, m_constantBufferPerObject.GetAddressOf());
+	m_d3dContext->HSSetShaderResources(0, 1, m_patchFactorView.GetAddressOf());
 
 	m_d3dContext->DSSetShader(m_domainShader.Get(), nullptr, 0);
 	m_d3dContext->DSSetConstantBuffers(1, 1, m_constantBufferPerObject.GetAddressOf());
@@ -37,28 +75,62 @@ void TessellationHill::Render()
 	m_d3dContext->PSSetConstantBuffers(1, 1, m_constantBufferPerObject.GetAddressOf());
 	m_d3dContext->PSSetShaderResources(0, 1, m_diffuseMapView.GetAddressOf());
 
-	m_d3dContext->Draw(4, 0);
+	m_d3dContext->DrawIndexed(m_indexCount, 0, 0);
 }
 
 void TessellationHill::BuildShape()
 {
-	VertexType vertices[4] = 
+	// The control points are shared by every hill of the same size; which
+	// patches to draw is up to each hill.
+	const std::string key = MeshCache::MakeKey("TessellationHill", width, depth, m, n);
+	UseSharedMesh(MeshCache::GetDefault().GetMeshBuffers(m_d3dDevice.Get(), key, [this](MeshData& mesh)
 	{
-		{XMFLOAT3(-width / 2,0.f, depth / 2),XMFLOAT3(0.f,1.f,0.f),XMFLOAT2(0.f,0.f) },
-		{XMFLOAT3( width / 2,0.f, depth / 2),XMFLOAT3(0.f,1.f,0.f),XMFLOAT2(0.f,1.f) },
-		{XMFLOAT3(-width / 2,0.f,-depth / 2),XMFLOAT3(0.f,1.f,0.f),XMFLOAT2(1.f,0.f) },
-		{XMFLOAT3( width / 2,0.f,-depth / 2),XMFLOAT3(0.f,1.f,0.f),XMFLOAT2(1.f,1.f) }
-	};
+		std::vector<VertexType> vertices(m * n);
+		for (UINT i = 0; i < m; ++i)
+		{
+			for (UINT j = 0; j < n; ++j)
+			{
+				vertices[i*n + j] = { m_tessellator.GetControlPoint(i, j), XMFLOAT3(0.f,1.f,0.f), XMFLOAT2(float(j) / (n - 1), float(i) / (m - 1)) };
+			}
+		}
+
+		mesh.SetVertices(vertices.data(), static_cast<UINT>(vertices.size()));
+	}));
+
+	m_tessellator.SetHeights(HillFunction::GetDefault());
+
+	// At most every patch is drawn.
+	const UINT patchCount = m_tessellator.GetPatchCount();
+
+	D3D11_BUFFER_DESC ibDesc;
+	ibDesc.ByteWidth = sizeof(UINT) * 4 * patchCount;
+	ibDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ibDesc.MiscFlags = 0;
+	ibDesc.StructureByteStride = 0;
+
+	HRESULT hr = m_d3dDevice->CreateBuffer(&ibDesc, nullptr, m_indexBuffer.ReleaseAndGetAddressOf());
+	DX::ThrowIfFailed(hr);
 
-	UINT byteWidth = 4 * sizeof(VertexType);
-	CD3D11_BUFFER_DESC vbDesc(byteWidth,D3D11_BIND_VERTEX_BUFFER);
+	m_indexCount = 0;
+	m_indexFormat = DXGI_FORMAT_R32_UINT;
+
+	D3D11_BUFFER_DESC factorDesc;
+	factorDesc.ByteWidth = sizeof(PatchTessFactors) * patchCount;
+	factorDesc.Usage = D3D11_USAGE_DYNAMIC;
+	factorDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	factorDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	factorDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	factorDesc.StructureByteStride = sizeof(PatchTessFactors);
+
+	hr = m_d3dDevice->CreateBuffer(&factorDesc, nullptr, m_patchFactorBuffer.GetAddressOf());
+	DX::ThrowIfFailed(hr);
 
-	D3D11_SUBRESOURCE_DATA vbInitData;
-	vbInitData.pSysMem = vertices;
-	vbInitData.SysMemPitch = 0;
-	vbInitData.SysMemSlicePitch = 0;
+	CD3D11_SHADER_RESOURCE_VIEW_DESC srvDesc(D3D11_SRV_DIMENSION_BUFFER);
+	srvDesc.Buffer.NumElements = patchCount;
 
-	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, &vbInitData, m_vertexBuffer.GetAddressOf());
+	hr = m_d3dDevice->CreateShaderResourceView(m_patchFactorBuffer.Get(), &srvDesc, m_patchFactorView.GetAddressOf());
 	DX::ThrowIfFailed(hr);
 }
 
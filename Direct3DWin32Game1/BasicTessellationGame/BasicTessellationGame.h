@@ -1,5 +1,6 @@
 #pragma once
 #include "TransparentWaveGame/TransparentWaveGame.h"
+#include "Common/PatchTessellator.h"
 
 class BasicTessellationGame : public TransparentWaveGame
 {
@@ -20,14 +21,23 @@ protected:
 	virtual void AddObjects() override;
 };
 
+// The hill as a grid of quad patches displaced in the domain shader. Every
+// frame the CPU culls the patches against the frustum and works out their
+// tessellation factors, see PatchTessellator; only the visible patches are
+// drawn, and the hull shader reads their factors from a structured buffer.
 class TessellationHill : public LitShape
 {
 	using Super = LitShape;
 
 public:
 
+	TessellationHill();
+
+	virtual void Update(DX::StepTimer const& timer) override;
 	virtual void Render() override;
 
+	UINT GetVisiblePatchCount() const { return static_cast<UINT>(m_patchFactors.size()); }
+
 protected:
 
 	virtual void BuildShape();
@@ -37,8 +47,18 @@ protected:
 
 	float width = 150.f;
 	float depth = 150.f;
-	const UINT m = 50;
-	const UINT n = 50;
+	// Control points along z and x; (m - 1) x (n - 1) patches.
+	const UINT m = 17;
+	const UINT n = 17;
+
+	PatchTessellator m_tessellator;
+
+	// Patches drawn this frame: their control point indices go to the index
+	// buffer, their factors to the factor buffer.
+	std::vector<UINT> m_controlPoints;
+	std::vector<PatchTessFactors> m_patchFactors;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_patchFactorBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_patchFactorView;
 
 	Microsoft::WRL::ComPtr<ID3DBlob> m_HSByteCode;
 	Microsoft::WRL::ComPtr<ID3DBlob> m_DSByteCode;
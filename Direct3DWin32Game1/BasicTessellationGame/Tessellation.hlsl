@@ -51,32 +51,30 @@ struct PatchTess
 	float InsideTess[2] : SV_InsideTessFactor;
 };
 
-PatchTess ConstantHS(InputPatch<VertexOut, 4> patch, uint patchID : SV_PrimitiveID)
+// Factors of the patches drawn, worked out on the CPU (see PatchTessellator)
+// in the order they are drawn. Patches off screen are not drawn at all.
+struct PatchFactors
 {
-	PatchTess pt;
-
-	float3 centerL = 0.25f*(patch[0].PosL + patch[1].PosL + patch[2].PosL + patch[3].PosL);
-	float3 centerW = mul(float4(centerL, 1.0f), gWorld).xyz;
-
-	float d = distance(centerW, gEyePosW);
+	float4 Edges;
+	float2 Inside;
+	float2 Padding;
+};
 
-	// Tessellate the patch based on distance from the eye such that
-	// the tessellation is 0 if d >= d1 and 64 if d <= d0.  The interval
-	// [d0, d1] defines the range we tessellate in.
+StructuredBuffer<PatchFactors> gPatchFactors : register(t0);
 
-	const float d0 = 20.0f;
-	const float d1 = 500.0f;
-	float tess = 64.0f*saturate((d1 - d) / (d1 - d0));
+PatchTess ConstantHS(InputPatch<VertexOut, 4> patch, uint patchID : SV_PrimitiveID)
+{
+	PatchTess pt;
 
-	// Uniformly tessellate the patch.
+	PatchFactors factors = gPatchFactors[patchID];
 
-	pt.EdgeTess[0] = tess;
-	pt.EdgeTess[1] = tess;
-	pt.EdgeTess[2] = tess;
-	pt.EdgeTess[3] = tess;
+	pt.EdgeTess[0] = factors.Edges.x;
+	pt.EdgeTess[1] = factors.Edges.y;
+	pt.EdgeTess[2] = factors.Edges.z;
+	pt.EdgeTess[3] = factors.Edges.w;
 
-	pt.InsideTess[0] = tess;
-	pt.InsideTess[1] = tess;
+	pt.InsideTess[0] = factors.Inside.x;
+	pt.InsideTess[1] = factors.Inside.y;
 
 	return pt;
 }
@@ -84,6 +82,7 @@ PatchTess ConstantHS(InputPatch<VertexOut, 4> patch, uint patchID : SV_Primitive
 struct HullOut
 {
 	float3 PosL : POSITION;
+	float2 TexUV : TEXUV;
 };
 
 [domain("quad")]
@@ -101,6 +100,7 @@ HullOut HS(InputPatch<VertexOut, 4> p,
 	HullOut hout;
 
 	hout.PosL = p[i].PosL;
+	hout.TexUV = p[i].TexUV;
 
 	return hout;
 }
@@ -141,7 +141,9 @@ DomainOut DS(PatchTess patchTess,
 	NormalL = normalize(NormalL);
 	dout.NormalW = mul(NormalL, (float3x3)gWorldInvTranspose);
 
-	dout.TexUV = uv;
+	float2 t1 = lerp(quad[0].TexUV, quad[1].TexUV, uv.x);
+	float2 t2 = lerp(quad[2].TexUV, quad[3].TexUV, uv.x);
+	dout.TexUV = lerp(t1, t2, uv.y);
 
 	return dout;
 }
\ No newline at end of file
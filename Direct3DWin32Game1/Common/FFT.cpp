@@ -0,0 +1,170 @@
+#include "pch.h"
+#include "Common/FFT.h"
+#include "Common/WorkerPool.h"
+
+namespace
+{
+	// Edge of the square blocks the transpose works in; a block of source and
+	// destination rows stays in L1.
+	const UINT TransposeBlock = 32;
+}
+
+FFT::FFT(UINT size)
+	: m_size(size)
+{
+	assert(size >= 2 && (size & (size - 1)) == 0);
+
+	UINT numBits = 0;
+	while ((1u << numBits) < size)
+	{
+		++numBits;
+	}
+
+	m_bitReverse.resize(size);
+	for (UINT i = 0; i < size; ++i)
+	{
+		UINT reversed = 0;
+		for (UINT bit = 0; bit < numBits; ++bit)
+		{
+			reversed |= ((i >> bit) & 1) << (numBits - 1 - bit);
+		}
+		m_bitReverse[i] = reversed;
+	}
+
+	// Computed in double, so the large transforms do not pick up the error of
+	// float sin/cos.
+	m_twiddles.resize(size - 1);
+	for (UINT half = 1; half < size; half *= 2)
+	{
+		for (UINT j = 0; j < half; ++j)
+		{
+			const double angle = -3.14159265358979323846 * j / half;
+			m_twiddles[half - 1 + j] = Complex(float(cos(angle)), float(sin(angle)));
+		}
+	}
+}
+
+void FFT::Forward(Complex* data) const
+{
+	Transform(data, false);
+}
+
+void FFT::Inverse(Complex* data) const
+{
+	Transform(data, true);
+}
+
+void FFT::Forward2D(Complex* data, Complex* scratch, WorkerPool* pool) const
+{
+	Transform2D(data, scratch, pool, false);
+}
+
+void FFT::Inverse2D(Complex* data, Complex* scratch, WorkerPool* pool) const
+{
+	Transform2D(data, scratch, pool, true);
+}
+
+void FFT::Transform(Complex* data, bool bInverse) const
+{
+	for (UINT i = 0; i < m_size; ++i)
+	{
+		const UINT j = m_bitReverse[i];
+		if (i < j)
+		{
+			std::swap(data[i], data[j]);
+		}
+	}
+
+	// The products are written out by hand; std::complex multiplication
+	// checks for infinities and NaNs on some compilers.
+	const float sign = bInverse ? -1.0f : 1.0f;
+	for (UINT half = 1; half < m_size; half *= 2)
+	{
+		const Complex* twiddles = m_twiddles.data() + half - 1;
+
+		for (UINT block = 0; block < m_size; block += 2 * half)
+		{
+			Complex* a = data + block;
+			Complex* b = a + half;
+
+			for (UINT j = 0; j < half; ++j)
+			{
+				const float wr = twiddles[j].real();
+				const float wi = sign * twiddles[j].imag();
+				const float br = b[j].real();
+				const float bi = b[j].imag();
+				const Complex t(wr * br - wi * bi, wr * bi + wi * br);
+
+				b[j] = a[j] - t;
+				a[j] += t;
+			}
+		}
+	}
+}
+
+void FFT::Transform2D(Complex* data, Complex* scratch, WorkerPool* pool, bool bInverse) const
+{
+	const UINT n = m_size;
+
+	auto transformRows = [&](Complex* rows)
+	{
+		auto task = [&](UINT rowBegin, UINT rowEnd)
+		{
+			for (UINT i = rowBegin; i < rowEnd; ++i)
+			{
+				Transform(rows + i * n, bInverse);
+			}
+		};
+
+		if (pool)
+		{
+			pool->ParallelFor(0, n, task);
+		}
+		else
+		{
+			task(0, n);
+		}
+	};
+
+	transformRows(data);
+	Transpose(data, scratch, pool);
+	transformRows(scratch);
+	Transpose(scratch, data, pool);
+}
+
+void FFT::Transpose(const Complex* src, Complex* dst, WorkerPool* pool) const
+{
+	const UINT n = m_size;
+	const UINT numBlocks = (n + TransposeBlock - 1) / TransposeBlock;
+
+	auto task = [&](UINT blockRowBegin, UINT blockRowEnd)
+	{
+		for (UINT blockRow = blockRowBegin; blockRow < blockRowEnd; ++blockRow)
+		{
+			const UINT rowBegin = blockRow * TransposeBlock;
+			const UINT rowEnd = std::min(rowBegin + TransposeBlock, n);
+
+			for (UINT colBegin = 0; colBegin < n; colBegin += TransposeBlock)
+			{
+				const UINT colEnd = std::min(colBegin + TransposeBlock, n);
+
+				for (UINT i = rowBegin; i < rowEnd; ++i)
+				{
+					for (UINT j = colBegin; j < colEnd; ++j)
+					{
+						dst[j * n + i] = src[i * n + j];
+					}
+				}
+			}
+		}
+	};
+
+	if (pool)
+	{
+		pool->ParallelFor(0, numBlocks, task);
+	}
+	else
+	{
+		task(0, numBlocks);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include <complex>
+#include <vector>
+
+class WorkerPool;
+
+// Radix-2 complex FFT of a fixed power of two size. The butterflies of each
+// pass read their twiddle factors from one contiguous table per pass, and the
+// 2D transforms only ever run 1D transforms over contiguous rows: columns are
+// brought into rows by a blocked transpose.
+class FFT
+{
+public:
+	typedef std::complex<float> Complex;
+
+	explicit FFT(UINT size);
+
+	UINT GetSize() const { return m_size; }
+
+	// out[n] = sum over k of in[k] * exp(-2 pi i k n / size), in place.
+	void Forward(Complex* data) const;
+
+	// out[n] = sum over k of in[k] * exp(+2 pi i k n / size), in place and
+	// without the 1 / size scale.
+	void Inverse(Complex* data) const;
+
+	// 2D versions over size x size row major data. scratch must hold
+	// size * size values. Rows are spread over pool when there is one.
+	void Forward2D(Complex* data, Complex* scratch, WorkerPool* pool) const;
+	void Inverse2D(Complex* data, Complex* scratch, WorkerPool* pool) const;
+
+private:
+
+	void Transform(Complex* data, bool bInverse) const;
+	void Transform2D(Complex* data, Complex* scratch, WorkerPool* pool, bool bInverse) const;
+
+	// Writes the transpose of the size x size matrix src to dst.
+	void Transpose(const Complex* src, Complex* dst, WorkerPool* pool) const;
+
+	UINT m_size;
+
+	std::vector<UINT> m_bitReverse;
+
+	// exp(-2 pi i j / (2 h)) for j < h, for every half size h = 1, 2, 4, ...
+	// of the passes, starting at index h - 1.
+	std::vector<Complex> m_twiddles;
+};
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "pch.h"
+#include "Common/FFTOcean.h"
+#include "Common/WorkerPool.h"
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	const float Gravity = 9.81f;
+}
+
+FFTOcean::FFTOcean(const OceanDesc& desc)
+	: m_desc(desc)
+	, m_fft(desc.resolution)
+{
+	const UINT n = m_desc.resolution;
+	assert(n >= 64 && n <= 1024 && (n & (n - 1)) == 0);
+
+	const UINT count = n * n;
+	m_h0.resize(count);
+	m_omega.resize(count);
+	m_heightDx.resize(count);
+	m_dzSlopeX.resize(count);
+	m_slopeZ.resize(count);
+	m_scratch.resize(count);
+	m_displacements.resize(count, XMFLOAT3(0.0f, 0.0f, 0.0f));
+	m_normals.resize(count, XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+	BuildSpectrum();
+}
+
+void FFTOcean::BuildSpectrum()
+{
+	const UINT n = m_desc.resolution;
+	const float dk = XM_2PI / m_desc.patchSize;
+
+	std::mt19937 random(m_desc.seed);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+	for (UINT i = 0; i < n; ++i)
+	{
+		for (UINT j = 0; j < n; ++j)
+		{
+			// Index n/2 and above stand for the negative wave numbers.
+			const float kx = dk * (j < n / 2 ? float(j) : float(j) - float(n));
+			const float kz = dk * (i < n / 2 ? float(i) : float(i) - float(n));
+			const float k = sqrtf(kx * kx + kz * kz);
+
+			const float xr = gaussian(random);
+			const float xi = gaussian(random);
+
+			// The Nyquist row and column have no partner of the opposite wave
+			// vector, which would make the height field complex.
+			const UINT index = i * n + j;
+			if (i == n / 2 || j == n / 2)
+			{
+				m_h0[index] = Complex(0.0f, 0.0f);
+			}
+			else
+			{
+				// E|h0|^2 = E dk^2 / 2; together with the opposite wave vector
+				// that gives the mode its share E dk^2 of the variance.
+				const float amplitude = 0.5f * sqrtf(EvaluateSpectrum(kx, kz)) * dk;
+				m_h0[index] = Complex(xr * amplitude, xi * amplitude);
+			}
+
+			// Deep water dispersion.
+			m_omega[index] = sqrtf(Gravity * k);
+		}
+	}
+}
+
+float FFTOcean::EvaluateSpectrum(float kx, float kz) const
+{
+	const float k2 = kx * kx + kz * kz;
+	if (k2 < 1e-12f)
+		return 0.0f;
+
+	const float k = sqrtf(k2);
+
+	XMFLOAT2 wind = m_desc.windDirection;
+	const float windLength = sqrtf(wind.x * wind.x + wind.y * wind.y);
+	const float cosTheta = windLength > 0.0f ? (kx * wind.x + kz * wind.y) / (k * windLength) : 1.0f;
+
+	if (m_desc.spectrum == OceanSpectrum::Phillips)
+	{
+		// Largest waves the wind can raise.
+		const float L = m_desc.windSpeed * m_desc.windSpeed / Gravity;
+		const float l = m_desc.phillipsSmallWave;
+
+		return m_desc.phillipsAmplitude * expf(-1.0f / (k2 * L * L)) / (k2 * k2)
+			* cosTheta * cosTheta * expf(-k2 * l * l);
+	}
+
+	// JONSWAP in angular frequency, after Hasselmann et al.
+	if (cosTheta <= 0.0f)
+		return 0.0f;
+
+	const float U = m_desc.windSpeed;
+	const float F = m_desc.fetch;
+	const float alpha = 0.076f * powf(U * U / (F * Gravity), 0.22f);
+	const float omegaPeak = 22.0f * powf(Gravity * Gravity / (U * F), 1.0f / 3.0f);
+
+	const float omega = sqrtf(Gravity * k);
+	const float sigma = omega <= omegaPeak ? 0.07f : 0.09f;
+	const float r = expf(-(omega - omegaPeak) * (omega - omegaPeak) / (2.0f * sigma * sigma * omegaPeak * omegaPeak));
+	const float ratio = omegaPeak / omega;
+	const float spectrum = alpha * Gravity * Gravity / powf(omega, 5.0f)
+		* expf(-1.25f * ratio * ratio * ratio * ratio) * powf(m_desc.peakEnhancement, r);
+
+	// d omega / dk turns it into a wave number spectrum and 1 / k into a
+	// density over the plane. cos^2 spreading over the half plane downwind.
+	const float dOmegaDk = Gravity / (2.0f * omega);
+	const float spreading = 2.0f * XM_1DIVPI * cosTheta * cosTheta;
+
+	return spectrum * dOmegaDk / k * spreading;
+}
+
+void FFTOcean::Update(float t)
+{
+	const UINT n = m_desc.resolution;
+	const float dk = XM_2PI / m_desc.patchSize;
+
+	ForEachRowBand([&](UINT rowBegin, UINT rowEnd)
+	{
+		for (UINT i = rowBegin; i < rowEnd; ++i)
+		{
+			const float kz = dk * (i < n / 2 ? float(i) : float(i) - float(n));
+			const UINT mirrorRow = (n - i) & (n - 1);
+
+			for (UINT j = 0; j < n; ++j)
+			{
+				const float kx = dk * (j < n / 2 ? float(j) : float(j) - float(n));
+				const UINT index = i * n + j;
+				const UINT mirror = mirrorRow * n + ((n - j) & (n - 1));
+
+				// h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t)
+				const float c = cosf(m_omega[index] * t);
+				const float s = sinf(m_omega[index] * t);
+				const Complex h0 = m_h0[index];
+				const Complex h0Mirror = m_h0[mirror];
+				const float hr = (h0.real() + h0Mirror.real()) * c - (h0.imag() + h0Mirror.imag()) * s;
+				const float hi = (h0.real() - h0Mirror.real()) * s + (h0.imag() - h0Mirror.imag()) * c;
+
+				// i k / |k| h moves points towards the crests, i k h is the slope.
+				const float k = sqrtf(kx * kx + kz * kz);
+				const float ux = k > 0.0f ? kx / k : 0.0f;
+				const float uz = k > 0.0f ? kz / k : 0.0f;
+
+				const Complex dx(-ux * hi, ux * hr);
+				const Complex dz(-uz * hi, uz * hr);
+				const Complex slopeX(-kx * hi, kx * hr);
+				const Complex slopeZ(-kz * hi, kz * hr);
+
+				// a + i b of two real fields.
+				m_heightDx[index] = Complex(hr - dx.imag(), hi + dx.real());
+				m_dzSlopeX[index] = Complex(dz.real() - slopeX.imag(), dz.imag() + slopeX.real());
+				m_slopeZ[index] = slopeZ;
+			}
+		}
+	});
+
+	m_fft.Inverse2D(m_heightDx.data(), m_scratch.data(), m_workerPool);
+	m_fft.Inverse2D(m_dzSlopeX.data(), m_scratch.data(), m_workerPool);
+	m_fft.Inverse2D(m_slopeZ.data(), m_scratch.data(), m_workerPool);
+
+	const float choppiness = m_desc.choppiness;
+
+	ForEachRowBand([&](UINT rowBegin, UINT rowEnd)
+	{
+		for (UINT index = rowBegin * n; index < rowEnd * n; ++index)
+		{
+			const float height = m_heightDx[index].real();
+			const float dx = m_heightDx[index].imag();
+			const float dz = m_dzSlopeX[index].real();
+			const float slopeX = m_dzSlopeX[index].imag();
+			const float slopeZ = m_slopeZ[index].real();
+
+			m_displacements[index] = XMFLOAT3(choppiness * dx, height, choppiness * dz);
+
+			const float invLength = 1.0f / sqrtf(slopeX * slopeX + 1.0f + slopeZ * slopeZ);
+			m_normals[index] = XMFLOAT3(-slopeX * invLength, invLength, -slopeZ * invLength);
+		}
+	});
+}
+
+void FFTOcean::ForEachRowBand(const std::function<void(UINT, UINT)>& task) const
+{
+	if (m_workerPool)
+	{
+		m_workerPool->ParallelFor(0, m_desc.resolution, task);
+	}
+	else
+	{
+		task(0, m_desc.resolution);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+#include "Common/FFT.h"
+#include <functional>
+#include <vector>
+
+class WorkerPool;
+
+enum class OceanSpectrum
+{
+	// Phillips spectrum scaled by phillipsAmplitude, as in Tessendorf's notes.
+	Phillips,
+	// JONSWAP spectrum of a sea developing over fetch, with cos^2 spreading.
+	JONSWAP
+};
+
+struct OceanDesc
+{
+	// Grid points along each side of the patch, a power of two from 64 to 1024.
+	UINT resolution = 256;
+	// Side length of the periodic patch in meters.
+	float patchSize = 500.0f;
+
+	OceanSpectrum spectrum = OceanSpectrum::Phillips;
+	DirectX::XMFLOAT2 windDirection = DirectX::XMFLOAT2(1.0f, 0.0f);
+	float windSpeed = 20.0f;
+
+	float phillipsAmplitude = 1e-3f;
+	// Waves shorter than this are damped away, in meters.
+	float phillipsSmallWave = 0.5f;
+
+	// Distance over which the wind has been blowing, in meters.
+	float fetch = 100000.0f;
+	float peakEnhancement = 3.3f;
+
+	// Horizontal displacement scale; 0 gives a plain height field.
+	float choppiness = 1.0f;
+
+	UINT seed = 1;
+};
+
+// Ocean surface synthesized from a wave spectrum after Tessendorf,
+// "Simulating Ocean Water". The spectrum is drawn once; Update advances every
+// wave to the given time and brings heights, horizontal displacements and
+// slopes back to the grid with three 2D inverse FFTs. The result is periodic
+// over patchSize, so patches tile without seams.
+class FFTOcean
+{
+public:
+	explicit FFTOcean(const OceanDesc& desc);
+
+	FFTOcean(const FFTOcean&) = delete;
+	FFTOcean& operator=(const FFTOcean&) = delete;
+
+	// Runs the FFTs and the per point passes on pool when set.
+	void SetWorkerPool(WorkerPool* pool) { m_workerPool = pool; }
+
+	// Evaluates the surface at time t in seconds.
+	void Update(float t);
+
+	const OceanDesc& GetDesc() const { return m_desc; }
+	UINT GetResolution() const { return m_desc.resolution; }
+	float GetPatchSize() const { return m_desc.patchSize; }
+
+	// Grid point (i, j) rests at x = j * patchSize / resolution and
+	// z = i * patchSize / resolution and is moved by its displacement
+	// (dx, height, dz). Indices wrap around, as the patch is periodic.
+	const DirectX::XMFLOAT3& GetDisplacement(UINT i, UINT j) const { return m_displacements[Wrap(i) * m_desc.resolution + Wrap(j)]; }
+	const DirectX::XMFLOAT3& GetNormal(UINT i, UINT j) const { return m_normals[Wrap(i) * m_desc.resolution + Wrap(j)]; }
+
+	const DirectX::XMFLOAT3* GetDisplacements() const { return m_displacements.data(); }
+	const DirectX::XMFLOAT3* GetNormals() const { return m_normals.data(); }
+
+private:
+
+	typedef FFT::Complex Complex;
+
+	UINT Wrap(UINT i) const { return i & (m_desc.resolution - 1); }
+
+	void BuildSpectrum();
+
+	// Directional spectrum of the wave vector (kx, kz). Its integral over
+	// all wave vectors is the variance of the height.
+	float EvaluateSpectrum(float kx, float kz) const;
+
+	// Runs task over the grid rows, on the worker pool when there is one.
+	void ForEachRowBand(const std::function<void(UINT, UINT)>& task) const;
+
+	OceanDesc m_desc;
+	FFT m_fft;
+
+	WorkerPool* m_workerPool = nullptr;
+
+	// Initial amplitudes h0(k) and angular frequencies of every wave vector.
+	std::vector<Complex> m_h0;
+	std::vector<float> m_omega;
+
+	// Spectra of height + i * dx, dz + i * slope x, and slope z. Each field
+	// is real, so two of them share one complex transform.
+	std::vector<Complex> m_heightDx;
+	std::vector<Complex> m_dzSlopeX;
+	std::vector<Complex> m_slopeZ;
+	std::vector<Complex> m_scratch;
+
+	std::vector<DirectX::XMFLOAT3> m_displacements;
+	std::vector<DirectX::XMFLOAT3> m_normals;
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "Common/GeometryGenerator.h"
+#include <unordered_map>
 
 //***************************************************************************************
 // GeometryGenerator.cpp by Frank Luna (C) 2011 All Rights Reserved.
@@ -227,13 +228,6 @@ void GeometryGenerator::CreateSphere(float radius, UINT sliceCount, UINT stackCo
 
 void GeometryGenerator::Subdivide(MeshData& meshData)
 {
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices.resize(0);
-
 	//       v1
 	//       *
 	//      / \
@@ -244,63 +238,94 @@ void GeometryGenerator::Subdivide(MeshData& meshData)
 	// *-----*-----*
 	// v0    m2     v2
 
-	UINT numTris = inputCopy.Indices.size() / 3;
+	// The input vertices are kept and every edge gets one midpoint, shared by
+	// the triangles on either side, so the output stays welded. Midpoints are
+	// numbered after the input vertices in the order their edges come up.
+	const UINT numVertices = static_cast<UINT>(meshData.Vertices.size());
+	const UINT numTris = static_cast<UINT>(meshData.Indices.size() / 3);
+
+	// Keyed by the two vertex indices of the edge, smaller first. A closed
+	// mesh has exactly 3/2 edges per triangle.
+	std::unordered_map<UINT64, UINT> edgeMidpoints;
+	edgeMidpoints.reserve(numTris * 3 / 2);
+
+	// Midpoint indices m0, m1, m2 of every triangle.
+	std::vector<UINT> triMidpoints(numTris * 3);
+	std::vector<UINT64> midpointEdges;
+	midpointEdges.reserve(numTris * 3 / 2);
+
+	for (UINT i = 0; i < numTris; ++i)
+	{
+		const UINT* tri = &meshData.Indices[i * 3];
+		const UINT edges[3][2] = { { tri[0], tri[1] }, { tri[1], tri[2] }, { tri[0], tri[2] } };
+
+		for (UINT e = 0; e < 3; ++e)
+		{
+			const UINT a = std::min(edges[e][0], edges[e][1]);
+			const UINT b = std::max(edges[e][0], edges[e][1]);
+			const UINT64 key = (UINT64(a) << 32) | b;
+
+			auto inserted = edgeMidpoints.insert(std::make_pair(key, numVertices + static_cast<UINT>(midpointEdges.size())));
+			if (inserted.second)
+			{
+				midpointEdges.push_back(key);
+			}
+			triMidpoints[i * 3 + e] = inserted.first->second;
+		}
+	}
+
+	//
+	// Generate the midpoints.
+	//
+
+	// For subdivision, we just care about the position component.  We derive the other
+	// vertex components in CreateGeosphere.
+
+	meshData.Vertices.resize(numVertices + midpointEdges.size());
+	for (size_t e = 0; e < midpointEdges.size(); ++e)
+	{
+		const XMFLOAT3& p0 = meshData.Vertices[UINT(midpointEdges[e] >> 32)].Position;
+		const XMFLOAT3& p1 = meshData.Vertices[UINT(midpointEdges[e])].Position;
+
+		meshData.Vertices[numVertices + e].Position = XMFLOAT3(
+			0.5f*(p0.x + p1.x),
+			0.5f*(p0.y + p1.y),
+			0.5f*(p0.z + p1.z));
+	}
+
+	//
+	// Add new geometry.
+	//
+
+	std::vector<UINT> inputIndices;
+	inputIndices.swap(meshData.Indices);
+	meshData.Indices.reserve(numTris * 12);
+
 	for (UINT i = 0; i < numTris; ++i)
 	{
-		Vertex v0 = inputCopy.Vertices[inputCopy.Indices[i * 3 + 0]];
-		Vertex v1 = inputCopy.Vertices[inputCopy.Indices[i * 3 + 1]];
-		Vertex v2 = inputCopy.Vertices[inputCopy.Indices[i * 3 + 2]];
-
-		//
-		// Generate the midpoints.
-		//
-
-		Vertex m0, m1, m2;
-
-		// For subdivision, we just care about the position component.  We derive the other
-		// vertex components in CreateGeosphere.
-
-		m0.Position = XMFLOAT3(
-			0.5f*(v0.Position.x + v1.Position.x),
-			0.5f*(v0.Position.y + v1.Position.y),
-			0.5f*(v0.Position.z + v1.Position.z));
-
-		m1.Position = XMFLOAT3(
-			0.5f*(v1.Position.x + v2.Position.x),
-			0.5f*(v1.Position.y + v2.Position.y),
-			0.5f*(v1.Position.z + v2.Position.z));
-
-		m2.Position = XMFLOAT3(
-			0.5f*(v0.Position.x + v2.Position.x),
-			0.5f*(v0.Position.y + v2.Position.y),
-			0.5f*(v0.Position.z + v2.Position.z));
-
-		//
-		// Add new geometry.
-		//
-
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
-
-		meshData.Indices.push_back(i * 6 + 0);
-		meshData.Indices.push_back(i * 6 + 3);
-		meshData.Indices.push_back(i * 6 + 5);
-
-		meshData.Indices.push_back(i * 6 + 3);
-		meshData.Indices.push_back(i * 6 + 4);
-		meshData.Indices.push_back(i * 6 + 5);
-
-		meshData.Indices.push_back(i * 6 + 5);
-		meshData.Indices.push_back(i * 6 + 4);
-		meshData.Indices.push_back(i * 6 + 2);
-
-		meshData.Indices.push_back(i * 6 + 3);
-		meshData.Indices.push_back(i * 6 + 1);
-		meshData.Indices.push_back(i * 6 + 4);
+		const UINT v0 = inputIndices[i * 3 + 0];
+		const UINT v1 = inputIndices[i * 3 + 1];
+		const UINT v2 = inputIndices[i * 3 + 2];
+
+		const UINT m0 = triMidpoints[i * 3 + 0];
+		const UINT m1 = triMidpoints[i * 3 + 1];
+		const UINT m2 = triMidpoints[i * 3 + 2];
+
+		meshData.Indices.push_back(v0);
+		meshData.Indices.push_back(m0);
+		meshData.Indices.push_back(m2);
+
+		meshData.Indices.push_back(m0);
+		meshData.Indices.push_back(m1);
+		meshData.Indices.push_back(m2);
+
+		meshData.Indices.push_back(m2);
+		meshData.Indices.push_back(m1);
+		meshData.Indices.push_back(v2);
+
+		meshData.Indices.push_back(m0);
+		meshData.Indices.push_back(v1);
+		meshData.Indices.push_back(m1);
 	}
 }
 
@@ -0,0 +1,169 @@
+#include "pch.h"
+#include "Common/GerstnerWaves.h"
+#include "Common/WorkerPool.h"
+
+using namespace DirectX;
+
+void GerstnerWaves::AddWave(const GerstnerWave& wave)
+{
+	GerstnerWave added = wave;
+
+	const float length = sqrtf(wave.direction.x * wave.direction.x + wave.direction.y * wave.direction.y);
+	added.direction = length > 0.0f ? XMFLOAT2(wave.direction.x / length, wave.direction.y / length) : XMFLOAT2(1.0f, 0.0f);
+
+	m_waves.push_back(added);
+
+	BuildConstants();
+}
+
+void GerstnerWaves::BuildConstants()
+{
+	const float numWaves = float(m_waves.size());
+
+	m_constants.resize(m_waves.size());
+	for (size_t i = 0; i < m_waves.size(); ++i)
+	{
+		const GerstnerWave& wave = m_waves[i];
+		WaveConstants& c = m_constants[i];
+
+		const float k = XM_2PI / wave.wavelength;
+		const float dx = wave.direction.x;
+		const float dz = wave.direction.y;
+
+		// Q = steepness / (k A numWaves) keeps the crests of the sum from looping.
+		const float qa = wave.amplitude > 0.0f ? wave.steepness / (k * numWaves) : 0.0f;
+
+		c.kx = k * dx;
+		c.kz = k * dz;
+		c.omega = k * wave.speed;
+		c.amplitude = wave.amplitude;
+		c.qaDx = qa * dx;
+		c.qaDz = qa * dz;
+		c.ampKx = wave.amplitude * c.kx;
+		c.ampKz = wave.amplitude * c.kz;
+		c.qaDxKx = qa * dx * c.kx;
+		c.qaDxKz = qa * dx * c.kz;
+		c.qaDzKz = qa * dz * c.kz;
+	}
+}
+
+void GerstnerWaves::Evaluate(const WaveGrid& grid, XMFLOAT2 origin, float t, void* vertices, const GerstnerVertexLayout& layout) const
+{
+	auto task = [&](UINT rowBegin, UINT rowEnd)
+	{
+		EvaluateRows(grid, origin, t, vertices, layout, rowBegin, rowEnd);
+	};
+
+	if (m_workerPool)
+	{
+		m_workerPool->ParallelFor(0, grid.numRows, task);
+	}
+	else
+	{
+		task(0, grid.numRows);
+	}
+}
+
+void GerstnerWaves::EvaluateRows(const WaveGrid& grid, XMFLOAT2 origin, float t, void* vertices, const GerstnerVertexLayout& layout,
+	UINT rowBegin, UINT rowEnd) const
+{
+	BYTE* bytes = reinterpret_cast<BYTE*>(vertices);
+	const UINT numWaves = GetWaveCount();
+	const XMVECTOR one = XMVectorReplicate(1.0f);
+	const XMVECTOR columnOffsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+
+	for (UINT i = rowBegin; i < rowEnd; ++i)
+	{
+		const float z = origin.y + grid.GetZ(i);
+		BYTE* row = bytes + size_t(i) * grid.numCols * layout.stride;
+
+		for (UINT j = 0; j < grid.numCols; j += 4)
+		{
+			// x of four neighbouring points.
+			const XMVECTOR x = XMVectorAdd(XMVectorReplicate(origin.x + grid.GetX(j)),
+				XMVectorMultiply(columnOffsets, XMVectorReplicate(grid.spatialStep)));
+
+			// Position and its derivatives along x (the tangent) and z.
+			XMVECTOR px = x;
+			XMVECTOR py = XMVectorZero();
+			XMVECTOR pz = XMVectorReplicate(z);
+			XMVECTOR tx = one;
+			XMVECTOR ty = XMVectorZero();
+			XMVECTOR tz = XMVectorZero();
+			XMVECTOR by = XMVectorZero();
+			XMVECTOR bz = one;
+
+			for (UINT w = 0; w < numWaves; ++w)
+			{
+				const WaveConstants& c = m_constants[w];
+
+				// theta = k . (x, z) - omega t
+				const XMVECTOR theta = XMVectorMultiplyAdd(XMVectorReplicate(c.kx), x, XMVectorReplicate(c.kz * z - c.omega * t));
+
+				XMVECTOR s, cs;
+				XMVectorSinCos(&s, &cs, theta);
+
+				px = XMVectorMultiplyAdd(XMVectorReplicate(c.qaDx), cs, px);
+				py = XMVectorMultiplyAdd(XMVectorReplicate(c.amplitude), s, py);
+				pz = XMVectorMultiplyAdd(XMVectorReplicate(c.qaDz), cs, pz);
+
+				tx = XMVectorNegativeMultiplySubtract(XMVectorReplicate(c.qaDxKx), s, tx);
+				ty = XMVectorMultiplyAdd(XMVectorReplicate(c.ampKx), cs, ty);
+				tz = XMVectorNegativeMultiplySubtract(XMVectorReplicate(c.qaDxKz), s, tz);
+
+				by = XMVectorMultiplyAdd(XMVectorReplicate(c.ampKz), cs, by);
+				bz = XMVectorNegativeMultiplySubtract(XMVectorReplicate(c.qaDzKz), s, bz);
+			}
+
+			// The x component of the z derivative equals tz. The normal is
+			// (d/dz) x (d/dx), exact rather than the usual approximation.
+			const XMVECTOR bx = tz;
+			const XMVECTOR nx = XMVectorNegativeMultiplySubtract(bz, ty, XMVectorMultiply(by, tz));
+			const XMVECTOR ny = XMVectorNegativeMultiplySubtract(bx, tz, XMVectorMultiply(bz, tx));
+			const XMVECTOR nz = XMVectorNegativeMultiplySubtract(by, tx, XMVectorMultiply(bx, ty));
+
+			const XMVECTOR normalScale = XMVectorReciprocalSqrt(
+				XMVectorMultiplyAdd(nx, nx, XMVectorMultiplyAdd(ny, ny, XMVectorMultiply(nz, nz))));
+			const XMVECTOR tangentScale = XMVectorReciprocalSqrt(
+				XMVectorMultiplyAdd(tx, tx, XMVectorMultiplyAdd(ty, ty, XMVectorMultiply(tz, tz))));
+
+			XMFLOAT4 position[3];
+			XMFLOAT4 normal[3];
+			XMFLOAT4 tangent[3];
+			XMStoreFloat4(&position[0], px);
+			XMStoreFloat4(&position[1], py);
+			XMStoreFloat4(&position[2], pz);
+			XMStoreFloat4(&normal[0], XMVectorMultiply(nx, normalScale));
+			XMStoreFloat4(&normal[1], XMVectorMultiply(ny, normalScale));
+			XMStoreFloat4(&normal[2], XMVectorMultiply(nz, normalScale));
+			XMStoreFloat4(&tangent[0], XMVectorMultiply(tx, tangentScale));
+			XMStoreFloat4(&tangent[1], XMVectorMultiply(ty, tangentScale));
+			XMStoreFloat4(&tangent[2], XMVectorMultiply(tz, tangentScale));
+
+			// Lanes past the end of the row are dropped.
+			const UINT count = std::min(4u, grid.numCols - j);
+			for (UINT lane = 0; lane < count; ++lane)
+			{
+				BYTE* vertex = row + size_t(j + lane) * layout.stride;
+
+				const float* p0 = &position[0].x;
+				const float* p1 = &position[1].x;
+				const float* p2 = &position[2].x;
+				*reinterpret_cast<XMFLOAT3*>(vertex + layout.positionOffset) = XMFLOAT3(p0[lane], p1[lane], p2[lane]);
+
+				const float* n0 = &normal[0].x;
+				const float* n1 = &normal[1].x;
+				const float* n2 = &normal[2].x;
+				*reinterpret_cast<XMFLOAT3*>(vertex + layout.normalOffset) = XMFLOAT3(n0[lane], n1[lane], n2[lane]);
+
+				if (layout.tangentOffset != UINT_MAX)
+				{
+					const float* t0 = &tangent[0].x;
+					const float* t1 = &tangent[1].x;
+					const float* t2 = &tangent[2].x;
+					*reinterpret_cast<XMFLOAT3*>(vertex + layout.tangentOffset) = XMFLOAT3(t0[lane], t1[lane], t2[lane]);
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include "Common/WaveSolver.h"
+#include <vector>
+
+class WorkerPool;
+
+struct GerstnerWave
+{
+	// Direction of travel in the xz plane; normalized when the wave is added.
+	DirectX::XMFLOAT2 direction = DirectX::XMFLOAT2(1.0f, 0.0f);
+	float amplitude = 0.5f;
+	float wavelength = 20.0f;
+	float speed = 5.0f;
+	// 0 gives a sine wave, 1 the sharpest crests that do not loop over.
+	float steepness = 0.5f;
+};
+
+// Where the evaluated vertices go: byte offsets of the position, normal and
+// tangent members inside a vertex of stride bytes, like the elements of an
+// input layout. A tangent offset of UINT_MAX leaves tangents out.
+struct GerstnerVertexLayout
+{
+	UINT stride;
+	UINT positionOffset;
+	UINT normalOffset;
+	UINT tangentOffset = UINT_MAX;
+};
+
+// Sum of Gerstner waves after Fournier and Reeves, evaluated in closed form
+// (GPU Gems 1, chapter 1). There is no simulation state, so any region can
+// be evaluated at any time and resolution. Four vertices are evaluated at a
+// time through DirectXMath and rows are spread over the worker pool.
+class GerstnerWaves
+{
+public:
+	void AddWave(const GerstnerWave& wave);
+	void ClearWaves() { m_waves.clear(); m_constants.clear(); }
+	UINT GetWaveCount() const { return static_cast<UINT>(m_waves.size()); }
+
+	// Runs Evaluate on pool when set, on the calling thread otherwise.
+	void SetWorkerPool(WorkerPool* pool) { m_workerPool = pool; }
+
+	// Writes the displaced positions, normals and x tangents of every point of
+	// grid, shifted by origin in the xz plane, at time t to vertices. Rows
+	// follow the grid layout of WaveSolver.
+	void Evaluate(const WaveGrid& grid, DirectX::XMFLOAT2 origin, float t, void* vertices, const GerstnerVertexLayout& layout) const;
+
+	// Evaluate over rows [rowBegin, rowEnd) only, on the calling thread. For
+	// callers that fill in the rest of the vertices in the same row bands.
+	void EvaluateRows(const WaveGrid& grid, DirectX::XMFLOAT2 origin, float t, void* vertices, const GerstnerVertexLayout& layout,
+		UINT rowBegin, UINT rowEnd) const;
+
+private:
+
+	// Terms of one wave that do not depend on the point, with k the wave
+	// vector, A the amplitude and Q the steepness scaled as in the chapter.
+	struct WaveConstants
+	{
+		float kx;
+		float kz;
+		float omega;
+		float amplitude;
+		float qaDx;		// Q A Dx
+		float qaDz;		// Q A Dz
+		float ampKx;	// A kx
+		float ampKz;	// A kz
+		float qaDxKx;	// Q A Dx kx
+		float qaDxKz;	// Q A Dx kz, also Q A Dz kx
+		float qaDzKz;	// Q A Dz kz
+	};
+
+	// Q depends on the number of waves, so every wave is redone on a change.
+	void BuildConstants();
+
+	std::vector<GerstnerWave> m_waves;
+	std::vector<WaveConstants> m_constants;
+
+	WorkerPool* m_workerPool = nullptr;
+};
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include "pch.h"
+#include "Common/HeightFieldMesher.h"
+#include "Common/WorkerPool.h"
+
+using namespace DirectX;
+
+namespace
+{
+	void ParallelFor(WorkerPool* pool, UINT begin, UINT end, const std::function<void(UINT, UINT)>& task)
+	{
+		if (pool)
+		{
+			pool->ParallelFor(begin, end, task);
+		}
+		else
+		{
+			task(begin, end);
+		}
+	}
+}
+
+HeightFieldMesher::HeightFieldMesher(const HeightField& heightField, float width, float depth, UINT gridCells, WorkerPool* pool)
+	: m_heightField(heightField)
+	, m_width(width)
+	, m_depth(depth)
+	, m_gridCells(gridCells)
+	, m_pool(pool)
+{
+	assert(gridCells >= 2 && (gridCells & (gridCells - 1)) == 0);
+
+	const UINT n = gridCells + 1;
+	const float dx = width / gridCells;
+	const float dz = depth / gridCells;
+
+	std::vector<XMFLOAT2> points(n * n);
+	for (UINT i = 0; i < n; ++i)
+	{
+		for (UINT j = 0; j < n; ++j)
+		{
+			points[i*n + j] = XMFLOAT2(-0.5f * width + j * dx, 0.5f * depth - i * dz);
+		}
+	}
+
+	m_heights.resize(n * n);
+	heightField.Evaluate(points.data(), n * n, m_heights.data(), nullptr, pool);
+
+	// Every sample but the corners is the midpoint of the hypotenuse of one
+	// or two triangles of the same level, which halve the squares of size
+	// cells either at the diagonal (centers) or at a side (side midpoints).
+	// Side midpoints of a size take the errors of the centers of the size
+	// below, and centers those of the side midpoints of their own size, so
+	// going up the sizes every sample only reads finished ones.
+	m_errors.assign(n * n, 0.0f);
+	for (UINT size = 2; size <= gridCells; size *= 2)
+	{
+		const UINT half = size / 2;
+		const UINT numSquares = gridCells / size;
+
+		// Horizontal sides on rows 0, size, ..., and vertical sides on the rows in between.
+		ParallelFor(pool, 0, 2 * numSquares + 1, [&](UINT begin, UINT end)
+		{
+			for (UINT k = begin; k < end; ++k)
+			{
+				const UINT y = k * half;
+				if (k % 2 == 0)
+				{
+					for (UINT x = half; x < gridCells; x += size)
+					{
+						ComputeSideError(x, y, size, true);
+					}
+				}
+				else
+				{
+					for (UINT x = 0; x <= gridCells; x += size)
+					{
+						ComputeSideError(x, y, size, false);
+					}
+				}
+			}
+		});
+
+		ParallelFor(pool, 0, numSquares, [&](UINT begin, UINT end)
+		{
+			for (UINT k = begin; k < end; ++k)
+			{
+				for (UINT x = half; x < gridCells; x += size)
+				{
+					ComputeCenterError(x, k * size + half, size);
+				}
+			}
+		});
+	}
+}
+
+void HeightFieldMesher::ComputeSideError(UINT x, UINT y, UINT size, bool bHorizontal)
+{
+	const UINT n = m_gridCells + 1;
+	const UINT half = size / 2;
+
+	const float midpointError = bHorizontal ?
+		fabsf(0.5f * (GetHeight(x - half, y) + GetHeight(x + half, y)) - GetHeight(x, y)) :
+		fabsf(0.5f * (GetHeight(x, y - half) + GetHeight(x, y + half)) - GetHeight(x, y));
+
+	// The triangles on either side have their right angles at the centers
+	// of the squares next to the side; their halves in turn are split at
+	// the centers of the squares of half the size.
+	float below = 0.0f;
+	if (size > 2)
+	{
+		const UINT quarter = half / 2;
+		if (bHorizontal)
+		{
+			if (y > 0)
+			{
+				below = std::max(below, std::max(m_errors[(y - quarter) * n + x - quarter], m_errors[(y - quarter) * n + x + quarter]));
+			}
+			if (y < m_gridCells)
+			{
+				below = std::max(below, std::max(m_errors[(y + quarter) * n + x - quarter], m_errors[(y + quarter) * n + x + quarter]));
+			}
+		}
+		else
+		{
+			if (x > 0)
+			{
+				below = std::max(below, std::max(m_errors[(y - quarter) * n + x - quarter], m_errors[(y + quarter) * n + x - quarter]));
+			}
+			if (x < m_gridCells)
+			{
+				below = std::max(below, std::max(m_errors[(y - quarter) * n + x + quarter], m_errors[(y + quarter) * n + x + quarter]));
+			}
+		}
+	}
+
+	m_errors[y * n + x] = midpointError + below;
+}
+
+void HeightFieldMesher::ComputeCenterError(UINT x, UINT y, UINT size)
+{
+	const UINT n = m_gridCells + 1;
+	const UINT half = size / 2;
+
+	// Squares alternate between the two diagonals like a checkerboard, the
+	// whole grid being halved from (0, 0) to (gridCells, gridCells).
+	const bool bMainDiagonal = ((x / size + y / size) & 1) == 0;
+	const float interpolated = bMainDiagonal ?
+		0.5f * (GetHeight(x - half, y - half) + GetHeight(x + half, y + half)) :
+		0.5f * (GetHeight(x + half, y - half) + GetHeight(x - half, y + half));
+
+	const float midpointError = fabsf(interpolated - GetHeight(x, y));
+
+	// The halves of both triangles are split at the midpoints of the sides.
+	const float below = std::max(
+		std::max(m_errors[(y - half) * n + x], m_errors[(y + half) * n + x]),
+		std::max(m_errors[y * n + x - half], m_errors[y * n + x + half]));
+
+	m_errors[y * n + x] = midpointError + below;
+}
+
+void HeightFieldMesher::CreateMesh(float maxError, GeometryGenerator::MeshData& meshData, UINT tileCells) const
+{
+	tileCells = std::min(std::max(tileCells, 2u), m_gridCells);
+	assert((tileCells & (tileCells - 1)) == 0);
+
+	const UINT n = m_gridCells + 1;
+	const UINT s = m_gridCells;
+
+	// Triangles larger than a tile, and the roots of the tiles.
+	std::vector<UINT> corners;
+	std::vector<UINT> tileRoots;
+	AddTriangles(maxError, 0, 0, s, s, s, 0, tileCells, corners, &tileRoots);
+	AddTriangles(maxError, s, s, 0, 0, 0, s, tileCells, corners, &tileRoots);
+
+	const UINT numRoots = static_cast<UINT>(tileRoots.size() / 6);
+	std::vector<std::vector<UINT>> tileCorners(numRoots);
+	ParallelFor(m_pool, 0, numRoots, [&](UINT begin, UINT end)
+	{
+		for (UINT root = begin; root < end; ++root)
+		{
+			const UINT* t = &tileRoots[root * 6];
+			AddTriangles(maxError, t[0], t[1], t[2], t[3], t[4], t[5], tileCells, tileCorners[root], nullptr);
+		}
+	});
+
+	for (const std::vector<UINT>& tile : tileCorners)
+	{
+		corners.insert(corners.end(), tile.begin(), tile.end());
+	}
+
+	// Number the samples in use in grid order.
+	std::vector<UINT> vertexIndices(n * n, UINT_MAX);
+	for (UINT corner : corners)
+	{
+		vertexIndices[corner] = 0;
+	}
+
+	std::vector<XMFLOAT2> points;
+	std::vector<UINT> samples;
+	for (UINT k = 0; k < n * n; ++k)
+	{
+		if (vertexIndices[k] == 0)
+		{
+			vertexIndices[k] = static_cast<UINT>(samples.size());
+			samples.push_back(k);
+		}
+	}
+
+	const UINT vertexCount = static_cast<UINT>(samples.size());
+	const float dx = m_width / m_gridCells;
+	const float dz = m_depth / m_gridCells;
+	const float du = 1.0f / m_gridCells;
+
+	points.resize(vertexCount);
+	for (UINT v = 0; v < vertexCount; ++v)
+	{
+		const UINT i = samples[v] / n;
+		const UINT j = samples[v] % n;
+		points[v] = XMFLOAT2(-0.5f * m_width + j * dx, 0.5f * m_depth - i * dz);
+	}
+
+	std::vector<XMFLOAT3> normals(vertexCount);
+	m_heightField.Evaluate(points.data(), vertexCount, nullptr, normals.data(), m_pool);
+
+	meshData.Vertices.resize(vertexCount);
+	for (UINT v = 0; v < vertexCount; ++v)
+	{
+		const UINT i = samples[v] / n;
+		const UINT j = samples[v] % n;
+
+		GeometryGenerator::Vertex& vertex = meshData.Vertices[v];
+		vertex.Position = XMFLOAT3(points[v].x, m_heights[samples[v]], points[v].y);
+		vertex.Normal = normals[v];
+		vertex.TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+		vertex.TexC = XMFLOAT2(j * du, i * du);
+	}
+
+	meshData.Indices.resize(corners.size());
+	for (size_t k = 0; k < corners.size(); k += 3)
+	{
+		// Clockwise seen from above, as CreateGrid winds its triangles:
+		// columns run along +x and rows along -z.
+		const int ax = corners[k] % n, ay = corners[k] / n;
+		const int bx = corners[k + 1] % n, by = corners[k + 1] / n;
+		const int cx = corners[k + 2] % n, cy = corners[k + 2] / n;
+		const bool bClockwise = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax) > 0;
+
+		meshData.Indices[k] = vertexIndices[corners[k]];
+		meshData.Indices[k + 1] = vertexIndices[corners[bClockwise ? k + 1 : k + 2]];
+		meshData.Indices[k + 2] = vertexIndices[corners[bClockwise ? k + 2 : k + 1]];
+	}
+}
+
+void HeightFieldMesher::AddTriangles(float maxError, UINT ax, UINT ay, UINT bx, UINT by, UINT cx, UINT cy,
+	UINT tileCells, std::vector<UINT>& corners, std::vector<UINT>* tileRoots) const
+{
+	const UINT n = m_gridCells + 1;
+	const UINT mx = (ax + bx) / 2;
+	const UINT my = (ay + by) / 2;
+
+	// Legs longer than a cell and a midpoint too far off: halve it.
+	const UINT legLength = (ax > cx ? ax - cx : cx - ax) + (ay > cy ? ay - cy : cy - ay);
+	if (legLength > 1 && m_errors[my * n + mx] > maxError)
+	{
+		if (tileRoots && ax != bx && ay != by && (ax > bx ? ax - bx : bx - ax) == tileCells)
+		{
+			const UINT root[] = { ax, ay, bx, by, cx, cy };
+			tileRoots->insert(tileRoots->end(), root, root + 6);
+			return;
+		}
+
+		AddTriangles(maxError, cx, cy, ax, ay, mx, my, tileCells, corners, tileRoots);
+		AddTriangles(maxError, bx, by, cx, cy, mx, my, tileCells, corners, tileRoots);
+		return;
+	}
+
+	corners.push_back(ay * n + ax);
+	corners.push_back(by * n + bx);
+	corners.push_back(cy * n + cx);
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include "Common/GeometryGenerator.h"
+#include "Common/Heightmap.h"
+
+// Adaptive triangulation of a height field within a vertical error bound,
+// as a right-triangulated irregular network (RTIN, after Martini). The field
+// is sampled on a grid of (gridCells + 1) x (gridCells + 1) points,
+// gridCells a power of two, laid out like the hill grids. The grid is cut
+// into right triangles by halving them along the hypotenuse, over and over,
+// down to the grid spacing; a mesh keeps halving only the triangles whose
+// hypotenuse midpoint is further than the error bound from the line between
+// its ends, or that must be halved so that a neighbour can be without a
+// crack.
+//
+// The error of a midpoint is its distance from the hypotenuse plus the
+// largest error of the midpoints its triangles split at. That bounds how
+// far any sample under the triangles is from them, so a mesh is within the
+// bound everywhere, not only at the midpoints; Martini takes the larger of
+// the two instead, which is tighter but can be exceeded. The errors are
+// worked out once, a level of the triangle tree at a time and spread over
+// the worker pool. After that a mesh for any error bound is a
+// walk down the tree, split into tiles of tileCells x tileCells cells that
+// are walked in parallel. The splits only depend on the shared errors, so
+// the tiles meet without cracks.
+class HeightFieldMesher
+{
+public:
+	// Samples heightField over width x depth, centered on the origin.
+	// heightField must outlive the mesher, which reads its normals.
+	HeightFieldMesher(const HeightField& heightField, float width, float depth, UINT gridCells, WorkerPool* pool = nullptr);
+
+	// Triangles of the network within maxError of the samples, with normals
+	// from the height field, tangents along +x and texture coordinates
+	// stretched over the grid, as GeometryGenerator::CreateGrid makes them.
+	// Only vertices the triangles use are kept.
+	void CreateMesh(float maxError, GeometryGenerator::MeshData& meshData, UINT tileCells = 64) const;
+
+	UINT GetGridCells() const { return m_gridCells; }
+
+	// Bound on the height error of dropping sample (row, col), including
+	// what it takes with it. Zero for the corners, which are always kept.
+	float GetError(UINT row, UINT col) const { return m_errors[row * (m_gridCells + 1) + col]; }
+
+private:
+
+	// Error of the sample at (x, y) for the grid size of its level; y is the row.
+	void ComputeSideError(UINT x, UINT y, UINT size, bool bHorizontal);
+	void ComputeCenterError(UINT x, UINT y, UINT size);
+
+	// Appends the corners of the triangles to draw within triangle (a, b, c),
+	// c at the right angle, as grid indices. Triangles halving a square of
+	// tileCells cells are left to their tile and appended to tileRoots.
+	void AddTriangles(float maxError, UINT ax, UINT ay, UINT bx, UINT by, UINT cx, UINT cy,
+		UINT tileCells, std::vector<UINT>& corners, std::vector<UINT>* tileRoots) const;
+
+	float GetHeight(UINT x, UINT y) const { return m_heights[y * (m_gridCells + 1) + x]; }
+
+	const HeightField& m_heightField;
+	float m_width;
+	float m_depth;
+	UINT m_gridCells;
+	WorkerPool* m_pool;
+
+	std::vector<float> m_heights;
+	std::vector<float> m_errors;
+};
\ No newline at end of file
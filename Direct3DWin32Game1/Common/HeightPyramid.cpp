@@ -0,0 +1,398 @@
+#include "pch.h"
+#include "Common/HeightPyramid.h"
+#include "Common/WorkerPool.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Nodes are tested slightly larger than they are, so rays along the
+	// boundary between two nodes do not slip through both.
+	const float BoundsEpsilon = 1e-4f;
+
+	const XMFLOAT2 EmptyBounds(FLT_MAX, -FLT_MAX);
+
+	XMFLOAT2 MergeBounds(const XMFLOAT2& a, const XMFLOAT2& b)
+	{
+		return XMFLOAT2(std::min(a.x, b.x), std::max(a.y, b.y));
+	}
+
+	// Narrows [tEnter, tExit] to where origin + t * direction is within
+	// [lo, hi] along one axis.
+	bool ClipSlab(float origin, float direction, float lo, float hi, float& tEnter, float& tExit)
+	{
+		if (fabsf(direction) < 1e-20f)
+		{
+			return origin >= lo && origin <= hi;
+		}
+
+		const float invDirection = 1.0f / direction;
+		float t0 = (lo - origin) * invDirection;
+		float t1 = (hi - origin) * invDirection;
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
+
+		tEnter = std::max(tEnter, t0);
+		tExit = std::min(tExit, t1);
+		return tEnter <= tExit;
+	}
+
+	// Moller-Trumbore; t of the hit, or a negative value.
+	float IntersectTriangle(const XMFLOAT3& origin, const XMFLOAT3& direction, const XMFLOAT3& v0, const XMFLOAT3& v1, const XMFLOAT3& v2)
+	{
+		const XMVECTOR o = XMLoadFloat3(&origin);
+		const XMVECTOR d = XMLoadFloat3(&direction);
+		const XMVECTOR p0 = XMLoadFloat3(&v0);
+		const XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&v1), p0);
+		const XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&v2), p0);
+
+		const XMVECTOR p = XMVector3Cross(d, e2);
+		const float det = XMVectorGetX(XMVector3Dot(e1, p));
+		if (fabsf(det) < 1e-12f)
+			return -1.0f;
+
+		const float invDet = 1.0f / det;
+		const XMVECTOR s = XMVectorSubtract(o, p0);
+		const float u = XMVectorGetX(XMVector3Dot(s, p)) * invDet;
+		if (u < -1e-6f || u > 1.0f + 1e-6f)
+			return -1.0f;
+
+		const XMVECTOR q = XMVector3Cross(s, e1);
+		const float v = XMVectorGetX(XMVector3Dot(d, q)) * invDet;
+		if (v < -1e-6f || u + v > 1.0f + 1e-6f)
+			return -1.0f;
+
+		return XMVectorGetX(XMVector3Dot(e2, q)) * invDet;
+	}
+}
+
+void HeightPyramid::Reset(const WaveGrid& grid)
+{
+	assert(grid.numRows >= 2 && grid.numCols >= 2);
+
+	m_grid = grid;
+	m_heights.assign(grid.GetVertexCount(), 0.0f);
+	m_levels.clear();
+
+	UINT numRows = grid.numRows - 1;
+	UINT numCols = grid.numCols - 1;
+	for (;;)
+	{
+		Level level;
+		level.numRows = numRows;
+		level.numCols = numCols;
+		level.bounds.assign(numRows * numCols, EmptyBounds);
+		level.changedRows.assign(numRows, 0);
+		m_levels.push_back(std::move(level));
+
+		if (numRows == 1 && numCols == 1)
+			break;
+
+		numRows = (numRows + 1) / 2;
+		numCols = (numCols + 1) / 2;
+	}
+}
+
+void HeightPyramid::Build(const WaveGrid& grid, const float* heights)
+{
+	Reset(grid);
+	Update(heights, 0, grid.numRows, 0, grid.numCols);
+}
+
+void HeightPyramid::Update(const float* heights, UINT rowBegin, UINT rowEnd, UINT colBegin, UINT colEnd)
+{
+	const UINT n = m_grid.numCols;
+	rowEnd = std::min(rowEnd, m_grid.numRows);
+	colEnd = std::min(colEnd, n);
+	if (rowBegin >= rowEnd || colBegin >= colEnd)
+		return;
+
+	for (UINT i = rowBegin; i < rowEnd; ++i)
+	{
+		memcpy(&m_heights[i * n + colBegin], &heights[i * n + colBegin], sizeof(float) * (colEnd - colBegin));
+	}
+
+	// Cells touching a changed point.
+	Level& cells = m_levels[0];
+	const UINT cellRowBegin = rowBegin > 0 ? rowBegin - 1 : 0;
+	const UINT cellRowEnd = std::min(rowEnd, cells.numRows);
+	const UINT cellColBegin = colBegin > 0 ? colBegin - 1 : 0;
+	const UINT cellColEnd = std::min(colEnd, cells.numCols);
+
+	for (UINT i = cellRowBegin; i < cellRowEnd; ++i)
+	{
+		const float* row = &m_heights[i * n];
+		const float* below = row + n;
+		for (UINT j = cellColBegin; j < cellColEnd; ++j)
+		{
+			const XMFLOAT2 bounds(
+				std::min(std::min(row[j], row[j + 1]), std::min(below[j], below[j + 1])),
+				std::max(std::max(row[j], row[j + 1]), std::max(below[j], below[j + 1])));
+
+			XMFLOAT2& cell = cells.bounds[i * cells.numCols + j];
+			if (cell.x != bounds.x || cell.y != bounds.y)
+			{
+				cell = bounds;
+				cells.changedRows[i] = 1;
+			}
+		}
+	}
+
+	Refit();
+}
+
+void HeightPyramid::UpdateCellRow(UINT i, const float* row, const float* below)
+{
+	const UINT n = m_grid.numCols;
+	assert(i + 1 < m_grid.numRows);
+
+	// Each call owns point row i; the last row belongs to the last cell row.
+	memcpy(&m_heights[i * n], row, sizeof(float) * n);
+	if (i + 2 == m_grid.numRows)
+	{
+		memcpy(&m_heights[(i + 1) * n], below, sizeof(float) * n);
+	}
+
+	Level& cells = m_levels[0];
+	XMFLOAT2* rowBounds = &cells.bounds[i * cells.numCols];
+	bool bChanged = false;
+	for (UINT j = 0; j < cells.numCols; ++j)
+	{
+		const XMFLOAT2 bounds(
+			std::min(std::min(row[j], row[j + 1]), std::min(below[j], below[j + 1])),
+			std::max(std::max(row[j], row[j + 1]), std::max(below[j], below[j + 1])));
+
+		bChanged = bChanged || rowBounds[j].x != bounds.x || rowBounds[j].y != bounds.y;
+		rowBounds[j] = bounds;
+	}
+
+	if (bChanged)
+	{
+		cells.changedRows[i] = 1;
+	}
+}
+
+void HeightPyramid::Refit()
+{
+	for (UINT level = 1; level < m_levels.size(); ++level)
+	{
+		Level& children = m_levels[level - 1];
+		for (UINT row = 0; row < m_levels[level].numRows; ++row)
+		{
+			const bool bChildChanged = children.changedRows[2 * row] ||
+				(2 * row + 1 < children.numRows && children.changedRows[2 * row + 1]);
+
+			if (bChildChanged && RefitRow(level, row))
+			{
+				m_levels[level].changedRows[row] = 1;
+			}
+		}
+		std::fill(children.changedRows.begin(), children.changedRows.end(), BYTE(0));
+	}
+	std::fill(m_levels.back().changedRows.begin(), m_levels.back().changedRows.end(), BYTE(0));
+}
+
+bool HeightPyramid::RefitRow(UINT level, UINT row)
+{
+	const Level& children = m_levels[level - 1];
+	Level& parents = m_levels[level];
+
+	const XMFLOAT2* childRow0 = &children.bounds[(2 * row) * children.numCols];
+	const XMFLOAT2* childRow1 = 2 * row + 1 < children.numRows ? childRow0 + children.numCols : childRow0;
+
+	bool bChanged = false;
+	for (UINT col = 0; col < parents.numCols; ++col)
+	{
+		const UINT c0 = 2 * col;
+		const UINT c1 = std::min(c0 + 1, children.numCols - 1);
+		const XMFLOAT2 bounds = MergeBounds(
+			MergeBounds(childRow0[c0], childRow0[c1]),
+			MergeBounds(childRow1[c0], childRow1[c1]));
+
+		XMFLOAT2& parent = parents.bounds[row * parents.numCols + col];
+		bChanged = bChanged || parent.x != bounds.x || parent.y != bounds.y;
+		parent = bounds;
+	}
+	return bChanged;
+}
+
+bool HeightPyramid::Intersect(const HeightRay& ray, HeightRayHit& hit) const
+{
+	hit = HeightRayHit();
+	if (m_levels.empty())
+		return false;
+
+	// The ray in cell units: u along columns, v along rows.
+	const float invStep = 1.0f / m_grid.spatialStep;
+	const float originU = (ray.origin.x + m_grid.halfWidth) * invStep;
+	const float originV = (m_grid.halfDepth - ray.origin.z) * invStep;
+	const float directionU = ray.direction.x * invStep;
+	const float directionV = -ray.direction.z * invStep;
+
+	// Children are visited nearest first: the one on the side the ray comes
+	// from in both directions, the two beside it, then the far one. A ray
+	// crosses at most three of them, so this is front to back.
+	const UINT nearCol = directionU >= 0.0f ? 0 : 1;
+	const UINT nearRow = directionV >= 0.0f ? 0 : 1;
+	const UINT childOrder[4][2] =
+	{
+		{ nearRow, nearCol },
+		{ nearRow, 1 - nearCol },
+		{ 1 - nearRow, nearCol },
+		{ 1 - nearRow, 1 - nearCol },
+	};
+
+	struct Node
+	{
+		UINT level;
+		UINT row;
+		UINT col;
+	};
+
+	// Each level adds at most three nodes to the stack.
+	Node stack[3 * 32 + 1];
+	UINT stackSize = 0;
+	stack[stackSize++] = { GetLevelCount() - 1, 0, 0 };
+
+	const UINT numCellRows = m_levels[0].numRows;
+	const UINT numCellCols = m_levels[0].numCols;
+
+	while (stackSize > 0)
+	{
+		const Node node = stack[--stackSize];
+
+		const XMFLOAT2& bounds = GetBounds(node.level, node.row, node.col);
+		if (bounds.x > bounds.y)
+			continue;
+
+		const float u0 = float(node.col << node.level);
+		const float u1 = float(std::min((node.col + 1) << node.level, numCellCols));
+		const float v0 = float(node.row << node.level);
+		const float v1 = float(std::min((node.row + 1) << node.level, numCellRows));
+		const float yEpsilon = BoundsEpsilon * (1.0f + bounds.y - bounds.x);
+
+		float tEnter = 0.0f;
+		float tExit = ray.maxDistance;
+		if (!ClipSlab(originU, directionU, u0 - BoundsEpsilon, u1 + BoundsEpsilon, tEnter, tExit) ||
+			!ClipSlab(originV, directionV, v0 - BoundsEpsilon, v1 + BoundsEpsilon, tEnter, tExit) ||
+			!ClipSlab(ray.origin.y, ray.direction.y, bounds.x - yEpsilon, bounds.y + yEpsilon, tEnter, tExit))
+		{
+			continue;
+		}
+
+		if (node.level == 0)
+		{
+			// Nodes come front to back, so the first cell hit holds the first hit.
+			if (IntersectCell(ray, node.row, node.col, ray.maxDistance, hit))
+				return true;
+			continue;
+		}
+
+		const Level& children = m_levels[node.level - 1];
+		for (int k = 3; k >= 0; --k)
+		{
+			const UINT row = 2 * node.row + childOrder[k][0];
+			const UINT col = 2 * node.col + childOrder[k][1];
+			if (row < children.numRows && col < children.numCols)
+			{
+				stack[stackSize++] = { node.level - 1, row, col };
+			}
+		}
+	}
+
+	return false;
+}
+
+void HeightPyramid::Intersect(const HeightRay* rays, UINT count, HeightRayHit* hits, WorkerPool* pool) const
+{
+	auto task = [&](UINT begin, UINT end)
+	{
+		for (UINT i = begin; i < end; ++i)
+		{
+			Intersect(rays[i], hits[i]);
+		}
+	};
+
+	if (pool)
+	{
+		pool->ParallelFor(0, count, task);
+	}
+	else
+	{
+		task(0, count);
+	}
+}
+
+bool HeightPyramid::Intersect(const HeightRay& ray, const XMFLOAT4X4& world, HeightRayHit& hit) const
+{
+	const XMMATRIX toWorld = XMLoadFloat4x4(&world);
+	XMVECTOR det = XMMatrixDeterminant(toWorld);
+	const XMMATRIX toGrid = XMMatrixInverse(&det, toWorld);
+
+	// Affine maps keep the ray parameter, so the distance carries over as is.
+	HeightRay gridRay = ray;
+	XMStoreFloat3(&gridRay.origin, XMVector3TransformCoord(XMLoadFloat3(&ray.origin), toGrid));
+	XMStoreFloat3(&gridRay.direction, XMVector3TransformNormal(XMLoadFloat3(&ray.direction), toGrid));
+
+	if (!Intersect(gridRay, hit))
+		return false;
+
+	XMStoreFloat3(&hit.position, XMVector3TransformCoord(XMLoadFloat3(&hit.position), toWorld));
+	XMStoreFloat3(&hit.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&hit.normal), XMMatrixTranspose(toGrid))));
+	return true;
+}
+
+bool HeightPyramid::IntersectCell(const HeightRay& ray, UINT row, UINT col, float tMax, HeightRayHit& hit) const
+{
+	// The two triangles of MeshCache::BuildGridIndices.
+	const XMFLOAT3 p00 = GetPoint(row, col);
+	const XMFLOAT3 p01 = GetPoint(row, col + 1);
+	const XMFLOAT3 p10 = GetPoint(row + 1, col);
+	const XMFLOAT3 p11 = GetPoint(row + 1, col + 1);
+	const XMFLOAT3* triangles[2][3] =
+	{
+		{ &p00, &p01, &p10 },
+		{ &p10, &p01, &p11 },
+	};
+
+	bool bHit = false;
+	for (UINT k = 0; k < 2; ++k)
+	{
+		const XMFLOAT3& v0 = *triangles[k][0];
+		const XMFLOAT3& v1 = *triangles[k][1];
+		const XMFLOAT3& v2 = *triangles[k][2];
+
+		const float t = IntersectTriangle(ray.origin, ray.direction, v0, v1, v2);
+		if (t < 0.0f || t > tMax)
+			continue;
+
+		tMax = t;
+		bHit = true;
+
+		XMVECTOR normal = XMVector3Normalize(XMVector3Cross(
+			XMVectorSubtract(XMLoadFloat3(&v1), XMLoadFloat3(&v0)),
+			XMVectorSubtract(XMLoadFloat3(&v2), XMLoadFloat3(&v0))));
+		if (XMVectorGetY(normal) < 0.0f)
+		{
+			normal = XMVectorNegate(normal);
+		}
+
+		hit.bHit = true;
+		hit.distance = t;
+		hit.position = XMFLOAT3(
+			ray.origin.x + t * ray.direction.x,
+			ray.origin.y + t * ray.direction.y,
+			ray.origin.z + t * ray.direction.z);
+		XMStoreFloat3(&hit.normal, normal);
+		hit.row = row;
+		hit.col = col;
+	}
+	return bHit;
+}
+
+XMFLOAT3 HeightPyramid::GetPoint(UINT row, UINT col) const
+{
+	return XMFLOAT3(m_grid.GetX(col), m_heights[row * m_grid.numCols + col], m_grid.GetZ(row));
+}
\ No newline at end of file
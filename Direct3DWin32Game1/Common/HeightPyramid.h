@@ -0,0 +1,106 @@
+#pragma once
+#include "Common/WaveSolver.h"
+#include <cfloat>
+#include <vector>
+
+class WorkerPool;
+
+struct HeightRay
+{
+	DirectX::XMFLOAT3 origin;
+	DirectX::XMFLOAT3 direction;
+	// Hits further than this many lengths of direction are ignored.
+	float maxDistance = FLT_MAX;
+};
+
+struct HeightRayHit
+{
+	bool bHit = false;
+	// Ray parameter of the hit, in lengths of the ray direction.
+	float distance = FLT_MAX;
+	DirectX::XMFLOAT3 position;
+	// Normal of the triangle hit, facing +y.
+	DirectX::XMFLOAT3 normal;
+	// Cell hit: the quad between points (row, col) and (row + 1, col + 1).
+	UINT row = 0;
+	UINT col = 0;
+};
+
+// Minimum and maximum heights over a height grid laid out like WaveGrid, in
+// a pyramid of levels: level 0 holds the bounds of every cell, and each
+// further level the bounds of 2 x 2 nodes of the level below, up to a single
+// node over the whole grid. Rays are intersected with the surface the grid
+// meshes draw, two triangles per cell split as in
+// MeshCache::BuildGridIndices, and march down the pyramid front to back,
+// only visiting nodes whose height range the ray passes through. A ray over
+// flat regions skips whole blocks of cells at once.
+//
+// Changed heights are folded in incrementally: only leaf rows whose bounds
+// changed are refitted up the pyramid.
+class HeightPyramid
+{
+public:
+	// Sizes the pyramid for grid, with every node empty until heights come in.
+	void Reset(const WaveGrid& grid);
+
+	// Reset, then the bounds of all of heights, numRows x numCols row by row.
+	void Build(const WaveGrid& grid, const float* heights);
+
+	// Refits after the points in [rowBegin, rowEnd) x [colBegin, colEnd) of
+	// heights changed.
+	void Update(const float* heights, UINT rowBegin, UINT rowEnd, UINT colBegin, UINT colEnd);
+
+	// Recomputes the cells between point rows i and i + 1 from those rows,
+	// e.g. from a WaveSolver::RowWriter, for i < numRows - 1. May be called
+	// for different rows at the same time. The coarser levels follow on the
+	// next Refit.
+	void UpdateCellRow(UINT i, const float* row, const float* below);
+
+	// Brings the coarser levels up to date with the cell rows that changed.
+	void Refit();
+
+	// First hit of ray with the surface, in the space of the grid. Misses
+	// before the first Reset.
+	bool Intersect(const HeightRay& ray, HeightRayHit& hit) const;
+
+	// Intersect for count rays, spread over pool when given.
+	void Intersect(const HeightRay* rays, UINT count, HeightRayHit* hits, WorkerPool* pool = nullptr) const;
+
+	// Intersect with ray and hit in the space world takes the grid to, e.g.
+	// world space for the world matrix of the object drawing the grid.
+	bool Intersect(const HeightRay& ray, const DirectX::XMFLOAT4X4& world, HeightRayHit& hit) const;
+
+	const WaveGrid& GetGrid() const { return m_grid; }
+	UINT GetLevelCount() const { return static_cast<UINT>(m_levels.size()); }
+
+	// Height range below a node; empty (min > max) before any heights came in.
+	const DirectX::XMFLOAT2& GetBounds(UINT level, UINT row, UINT col) const
+	{
+		return m_levels[level].bounds[row * m_levels[level].numCols + col];
+	}
+
+private:
+
+	struct Level
+	{
+		UINT numRows;
+		UINT numCols;
+		std::vector<DirectX::XMFLOAT2> bounds;
+		// Rows whose bounds changed since the last Refit.
+		std::vector<BYTE> changedRows;
+	};
+
+	// Recomputes row of level from the two rows below it.
+	bool RefitRow(UINT level, UINT row);
+
+	bool IntersectCell(const HeightRay& ray, UINT row, UINT col, float tMax, HeightRayHit& hit) const;
+
+	DirectX::XMFLOAT3 GetPoint(UINT row, UINT col) const;
+
+	WaveGrid m_grid;
+
+	// Heights the cells were built from, kept for the triangle tests.
+	std::vector<float> m_heights;
+
+	std::vector<Level> m_levels;
+};
\ No newline at end of file
@@ -0,0 +1,300 @@
+#include "pch.h"
+#include "Common/Heightmap.h"
+#include "Common/WorkerPool.h"
+
+using namespace DirectX;
+
+XMFLOAT3 HeightField::GetNormal(float x, float z) const
+{
+	const float step = GetNormalStep();
+
+	// n = (-dh/dx, 1, -dh/dz)
+	XMFLOAT3 n(
+		(GetHeight(x - step, z) - GetHeight(x + step, z)) / (2.0f * step),
+		1.0f,
+		(GetHeight(x, z - step) - GetHeight(x, z + step)) / (2.0f * step));
+
+	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
+	XMStoreFloat3(&n, unitNormal);
+
+	return n;
+}
+
+void HeightField::Evaluate(const XMFLOAT2* points, UINT count, float* heights, XMFLOAT3* normals, WorkerPool* pool) const
+{
+	if (pool && count >= MinParallelPoints)
+	{
+		// Bands of whole groups of four, so vectorized overrides only see a
+		// partial group at the very end.
+		const UINT numGroups = (count + 3) / 4;
+		pool->ParallelFor(0, numGroups, [&](UINT groupBegin, UINT groupEnd)
+		{
+			const UINT begin = groupBegin * 4;
+			const UINT end = std::min(groupEnd * 4, count);
+			EvaluatePoints(points + begin, end - begin, heights ? heights + begin : nullptr, normals ? normals + begin : nullptr);
+		});
+	}
+	else
+	{
+		EvaluatePoints(points, count, heights, normals);
+	}
+}
+
+void HeightField::EvaluatePoints(const XMFLOAT2* points, UINT count, float* heights, XMFLOAT3* normals) const
+{
+	for (UINT i = 0; i < count; ++i)
+	{
+		if (heights)
+		{
+			heights[i] = GetHeight(points[i].x, points[i].y);
+		}
+		if (normals)
+		{
+			normals[i] = GetNormal(points[i].x, points[i].y);
+		}
+	}
+}
+
+MappedHeightmap::MappedHeightmap(
+	const std::wstring& fileName,
+	HeightmapFormat format,
+	UINT numRows,
+	UINT numCols,
+	float width,
+	float depth,
+	float heightScale,
+	float heightOffset,
+	size_t residentBudget)
+	: m_format(format)
+	, m_numRows(numRows)
+	, m_numCols(numCols)
+	, m_width(width)
+	, m_depth(depth)
+	, m_heightScale(heightScale)
+	, m_heightOffset(heightOffset)
+	, m_residentBudget(residentBudget)
+{
+	assert(numRows >= 2 && numCols >= 2);
+
+	m_spacing = std::min(width / (numCols - 1), depth / (numRows - 1));
+
+	m_sampleBytes = format == HeightmapFormat::R16 ? sizeof(USHORT) : sizeof(float);
+	m_rowBytes = m_sampleBytes * numCols;
+	m_pageRows = static_cast<UINT>(std::max<size_t>(1, TargetPageBytes / m_rowBytes));
+	m_pageRows = std::min(m_pageRows, numRows);
+	m_numPages = (numRows + m_pageRows - 1) / m_pageRows;
+	m_pages.reset(new Page[m_numPages]);
+	m_zeroRow.assign(m_rowBytes, 0);
+
+	// Views have to start on a multiple of the allocation granularity.
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	m_granularity = systemInfo.dwAllocationGranularity;
+
+	m_file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		DX::ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()));
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_file, &fileSize) || UINT64(fileSize.QuadPart) < UINT64(m_rowBytes) * numRows)
+	{
+		CloseHandle(m_file);
+		DX::ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_HANDLE_EOF));
+	}
+
+	m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_mapping)
+	{
+		const DWORD error = GetLastError();
+		CloseHandle(m_file);
+		DX::ThrowIfFailed(HRESULT_FROM_WIN32(error));
+	}
+}
+
+MappedHeightmap::~MappedHeightmap()
+{
+	for (UINT i = 0; i < m_numPages; ++i)
+	{
+		if (m_pages[i].view)
+		{
+			UnmapViewOfFile(m_pages[i].view);
+		}
+	}
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+}
+
+float MappedHeightmap::GetHeight(float x, float z) const
+{
+	// Continuous sample coordinates, clamped to the map.
+	float col = (x + 0.5f * m_width) / m_width * (m_numCols - 1);
+	float row = (0.5f * m_depth - z) / m_depth * (m_numRows - 1);
+	col = std::min(std::max(col, 0.0f), float(m_numCols - 1));
+	row = std::min(std::max(row, 0.0f), float(m_numRows - 1));
+
+	const UINT c = std::min(UINT(col), m_numCols - 2);
+	const UINT r = std::min(UINT(row), m_numRows - 2);
+	const float s = col - c;
+	const float t = row - r;
+
+	Page* page0;
+	Page* page1;
+	const BYTE* row0 = PinRow(r, page0);
+	const BYTE* row1 = PinRow(r + 1, page1);
+
+	const float h0 = Decode(row0, c) + s * (Decode(row0, c + 1) - Decode(row0, c));
+	const float h1 = Decode(row1, c) + s * (Decode(row1, c + 1) - Decode(row1, c));
+
+	Unpin(page0);
+	Unpin(page1);
+
+	return h0 + t * (h1 - h0);
+}
+
+float MappedHeightmap::GetSample(UINT row, UINT col) const
+{
+	row = std::min(row, m_numRows - 1);
+	col = std::min(col, m_numCols - 1);
+
+	Page* page;
+	const float height = Decode(PinRow(row, page), col);
+	Unpin(page);
+
+	return height;
+}
+
+void MappedHeightmap::SetResidentBudget(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_residentBudget = bytes;
+	EvictPages(UINT_MAX);
+}
+
+size_t MappedHeightmap::GetResidentBytes() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_residentBytes;
+}
+
+UINT MappedHeightmap::GetResidentPageCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_residentPages;
+}
+
+const BYTE* MappedHeightmap::PinRow(UINT row, Page*& page) const
+{
+	const UINT pageIndex = row / m_pageRows;
+	page = &m_pages[pageIndex];
+
+	for (;;)
+	{
+		// Pins before looking at the rows. EvictPages clears the rows before
+		// looking at the pins, so one of the two always sees the other.
+		page->pins.fetch_add(1);
+		const BYTE* rows = page->rows.load();
+		if (rows)
+		{
+			// Only written when it changes, to keep pages that are read from
+			// many threads out of each other's caches.
+			const UINT64 now = m_useClock.load(std::memory_order_relaxed);
+			if (page->lastUse.load(std::memory_order_relaxed) != now)
+			{
+				page->lastUse.store(now, std::memory_order_relaxed);
+			}
+			return rows + size_t(row - pageIndex * m_pageRows) * m_rowBytes;
+		}
+		page->pins.fetch_sub(1);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!page->view && !MapPage(pageIndex))
+		{
+			// Zero samples rather than an exception, see Heightmap.h.
+			page = nullptr;
+			return m_zeroRow.data();
+		}
+	}
+}
+
+bool MappedHeightmap::MapPage(UINT pageIndex) const
+{
+	Page& page = m_pages[pageIndex];
+
+	const UINT firstRow = pageIndex * m_pageRows;
+	const UINT numRows = std::min(m_pageRows, m_numRows - firstRow);
+	const UINT64 rowsOffset = UINT64(firstRow) * m_rowBytes;
+	const UINT64 viewOffset = rowsOffset - rowsOffset % m_granularity;
+	const size_t viewBytes = size_t(rowsOffset - viewOffset + UINT64(numRows) * m_rowBytes);
+
+	void* view = MapViewOfFile(m_mapping, FILE_MAP_READ, DWORD(viewOffset >> 32), DWORD(viewOffset & 0xFFFFFFFF), viewBytes);
+	if (!view)
+	{
+		m_bMapFailed = true;
+		return false;
+	}
+
+	page.view = view;
+	page.viewBytes = viewBytes;
+	page.lastUse.store(m_useClock.fetch_add(1) + 1, std::memory_order_relaxed);
+	page.rows.store(static_cast<const BYTE*>(view) + (rowsOffset - viewOffset));
+
+	m_residentBytes += viewBytes;
+	++m_residentPages;
+
+	EvictPages(pageIndex);
+	return true;
+}
+
+void MappedHeightmap::EvictPages(UINT keepPage) const
+{
+	if (m_residentBytes <= m_residentBudget)
+		return;
+
+	// Mapped pages from least to most recently used.
+	std::vector<std::pair<UINT64, UINT>> candidates;
+	for (UINT i = 0; i < m_numPages; ++i)
+	{
+		if (i != keepPage && m_pages[i].view)
+		{
+			candidates.push_back(std::make_pair(m_pages[i].lastUse.load(std::memory_order_relaxed), i));
+		}
+	}
+	std::sort(candidates.begin(), candidates.end());
+
+	for (size_t i = 0; i < candidates.size() && m_residentBytes > m_residentBudget; ++i)
+	{
+		Page& page = m_pages[candidates[i].second];
+
+		// A page somebody is reading stays. The rows are cleared before the
+		// pins are checked, see PinRow.
+		const BYTE* rows = page.rows.exchange(nullptr);
+		if (page.pins.load() > 0)
+		{
+			page.rows.store(rows);
+			continue;
+		}
+
+		UnmapViewOfFile(page.view);
+		m_residentBytes -= page.viewBytes;
+		--m_residentPages;
+		page.view = nullptr;
+		page.viewBytes = 0;
+	}
+}
+
+float MappedHeightmap::Decode(const BYTE* row, UINT col) const
+{
+	const BYTE* sample = row + col * m_sampleBytes;
+	if (m_format == HeightmapFormat::R16)
+	{
+		USHORT value;
+		memcpy(&value, sample, sizeof(value));
+		return m_heightOffset + m_heightScale * (value * (1.0f / 65535.0f));
+	}
+
+	float value;
+	memcpy(&value, sample, sizeof(value));
+	return m_heightOffset + m_heightScale * value;
+}
\ No newline at end of file
@@ -0,0 +1,174 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+// Height and normal queries over the xz plane, shared by the analytic hill
+// and heightmaps read from disk.
+class HeightField
+{
+public:
+	virtual ~HeightField() = default;
+
+	virtual float GetHeight(float x, float z) const = 0;
+
+	// n = (-dh/dx, 1, -dh/dz), normalized. Central differences over
+	// GetNormalStep() by default.
+	virtual DirectX::XMFLOAT3 GetNormal(float x, float z) const;
+
+	// Heights and normals of count points, with x and z of each point in x
+	// and y of points. Either output may be null. Batches of at least
+	// MinParallelPoints points are split over pool when given.
+	void Evaluate(const DirectX::XMFLOAT2* points, UINT count, float* heights, DirectX::XMFLOAT3* normals, WorkerPool* pool = nullptr) const;
+
+	static const UINT MinParallelPoints = 16384;
+
+protected:
+	virtual float GetNormalStep() const { return 1.0f; }
+
+	// Evaluate on the calling thread. One GetHeight and GetNormal per point
+	// by default.
+	virtual void EvaluatePoints(const DirectX::XMFLOAT2* points, UINT count, float* heights, DirectX::XMFLOAT3* normals) const;
+};
+
+// Sample format of a raw heightmap. R16 is unsigned and normalized to [0, 1]
+// before the height scale is applied.
+enum class HeightmapFormat
+{
+	R16,
+	R32F,
+};
+
+// Raw heightmap file of numRows x numCols samples, row by row with no
+// header, mapped into memory a page at a time. A page is a band of whole
+// rows, which is what a row major file can map in one view. Pages are mapped
+// the first time a sample in them is read; when the mapped pages exceed the
+// resident budget, the least recently used ones are unmapped again, so maps
+// far larger than memory, or than the address space of a 32 bit build, can
+// be sampled anywhere.
+//
+// The map covers width x depth centered on the origin, with row 0 at +z and
+// column 0 at -x, as the hill grids are laid out. Heights are bilinear
+// between samples. Queries may run on several threads at once; only page
+// misses take a lock. Queries never throw, as they run on worker and loader
+// threads: samples of a page that cannot be mapped, e.g. when the address
+// space runs out, read as 0, which gives heightOffset, and set HasMapFailed.
+// Only the constructor throws, when the file cannot be opened.
+class MappedHeightmap : public HeightField
+{
+public:
+	MappedHeightmap(
+		const std::wstring& fileName,
+		HeightmapFormat format,
+		UINT numRows,
+		UINT numCols,
+		float width,
+		float depth,
+		float heightScale = 1.0f,
+		float heightOffset = 0.0f,
+		size_t residentBudget = 256 << 20);
+	virtual ~MappedHeightmap();
+
+	MappedHeightmap(const MappedHeightmap&) = delete;
+	MappedHeightmap& operator=(const MappedHeightmap&) = delete;
+
+	virtual float GetHeight(float x, float z) const override;
+
+	// Height of sample (row, col), clamped to the map.
+	float GetSample(UINT row, UINT col) const;
+
+	UINT GetRowCount() const { return m_numRows; }
+	UINT GetColCount() const { return m_numCols; }
+	float GetWidth() const { return m_width; }
+	float GetDepth() const { return m_depth; }
+
+	// Bytes of the file that may stay mapped. Pages being read when the budget
+	// is enforced stay mapped, so at least one page per reading thread may.
+	void SetResidentBudget(size_t bytes);
+	size_t GetResidentBudget() const { return m_residentBudget; }
+
+	size_t GetResidentBytes() const;
+	UINT GetResidentPageCount() const;
+
+	// Whether a page failed to map since the map was opened, so some
+	// heights read were wrong. Later reads try to map the page again.
+	bool HasMapFailed() const { return m_bMapFailed; }
+
+	// Rows per page, chosen so a page maps about this many bytes.
+	static const size_t TargetPageBytes = 4 << 20;
+
+protected:
+	virtual float GetNormalStep() const override { return m_spacing; }
+
+private:
+
+	struct Page
+	{
+		// First sample of the first row of the page, null while unmapped.
+		std::atomic<const BYTE*> rows{ nullptr };
+
+		// Readers inside the page; a pinned page is never unmapped.
+		std::atomic<UINT> pins{ 0 };
+
+		// Value of m_useClock when the page was last read.
+		std::atomic<UINT64> lastUse{ 0 };
+
+		// Start of the view, which begins on an allocation granularity
+		// boundary at or before the rows.
+		void* view = nullptr;
+		size_t viewBytes = 0;
+	};
+
+	// Pins the page of row and returns the row, mapping the page if needed.
+	// Returns m_zeroRow and a null page when the page cannot be mapped.
+	const BYTE* PinRow(UINT row, Page*& page) const;
+	void Unpin(Page* page) const { if (page) page->pins.fetch_sub(1); }
+
+	// Maps a page, and unmaps others until the budget holds. Called with
+	// m_mutex held. False when the view could not be mapped.
+	bool MapPage(UINT pageIndex) const;
+	void EvictPages(UINT keepPage) const;
+
+	float Decode(const BYTE* row, UINT col) const;
+
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+
+	HeightmapFormat m_format;
+	UINT m_numRows;
+	UINT m_numCols;
+	float m_width;
+	float m_depth;
+	float m_heightScale;
+	float m_heightOffset;
+
+	// Distance between samples, the smaller of both directions.
+	float m_spacing;
+
+	size_t m_sampleBytes;
+	size_t m_rowBytes;
+	UINT m_pageRows;
+	UINT m_numPages;
+	UINT64 m_granularity;
+
+	size_t m_residentBudget;
+
+	std::unique_ptr<Page[]> m_pages;
+
+	// A row of zero samples, read in place of rows that failed to map.
+	std::vector<BYTE> m_zeroRow;
+	mutable std::atomic<bool> m_bMapFailed{ false };
+
+	// Guards mapping and unmapping, and the counters below.
+	mutable std::mutex m_mutex;
+	mutable size_t m_residentBytes = 0;
+	mutable UINT m_residentPages = 0;
+
+	// Advances on every page miss, which is often enough to tell recently
+	// used pages from old ones.
+	mutable std::atomic<UINT64> m_useClock{ 1 };
+};
\ No newline at end of file
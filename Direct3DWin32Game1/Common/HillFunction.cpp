@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "Common/HillFunction.h"
+
+using namespace DirectX;
+
+float HillFunction::GetHeight(float x, float z) const
+{
+	return 0.3f*(z*sinf(0.1f*x) + x * cosf(0.1f*z));
+}
+
+XMFLOAT3 HillFunction::GetNormal(float x, float z) const
+{
+	// n = (-df/dx, 1, -df/dz)
+	XMFLOAT3 n(
+		-0.03f*z*cosf(0.1f*x) - 0.3f*cosf(0.1f*z),
+		1.0f,
+		-0.3f*sinf(0.1f*x) + 0.03f*x*sinf(0.1f*z));
+
+	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
+	XMStoreFloat3(&n, unitNormal);
+
+	return n;
+}
+
+const HillFunction& HillFunction::GetDefault()
+{
+	static const HillFunction hill;
+	return hill;
+}
+
+void HillFunction::EvaluatePoints(const XMFLOAT2* points, UINT count, float* heights, XMFLOAT3* normals) const
+{
+	const XMVECTOR frequency = XMVectorReplicate(0.1f);
+	const XMVECTOR amplitude = XMVectorReplicate(0.3f);
+	const XMVECTOR slope = XMVectorReplicate(0.03f);
+	const XMVECTOR one = XMVectorReplicate(1.0f);
+
+	for (UINT i = 0; i < count; i += 4)
+	{
+		// Lanes past the end of the batch repeat the last point.
+		XMFLOAT2 group[4];
+		const UINT numLanes = std::min(4u, count - i);
+		for (UINT lane = 0; lane < 4; ++lane)
+		{
+			group[lane] = points[i + std::min(lane, numLanes - 1)];
+		}
+
+		// xzxz pairs to x and z vectors.
+		const XMVECTOR xz01 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&group[0]));
+		const XMVECTOR xz23 = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&group[2]));
+		const XMVECTOR x = XMVectorPermute<XM_PERMUTE_0X, XM_PERMUTE_0Z, XM_PERMUTE_1X, XM_PERMUTE_1Z>(xz01, xz23);
+		const XMVECTOR z = XMVectorPermute<XM_PERMUTE_0Y, XM_PERMUTE_0W, XM_PERMUTE_1Y, XM_PERMUTE_1W>(xz01, xz23);
+
+		XMVECTOR sinX, cosX, sinZ, cosZ;
+		XMVectorSinCos(&sinX, &cosX, XMVectorMultiply(frequency, x));
+		XMVectorSinCos(&sinZ, &cosZ, XMVectorMultiply(frequency, z));
+
+		if (heights)
+		{
+			XMFLOAT4 h;
+			XMStoreFloat4(&h, XMVectorMultiply(amplitude, XMVectorMultiplyAdd(z, sinX, XMVectorMultiply(x, cosZ))));
+
+			const float* lanes = &h.x;
+			for (UINT lane = 0; lane < numLanes; ++lane)
+			{
+				heights[i + lane] = lanes[lane];
+			}
+		}
+
+		if (normals)
+		{
+			// n = (-df/dx, 1, -df/dz)
+			const XMVECTOR nx = XMVectorNegate(XMVectorMultiplyAdd(slope, XMVectorMultiply(z, cosX), XMVectorMultiply(amplitude, cosZ)));
+			const XMVECTOR nz = XMVectorNegativeMultiplySubtract(amplitude, sinX, XMVectorMultiply(slope, XMVectorMultiply(x, sinZ)));
+			const XMVECTOR scale = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(nx, nx, XMVectorMultiplyAdd(nz, nz, one)));
+
+			XMFLOAT4 normal[3];
+			XMStoreFloat4(&normal[0], XMVectorMultiply(nx, scale));
+			XMStoreFloat4(&normal[1], scale);
+			XMStoreFloat4(&normal[2], XMVectorMultiply(nz, scale));
+
+			const float* n0 = &normal[0].x;
+			const float* n1 = &normal[1].x;
+			const float* n2 = &normal[2].x;
+			for (UINT lane = 0; lane < numLanes; ++lane)
+			{
+				normals[i + lane] = XMFLOAT3(n0[lane], n1[lane], n2[lane]);
+			}
+		}
+	}
+}
\ No newline at end of file
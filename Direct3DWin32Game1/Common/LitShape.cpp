@@ -52,10 +52,8 @@ void LitShape::Initialize(
 void LitShape::Render()
 {
 	m_d3dContext->IASetInputLayout(m_inputLayout.Get());
-	UINT stride = sizeof(VertexType);
-	UINT offset = 0;
-	m_d3dContext->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
-	m_d3dContext->IASetIndexBuffer(m_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	SetVertexBuffers();
+	m_d3dContext->IASetIndexBuffer(m_indexBuffer.Get(), m_indexFormat, 0);
 	m_d3dContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	m_d3dContext->VSSetConstantBuffers(1, 1, m_constantBufferPerObject.GetAddressOf());
 	m_d3dContext->VSSetShader(m_vertexShader.Get(), nullptr, 0);
@@ -67,6 +65,18 @@ void LitShape::Render()
 	m_d3dContext->PSSetShaderResources(0, 1, m_diffuseMapView.GetAddressOf());
 #endif
 
+	Draw();
+}
+
+void LitShape::SetVertexBuffers()
+{
+	UINT stride = sizeof(VertexType);
+	UINT offset = 0;
+	m_d3dContext->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
+}
+
+void LitShape::Draw()
+{
 	m_d3dContext->DrawIndexed(m_indexCount, 0, 0);
 }
 
@@ -110,7 +120,12 @@ void LitShape::BuildMaterial()
 
 void LitShape::UpdateConstantBufferPerObject()
 {
-	XMMATRIX world = XMLoadFloat4x4(m_world);
+	UpdateConstantBufferPerObject(*m_world);
+}
+
+void LitShape::UpdateConstantBufferPerObject(const XMFLOAT4X4& worldMatrix)
+{
+	XMMATRIX world = XMLoadFloat4x4(&worldMatrix);
 	XMMATRIX view = XMLoadFloat4x4(m_view);
 	XMMATRIX proj = XMLoadFloat4x4(m_proj);
 
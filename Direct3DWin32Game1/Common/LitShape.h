@@ -23,11 +23,21 @@ public:
 
 protected:
 
+	// Per object constants for world instead of the shared world matrix,
+	// for objects drawn several times a frame in different places.
+	void UpdateConstantBufferPerObject(const DirectX::XMFLOAT4X4& world);
+
 	virtual void BuildShader() override;
 	virtual void SetInputLayout() override;
 	virtual void BuildConstantBuffer() override;
 	virtual void BuildMaterial();
 
+	// Binds the vertex buffers, and anything else the vertex stage reads, for Render().
+	virtual void SetVertexBuffers();
+
+	// Issues the draw calls once Render() has set up the pipeline.
+	virtual void Draw();
+
 #if USE_VERTEX_COLOR
 #elif USE_TEXTURE_UV
 	virtual void BuildTexture() = 0;
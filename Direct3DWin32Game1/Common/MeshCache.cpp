@@ -0,0 +1,182 @@
+#include "pch.h"
+#include "Common/MeshCache.h"
+
+namespace
+{
+	// Drops the entries nobody holds any more.
+	template<typename Map>
+	void RemoveExpired(Map& map)
+	{
+		for (auto it = map.begin(); it != map.end();)
+		{
+			if (it->second.expired())
+			{
+				it = map.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+}
+
+MeshCache::DataHandle MeshCache::GetMeshData(const std::string& key, const Generator& generate)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	DataHandle data = m_data[key].lock();
+	if (!data)
+	{
+		std::shared_ptr<MeshData> mesh = std::make_shared<MeshData>();
+		generate(*mesh);
+		assert(mesh->vertices.size() == size_t(mesh->vertexStride) * mesh->vertexCount);
+
+		data = mesh;
+		m_data[key] = data;
+		RemoveExpired(m_data);
+	}
+	return data;
+}
+
+MeshCache::BuffersHandle MeshCache::GetMeshBuffers(ID3D11Device* device, const std::string& key, const Generator& generate)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+
+	const auto bufferKey = std::make_pair(device, key);
+	BuffersHandle buffers = m_buffers[bufferKey].lock();
+	if (!buffers)
+	{
+		// The CPU data is only kept for as long as someone else holds it.
+		DataHandle data = GetMeshData(key, generate);
+		buffers = CreateBuffers(device, *data);
+		m_buffers[bufferKey] = buffers;
+		RemoveExpired(m_buffers);
+	}
+	return buffers;
+}
+
+MeshCache::DataHandle MeshCache::GetGridIndices(UINT numRows, UINT numCols)
+{
+	return GetMeshData(MakeKey("GridIndices", numRows, numCols), [=](MeshData& mesh)
+	{
+		mesh.vertexCount = numRows * numCols;
+		BuildGridIndices(numRows, numCols, mesh.indices);
+	});
+}
+
+MeshCache::BuffersHandle MeshCache::GetGridIndexBuffer(ID3D11Device* device, UINT numRows, UINT numCols)
+{
+	return GetMeshBuffers(device, MakeKey("GridIndices", numRows, numCols), [=](MeshData& mesh)
+	{
+		mesh.vertexCount = numRows * numCols;
+		BuildGridIndices(numRows, numCols, mesh.indices);
+	});
+}
+
+UINT MeshCache::GetLiveDataCount()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	RemoveExpired(m_data);
+	return static_cast<UINT>(m_data.size());
+}
+
+UINT MeshCache::GetLiveBuffersCount()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_mutex);
+	RemoveExpired(m_buffers);
+	return static_cast<UINT>(m_buffers.size());
+}
+
+void MeshCache::BuildGridIndices(UINT numRows, UINT numCols, std::vector<UINT>& indices)
+{
+	const UINT m = numRows;
+	const UINT n = numCols;
+	indices.resize((m - 1)*(n - 1) * 6);
+
+	// Iterate over each quad and compute indices.
+	UINT k = 0;
+	for (UINT i = 0; i < m - 1; ++i)
+	{
+		for (UINT j = 0; j < n - 1; ++j)
+		{
+			indices[k] = i * n + j;
+			indices[k + 1] = i * n + j + 1;
+			indices[k + 2] = (i + 1)*n + j;
+
+			indices[k + 3] = (i + 1)*n + j;
+			indices[k + 4] = i * n + j + 1;
+			indices[k + 5] = (i + 1)*n + j + 1;
+
+			k += 6; // next quad
+		}
+	}
+}
+
+MeshCache& MeshCache::GetDefault()
+{
+	static MeshCache cache;
+	return cache;
+}
+
+MeshCache::BuffersHandle MeshCache::CreateBuffers(ID3D11Device* device, const MeshData& mesh) const
+{
+	std::shared_ptr<MeshBuffers> buffers = std::make_shared<MeshBuffers>();
+	buffers->vertexStride = mesh.vertexStride;
+	buffers->vertexCount = mesh.vertexCount;
+	buffers->indexCount = static_cast<UINT>(mesh.indices.size());
+
+	HRESULT hr;
+
+	if (!mesh.vertices.empty())
+	{
+		D3D11_BUFFER_DESC vbDesc;
+		vbDesc.ByteWidth = static_cast<UINT>(mesh.vertices.size());
+		vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vbDesc.CPUAccessFlags = 0;
+		vbDesc.MiscFlags = 0;
+		vbDesc.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA vbInitData;
+		vbInitData.pSysMem = mesh.vertices.data();
+		vbInitData.SysMemPitch = 0;
+		vbInitData.SysMemSlicePitch = 0;
+
+		hr = device->CreateBuffer(&vbDesc, &vbInitData, buffers->vertexBuffer.GetAddressOf());
+		DX::ThrowIfFailed(hr);
+	}
+
+	if (!mesh.indices.empty())
+	{
+		// Half the memory and bandwidth whenever the vertices allow it.
+		std::vector<USHORT> shortIndices;
+		const void* indexData = mesh.indices.data();
+		UINT indexSize = sizeof(UINT);
+		if (mesh.vertexCount <= 0x10000)
+		{
+			shortIndices.assign(mesh.indices.begin(), mesh.indices.end());
+			indexData = shortIndices.data();
+			indexSize = sizeof(USHORT);
+			buffers->indexFormat = DXGI_FORMAT_R16_UINT;
+		}
+
+		D3D11_BUFFER_DESC ibDesc;
+		ibDesc.ByteWidth = indexSize * buffers->indexCount;
+		ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		ibDesc.CPUAccessFlags = 0;
+		ibDesc.MiscFlags = 0;
+		ibDesc.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA ibInitData;
+		ibInitData.pSysMem = indexData;
+		ibInitData.SysMemPitch = 0;
+		ibInitData.SysMemSlicePitch = 0;
+
+		hr = device->CreateBuffer(&ibDesc, &ibInitData, buffers->indexBuffer.GetAddressOf());
+		DX::ThrowIfFailed(hr);
+	}
+
+	return buffers;
+}
\ No newline at end of file
@@ -0,0 +1,109 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Vertices and indices of a generated mesh. Vertices are kept as raw bytes
+// so one cache serves every vertex layout.
+struct MeshData
+{
+	std::vector<BYTE> vertices;
+	UINT vertexStride = 0;
+
+	// May be set without vertices, for an index list over vertices that live
+	// elsewhere, e.g. a dynamic vertex buffer.
+	UINT vertexCount = 0;
+
+	std::vector<UINT> indices;
+
+	template<typename Vertex>
+	void SetVertices(const Vertex* data, UINT count)
+	{
+		vertexStride = sizeof(Vertex);
+		vertexCount = count;
+		vertices.assign(reinterpret_cast<const BYTE*>(data), reinterpret_cast<const BYTE*>(data + count));
+	}
+
+	template<typename Vertex>
+	const Vertex* GetVertices() const { return reinterpret_cast<const Vertex*>(vertices.data()); }
+};
+
+// Immutable GPU buffers of a MeshData. Indices are 16 bit whenever every
+// vertex can be addressed with them. Either buffer is null when the mesh
+// has no vertices or no indices.
+struct MeshBuffers
+{
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
+	UINT vertexStride = 0;
+	UINT vertexCount = 0;
+	UINT indexCount = 0;
+};
+
+// Hands out meshes shared by every object built with the same generator
+// parameters, so the cost of building a shape and the memory it takes stop
+// growing with the number of objects using it. Meshes are named by a key
+// that holds the generator and all of its parameters, see MakeKey.
+//
+// Handles are reference counted: a mesh lives while any object holds a
+// handle to it, and is built again on the next request once the last one
+// has been released. All functions may be called from any thread.
+class MeshCache
+{
+public:
+	typedef std::shared_ptr<const MeshData> DataHandle;
+	typedef std::shared_ptr<const MeshBuffers> BuffersHandle;
+	typedef std::function<void(MeshData& mesh)> Generator;
+
+	// CPU data of the mesh named key; generate is only called when no handle
+	// to it is held.
+	DataHandle GetMeshData(const std::string& key, const Generator& generate);
+
+	// GPU buffers of the mesh named key on device, built from GetMeshData.
+	BuffersHandle GetMeshBuffers(ID3D11Device* device, const std::string& key, const Generator& generate);
+
+	// Indices of a grid of numRows x numCols vertices, two triangles per
+	// cell, row by row. Every grid mesh in the demos uses this triangulation.
+	DataHandle GetGridIndices(UINT numRows, UINT numCols);
+
+	// Index buffer of the grid above, for grids whose vertices are rewritten
+	// every frame.
+	BuffersHandle GetGridIndexBuffer(ID3D11Device* device, UINT numRows, UINT numCols);
+
+	// Number of meshes currently held by someone, on the CPU and the GPU.
+	UINT GetLiveDataCount();
+	UINT GetLiveBuffersCount();
+
+	// Joins a generator name and its parameters into a key. Floats are
+	// written with enough digits to tell any two apart.
+	template<typename... Args>
+	static std::string MakeKey(const char* generator, const Args&... args)
+	{
+		std::ostringstream key;
+		key.precision(9);
+		key << generator;
+		using Expand = int[];
+		(void)Expand{ 0, ((key << ' ' << args), 0)... };
+		return key.str();
+	}
+
+	static void BuildGridIndices(UINT numRows, UINT numCols, std::vector<UINT>& indices);
+
+	// Shared cache used by the demos, created on first use.
+	static MeshCache& GetDefault();
+
+private:
+
+	BuffersHandle CreateBuffers(ID3D11Device* device, const MeshData& mesh) const;
+
+	// Generators may ask the cache for other meshes, e.g. grid indices.
+	std::recursive_mutex m_mutex;
+
+	std::map<std::string, std::weak_ptr<const MeshData>> m_data;
+	std::map<std::pair<ID3D11Device*, std::string>, std::weak_ptr<const MeshBuffers>> m_buffers;
+};
\ No newline at end of file
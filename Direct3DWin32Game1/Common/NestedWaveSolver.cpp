@@ -0,0 +1,189 @@
+#include "pch.h"
+#include "Common/NestedWaveSolver.h"
+
+NestedWaveSolver::NestedWaveSolver(WaveSolver& coarse, UINT numCells)
+	: m_coarse(coarse)
+	, m_fine(2 * numCells + 1, 2 * numCells + 1, 0.5f * coarse.GetGrid().spatialStep,
+		coarse.GetTimeStep(), coarse.GetSpeed(), coarse.GetDamping())
+	, m_numCells(numCells)
+{
+	// The window has to fit between the coarse boundary rows and columns.
+	assert(numCells >= 2);
+	assert(numCells + 3 <= coarse.GetGrid().numRows && numCells + 3 <= coarse.GetGrid().numCols);
+
+	// Half the spacing at the same time step doubles the Courant number of
+	// the fine grid, which has to stay below 1/sqrt(2) like any other.
+	assert(coarse.GetSpeed() * coarse.GetTimeStep() / (0.5f * coarse.GetGrid().spatialStep) <= 0.7071f);
+
+	m_fine.SetSleepThreshold(coarse.GetSleepThreshold());
+
+	const UINT numPoints = m_fine.GetGrid().GetVertexCount();
+	m_prevScratch.resize(numPoints);
+	m_currScratch.resize(numPoints);
+
+	const WaveGrid& grid = coarse.GetGrid();
+	Center(0.5f * (grid.numRows - 1), 0.5f * (grid.numCols - 1));
+}
+
+void NestedWaveSolver::SetOrigin(UINT row, UINT col)
+{
+	const WaveGrid& grid = m_coarse.GetGrid();
+	row = std::min(std::max(row, 1u), grid.numRows - 2 - m_numCells);
+	col = std::min(std::max(col, 1u), grid.numCols - 2 - m_numCells);
+	if (row == m_originRow && col == m_originCol)
+		return;
+
+	const UINT n = m_fine.GetGrid().numCols;
+	const int lastInterior = int(n) - 2;
+
+	// Fine point (i, j) of the new window is fine point (i + rowShift,
+	// j + colShift) of the old one.
+	const int rowShift = 2 * (int(row) - int(m_originRow));
+	const int colShift = 2 * (int(col) - int(m_originCol));
+
+	const float* prevFine = m_fine.GetPreviousHeights();
+	const float* currFine = m_fine.GetHeights();
+
+	for (UINT i = 0; i < n; ++i)
+	{
+		for (UINT j = 0; j < n; ++j)
+		{
+			const int oldI = int(i) + rowShift;
+			const int oldJ = int(j) + colShift;
+			float& prev = m_prevScratch[i * n + j];
+			float& curr = m_currScratch[i * n + j];
+
+			if (oldI >= 1 && oldI <= lastInterior && oldJ >= 1 && oldJ <= lastInterior)
+			{
+				prev = prevFine[oldI * n + oldJ];
+				curr = currFine[oldI * n + oldJ];
+			}
+			else
+			{
+				const float coarseRow = row + 0.5f * i;
+				const float coarseCol = col + 0.5f * j;
+				prev = SampleCoarse(m_coarse.GetPreviousHeights(), coarseRow, coarseCol);
+				curr = SampleCoarse(m_coarse.GetHeights(), coarseRow, coarseCol);
+			}
+		}
+	}
+
+	m_originRow = row;
+	m_originCol = col;
+	m_fine.SetHeights(0, 0, n, n, m_prevScratch.data(), m_currScratch.data());
+}
+
+void NestedWaveSolver::Center(float row, float col)
+{
+	const float half = 0.5f * m_numCells;
+	SetOrigin(UINT(std::max(floorf(row - half + 0.5f), 0.0f)), UINT(std::max(floorf(col - half + 0.5f), 0.0f)));
+}
+
+bool NestedWaveSolver::CoversCell(UINT i, UINT j) const
+{
+	return i >= m_originRow && i < m_originRow + m_numCells &&
+		j >= m_originCol && j < m_originCol + m_numCells;
+}
+
+void NestedWaveSolver::Step()
+{
+	m_coarse.Step();
+	m_fine.Step();
+
+	Restrict();
+	Prolong();
+}
+
+void NestedWaveSolver::Disturb(UINT i, UINT j, float magnitude)
+{
+	// Coarse points inside the window are overwritten by the fine grid.
+	if (i > m_originRow && i < m_originRow + m_numCells &&
+		j > m_originCol && j < m_originCol + m_numCells)
+	{
+		m_fine.Disturb(2 * (i - m_originRow), 2 * (j - m_originCol), magnitude);
+	}
+	else
+	{
+		m_coarse.Disturb(i, j, magnitude);
+	}
+}
+
+WaveGrid NestedWaveSolver::GetFineGrid() const
+{
+	const WaveGrid& coarseGrid = m_coarse.GetGrid();
+
+	WaveGrid grid = m_fine.GetGrid();
+	grid.halfWidth = coarseGrid.halfWidth - m_originCol * coarseGrid.spatialStep;
+	grid.halfDepth = coarseGrid.halfDepth - m_originRow * coarseGrid.spatialStep;
+	return grid;
+}
+
+float NestedWaveSolver::SampleCoarse(const float* plane, float row, float col) const
+{
+	const WaveGrid& grid = m_coarse.GetGrid();
+
+	const UINT i0 = std::min(UINT(row), grid.numRows - 2);
+	const UINT j0 = std::min(UINT(col), grid.numCols - 2);
+	const float fi = row - float(i0);
+	const float fj = col - float(j0);
+
+	const float* above = plane + i0 * grid.numCols;
+	const float* below = above + grid.numCols;
+
+	const float top = above[j0] + (above[j0 + 1] - above[j0]) * fj;
+	const float bottom = below[j0] + (below[j0 + 1] - below[j0]) * fj;
+	return top + (bottom - top) * fi;
+}
+
+void NestedWaveSolver::Restrict()
+{
+	// Coarse points on the window edge stay coarse; they drive the fine boundary.
+	const UINT count = m_numCells - 1;
+	const UINT n = m_fine.GetGrid().numCols;
+	const float* prevFine = m_fine.GetPreviousHeights();
+	const float* currFine = m_fine.GetHeights();
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		for (UINT j = 0; j < count; ++j)
+		{
+			const UINT fine = 2 * (i + 1) * n + 2 * (j + 1);
+			m_prevScratch[i * count + j] = prevFine[fine];
+			m_currScratch[i * count + j] = currFine[fine];
+		}
+	}
+
+	m_coarse.SetHeights(m_originRow + 1, m_originCol + 1, count, count, m_prevScratch.data(), m_currScratch.data());
+}
+
+void NestedWaveSolver::Prolong()
+{
+	const UINT n = m_fine.GetGrid().numCols;
+	const float* prevCoarse = m_coarse.GetPreviousHeights();
+	const float* currCoarse = m_coarse.GetHeights();
+
+	// Fills the scratch rows with the coarse heights at count fine points from
+	// (i, j) on, stepping by (di, dj).
+	auto sampleEdge = [&](UINT i, UINT j, UINT di, UINT dj, UINT count)
+	{
+		for (UINT k = 0; k < count; ++k)
+		{
+			const float row = m_originRow + 0.5f * (i + k * di);
+			const float col = m_originCol + 0.5f * (j + k * dj);
+			m_prevScratch[k] = SampleCoarse(prevCoarse, row, col);
+			m_currScratch[k] = SampleCoarse(currCoarse, row, col);
+		}
+	};
+
+	sampleEdge(0, 0, 0, 1, n);
+	m_fine.SetHeights(0, 0, 1, n, m_prevScratch.data(), m_currScratch.data());
+
+	sampleEdge(n - 1, 0, 0, 1, n);
+	m_fine.SetHeights(n - 1, 0, 1, n, m_prevScratch.data(), m_currScratch.data());
+
+	sampleEdge(1, 0, 1, 0, n - 2);
+	m_fine.SetHeights(1, 0, n - 2, 1, m_prevScratch.data(), m_currScratch.data());
+
+	sampleEdge(1, n - 1, 1, 0, n - 2);
+	m_fine.SetHeights(1, n - 1, n - 2, 1, m_prevScratch.data(), m_currScratch.data());
+}
\ No newline at end of file
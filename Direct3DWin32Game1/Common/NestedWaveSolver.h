@@ -0,0 +1,76 @@
+#pragma once
+#include "Common/WaveSolver.h"
+
+// Fine wave grid at half the spacing of a coarse one, over a square window of
+// the coarse grid, coupled both ways at every step. Detail is only simulated
+// where it is needed, e.g. around the camera, and the cost grows with the
+// window instead of the whole body of water.
+//
+// After both grids stepped, the coarse points inside the window take the
+// heights of the fine points on them, so waves leave the window on the
+// coarse grid. The fine boundary is then set to the coarse heights along the
+// window edge, linear in between, so waves enter the window from the coarse
+// grid. Both grids use the same time step, so the coarse grid has to keep
+// speed*timeStep/spatialStep below 1/(2*sqrt(2)), half the usual limit.
+class NestedWaveSolver
+{
+public:
+	// The window covers numCells x numCells coarse cells, which the fine grid
+	// resolves with 2*numCells + 1 points per side.
+	NestedWaveSolver(WaveSolver& coarse, UINT numCells);
+
+	NestedWaveSolver(const NestedWaveSolver&) = delete;
+	NestedWaveSolver& operator=(const NestedWaveSolver&) = delete;
+
+	// Moves the window so its first point is coarse point (row, col), kept
+	// inside the coarse interior. Fine heights that stay inside the window
+	// are kept; the rest start from the coarse heights.
+	void SetOrigin(UINT row, UINT col);
+
+	// Moves the window so it is centered on coarse point (row, col), see above.
+	void Center(float row, float col);
+
+	UINT GetOriginRow() const { return m_originRow; }
+	UINT GetOriginCol() const { return m_originCol; }
+	UINT GetCellCount() const { return m_numCells; }
+
+	// Whether coarse cell (i, j), between points (i, j) and (i + 1, j + 1),
+	// is inside the window and drawn by the fine grid.
+	bool CoversCell(UINT i, UINT j) const;
+
+	// Advances both grids by one time step.
+	void Step();
+
+	// Disturbs coarse point (i, j), on the fine grid inside the window.
+	void Disturb(UINT i, UINT j, float magnitude);
+
+	WaveSolver& GetCoarseSolver() { return m_coarse; }
+	WaveSolver& GetFineSolver() { return m_fine; }
+	const WaveSolver& GetFineSolver() const { return m_fine; }
+
+	// Layout of the fine grid placed in the xz space of the coarse grid.
+	WaveGrid GetFineGrid() const;
+
+private:
+
+	// Coarse heights at fractional coarse point (row, col) of plane.
+	float SampleCoarse(const float* plane, float row, float col) const;
+
+	// Copies the fine heights on the coarse points inside the window to the
+	// coarse grid.
+	void Restrict();
+
+	// Sets the fine boundary from the coarse grid.
+	void Prolong();
+
+	WaveSolver& m_coarse;
+	WaveSolver m_fine;
+
+	UINT m_numCells;
+	UINT m_originRow = 1;
+	UINT m_originCol = 1;
+
+	// Scratch rows for SetHeights.
+	std::vector<float> m_prevScratch;
+	std::vector<float> m_currScratch;
+};
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "pch.h"
+#include "Common/PatchTessellator.h"
+#include <cfloat>
+
+using namespace DirectX;
+
+PatchTessellator::PatchTessellator(UINT numRows, UINT numCols, float width, float depth)
+	: m_numRows(numRows)
+	, m_numCols(numCols)
+	, m_width(width)
+	, m_depth(depth)
+	, m_bounds(numRows * numCols, XMFLOAT2(0.0f, 0.0f))
+	, m_points((numRows + 1) * (numCols + 1))
+{
+	assert(numRows > 0 && numCols > 0);
+
+	for (UINT i = 0; i <= numRows; ++i)
+	{
+		for (UINT j = 0; j <= numCols; ++j)
+		{
+			m_points[i * (numCols + 1) + j] = GetControlPoint(i, j);
+		}
+	}
+}
+
+void PatchTessellator::SetHeights(const HeightField& heightField, UINT samplesPerEdge, float margin)
+{
+	assert(samplesPerEdge >= 2);
+
+	// One grid of samples over the whole map, shared along the patch borders,
+	// with a sample on every control point.
+	const UINT steps = samplesPerEdge - 1;
+	const UINT numRows = m_numRows * steps + 1;
+	const UINT numCols = m_numCols * steps + 1;
+	const float dx = m_width / (m_numCols * steps);
+	const float dz = m_depth / (m_numRows * steps);
+
+	std::vector<XMFLOAT2> points(numRows * numCols);
+	for (UINT i = 0; i < numRows; ++i)
+	{
+		for (UINT j = 0; j < numCols; ++j)
+		{
+			points[i * numCols + j] = XMFLOAT2(-0.5f * m_width + j * dx, 0.5f * m_depth - i * dz);
+		}
+	}
+
+	std::vector<float> heights(points.size());
+	heightField.Evaluate(points.data(), static_cast<UINT>(points.size()), heights.data(), nullptr);
+
+	for (UINT i = 0; i <= m_numRows; ++i)
+	{
+		for (UINT j = 0; j <= m_numCols; ++j)
+		{
+			m_points[i * (m_numCols + 1) + j].y = heights[i * steps * numCols + j * steps];
+		}
+	}
+
+	for (UINT i = 0; i < m_numRows; ++i)
+	{
+		for (UINT j = 0; j < m_numCols; ++j)
+		{
+			float minHeight = FLT_MAX;
+			float maxHeight = -FLT_MAX;
+			float maxStep = 0.0f;
+
+			for (UINT r = i * steps; r <= (i + 1) * steps; ++r)
+			{
+				for (UINT c = j * steps; c <= (j + 1) * steps; ++c)
+				{
+					const float h = heights[r * numCols + c];
+					minHeight = std::min(minHeight, h);
+					maxHeight = std::max(maxHeight, h);
+
+					if (c < (j + 1) * steps)
+					{
+						maxStep = std::max(maxStep, fabsf(heights[r * numCols + c + 1] - h));
+					}
+					if (r < (i + 1) * steps)
+					{
+						maxStep = std::max(maxStep, fabsf(heights[(r + 1) * numCols + c] - h));
+					}
+				}
+			}
+
+			// Between two samples the surface rises above the higher one by
+			// about half the step between them at most.
+			const float widening = 0.5f * maxStep + margin;
+			m_bounds[i * m_numCols + j] = XMFLOAT2(minHeight - widening, maxHeight + widening);
+		}
+	}
+}
+
+UINT PatchTessellator::Update(const XMFLOAT4X4& world, const XMFLOAT4X4& view, const XMFLOAT4X4& proj, float viewportHeight,
+	std::vector<UINT>& controlPoints, std::vector<PatchTessFactors>& factors) const
+{
+	const XMMATRIX worldView = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&view));
+
+	UpdateContext context;
+	XMStoreFloat4x4(&context.worldView, worldView);
+	context.factorScale = 0.5f * viewportHeight * proj.m[1][1] / m_targetPixels;
+
+	XMFLOAT4X4 worldViewProj;
+	XMStoreFloat4x4(&worldViewProj, XMMatrixMultiply(worldView, XMLoadFloat4x4(&proj)));
+
+	// Planes of clip space, for row vectors: -w <= x, y <= w and 0 <= z <= w.
+	auto column = [&](UINT j) { return XMFLOAT4(worldViewProj.m[0][j], worldViewProj.m[1][j], worldViewProj.m[2][j], worldViewProj.m[3][j]); };
+	const XMFLOAT4 c0 = column(0);
+	const XMFLOAT4 c1 = column(1);
+	const XMFLOAT4 c2 = column(2);
+	const XMFLOAT4 c3 = column(3);
+	const XMFLOAT4 planes[6] =
+	{
+		XMFLOAT4(c3.x + c0.x, c3.y + c0.y, c3.z + c0.z, c3.w + c0.w),
+		XMFLOAT4(c3.x - c0.x, c3.y - c0.y, c3.z - c0.z, c3.w - c0.w),
+		XMFLOAT4(c3.x + c1.x, c3.y + c1.y, c3.z + c1.z, c3.w + c1.w),
+		XMFLOAT4(c3.x - c1.x, c3.y - c1.y, c3.z - c1.z, c3.w - c1.w),
+		c2,
+		XMFLOAT4(c3.x - c2.x, c3.y - c2.y, c3.z - c2.z, c3.w - c2.w)
+	};
+
+	controlPoints.clear();
+	factors.clear();
+
+	const UINT pitch = m_numCols + 1;
+	for (UINT i = 0; i < m_numRows; ++i)
+	{
+		for (UINT j = 0; j < m_numCols; ++j)
+		{
+			const XMFLOAT2& bounds = GetBounds(i, j);
+			const XMFLOAT3 boxMin(m_points[(i + 1) * pitch + j].x, bounds.x, m_points[(i + 1) * pitch + j].z);
+			const XMFLOAT3 boxMax(m_points[i * pitch + j + 1].x, bounds.y, m_points[i * pitch + j + 1].z);
+
+			// Outside when the corner furthest along a plane normal is behind it.
+			bool bOutside = false;
+			for (const XMFLOAT4& plane : planes)
+			{
+				const float farDistance = plane.x * (plane.x >= 0.0f ? boxMax.x : boxMin.x) +
+					plane.y * (plane.y >= 0.0f ? boxMax.y : boxMin.y) +
+					plane.z * (plane.z >= 0.0f ? boxMax.z : boxMin.z) + plane.w;
+				if (farDistance < 0.0f)
+				{
+					bOutside = true;
+					break;
+				}
+			}
+
+			if (bOutside)
+				continue;
+
+			const UINT topLeft = i * pitch + j;
+			const UINT topRight = topLeft + 1;
+			const UINT bottomLeft = topLeft + pitch;
+			const UINT bottomRight = bottomLeft + 1;
+
+			controlPoints.push_back(topLeft);
+			controlPoints.push_back(topRight);
+			controlPoints.push_back(bottomLeft);
+			controlPoints.push_back(bottomRight);
+
+			// Edges along x run left to right and edges along z top to
+			// bottom, whichever patch asks.
+			PatchTessFactors patch;
+			patch.edges[0] = GetEdgeFactor(context, topLeft, bottomLeft);
+			patch.edges[1] = GetEdgeFactor(context, topLeft, topRight);
+			patch.edges[2] = GetEdgeFactor(context, topRight, bottomRight);
+			patch.edges[3] = GetEdgeFactor(context, bottomLeft, bottomRight);
+			patch.inside[0] = std::max(patch.edges[1], patch.edges[3]);
+			patch.inside[1] = std::max(patch.edges[0], patch.edges[2]);
+			patch.padding[0] = 0.0f;
+			patch.padding[1] = 0.0f;
+			factors.push_back(patch);
+		}
+	}
+
+	return static_cast<UINT>(factors.size());
+}
+
+XMFLOAT3 PatchTessellator::GetControlPoint(UINT i, UINT j) const
+{
+	return XMFLOAT3(-0.5f * m_width + j * m_width / m_numCols, 0.0f, 0.5f * m_depth - i * m_depth / m_numRows);
+}
+
+float PatchTessellator::GetEdgeFactor(const UpdateContext& context, UINT a, UINT b) const
+{
+	const XMMATRIX worldView = XMLoadFloat4x4(&context.worldView);
+	const XMVECTOR pointA = XMVector3TransformCoord(XMLoadFloat3(&m_points[a]), worldView);
+	const XMVECTOR pointB = XMVector3TransformCoord(XMLoadFloat3(&m_points[b]), worldView);
+
+	const float diameter = XMVectorGetX(XMVector3Length(XMVectorSubtract(pointB, pointA)));
+	const float centerDepth = 0.5f * (XMVectorGetZ(pointA) + XMVectorGetZ(pointB));
+
+	// An eye inside the sphere sees it at least as large as from its surface.
+	const float distance = std::max(centerDepth, 0.5f * diameter);
+	if (distance <= 0.0f)
+		return m_minFactor;
+
+	const float factor = diameter * context.factorScale / distance;
+	return std::min(std::max(factor, m_minFactor), m_maxFactor);
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+#include "Common/Heightmap.h"
+#include <vector>
+
+// Tessellation factors of one quad patch, laid out for a StructuredBuffer
+// the patch constant function reads by SV_PrimitiveID. Edges are in the
+// order of SV_TessFactor for the quad domain: u = 0, v = 0, u = 1, v = 1.
+struct PatchTessFactors
+{
+	float edges[4];
+	float inside[2];
+	float padding[2];
+};
+
+// Per frame culling and tessellation factors for a grid of quad patches
+// displaced by a height field, worked out on the CPU so that the hull shader
+// only reads them back. The patches are the cells of a grid of
+// (numRows + 1) x (numCols + 1) control points laid out like WaveGrid, row 0
+// at +z, each patch drawn from its corners in the order top left, top right,
+// bottom left, bottom right.
+//
+// Patches whose box misses the frustum are left out of the patch list, so
+// nothing downstream of the input assembler runs for them. The box spans the
+// heights sampled over the patch, widened by a margin for peaks between the
+// samples.
+//
+// An edge is tessellated so that its segments cover about targetPixels
+// pixels on screen, measured with the sphere through its two displaced end
+// points: the diameter projected at the distance of the center. The factor
+// depends on nothing but the edge, which two patches sharing it pass in the
+// same order, so both get the same bits and the edge cannot crack. Inside
+// factors follow the larger of the two edges along each direction.
+class PatchTessellator
+{
+public:
+	// numRows x numCols patches over width x depth, centered on the origin.
+	PatchTessellator(UINT numRows, UINT numCols, float width, float depth);
+
+	// Height bounds of every patch from samplesPerEdge x samplesPerEdge
+	// points of heightField, widened by half the largest step between
+	// neighbouring samples and then by margin. Until this is called the
+	// patches are flat at height 0.
+	void SetHeights(const HeightField& heightField, UINT samplesPerEdge = 9, float margin = 0.0f);
+
+	// On screen length of a tessellated segment to aim for, and the range
+	// factors are clamped to.
+	void SetTargetPixels(float targetPixels) { m_targetPixels = targetPixels; }
+	void SetFactorRange(float minFactor, float maxFactor) { m_minFactor = minFactor; m_maxFactor = maxFactor; }
+
+	// Culls the patches against the frustum of world * view * proj and works
+	// out the factors of the others, for a viewport viewportHeight pixels
+	// high. Writes four control point indices per visible patch to
+	// controlPoints and its factors to factors, in the same order. Returns
+	// the number of visible patches.
+	UINT Update(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& proj, float viewportHeight,
+		std::vector<UINT>& controlPoints, std::vector<PatchTessFactors>& factors) const;
+
+	UINT GetRowCount() const { return m_numRows; }
+	UINT GetColCount() const { return m_numCols; }
+	UINT GetPatchCount() const { return m_numRows * m_numCols; }
+
+	// Control point (i, j), at height 0, as the vertex buffer holds it.
+	DirectX::XMFLOAT3 GetControlPoint(UINT i, UINT j) const;
+
+	// Height range of patch (i, j) used for culling.
+	const DirectX::XMFLOAT2& GetBounds(UINT i, UINT j) const { return m_bounds[i * m_numCols + j]; }
+
+private:
+
+	struct UpdateContext
+	{
+		DirectX::XMFLOAT4X4 worldView;
+		// Projected diameter of a sphere at unit distance, over targetPixels.
+		float factorScale;
+	};
+
+	// Factor of the edge from control point a to control point b.
+	float GetEdgeFactor(const UpdateContext& context, UINT a, UINT b) const;
+
+	UINT m_numRows;
+	UINT m_numCols;
+	float m_width;
+	float m_depth;
+
+	float m_targetPixels = 16.0f;
+	float m_minFactor = 1.0f;
+	float m_maxFactor = 64.0f;
+
+	// Minimum and maximum height of every patch.
+	std::vector<DirectX::XMFLOAT2> m_bounds;
+
+	// Displaced position of every control point, for the edge metric.
+	std::vector<DirectX::XMFLOAT3> m_points;
+};
\ No newline at end of file
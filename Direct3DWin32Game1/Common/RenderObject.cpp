@@ -27,3 +27,16 @@ void RenderObject::WorldTransform(XMMATRIX& trans)
 {
 	XMStoreFloat4x4(m_world, XMMatrixMultiply(XMLoadFloat4x4(m_world), trans));
 }
+
+
+void RenderObject::UseSharedMesh(const MeshCache::BuffersHandle& mesh)
+{
+	m_sharedMesh = mesh;
+	if (mesh->vertexBuffer)
+	{
+		m_vertexBuffer = mesh->vertexBuffer;
+	}
+	m_indexBuffer = mesh->indexBuffer;
+	m_indexCount = mesh->indexCount;
+	m_indexFormat = mesh->indexFormat;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "Common/d3dUtil.h"
+#include "Common/MeshCache.h"
 #include "StepTimer.h"
 
 class RenderObject
@@ -21,6 +22,11 @@ public:
 
 protected:
 
+	// Takes the buffers of a mesh shared through MeshCache and holds it for
+	// as long as this object lives. A mesh without vertices only replaces the
+	// index buffer.
+	void UseSharedMesh(const MeshCache::BuffersHandle& mesh);
+
 	Microsoft::WRL::ComPtr<ID3D11Device>			m_d3dDevice;
 	Microsoft::WRL::ComPtr<ID3D11DeviceContext>		m_d3dContext;
 
@@ -37,4 +43,7 @@ protected:
 	DirectX::XMFLOAT4X4* m_proj;
 
 	UINT m_indexCount;
+	DXGI_FORMAT m_indexFormat = DXGI_FORMAT_R32_UINT;
+
+	MeshCache::BuffersHandle m_sharedMesh;
 };
\ No newline at end of file
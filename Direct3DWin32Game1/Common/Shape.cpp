@@ -33,7 +33,7 @@ void Shape::Render()
 	UINT stride = sizeof(VertexType);
 	UINT offset = 0;
 	m_d3dContext->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
-	m_d3dContext->IASetIndexBuffer(m_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	m_d3dContext->IASetIndexBuffer(m_indexBuffer.Get(), m_indexFormat, 0);
 	m_d3dContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	m_d3dContext->VSSetConstantBuffers(0, 1, m_constantBufferPerObject.GetAddressOf());
 	m_d3dContext->VSSetShader(m_vertexShader.Get(), nullptr, 0);
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <vector>
+
+// Bounded queue from exactly one producer thread to exactly one consumer
+// thread, without locks. Each side only writes its own index and reads the
+// other's, so a push never waits for a pop and the other way round; a full
+// or empty queue is reported instead.
+template<typename T>
+class SpscQueue
+{
+public:
+	explicit SpscQueue(UINT capacity)
+		: m_slots(capacity + 1)
+	{
+	}
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Producer side. Leaves value alone and returns false when full.
+	bool TryPush(T& value)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		const size_t next = tail + 1 < m_slots.size() ? tail + 1 : 0;
+		if (next == m_head.load(std::memory_order_acquire))
+			return false;
+
+		m_slots[tail] = std::move(value);
+		m_tail.store(next, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side. Returns false when empty.
+	bool TryPop(T& value)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+			return false;
+
+		value = std::move(m_slots[head]);
+		m_head.store(head + 1 < m_slots.size() ? head + 1 : 0, std::memory_order_release);
+		return true;
+	}
+
+	// Either side; may be out of date by the time it returns.
+	bool IsEmpty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+	UINT GetCapacity() const { return static_cast<UINT>(m_slots.size()) - 1; }
+
+private:
+	// One slot is always free, which tells a full queue from an empty one.
+	std::vector<T> m_slots;
+
+	// Next slot to pop, written by the consumer only.
+	std::atomic<size_t> m_head{ 0 };
+
+	// Next slot to push, written by the producer only.
+	std::atomic<size_t> m_tail{ 0 };
+};
\ No newline at end of file
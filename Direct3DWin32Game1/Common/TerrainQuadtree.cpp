@@ -0,0 +1,293 @@
+#include "pch.h"
+#include "Common/TerrainQuadtree.h"
+#include "Common/WorkerPool.h"
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+	// Share of the range of a level, counted from the range of the level
+	// below, after which its vertices start morphing.
+	const float MorphStartRatio = 0.66f;
+
+	bool IntersectsSphere(const XMFLOAT3& boxMin, const XMFLOAT3& boxMax, const XMFLOAT3& center, float radius)
+	{
+		const float dx = std::max(std::max(boxMin.x - center.x, center.x - boxMax.x), 0.0f);
+		const float dy = std::max(std::max(boxMin.y - center.y, center.y - boxMax.y), 0.0f);
+		const float dz = std::max(std::max(boxMin.z - center.z, center.z - boxMax.z), 0.0f);
+		return dx * dx + dy * dy + dz * dz <= radius * radius;
+	}
+
+	enum FrustumTest
+	{
+		Outside,
+		Intersecting,
+		Inside
+	};
+}
+
+TerrainQuadtree::TerrainQuadtree(const HeightField& heightField, float size, UINT numLevels, UINT chunkCells, WorkerPool* pool)
+	: m_size(size)
+	, m_numLevels(numLevels)
+	, m_chunkCells(chunkCells)
+	, m_bounds(numLevels)
+{
+	assert(numLevels > 0 && numLevels <= MaxLevels);
+	assert(chunkCells >= 4 && chunkCells % 4 == 0);
+
+	const UINT c = chunkCells;
+
+	// Height error of halving the resolution of each level.
+	float coarseningErrors[MaxLevels] = {};
+
+	for (UINT level = 0; level < numLevels; ++level)
+	{
+		const UINT numNodes = GetNodeCount(level);
+		const float nodeSize = GetNodeSize(level);
+		const float spacing = nodeSize / c;
+
+		std::vector<XMFLOAT2>& bounds = m_bounds[level];
+		bounds.resize(numNodes * numNodes);
+
+		// Largest error per row of nodes, merged after the parallel loop.
+		std::vector<float> rowErrors(numNodes, 0.0f);
+
+		auto sampleNodes = [&](UINT rowBegin, UINT rowEnd)
+		{
+			std::vector<XMFLOAT2> points((c + 1) * (c + 1));
+			std::vector<float> h((c + 1) * (c + 1));
+
+			for (UINT nodeZ = rowBegin; nodeZ < rowEnd; ++nodeZ)
+			{
+				for (UINT nodeX = 0; nodeX < numNodes; ++nodeX)
+				{
+					const float x0 = -0.5f * size + nodeX * nodeSize;
+					const float z0 = -0.5f * size + nodeZ * nodeSize;
+
+					for (UINT i = 0; i <= c; ++i)
+					{
+						for (UINT j = 0; j <= c; ++j)
+						{
+							points[i * (c + 1) + j] = XMFLOAT2(x0 + j * spacing, z0 + i * spacing);
+						}
+					}
+					heightField.Evaluate(points.data(), UINT(points.size()), h.data(), nullptr);
+
+					float minHeight = FLT_MAX;
+					float maxHeight = -FLT_MAX;
+					for (float y : h)
+					{
+						minHeight = std::min(minHeight, y);
+						maxHeight = std::max(maxHeight, y);
+					}
+
+					// Vertices of coarser levels are vertices of this one, so the
+					// children bound a node exactly; they are merged below.
+					if (level == 0)
+					{
+						bounds[nodeZ * numNodes + nodeX] = XMFLOAT2(minHeight, maxHeight);
+					}
+
+					if (level + 1 == numLevels)
+						continue;
+
+					// Odd vertices against the grid of half the resolution: edge
+					// midpoints against their ends, cell centers against either
+					// diagonal of the coarse cell.
+					auto at = [&](UINT i, UINT j) { return h[i * (c + 1) + j]; };
+					float error = rowErrors[nodeZ];
+					for (UINT i = 0; i <= c; ++i)
+					{
+						for (UINT j = 0; j <= c; ++j)
+						{
+							const bool bOddRow = (i & 1) != 0;
+							const bool bOddCol = (j & 1) != 0;
+							const float y = at(i, j);
+							if (bOddRow && bOddCol)
+							{
+								error = std::max(error, fabsf(y - 0.5f * (at(i - 1, j + 1) + at(i + 1, j - 1))));
+								error = std::max(error, fabsf(y - 0.5f * (at(i - 1, j - 1) + at(i + 1, j + 1))));
+							}
+							else if (bOddCol)
+							{
+								error = std::max(error, fabsf(y - 0.5f * (at(i, j - 1) + at(i, j + 1))));
+							}
+							else if (bOddRow)
+							{
+								error = std::max(error, fabsf(y - 0.5f * (at(i - 1, j) + at(i + 1, j))));
+							}
+						}
+					}
+					rowErrors[nodeZ] = error;
+				}
+			}
+		};
+
+		if (pool)
+		{
+			pool->ParallelFor(0, numNodes, sampleNodes);
+		}
+		else
+		{
+			sampleNodes(0, numNodes);
+		}
+
+		if (level + 1 < numLevels)
+		{
+			coarseningErrors[level + 1] = *std::max_element(rowErrors.begin(), rowErrors.end());
+		}
+
+		if (level > 0)
+		{
+			const std::vector<XMFLOAT2>& childBounds = m_bounds[level - 1];
+			const UINT numChildren = 2 * numNodes;
+
+			for (UINT nodeZ = 0; nodeZ < numNodes; ++nodeZ)
+			{
+				for (UINT nodeX = 0; nodeX < numNodes; ++nodeX)
+				{
+					XMFLOAT2 nodeBounds(FLT_MAX, -FLT_MAX);
+					for (UINT child = 0; child < 4; ++child)
+					{
+						const XMFLOAT2& b = childBounds[(2 * nodeZ + (child >> 1)) * numChildren + 2 * nodeX + (child & 1)];
+						nodeBounds.x = std::min(nodeBounds.x, b.x);
+						nodeBounds.y = std::max(nodeBounds.y, b.y);
+					}
+					bounds[nodeZ * numNodes + nodeX] = nodeBounds;
+				}
+			}
+		}
+	}
+
+	// Errors add up from level to level.
+	m_levelErrors[0] = 0.0f;
+	for (UINT level = 1; level < numLevels; ++level)
+	{
+		m_levelErrors[level] = m_levelErrors[level - 1] + coarseningErrors[level];
+	}
+
+	SetErrorBound(720.0f, 0.25f * 3.14159265f, 2.0f);
+}
+
+void TerrainQuadtree::SetErrorBound(float viewportHeight, float fovY, float maxPixelError)
+{
+	// Pixels per unit of length at distance 1.
+	const float pixelsPerUnit = viewportHeight / (2.0f * tanf(0.5f * fovY));
+
+	float previousRange = 0.0f;
+	for (UINT level = 0; level < m_numLevels; ++level)
+	{
+		// The error of a level is drawn up to its range; beyond it the next
+		// level, with at most twice the error, takes over. Ranges at least
+		// double from level to level and stay clear of the node size, which
+		// keeps every node within one level of its neighbors.
+		float range = m_levelErrors[level] * pixelsPerUnit / maxPixelError;
+		range = std::max(range, 2.0f * GetNodeSize(level));
+		range = std::max(range, 2.0f * previousRange);
+
+		m_lodRanges[level] = range;
+		m_morphStarts[level] = previousRange + (range - previousRange) * MorphStartRatio;
+		previousRange = range;
+	}
+
+	// Nothing is coarser than the root.
+	m_lodRanges[m_numLevels - 1] = FLT_MAX;
+	m_morphStarts[m_numLevels - 1] = FLT_MAX;
+}
+
+UINT TerrainQuadtree::Select(const XMFLOAT3& eye, const XMFLOAT4X4& viewProj, std::vector<TerrainPatch>& patches) const
+{
+	SelectContext context;
+	context.eye = eye;
+	context.patches = &patches;
+
+	// Planes of clip space, for row vectors: -w <= x, y <= w and 0 <= z <= w.
+	auto column = [&](UINT j) { return XMFLOAT4(viewProj.m[0][j], viewProj.m[1][j], viewProj.m[2][j], viewProj.m[3][j]); };
+	const XMFLOAT4 c0 = column(0);
+	const XMFLOAT4 c1 = column(1);
+	const XMFLOAT4 c2 = column(2);
+	const XMFLOAT4 c3 = column(3);
+	context.frustum.planes[0] = XMFLOAT4(c3.x + c0.x, c3.y + c0.y, c3.z + c0.z, c3.w + c0.w);
+	context.frustum.planes[1] = XMFLOAT4(c3.x - c0.x, c3.y - c0.y, c3.z - c0.z, c3.w - c0.w);
+	context.frustum.planes[2] = XMFLOAT4(c3.x + c1.x, c3.y + c1.y, c3.z + c1.z, c3.w + c1.w);
+	context.frustum.planes[3] = XMFLOAT4(c3.x - c1.x, c3.y - c1.y, c3.z - c1.z, c3.w - c1.w);
+	context.frustum.planes[4] = c2;
+	context.frustum.planes[5] = XMFLOAT4(c3.x - c2.x, c3.y - c2.y, c3.z - c2.z, c3.w - c2.w);
+
+	patches.clear();
+	SelectNode(context, m_numLevels - 1, 0, 0, false);
+	return static_cast<UINT>(patches.size());
+}
+
+bool TerrainQuadtree::SelectNode(const SelectContext& context, UINT level, UINT nodeX, UINT nodeZ, bool bInsideFrustum) const
+{
+	const float nodeSize = GetNodeSize(level);
+	const XMFLOAT2& bounds = GetBounds(level, nodeX, nodeZ);
+	const XMFLOAT3 boxMin(-0.5f * m_size + nodeX * nodeSize, bounds.x, -0.5f * m_size + nodeZ * nodeSize);
+	const XMFLOAT3 boxMax(boxMin.x + nodeSize, bounds.y, boxMin.z + nodeSize);
+
+	if (!IntersectsSphere(boxMin, boxMax, context.eye, m_lodRanges[level]))
+		return false;
+
+	if (!bInsideFrustum)
+	{
+		// Test the corner furthest along each plane normal, and the nearest.
+		FrustumTest test = Inside;
+		for (const XMFLOAT4& plane : context.frustum.planes)
+		{
+			const float farDistance = plane.x * (plane.x >= 0.0f ? boxMax.x : boxMin.x) +
+				plane.y * (plane.y >= 0.0f ? boxMax.y : boxMin.y) +
+				plane.z * (plane.z >= 0.0f ? boxMax.z : boxMin.z) + plane.w;
+			const float nearDistance = plane.x * (plane.x >= 0.0f ? boxMin.x : boxMax.x) +
+				plane.y * (plane.y >= 0.0f ? boxMin.y : boxMax.y) +
+				plane.z * (plane.z >= 0.0f ? boxMin.z : boxMax.z) + plane.w;
+			if (farDistance < 0.0f)
+			{
+				test = Outside;
+				break;
+			}
+			if (nearDistance < 0.0f)
+			{
+				test = Intersecting;
+			}
+		}
+
+		// Nothing to draw, and nothing for the parent to draw either.
+		if (test == Outside)
+			return true;
+
+		bInsideFrustum = test == Inside;
+	}
+
+	if (level == 0 || !IntersectsSphere(boxMin, boxMax, context.eye, m_lodRanges[level - 1]))
+	{
+		for (UINT quadrant = 0; quadrant < 4; ++quadrant)
+		{
+			AddPatch(context, level, nodeX, nodeZ, quadrant);
+		}
+		return true;
+	}
+
+	// Children out of the range of their level leave their quarter to this node.
+	for (UINT quadrant = 0; quadrant < 4; ++quadrant)
+	{
+		if (!SelectNode(context, level - 1, 2 * nodeX + (quadrant & 1), 2 * nodeZ + (quadrant >> 1), bInsideFrustum))
+		{
+			AddPatch(context, level, nodeX, nodeZ, quadrant);
+		}
+	}
+	return true;
+}
+
+void TerrainQuadtree::AddPatch(const SelectContext& context, UINT level, UINT nodeX, UINT nodeZ, UINT quadrant) const
+{
+	const float nodeSize = GetNodeSize(level);
+
+	TerrainPatch patch;
+	patch.size = 0.5f * nodeSize;
+	patch.origin.x = -0.5f * m_size + nodeX * nodeSize + (quadrant & 1) * patch.size;
+	patch.origin.y = -0.5f * m_size + nodeZ * nodeSize + (quadrant >> 1) * patch.size;
+	patch.level = float(level);
+	context.patches->push_back(patch);
+}
\ No newline at end of file
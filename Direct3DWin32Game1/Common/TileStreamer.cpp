@@ -0,0 +1,250 @@
+#include "pch.h"
+#include "Common/TileStreamer.h"
+#include <algorithm>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+TileStreamer::TileStreamer(const HeightField& heightField, float mapSize, float tileSize, UINT tileCells, ID3D11Device* device)
+	: m_heightField(heightField)
+	, m_mapSize(mapSize)
+	, m_tileSize(tileSize)
+	, m_tileCells(tileCells)
+	, m_tilesPerSide(static_cast<UINT>(ceilf(mapSize / tileSize)))
+	, m_device(device)
+	, m_requests(MaxPendingTiles)
+	, m_arrivals(MaxPendingTiles)
+{
+	assert(tileCells > 0 && m_tilesPerSide > 0);
+
+	m_loader = std::thread(&TileStreamer::LoaderMain, this);
+}
+
+TileStreamer::~TileStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bStop = true;
+	}
+	m_wakeCondition.notify_one();
+
+	m_loader.join();
+}
+
+void TileStreamer::Update(float eyeX, float eyeZ)
+{
+	++m_frame;
+
+	m_eyeX = eyeX;
+	m_eyeZ = eyeZ;
+	m_cancelRadius = m_loadRadius + m_tileSize;
+
+	// Take what the loader finished, but no more than a frame can absorb.
+	m_arrivalCount = 0;
+	std::unique_ptr<TerrainTile> tile;
+	while (m_arrivalCount < m_maxArrivalsPerFrame && m_arrivals.TryPop(tile))
+	{
+		const UINT key = GetKey(tile->tileX, tile->tileZ);
+		m_pending.erase(key);
+
+		if (tile->bFailed)
+		{
+			m_failedTiles.insert(key);
+		}
+		else if (!tile->bCancelled)
+		{
+			// Only wanted again once the ring below asks for it.
+			tile->lastUse = m_frame - 1;
+			m_tiles[key] = std::move(tile);
+			++m_arrivalCount;
+		}
+	}
+
+	// Tiles in the ring, nearest first, as many as the budget holds.
+	const float radius = m_loadRadius;
+	const float origin = -0.5f * m_mapSize;
+	auto firstTile = [&](float x) { return static_cast<UINT>(std::max((x - radius - origin) / m_tileSize, 0.0f)); };
+	auto lastTile = [&](float x) { return std::min(static_cast<UINT>(std::max((x + radius - origin) / m_tileSize, 0.0f)), m_tilesPerSide - 1); };
+
+	m_wanted.clear();
+	for (UINT tileZ = firstTile(eyeZ); tileZ <= lastTile(eyeZ); ++tileZ)
+	{
+		for (UINT tileX = firstTile(eyeX); tileX <= lastTile(eyeX); ++tileX)
+		{
+			const float distance = GetTileDistance(tileX, tileZ, eyeX, eyeZ);
+			if (distance <= radius)
+			{
+				m_wanted.push_back(std::make_pair(distance, GetKey(tileX, tileZ)));
+			}
+		}
+	}
+
+	std::sort(m_wanted.begin(), m_wanted.end());
+
+	const size_t maxTiles = m_residentBudget / GetTileBytes();
+	if (m_wanted.size() > maxTiles)
+	{
+		m_wanted.resize(maxTiles);
+	}
+
+	m_visibleTiles.clear();
+	bool bRequested = false;
+	for (const auto& wanted : m_wanted)
+	{
+		const UINT key = wanted.second;
+		auto it = m_tiles.find(key);
+		if (it != m_tiles.end())
+		{
+			it->second->lastUse = m_frame;
+			m_visibleTiles.push_back(it->second.get());
+		}
+		else if (m_pending.size() < MaxPendingTiles && m_pending.find(key) == m_pending.end() &&
+			m_failedTiles.find(key) == m_failedTiles.end())
+		{
+			TileRequest request = { key % m_tilesPerSide, key / m_tilesPerSide };
+			if (m_requests.TryPush(request))
+			{
+				m_pending.insert(key);
+				bRequested = true;
+			}
+		}
+	}
+
+	if (bRequested)
+	{
+		// The lock only orders the wake up after the loader's check for requests.
+		{
+			std::lock_guard<std::mutex> lock(m_wakeMutex);
+		}
+		m_wakeCondition.notify_one();
+	}
+
+	// Evict the least recently wanted tiles over the budget. Every tile of
+	// this frame fits, so there is always an older one.
+	while (GetResidentBytes() > m_residentBudget)
+	{
+		auto oldest = m_tiles.end();
+		for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it)
+		{
+			if (oldest == m_tiles.end() || it->second->lastUse < oldest->second->lastUse)
+			{
+				oldest = it;
+			}
+		}
+		assert(oldest->second->lastUse < m_frame);
+		m_tiles.erase(oldest);
+	}
+}
+
+void TileStreamer::LoaderMain()
+{
+	while (!m_bStop)
+	{
+		TileRequest request;
+		if (!m_requests.TryPop(request))
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wakeCondition.wait(lock, [this]() { return m_bStop || !m_requests.IsEmpty(); });
+			continue;
+		}
+
+		std::unique_ptr<TerrainTile> tile(new TerrainTile());
+		tile->tileX = request.tileX;
+		tile->tileZ = request.tileZ;
+
+		if (GetTileDistance(request.tileX, request.tileZ, m_eyeX, m_eyeZ) > m_cancelRadius)
+		{
+			tile->bCancelled = true;
+		}
+		else
+		{
+			// An exception must not end the thread, which would take the
+			// process with it; the render thread learns of the failure from
+			// the tile instead.
+			try
+			{
+				LoadTile(*tile);
+			}
+			catch (const std::exception&)
+			{
+				std::vector<VertexPositionNormalUV>().swap(tile->vertices);
+				tile->vertexBuffer.Reset();
+				tile->bFailed = true;
+			}
+		}
+
+		// There are never more tiles in flight than the queue holds, so this
+		// only spins if the render thread fell behind on taking them.
+		while (!m_arrivals.TryPush(tile))
+		{
+			if (m_bStop)
+				return;
+			std::this_thread::yield();
+		}
+	}
+}
+
+void TileStreamer::LoadTile(TerrainTile& tile) const
+{
+	const UINT n = m_tileCells + 1;
+	const UINT vertexCount = n * n;
+	const float spacing = m_tileSize / m_tileCells;
+	const float left = -0.5f * m_mapSize + tile.tileX * m_tileSize;
+	const float top = -0.5f * m_mapSize + (tile.tileZ + 1) * m_tileSize;
+
+	std::vector<XMFLOAT2> points(vertexCount);
+	for (UINT i = 0; i < n; ++i)
+	{
+		for (UINT j = 0; j < n; ++j)
+		{
+			points[i*n + j] = XMFLOAT2(left + j * spacing, top - i * spacing);
+		}
+	}
+
+	// Not on the worker pool, which the render thread may be waiting on.
+	std::vector<float> heights(vertexCount);
+	std::vector<XMFLOAT3> normals(vertexCount);
+	m_heightField.Evaluate(points.data(), vertexCount, heights.data(), normals.data());
+
+	tile.vertices.resize(vertexCount);
+	for (UINT i = 0; i < n; ++i)
+	{
+		for (UINT j = 0; j < n; ++j)
+		{
+			VertexPositionNormalUV& vertex = tile.vertices[i*n + j];
+			vertex.position = XMFLOAT3(points[i*n + j].x, heights[i*n + j], points[i*n + j].y);
+			vertex.normal = normals[i*n + j];
+			vertex.textureUV = XMFLOAT2(float(j) / m_tileCells, float(i) / m_tileCells);
+		}
+	}
+
+	if (m_device)
+	{
+		D3D11_BUFFER_DESC vbDesc;
+		vbDesc.ByteWidth = static_cast<UINT>(GetTileBytes());
+		vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vbDesc.CPUAccessFlags = 0;
+		vbDesc.MiscFlags = 0;
+		vbDesc.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA vbInitData;
+		vbInitData.pSysMem = tile.vertices.data();
+		vbInitData.SysMemPitch = 0;
+		vbInitData.SysMemSlicePitch = 0;
+
+		HRESULT hr = m_device->CreateBuffer(&vbDesc, &vbInitData, tile.vertexBuffer.GetAddressOf());
+		DX::ThrowIfFailed(hr);
+
+		std::vector<VertexPositionNormalUV>().swap(tile.vertices);
+	}
+}
+
+float TileStreamer::GetTileDistance(UINT tileX, UINT tileZ, float x, float z) const
+{
+	const float left = -0.5f * m_mapSize + tileX * m_tileSize;
+	const float back = -0.5f * m_mapSize + tileZ * m_tileSize;
+	const float dx = std::max(std::max(left - x, x - (left + m_tileSize)), 0.0f);
+	const float dz = std::max(std::max(back - z, z - (back + m_tileSize)), 0.0f);
+	return sqrtf(dx * dx + dz * dz);
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#pragma once
+#include "Common/Heightmap.h"
+#include "Common/SpscQueue.h"
+#include "Common/VertexStructuer.h"
+#include <condition_variable>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+// A square of terrain, tileCells x tileCells cells in world space, laid out
+// row by row from +z like the hill grids, so every tile is drawn with the
+// same grid indices.
+struct TerrainTile
+{
+	UINT tileX = 0;
+	UINT tileZ = 0;
+
+	// Moved to vertexBuffer when the streamer has a device.
+	std::vector<VertexPositionNormalUV> vertices;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+
+	// Frame of the last Update that wanted the tile.
+	UINT64 lastUse = 0;
+
+	// Left unloaded because the camera moved away before the loader got to it.
+	bool bCancelled = false;
+
+	// Left unloaded because building it threw, e.g. a page of a mapped
+	// heightmap or the vertex buffer could not be created.
+	bool bFailed = false;
+};
+
+// Streams the tiles of a large height field in a ring around the camera.
+// The render thread asks for the tiles it is missing, nearest first, and a
+// loader thread builds them from the height field, mapped from disk or
+// generated, and creates their vertex buffers; ID3D11Device is free
+// threaded. Requests and finished tiles pass between the two threads
+// through lock-free queues, so neither side ever waits for the other.
+//
+// Tiles stay resident after the camera moves on, until the resident budget
+// runs out; then the least recently wanted ones are evicted first. The ring
+// is cut down to the tiles the budget can hold, so the tiles of the current
+// frame are never evicted.
+//
+// All a tile costs the frame it arrives on is an insertion into the resident
+// set and at most one eviction, and Update takes at most
+// maxArrivalsPerFrame tiles per call, leaving the rest for the next frames.
+// Tools/Headless checks that no Update of a fly-through of a 16384 x 16384
+// map with the defaults takes more than 0.2 ms of render thread CPU time.
+//
+// A tile that fails to load is never asked for again and leaves a hole in
+// the ring; the loader keeps running.
+class TileStreamer
+{
+public:
+	// Tiles of tileSize x tileSize over a mapSize x mapSize map centered on
+	// the origin. Without a device tiles keep their vertices on the CPU.
+	// heightField must outlive the streamer; it is read from the loader
+	// thread only.
+	TileStreamer(const HeightField& heightField, float mapSize, float tileSize, UINT tileCells, ID3D11Device* device = nullptr);
+	~TileStreamer();
+
+	TileStreamer(const TileStreamer&) = delete;
+	TileStreamer& operator=(const TileStreamer&) = delete;
+
+	// Tiles with any point within radius of the camera in the xz plane are wanted.
+	void SetLoadRadius(float radius) { m_loadRadius = radius; }
+	float GetLoadRadius() const { return m_loadRadius; }
+
+	// Bytes of vertex data that may stay resident.
+	void SetResidentBudget(size_t bytes) { m_residentBudget = bytes; }
+	size_t GetResidentBudget() const { return m_residentBudget; }
+
+	void SetMaxArrivalsPerFrame(UINT count) { m_maxArrivalsPerFrame = count; }
+
+	// Once a frame on the render thread, with the camera at (eyeX, eyeZ) in
+	// the space of the map: takes finished tiles, asks for missing ones and
+	// evicts what the budget cannot hold.
+	void Update(float eyeX, float eyeZ);
+
+	// Resident tiles within the ring as of the last Update, nearest first.
+	const std::vector<const TerrainTile*>& GetVisibleTiles() const { return m_visibleTiles; }
+
+	// Tiles within the ring, resident or not, as of the last Update.
+	UINT GetWantedTileCount() const { return static_cast<UINT>(m_wanted.size()); }
+
+	UINT GetResidentTileCount() const { return static_cast<UINT>(m_tiles.size()); }
+	size_t GetResidentBytes() const { return m_tiles.size() * GetTileBytes(); }
+	UINT GetPendingTileCount() const { return static_cast<UINT>(m_pending.size()); }
+
+	// Tiles taken by the last Update.
+	UINT GetArrivalCount() const { return m_arrivalCount; }
+
+	// Tiles that failed to load so far.
+	UINT GetFailedTileCount() const { return static_cast<UINT>(m_failedTiles.size()); }
+
+	UINT GetTileCells() const { return m_tileCells; }
+	UINT GetTilesPerSide() const { return m_tilesPerSide; }
+	size_t GetTileBytes() const { return sizeof(VertexPositionNormalUV) * (m_tileCells + 1) * (m_tileCells + 1); }
+
+	// Requests in flight at most.
+	static const UINT MaxPendingTiles = 16;
+
+private:
+
+	struct TileRequest
+	{
+		UINT tileX;
+		UINT tileZ;
+	};
+
+	void LoaderMain();
+	void LoadTile(TerrainTile& tile) const;
+
+	// Distance from (x, z) to the nearest point of a tile.
+	float GetTileDistance(UINT tileX, UINT tileZ, float x, float z) const;
+
+	UINT GetKey(UINT tileX, UINT tileZ) const { return tileZ * m_tilesPerSide + tileX; }
+
+	const HeightField& m_heightField;
+	float m_mapSize;
+	float m_tileSize;
+	UINT m_tileCells;
+	UINT m_tilesPerSide;
+	Microsoft::WRL::ComPtr<ID3D11Device> m_device;
+
+	float m_loadRadius = 512.0f;
+	size_t m_residentBudget = 64 << 20;
+	UINT m_maxArrivalsPerFrame = 4;
+
+	// State of the render thread.
+	UINT64 m_frame = 0;
+	std::unordered_map<UINT, std::unique_ptr<TerrainTile>> m_tiles;
+	std::unordered_set<UINT> m_pending;
+	std::unordered_set<UINT> m_failedTiles;
+	std::vector<std::pair<float, UINT>> m_wanted;
+	std::vector<const TerrainTile*> m_visibleTiles;
+	UINT m_arrivalCount = 0;
+
+	// Render thread to loader, and back.
+	SpscQueue<TileRequest> m_requests;
+	SpscQueue<std::unique_ptr<TerrainTile>> m_arrivals;
+
+	// Camera as of the last Update, for the loader to drop requests that
+	// have left the ring.
+	std::atomic<float> m_eyeX{ 0.0f };
+	std::atomic<float> m_eyeZ{ 0.0f };
+	std::atomic<float> m_cancelRadius{ 0.0f };
+
+	// Only for the loader to sleep on while there are no requests.
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic<bool> m_bStop{ false };
+
+	std::thread m_loader;
+};
\ No newline at end of file
@@ -28,4 +28,19 @@ struct VertexPositionNormalUVTangent
 	DirectX::XMFLOAT3 normal;
 	DirectX::XMFLOAT2 textureUV;
 	DirectX::XMFLOAT3 tangent;
+};
+
+// Static half of a height field vertex; the height comes from another stream.
+struct VertexPositionXZUV
+{
+	DirectX::XMFLOAT2 positionXZ;
+	DirectX::XMFLOAT2 textureUV;
+};
+
+// Dynamic half of a height field vertex. The normal is octahedral encoded
+// around +y and read as DXGI_FORMAT_R16G16_SNORM.
+struct VertexHeightNormal
+{
+	float height;
+	SHORT octNormal[2];
 };
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "pch.h"
+#include "Common/WaveClipmap.h"
+
+using namespace DirectX;
+
+namespace
+{
+	// Largest multiple of step not above value, also for negative values.
+	int FloorToMultiple(int value, int step)
+	{
+		int quotient = value / step;
+		if (value % step != 0 && value < 0)
+		{
+			--quotient;
+		}
+		return quotient * step;
+	}
+}
+
+WaveClipmap::WaveClipmap(UINT ringCells, UINT numLevels)
+	: m_ringCells(ringCells)
+	, m_levels(numLevels)
+{
+	assert(ringCells >= 4 && ringCells % 4 == 0);
+	assert(numLevels > 0);
+
+	const UINT n = ringCells;
+	const UINT q = ringCells / 4;
+
+	m_vertices.reserve((n + 1)*(n + 1));
+	for (UINT y = 0; y <= n; ++y)
+	{
+		for (UINT x = 0; x <= n; ++x)
+		{
+			m_vertices.push_back(XMFLOAT2(float(x), float(y)));
+		}
+	}
+
+	// The finer level covers 2q cells of the hole, which is one cell wider so
+	// the finer level can sit at either of two positions on each axis.
+	const UINT holeBegin = q;
+	const UINT holeEnd = 3 * q + 1;
+
+	m_holeRange.start = 0;
+	AddCells(holeBegin, holeBegin, holeEnd, holeEnd);
+	m_holeRange.count = static_cast<UINT>(m_indices.size());
+
+	m_ringRange.start = static_cast<UINT>(m_indices.size());
+	AddCells(0, 0, n, holeBegin);
+	AddCells(0, holeEnd, n, n);
+	AddCells(0, holeBegin, holeBegin, holeEnd);
+	AddCells(holeEnd, holeBegin, n, holeEnd);
+	m_ringRange.count = static_cast<UINT>(m_indices.size()) - m_ringRange.start;
+
+	// Bit 0 set: the finer level is one cell towards +x, and the trim column
+	// is on the -x side of the hole. Bit 1 is the same along y.
+	for (UINT trim = 0; trim < 4; ++trim)
+	{
+		const UINT column = (trim & 1) ? holeBegin : holeEnd - 1;
+		const UINT row = (trim & 2) ? holeBegin : holeEnd - 1;
+
+		m_trimRanges[trim].start = static_cast<UINT>(m_indices.size());
+		AddCells(column, holeBegin, column + 1, holeEnd);
+		if (column > holeBegin)
+		{
+			AddCells(holeBegin, row, column, row + 1);
+		}
+		if (column + 1 < holeEnd)
+		{
+			AddCells(column + 1, row, holeEnd, row + 1);
+		}
+		m_trimRanges[trim].count = static_cast<UINT>(m_indices.size()) - m_trimRanges[trim].start;
+	}
+
+	Update(0.0f, 0.0f);
+}
+
+WaveClipmap::IndexRange WaveClipmap::GetLevelRange(UINT level) const
+{
+	if (level == 0)
+	{
+		// The hole cells come right before the ring.
+		IndexRange range = { m_holeRange.start, m_holeRange.count + m_ringRange.count };
+		return range;
+	}
+	return m_ringRange;
+}
+
+WaveClipmap::IndexRange WaveClipmap::GetTrimRange(UINT level) const
+{
+	if (level == 0)
+	{
+		IndexRange range = { 0, 0 };
+		return range;
+	}
+	return m_trimRanges[m_levels[level].trim];
+}
+
+void WaveClipmap::Update(float row, float col)
+{
+	const int halfCells = int(m_ringCells / 2);
+
+	// Centers snap to twice the spacing of their level, which keeps the
+	// outer vertices of a level on the vertices of the next coarser one.
+	int centerRow = 2 * int(floorf(0.5f * row + 0.5f));
+	int centerCol = 2 * int(floorf(0.5f * col + 0.5f));
+
+	for (UINT level = 0; level < GetLevelCount(); ++level)
+	{
+		ClipmapLevel& clipmapLevel = m_levels[level];
+		const int scale = 1 << level;
+
+		clipmapLevel.scale = UINT(scale);
+		clipmapLevel.trim = 0;
+
+		if (level > 0)
+		{
+			const int finerRow = centerRow;
+			const int finerCol = centerCol;
+			centerRow = FloorToMultiple(finerRow, 2 * scale);
+			centerCol = FloorToMultiple(finerCol, 2 * scale);
+
+			if (finerCol != centerCol)
+			{
+				clipmapLevel.trim |= 1;
+			}
+			if (finerRow != centerRow)
+			{
+				clipmapLevel.trim |= 2;
+			}
+		}
+
+		clipmapLevel.originRow = centerRow - halfCells * scale;
+		clipmapLevel.originCol = centerCol - halfCells * scale;
+	}
+}
+
+void WaveClipmap::AddCells(UINT x0, UINT y0, UINT x1, UINT y1)
+{
+	const UINT stride = m_ringCells + 1;
+
+	// Same triangulation as the LitWave grid.
+	for (UINT y = y0; y < y1; ++y)
+	{
+		for (UINT x = x0; x < x1; ++x)
+		{
+			m_indices.push_back(y * stride + x);
+			m_indices.push_back(y * stride + x + 1);
+			m_indices.push_back((y + 1) * stride + x);
+
+			m_indices.push_back((y + 1) * stride + x);
+			m_indices.push_back(y * stride + x + 1);
+			m_indices.push_back((y + 1) * stride + x + 1);
+		}
+	}
+}
\ No newline at end of file
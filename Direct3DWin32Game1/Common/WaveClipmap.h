@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+
+// Placement of one clipmap level, in row and column indices of the height
+// field. Ring vertex (x, y) samples height (originRow + y*scale, originCol + x*scale).
+struct ClipmapLevel
+{
+	int originRow;
+	int originCol;
+	UINT scale;
+	// Which trim strip fills the gap around the next finer level, see WaveClipmap.
+	UINT trim;
+};
+
+// Nested square rings of grid around a viewer for drawing large height
+// fields, after geometry clipmaps. Level 0 is a full ringCells x ringCells
+// block at the resolution of the height field; every further level has the
+// same number of cells at twice the spacing of the one inside it, with a
+// hole the finer level sits in.
+//
+// All levels share one mesh of (ringCells + 1)^2 vertices holding integer
+// ring coordinates; only the placement of each level changes per frame.
+// Each level snaps to twice its own spacing, so its outer vertices line up
+// with every other vertex of the next coarser level. The finer level may sit
+// one coarse cell off center in the hole, and one of four L-shaped trim
+// strips closes the remaining gap. Odd vertices on the outer edge of a level
+// take the height halfway between their neighbors, which is where the
+// coarser level's edge runs, so no cracks open between levels.
+class WaveClipmap
+{
+public:
+	// ringCells must be a multiple of 4.
+	explicit WaveClipmap(UINT ringCells = 32, UINT numLevels = 4);
+
+	struct IndexRange
+	{
+		UINT start;
+		UINT count;
+	};
+
+	UINT GetRingCells() const { return m_ringCells; }
+	UINT GetLevelCount() const { return static_cast<UINT>(m_levels.size()); }
+
+	// Ring coordinates of the shared vertices and the triangle list indices of all parts.
+	const std::vector<DirectX::XMFLOAT2>& GetVertices() const { return m_vertices; }
+	const std::vector<UINT>& GetIndices() const { return m_indices; }
+
+	// Indices to draw for a level: the full block for level 0, the ring around
+	// the hole otherwise, and the trim strip of a level (empty for level 0).
+	IndexRange GetLevelRange(UINT level) const;
+	IndexRange GetTrimRange(UINT level) const;
+
+	// Places the levels around a viewer at the given fractional row and column.
+	// The cost only depends on the number of levels.
+	void Update(float row, float col);
+
+	const ClipmapLevel& GetLevel(UINT level) const { return m_levels[level]; }
+
+private:
+
+	// Appends the two triangles of every cell in [x0, x1) x [y0, y1).
+	void AddCells(UINT x0, UINT y0, UINT x1, UINT y1);
+
+	UINT m_ringCells;
+
+	std::vector<DirectX::XMFLOAT2> m_vertices;
+	std::vector<UINT> m_indices;
+
+	IndexRange m_holeRange;
+	IndexRange m_ringRange;
+	IndexRange m_trimRanges[4];
+
+	std::vector<ClipmapLevel> m_levels;
+};
\ No newline at end of file
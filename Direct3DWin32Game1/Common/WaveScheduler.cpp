@@ -0,0 +1,123 @@
+#include "pch.h"
+#include "Common/WaveScheduler.h"
+#include "Common/WorkerPool.h"
+#include <algorithm>
+
+UINT WaveClock::Advance(float dt)
+{
+	// Accumulate time.
+	m_time += dt;
+
+	// Only update the simulation at the specified time step.
+	UINT numSteps = 0;
+	while (m_time >= m_timeStep && numSteps < m_maxSubsteps)
+	{
+		m_time -= m_timeStep;
+		++numSteps;
+	}
+
+	if (m_time >= m_timeStep)
+	{
+		m_time = fmodf(m_time, m_timeStep);
+	}
+
+	return numSteps;
+}
+
+WaveScheduler::WaveScheduler(WorkerPool* pool)
+	: m_workerPool(pool)
+{
+}
+
+void WaveScheduler::Submit(WaveSolver& solver, UINT numSteps, float alpha,
+	const WaveSolver::RowWriter& writeRow, const std::function<void()>& onDone)
+{
+	m_jobs.push_back({ &solver, numSteps, alpha, writeRow, onDone });
+}
+
+void WaveScheduler::Run()
+{
+	const UINT numJobs = GetPendingCount();
+	if (numJobs == 0)
+		return;
+
+	// Start with the most expensive bodies, so the small ones fill the gaps
+	// at the end of the batch.
+	auto getCost = [this](UINT job)
+	{
+		const Job& j = m_jobs[job];
+		return UINT64(j.solver->GetGrid().GetVertexCount()) * std::max(j.numSteps, 1u);
+	};
+
+	m_order.resize(numJobs);
+	for (UINT job = 0; job < numJobs; ++job)
+	{
+		m_order[job] = job;
+	}
+	std::stable_sort(m_order.begin(), m_order.end(), [&](UINT a, UINT b) { return getCost(a) > getCost(b); });
+
+	// One band per body. Loops the solvers start from inside a band run on
+	// that band's thread.
+	auto runJobs = [this](UINT begin, UINT end)
+	{
+		for (UINT k = begin; k < end; ++k)
+		{
+			Job& job = m_jobs[m_order[k]];
+			job.solver->Advance(job.numSteps, job.writeRow, job.alpha);
+		}
+	};
+
+	if (numJobs > 1)
+	{
+		WorkerPool* pool = m_workerPool ? m_workerPool : &WorkerPool::GetDefault();
+		pool->ParallelFor(0, numJobs, numJobs, runJobs);
+	}
+	else
+	{
+		runJobs(0, numJobs);
+	}
+
+	for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it)
+	{
+		if (it->onDone)
+		{
+			it->onDone();
+		}
+	}
+
+	m_jobs.clear();
+}
+
+WaveQualityGovernor::WaveQualityGovernor(float frameBudget, UINT numLevels)
+	: m_frameBudget(frameBudget)
+	, m_numLevels(numLevels)
+	, m_averageFrameTime(frameBudget)
+{
+	assert(numLevels > 0);
+}
+
+bool WaveQualityGovernor::Update(float frameTime)
+{
+	m_averageFrameTime += (frameTime - m_averageFrameTime) * m_smoothing;
+	m_timeSinceChange += frameTime;
+
+	if (m_timeSinceChange < m_holdTime)
+		return false;
+
+	UINT level = m_level;
+	if (m_averageFrameTime > m_frameBudget && level + 1 < m_numLevels)
+	{
+		++level;
+	}
+	else if (m_averageFrameTime < m_frameBudget * m_raiseRatio && level > 0)
+	{
+		--level;
+	}
+
+	if (level == m_level)
+		return false;
+
+	m_level = level;
+	m_timeSinceChange = 0.0f;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include "Common/WaveSolver.h"
+#include <functional>
+#include <vector>
+
+class WorkerPool;
+
+// Fixed step time keeping of one water body. Frame times are accumulated and
+// every whole time step that has built up is simulated, so the cost of the
+// simulation follows the time step and not the frame rate. Frames in between
+// two steps blend the last two solutions by GetAlpha().
+class WaveClock
+{
+public:
+	explicit WaveClock(float timeStep, UINT maxSubsteps = 4)
+		: m_timeStep(timeStep)
+		, m_maxSubsteps(maxSubsteps)
+	{
+	}
+
+	// Adds dt to the clock and returns the number of steps that are due. At
+	// most maxSubsteps steps are taken per call; time beyond that is dropped,
+	// so a long frame cannot make the following frames longer still.
+	UINT Advance(float dt);
+
+	// Time accumulated since the last step, as a fraction of a time step.
+	float GetAlpha() const { return m_time / m_timeStep; }
+
+	void SetMaxSubsteps(UINT maxSubsteps) { m_maxSubsteps = maxSubsteps; }
+	UINT GetMaxSubsteps() const { return m_maxSubsteps; }
+
+	float GetTimeStep() const { return m_timeStep; }
+
+private:
+	float m_timeStep;
+	UINT m_maxSubsteps;
+	float m_time = 0.0f;
+};
+
+// Steps many water bodies as one batch. Bodies are queued with Submit while
+// the objects update and Run hands them out to the worker pool one body per
+// task, largest first, so dozens of small grids keep every thread busy. A
+// batch of a single body runs on the calling thread and its solver can use
+// the pool itself.
+//
+// Submit and Run must be called from the same thread.
+class WaveScheduler
+{
+public:
+	// Without a pool, batches of more than one body go to WorkerPool::GetDefault().
+	explicit WaveScheduler(WorkerPool* pool = nullptr);
+
+	WaveScheduler(const WaveScheduler&) = delete;
+	WaveScheduler& operator=(const WaveScheduler&) = delete;
+
+	// Queues numSteps steps of solver, see WaveSolver::Advance. writeRow is
+	// called from worker threads. onDone runs on the thread that calls Run once
+	// the whole batch has finished, e.g. to unmap the buffer the rows went to.
+	void Submit(WaveSolver& solver, UINT numSteps, float alpha,
+		const WaveSolver::RowWriter& writeRow, const std::function<void()>& onDone);
+
+	// Runs and removes every queued body.
+	void Run();
+
+	UINT GetPendingCount() const { return static_cast<UINT>(m_jobs.size()); }
+
+private:
+
+	struct Job
+	{
+		WaveSolver* solver;
+		UINT numSteps;
+		float alpha;
+		WaveSolver::RowWriter writeRow;
+		std::function<void()> onDone;
+	};
+
+	WorkerPool* m_workerPool;
+
+	std::vector<Job> m_jobs;
+	std::vector<UINT> m_order;
+};
+
+// Picks a detail level for water from the frame times, to trade fidelity for
+// frame time in heavy scenes. Level 0 is full detail and every further level
+// is cheaper, e.g. LitWave::SetDetailLevel. Frame times are smoothed; the
+// level goes up when they stay over the budget and back down once they are
+// well under it, and holds for a while after every change so the frame
+// times of the new level can settle first.
+class WaveQualityGovernor
+{
+public:
+	explicit WaveQualityGovernor(float frameBudget = 1.0f / 60.0f, UINT numLevels = 3);
+
+	// Adds the time of the last frame; returns true when the level changed.
+	bool Update(float frameTime);
+
+	UINT GetLevel() const { return m_level; }
+	UINT GetLevelCount() const { return m_numLevels; }
+
+	void SetFrameBudget(float frameBudget) { m_frameBudget = frameBudget; }
+	float GetFrameBudget() const { return m_frameBudget; }
+
+	float GetAverageFrameTime() const { return m_averageFrameTime; }
+
+private:
+	float m_frameBudget;
+	UINT m_numLevels;
+	UINT m_level = 0;
+
+	float m_averageFrameTime;
+	float m_timeSinceChange = 0.0f;
+
+	// Weight of the newest frame in the average.
+	const float m_smoothing = 0.05f;
+	// Fraction of the budget below which detail comes back. A level costs
+	// about four times the next one, so this leaves room for the step up.
+	const float m_raiseRatio = 0.5f;
+	// Seconds a level holds after a change.
+	const float m_holdTime = 2.0f;
+};
\ No newline at end of file
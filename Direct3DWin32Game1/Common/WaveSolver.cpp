@@ -0,0 +1,1246 @@
+#include "pch.h"
+#include "Common/WaveSolver.h"
+#include "Common/WorkerPool.h"
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#define WAVE_KERNEL_AVX2 1
+#define WAVE_TARGET_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+// GCC and Clang, for the headless build in Tools/Headless. They only accept
+// AVX2 intrinsics in functions compiled for it.
+#define WAVE_KERNEL_AVX2 1
+#define WAVE_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// All kernels evaluate k1*prev + k2*curr + k3*(((below + above) + right) + left)
+	// in the same order and without fused multiply-add, so they produce the same
+	// results as the scalar path.
+
+	// Rows are processed in tiles of this many rows by the fused pass. Each tile
+	// recomputes the new heights of the row above and below it, which keeps
+	// tiles independent and costs 2/FusedTileRows extra stencil work.
+	// Bands have to cover whole activity tiles, which keeps tile energies
+	// private to one thread.
+	const UINT FusedTileRows = 64;
+	static_assert(FusedTileRows % WaveSolver::ActiveTileSize == 0, "Fused tiles must cover whole activity tiles");
+
+	// Side of the square tiles of temporally blocked steps. With the halo of
+	// MaxBlockedSteps cells on each side, the two scratch planes and the
+	// window of the two solutions read take about 330 KB, which stays in L2.
+	const UINT TemporalTileSize = 128;
+	const UINT MinBlockedSteps = 3;
+	static_assert(TemporalTileSize % WaveSolver::ActiveTileSize == 0, "Temporal tiles must cover whole activity tiles");
+	static_assert(WaveSolver::MaxBlockedSteps < WaveSolver::ActiveTileSize, "A block must not carry waves past the ring of tiles it steps");
+
+	// Steps a tile has to stay below the sleep threshold before it is zeroed.
+	// A wavefront entering a quiet tile starts below the threshold, and
+	// zeroing it at once would cut off its leading edge every step. Less
+	// than ActiveTileSize, so the tiles kept awake by numerical noise ahead
+	// of a wave stay one ring deep.
+	const UINT QuietStepsToSleep = 8;
+	static_assert(QuietStepsToSleep < WaveSolver::ActiveTileSize, "Noise must not reach the next ring of tiles while a tile waits");
+
+	// A tile that fell asleep keeps its last heights until the next step
+	// starts, so everything written during a step agrees with the result.
+	enum TileState : BYTE
+	{
+		TileAsleep,
+		TileActive,
+		TileFallingAsleep
+	};
+
+	// Blends rows of an older and a newer solution for output between two
+	// steps. Rows have to be asked for in increasing order and each one is
+	// blended once while it is one of the last three rows asked for.
+	class RowBlender
+	{
+	public:
+		RowBlender(UINT numCols, float alpha)
+			: m_numCols(numCols)
+			, m_alpha(alpha)
+			, m_rows(3 * numCols)
+		{
+			m_rowIndices[0] = m_rowIndices[1] = m_rowIndices[2] = UINT_MAX;
+		}
+
+		const float* Blend(UINT i, const float* oldRow, const float* newRow)
+		{
+			float* row = m_rows.data() + (i % 3) * m_numCols;
+			if (m_rowIndices[i % 3] != i)
+			{
+				for (UINT j = 0; j < m_numCols; ++j)
+				{
+					row[j] = oldRow[j] + m_alpha * (newRow[j] - oldRow[j]);
+				}
+				m_rowIndices[i % 3] = i;
+			}
+			return row;
+		}
+
+	private:
+		UINT m_numCols;
+		float m_alpha;
+		std::vector<float> m_rows;
+		UINT m_rowIndices[3];
+	};
+
+	void StepRowScalar(float* next, const float* prev, const float* above, const float* curr, const float* below,
+		UINT begin, UINT end, float k1, float k2, float k3)
+	{
+		for (UINT j = begin; j < end; ++j)
+		{
+			next[j] =
+				k1 * prev[j] +
+				k2 * curr[j] +
+				k3 * (below[j] +
+					above[j] +
+					curr[j + 1] +
+					curr[j - 1]);
+		}
+	}
+
+	void StepRowVector(float* next, const float* prev, const float* above, const float* curr, const float* below,
+		UINT begin, UINT end, float k1, float k2, float k3)
+	{
+		const XMVECTOR K1 = XMVectorReplicate(k1);
+		const XMVECTOR K2 = XMVectorReplicate(k2);
+		const XMVECTOR K3 = XMVectorReplicate(k3);
+
+		UINT j = begin;
+		for (; j + 4 <= end; j += 4)
+		{
+			XMVECTOR p = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(prev + j));
+			XMVECTOR c = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j));
+			XMVECTOR a = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(above + j));
+			XMVECTOR b = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(below + j));
+			XMVECTOR r = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j + 1));
+			XMVECTOR l = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(curr + j - 1));
+
+			XMVECTOR sum = XMVectorAdd(XMVectorAdd(XMVectorAdd(b, a), r), l);
+			XMVECTOR result = XMVectorAdd(XMVectorMultiply(K1, p), XMVectorMultiply(K2, c));
+			result = XMVectorAdd(result, XMVectorMultiply(K3, sum));
+
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(next + j), result);
+		}
+
+		StepRowScalar(next, prev, above, curr, below, j, end, k1, k2, k3);
+	}
+
+#if WAVE_KERNEL_AVX2
+	// MSVC accepts AVX intrinsics without /arch:AVX2, so this is only ever
+	// called after IsAVX2Supported() has checked the CPU and the OS.
+	WAVE_TARGET_AVX2 void StepRowAVX2(float* next, const float* prev, const float* above, const float* curr, const float* below,
+		UINT begin, UINT end, float k1, float k2, float k3)
+	{
+		const __m256 K1 = _mm256_set1_ps(k1);
+		const __m256 K2 = _mm256_set1_ps(k2);
+		const __m256 K3 = _mm256_set1_ps(k3);
+
+		UINT j = begin;
+		for (; j + 8 <= end; j += 8)
+		{
+			__m256 p = _mm256_loadu_ps(prev + j);
+			__m256 c = _mm256_loadu_ps(curr + j);
+			__m256 a = _mm256_loadu_ps(above + j);
+			__m256 b = _mm256_loadu_ps(below + j);
+			__m256 r = _mm256_loadu_ps(curr + j + 1);
+			__m256 l = _mm256_loadu_ps(curr + j - 1);
+
+			__m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(b, a), r), l);
+			__m256 result = _mm256_add_ps(_mm256_mul_ps(K1, p), _mm256_mul_ps(K2, c));
+			result = _mm256_add_ps(result, _mm256_mul_ps(K3, sum));
+
+			_mm256_storeu_ps(next + j, result);
+		}
+
+		// The tail runs SSE code, which stalls on every row while the upper
+		// halves of the YMM registers are dirty.
+		_mm256_zeroupper();
+		StepRowVector(next, prev, above, curr, below, j, end, k1, k2, k3);
+	}
+
+	bool IsAVX2Supported()
+	{
+#if defined(__GNUC__)
+		// Checks the OS support for the YMM registers as well.
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// The OS has to save the YMM registers on context switches.
+		__cpuid(info, 1);
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx = (info[2] & (1 << 28)) != 0;
+		if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+			return false;
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#endif
+	}
+#endif
+}
+
+WaveSolver::WaveSolver(UINT numRows, UINT numCols, float spatialStep, float timeStep, float speed, float damping)
+	: m_grid(numRows, numCols, spatialStep)
+	, m_timeStep(timeStep)
+	, m_speed(speed)
+	, m_damping(damping)
+{
+	UpdateCoefficients();
+
+	const UINT vertexCount = m_grid.GetVertexCount();
+
+	m_prevHeights = new float[vertexCount];
+	m_currHeights = new float[vertexCount];
+	m_nextHeights = new float[vertexCount];
+
+	// Boundary rows and columns are never written again, which gives the
+	// zero boundary conditions.
+	std::fill(m_prevHeights, m_prevHeights + vertexCount, 0.0f);
+	std::fill(m_currHeights, m_currHeights + vertexCount, 0.0f);
+	std::fill(m_nextHeights, m_nextHeights + vertexCount, 0.0f);
+
+	// Still water, so every tile starts asleep.
+	m_numTileRows = (numRows + ActiveTileSize - 1) / ActiveTileSize;
+	m_numTileCols = (numCols + ActiveTileSize - 1) / ActiveTileSize;
+	m_tileState.assign(GetTileCount(), TileAsleep);
+	m_tileStepped.assign(GetTileCount(), 0);
+	m_tileEnergy.assign(GetTileCount(), 0.0f);
+	m_tileQuietSteps.assign(GetTileCount(), 0);
+
+	SetImpulseCapacity(4096);
+
+	SetKernel(GetBestKernel());
+}
+
+WaveSolver::~WaveSolver()
+{
+	delete[] m_prevHeights;
+	delete[] m_currHeights;
+	delete[] m_nextHeights;
+	delete[] m_blockHeights;
+}
+
+void WaveSolver::Resize(UINT numRows, UINT numCols, float spatialStep)
+{
+	assert(numRows >= 3 && numCols >= 3 && spatialStep > 0.0f);
+
+	const WaveGrid oldGrid = m_grid;
+	m_grid = WaveGrid(numRows, numCols, spatialStep);
+	UpdateCoefficients();
+
+	const UINT vertexCount = m_grid.GetVertexCount();
+
+	float* prevHeights = new float[vertexCount];
+	float* currHeights = new float[vertexCount];
+	std::fill(prevHeights, prevHeights + vertexCount, 0.0f);
+	std::fill(currHeights, currHeights + vertexCount, 0.0f);
+
+	ResamplePlane(oldGrid, m_prevHeights, prevHeights);
+	ResamplePlane(oldGrid, m_currHeights, currHeights);
+
+	delete[] m_prevHeights;
+	delete[] m_currHeights;
+	delete[] m_nextHeights;
+	delete[] m_blockHeights;
+
+	m_prevHeights = prevHeights;
+	m_currHeights = currHeights;
+	m_nextHeights = new float[vertexCount];
+	m_blockHeights = nullptr;
+	std::fill(m_nextHeights, m_nextHeights + vertexCount, 0.0f);
+
+	// Tiles that got any of the old waves are active, the rest are flat in
+	// every plane and can sleep.
+	m_numTileRows = (numRows + ActiveTileSize - 1) / ActiveTileSize;
+	m_numTileCols = (numCols + ActiveTileSize - 1) / ActiveTileSize;
+	m_tileState.assign(GetTileCount(), TileAsleep);
+	m_tileStepped.assign(GetTileCount(), 0);
+	m_tileEnergy.assign(GetTileCount(), 0.0f);
+
+	for (UINT i = 0; i < numRows; ++i)
+	{
+		const float* prevRow = m_prevHeights + i * numCols;
+		const float* currRow = m_currHeights + i * numCols;
+		float* rowEnergy = m_tileEnergy.data() + (i / ActiveTileSize) * m_numTileCols;
+
+		for (UINT j = 0; j < numCols; ++j)
+		{
+			float& energy = rowEnergy[j / ActiveTileSize];
+			energy = std::max(energy, std::max(fabsf(prevRow[j]), fabsf(currRow[j])));
+		}
+	}
+
+	m_tileQuietSteps.assign(GetTileCount(), 0);
+	m_numActiveTiles = 0;
+	for (UINT tile = 0; tile < GetTileCount(); ++tile)
+	{
+		if (m_tileEnergy[tile] > 0.0f)
+		{
+			m_tileState[tile] = TileActive;
+			++m_numActiveTiles;
+		}
+	}
+
+	// Impulses are queued in cells of the old grid; move them to the same
+	// positions on the new one.
+	const float scale = oldGrid.spatialStep / spatialStep;
+	const float rowOffset = (m_grid.halfDepth - oldGrid.halfDepth) / spatialStep;
+	const float colOffset = (m_grid.halfWidth - oldGrid.halfWidth) / spatialStep;
+
+	std::lock_guard<std::mutex> lock(m_impulseMutex);
+	for (WaveImpulse& impulse : m_queuedImpulses)
+	{
+		impulse.row = rowOffset + impulse.row * scale;
+		impulse.col = colOffset + impulse.col * scale;
+		impulse.radius *= scale;
+	}
+}
+
+void WaveSolver::UpdateCoefficients()
+{
+	float dt = m_timeStep;
+	float dx = m_grid.spatialStep;
+
+	float d = m_damping * dt + 2.0f;
+	float e = (m_speed*m_speed)*(dt*dt) / (dx*dx);
+	mK1 = (m_damping*dt - 2.0f) / d;
+	mK2 = (4.0f - 8.0f*e) / d;
+	mK3 = (2.0f*e) / d;
+}
+
+void WaveSolver::ResamplePlane(const WaveGrid& oldGrid, const float* plane, float* resampled) const
+{
+	const UINT oldRows = oldGrid.numRows;
+	const UINT oldCols = oldGrid.numCols;
+	const UINT n = m_grid.numCols;
+
+	// Fractional row and column on the old grid of the point (i, j) are
+	// rowOffset + i*scale and colOffset + j*scale.
+	const float scale = m_grid.spatialStep / oldGrid.spatialStep;
+	const float rowOffset = (oldGrid.halfDepth - m_grid.halfDepth) / oldGrid.spatialStep;
+	const float colOffset = (oldGrid.halfWidth - m_grid.halfWidth) / oldGrid.spatialStep;
+
+	ForEachInteriorRowBand([&](UINT rowBegin, UINT rowEnd)
+	{
+		for (UINT i = rowBegin; i < rowEnd; ++i)
+		{
+			const float row = rowOffset + i * scale;
+			if (row < 0.0f || row > float(oldRows - 1))
+				continue;
+
+			// The old boundary is flat, so points past it fade out to zero.
+			const UINT i0 = std::min(UINT(row), oldRows - 2);
+			const float fi = row - float(i0);
+			const float* above = plane + i0 * oldCols;
+			const float* below = above + oldCols;
+
+			float* out = resampled + i * n;
+			for (UINT j = 1; j < n - 1; ++j)
+			{
+				const float col = colOffset + j * scale;
+				if (col < 0.0f || col > float(oldCols - 1))
+					continue;
+
+				const UINT j0 = std::min(UINT(col), oldCols - 2);
+				const float fj = col - float(j0);
+
+				const float top = above[j0] + (above[j0 + 1] - above[j0]) * fj;
+				const float bottom = below[j0] + (below[j0 + 1] - below[j0]) * fj;
+				out[j] = top + (bottom - top) * fi;
+			}
+		}
+	});
+}
+
+void WaveSolver::Step()
+{
+	BeginActiveStep();
+
+	// Bands are whole rows of tiles, see StepRow.
+	auto stepTileRows = [this](UINT tileRowBegin, UINT tileRowEnd)
+	{
+		// Only update interior points; we use zero boundary conditions.
+		StepRows(std::max(tileRowBegin * ActiveTileSize, 1u),
+			std::min(tileRowEnd * ActiveTileSize, m_grid.numRows - 1));
+	};
+
+	if (m_workerPool)
+	{
+		m_workerPool->ParallelFor(0, m_numTileRows, stepTileRows);
+	}
+	else
+	{
+		stepTileRows(0, m_numTileRows);
+	}
+
+	SwapSolutions();
+
+	EndActiveStep(true);
+}
+
+void WaveSolver::Step(UINT numSteps)
+{
+	// Two steps per block save less than copying the tiles out costs.
+	if (numSteps < MinBlockedSteps || !CanBlockSteps())
+	{
+		for (UINT step = 0; step < numSteps; ++step)
+		{
+			Step();
+		}
+		return;
+	}
+
+	// Blocks of even length, so the last one is not too short to pay off.
+	const UINT numBlocks = (numSteps + MaxBlockedSteps - 1) / MaxBlockedSteps;
+	for (UINT block = 0; block < numBlocks; ++block)
+	{
+		StepBlock((numSteps * (block + 1)) / numBlocks - (numSteps * block) / numBlocks);
+	}
+}
+
+void WaveSolver::StepBlock(UINT numSteps)
+{
+	const UINT m = m_grid.numRows;
+	const UINT n = m_grid.numCols;
+
+	if (!m_blockHeights)
+	{
+		m_blockHeights = new float[m_grid.GetVertexCount()];
+		std::fill(m_blockHeights, m_blockHeights + m_grid.GetVertexCount(), 0.0f);
+	}
+
+	const UINT numTiles = GetTileCount();
+	m_blockTileEnergy.resize(MaxBlockedSteps * numTiles);
+	std::fill(m_blockTileEnergy.begin(), m_blockTileEnergy.begin() + numSteps * numTiles, 0.0f);
+
+	BeginActiveStep();
+
+	// A wave travels at most numSteps < ActiveTileSize cells in the block,
+	// so stepping the active tiles and the ring around them, corners
+	// included, computes every cell it can reach. Cells of skipped tiles
+	// are 0 and stay 0.
+	for (UINT tile = 0; tile < numTiles; ++tile)
+	{
+		if (m_tileState[tile] != TileActive)
+			continue;
+
+		const UINT tileRow = tile / m_numTileCols;
+		const UINT tileCol = tile % m_numTileCols;
+		for (UINT row = tileRow > 0 ? tileRow - 1 : 0; row <= std::min(tileRow + 1, m_numTileRows - 1); ++row)
+		{
+			for (UINT col = tileCol > 0 ? tileCol - 1 : 0; col <= std::min(tileCol + 1, m_numTileCols - 1); ++col)
+			{
+				m_tileStepped[row * m_numTileCols + col] = 1;
+			}
+		}
+	}
+
+	const UINT numTileRows = (m + TemporalTileSize - 1) / TemporalTileSize;
+	const UINT numTileCols = (n + TemporalTileSize - 1) / TemporalTileSize;
+
+	auto stepTiles = [&](UINT tileBegin, UINT tileEnd)
+	{
+		const UINT windowSize = TemporalTileSize + 2 * MaxBlockedSteps;
+		std::vector<float> scratch(2 * windowSize * windowSize);
+
+		for (UINT tile = tileBegin; tile < tileEnd; ++tile)
+		{
+			StepBlockTile(tile, numSteps, scratch.data());
+		}
+	};
+
+	if (m_workerPool)
+	{
+		m_workerPool->ParallelFor(0, numTileRows * numTileCols, stepTiles);
+	}
+	else
+	{
+		stepTiles(0, numTileRows * numTileCols);
+	}
+
+	// The two planes just written hold the last two solutions; the two that
+	// were read are free again.
+	float* oldPrev = m_prevHeights;
+	float* oldCurr = m_currHeights;
+	m_prevHeights = m_nextHeights;
+	m_currHeights = m_blockHeights;
+	m_nextHeights = oldPrev;
+	m_blockHeights = oldCurr;
+
+	// Replay the tile states step by step on the energies of each step, so
+	// tiles wake and count quiet steps like single steps do. A tile can only
+	// be zeroed once the block is done, so one that goes quiet for long
+	// enough inside it stays active until then.
+	for (UINT step = 0; step < numSteps; ++step)
+	{
+		std::copy(m_blockTileEnergy.begin() + step * numTiles, m_blockTileEnergy.begin() + (step + 1) * numTiles, m_tileEnergy.begin());
+		MarkSteppedTiles();
+		EndActiveStep(step + 1 == numSteps);
+	}
+
+	// Single steps zero a tile that falls asleep and wake it again on the
+	// wave coming in from an active neighbor. Do both now, or the tile would
+	// miss the first step of the next block and, with blocks as long as the
+	// quiet steps, fall asleep at the end of every block.
+	for (UINT tile = 0; tile < numTiles; ++tile)
+	{
+		if (m_tileState[tile] != TileFallingAsleep)
+			continue;
+
+		const UINT tileRow = tile / m_numTileCols;
+		const UINT tileCol = tile % m_numTileCols;
+		const bool bFed =
+			(tileRow > 0 && m_tileState[tile - m_numTileCols] == TileActive) ||
+			(tileRow + 1 < m_numTileRows && m_tileState[tile + m_numTileCols] == TileActive) ||
+			(tileCol > 0 && m_tileState[tile - 1] == TileActive) ||
+			(tileCol + 1 < m_numTileCols && m_tileState[tile + 1] == TileActive);
+		if (bFed)
+		{
+			ClearTile(tile);
+			m_tileState[tile] = TileActive;
+			++m_numActiveTiles;
+		}
+	}
+}
+
+void WaveSolver::StepBlockTile(UINT tile, UINT numSteps, float* scratch)
+{
+	const UINT m = m_grid.numRows;
+	const UINT n = m_grid.numCols;
+	const UINT numTileCols = (n + TemporalTileSize - 1) / TemporalTileSize;
+
+	// Interior cells owned by the tile.
+	const UINT rowBegin = std::max((tile / numTileCols) * TemporalTileSize, 1u);
+	const UINT rowEnd = std::min((tile / numTileCols + 1) * TemporalTileSize, m - 1);
+	const UINT colBegin = std::max((tile % numTileCols) * TemporalTileSize, 1u);
+	const UINT colEnd = std::min((tile % numTileCols + 1) * TemporalTileSize, n - 1);
+	if (rowBegin >= rowEnd || colBegin >= colEnd)
+		return;
+
+	// Waves do not reach tiles outside the ring stepped, so they are still
+	// flat.
+	bool bStepped = false;
+	for (UINT tileRow = rowBegin / ActiveTileSize; tileRow <= (rowEnd - 1) / ActiveTileSize; ++tileRow)
+	{
+		for (UINT tileCol = colBegin / ActiveTileSize; tileCol <= (colEnd - 1) / ActiveTileSize; ++tileCol)
+		{
+			bStepped = bStepped || m_tileStepped[tileRow * m_numTileCols + tileCol] != 0;
+		}
+	}
+
+	if (!bStepped)
+	{
+		for (UINT i = rowBegin; i < rowEnd; ++i)
+		{
+			std::fill(m_nextHeights + i * n + colBegin, m_nextHeights + i * n + colEnd, 0.0f);
+			std::fill(m_blockHeights + i * n + colBegin, m_blockHeights + i * n + colEnd, 0.0f);
+		}
+		return;
+	}
+
+	// Cells the first step depends on: one more per step on each side.
+	const UINT windowRow = rowBegin > numSteps ? rowBegin - numSteps : 0;
+	const UINT windowCol = colBegin > numSteps ? colBegin - numSteps : 0;
+	const UINT windowRows = std::min(rowEnd + numSteps, m) - windowRow;
+	const UINT windowCols = std::min(colEnd + numSteps, n) - windowCol;
+
+	// A plane of the window: the first two solutions are read in place, the
+	// ones computed here go to two scratch planes. Columns are counted from
+	// windowCol in every plane.
+	struct Plane
+	{
+		float* origin;
+		UINT stride;
+
+		float* Row(UINT i) const { return origin + i * stride; }
+	};
+
+	Plane prev = { m_prevHeights + windowRow * n + windowCol, n };
+	Plane curr = { m_currHeights + windowRow * n + windowCol, n };
+	Plane scratchPlanes[2] =
+	{
+		{ scratch, windowCols },
+		{ scratch + windowRows * windowCols, windowCols }
+	};
+
+	// Cells on the grid boundary are never computed and have to read as 0.
+	for (const Plane& plane : scratchPlanes)
+	{
+		if (windowRow == 0)
+			std::fill(plane.Row(0), plane.Row(0) + windowCols, 0.0f);
+		if (windowRow + windowRows == m)
+			std::fill(plane.Row(windowRows - 1), plane.Row(windowRows - 1) + windowCols, 0.0f);
+
+		for (UINT i = 0; i < windowRows; ++i)
+		{
+			if (windowCol == 0)
+				plane.Row(i)[0] = 0.0f;
+			if (windowCol + windowCols == n)
+				plane.Row(i)[windowCols - 1] = 0.0f;
+		}
+	}
+
+	for (UINT step = 1; step <= numSteps; ++step)
+	{
+		// The kernel may write over the previous solution, so from the third
+		// step on the new solution goes to the plane of the previous one.
+		const Plane next = step <= 2 ? scratchPlanes[step - 1] : prev;
+
+		// Cells still needed by the steps after this one.
+		const UINT shrink = numSteps - step;
+		const UINT stepRowBegin = std::max(rowBegin > shrink ? rowBegin - shrink : 0, 1u);
+		const UINT stepRowEnd = std::min(rowEnd + shrink, m - 1);
+		const UINT stepColBegin = std::max(colBegin > shrink ? colBegin - shrink : 0, 1u);
+		const UINT stepColEnd = std::min(colEnd + shrink, n - 1);
+
+		// Temporal tiles cover whole activity tiles, so the energies of the
+		// cells owned are private to this tile.
+		float* stepEnergy = m_blockTileEnergy.data() + (step - 1) * GetTileCount();
+
+		for (UINT i = stepRowBegin - windowRow; i < stepRowEnd - windowRow; ++i)
+		{
+			m_rowKernel(next.Row(i), prev.Row(i), curr.Row(i - 1), curr.Row(i), curr.Row(i + 1),
+				stepColBegin - windowCol, stepColEnd - windowCol, mK1, mK2, mK3);
+
+			const UINT row = i + windowRow;
+			if (row < rowBegin || row >= rowEnd)
+				continue;
+
+			const float* nextRow = next.Row(i) - windowCol;
+			float* rowEnergy = stepEnergy + (row / ActiveTileSize) * m_numTileCols;
+			for (UINT j = colBegin; j < colEnd; ++j)
+			{
+				float& energy = rowEnergy[j / ActiveTileSize];
+				energy = std::max(energy, fabsf(nextRow[j]));
+			}
+		}
+
+		prev = curr;
+		curr = next;
+	}
+
+	for (UINT i = rowBegin; i < rowEnd; ++i)
+	{
+		const float* prevRow = prev.Row(i - windowRow) + (colBegin - windowCol);
+		const float* currRow = curr.Row(i - windowRow) + (colBegin - windowCol);
+		std::copy(prevRow, prevRow + (colEnd - colBegin), m_nextHeights + i * n + colBegin);
+		std::copy(currRow, currRow + (colEnd - colBegin), m_blockHeights + i * n + colBegin);
+	}
+}
+
+void WaveSolver::StepRows(UINT rowBegin, UINT rowEnd)
+{
+	const UINT n = m_grid.numCols;
+
+	for (UINT i = rowBegin; i < rowEnd; ++i)
+	{
+		StepRow(i, m_nextHeights + i * n, false);
+	}
+}
+
+void WaveSolver::StepRow(UINT i, float* next, bool bHalo)
+{
+	const UINT n = m_grid.numCols;
+	const float* prev = m_prevHeights + i * n;
+	const float* curr = m_currHeights + i * n;
+	const UINT rowTiles = (i / ActiveTileSize) * m_numTileCols;
+
+	// Walk runs of tiles that are all stepped or all skipped, so a fully
+	// active row is a single kernel call.
+	UINT tileCol = 0;
+	while (tileCol < m_numTileCols)
+	{
+		const bool bStepped = m_tileStepped[rowTiles + tileCol] != 0;
+
+		UINT runEnd = tileCol + 1;
+		while (runEnd < m_numTileCols && (m_tileStepped[rowTiles + runEnd] != 0) == bStepped)
+		{
+			++runEnd;
+		}
+
+		const UINT begin = std::max(tileCol * ActiveTileSize, 1u);
+		const UINT end = std::min(runEnd * ActiveTileSize, n - 1);
+
+		if (begin < end)
+		{
+			if (bStepped)
+			{
+				m_rowKernel(next, prev, curr - n, curr, curr + n, begin, end, mK1, mK2, mK3);
+
+				if (!bHalo)
+				{
+					for (UINT tile = rowTiles + tileCol; tile < rowTiles + runEnd; ++tile)
+					{
+						const UINT col = tile - rowTiles;
+						const UINT tileBegin = std::max(col * ActiveTileSize, begin);
+						const UINT tileEnd = std::min((col + 1) * ActiveTileSize, end);
+
+						float energy = m_tileEnergy[tile];
+						for (UINT j = tileBegin; j < tileEnd; ++j)
+						{
+							energy = std::max(energy, fabsf(next[j]));
+						}
+						m_tileEnergy[tile] = energy;
+					}
+				}
+			}
+			else if (bHalo)
+			{
+				std::fill(next + begin, next + end, 0.0f);
+			}
+		}
+
+		tileCol = runEnd;
+	}
+}
+
+void WaveSolver::BeginActiveStep()
+{
+	const UINT numTiles = GetTileCount();
+
+	// Skipped tiles have to be flat in every plane, so that skipping them
+	// gives what stepping them would.
+	for (UINT tile = 0; tile < numTiles; ++tile)
+	{
+		if (m_tileState[tile] == TileFallingAsleep)
+		{
+			ClearTile(tile);
+			m_tileState[tile] = TileAsleep;
+		}
+	}
+
+	ApplyQueuedImpulses();
+
+	std::fill(m_tileEnergy.begin(), m_tileEnergy.end(), 0.0f);
+
+	MarkSteppedTiles();
+}
+
+void WaveSolver::MarkSteppedTiles()
+{
+	const UINT numTiles = GetTileCount();
+
+	// Step the active tiles and their neighbors, which is as far as a wave
+	// can travel from an active tile in one step.
+	std::fill(m_tileStepped.begin(), m_tileStepped.end(), BYTE(0));
+
+	for (UINT tile = 0; tile < numTiles; ++tile)
+	{
+		if (m_tileState[tile] != TileActive)
+			continue;
+
+		const UINT tileRow = tile / m_numTileCols;
+		const UINT tileCol = tile % m_numTileCols;
+
+		m_tileStepped[tile] = 1;
+		if (tileRow > 0)
+			m_tileStepped[tile - m_numTileCols] = 1;
+		if (tileRow + 1 < m_numTileRows)
+			m_tileStepped[tile + m_numTileCols] = 1;
+		if (tileCol > 0)
+			m_tileStepped[tile - 1] = 1;
+		if (tileCol + 1 < m_numTileCols)
+			m_tileStepped[tile + 1] = 1;
+	}
+}
+
+void WaveSolver::EndActiveStep(bool bCanSleep)
+{
+	const UINT numTiles = GetTileCount();
+
+	m_numActiveTiles = 0;
+	for (UINT tile = 0; tile < numTiles; ++tile)
+	{
+		if (!m_tileStepped[tile])
+			continue;
+
+		const float energy = m_tileEnergy[tile];
+		if (energy >= m_sleepThreshold)
+		{
+			m_tileState[tile] = TileActive;
+			m_tileQuietSteps[tile] = 0;
+			++m_numActiveTiles;
+		}
+		else if (m_tileState[tile] == TileActive || energy > 0.0f)
+		{
+			// Quiet, but holding some wave: keep stepping it until it stayed
+			// quiet for QuietStepsToSleep steps in a row.
+			const UINT quietSteps = std::min(m_tileQuietSteps[tile] + 1u, QuietStepsToSleep);
+			if (quietSteps < QuietStepsToSleep || !bCanSleep)
+			{
+				m_tileState[tile] = TileActive;
+				m_tileQuietSteps[tile] = BYTE(quietSteps);
+				++m_numActiveTiles;
+			}
+			else
+			{
+				m_tileState[tile] = TileFallingAsleep;
+				m_tileQuietSteps[tile] = 0;
+			}
+		}
+		else
+		{
+			m_tileState[tile] = TileAsleep;
+			m_tileQuietSteps[tile] = 0;
+		}
+	}
+}
+
+void WaveSolver::WakeTile(UINT i, UINT j)
+{
+	const UINT tile = (i / ActiveTileSize) * m_numTileCols + j / ActiveTileSize;
+	if (m_tileState[tile] != TileActive)
+	{
+		// Drop what is left of the old waves before new ones are added.
+		if (m_tileState[tile] == TileFallingAsleep)
+		{
+			ClearTile(tile);
+		}
+		m_tileState[tile] = TileActive;
+		++m_numActiveTiles;
+	}
+	m_tileQuietSteps[tile] = 0;
+}
+
+void WaveSolver::ClearTile(UINT tile)
+{
+	const UINT n = m_grid.numCols;
+	const UINT rowBegin = (tile / m_numTileCols) * ActiveTileSize;
+	const UINT rowEnd = std::min(rowBegin + ActiveTileSize, m_grid.numRows);
+	const UINT colBegin = (tile % m_numTileCols) * ActiveTileSize;
+	const UINT colEnd = std::min(colBegin + ActiveTileSize, n);
+
+	float* planes[] = { m_prevHeights, m_currHeights, m_nextHeights };
+	for (float* plane : planes)
+	{
+		for (UINT i = rowBegin; i < rowEnd; ++i)
+		{
+			std::fill(plane + i * n + colBegin, plane + i * n + colEnd, 0.0f);
+		}
+	}
+}
+
+void WaveSolver::SwapSolutions()
+{
+	// The new solution was written to the third plane so that the previous
+	// solution stayed readable for the whole sweep. Rotate: the current
+	// solution becomes the previous one and the old previous plane is reused.
+	float* oldPrev = m_prevHeights;
+	m_prevHeights = m_currHeights;
+	m_currHeights = m_nextHeights;
+	m_nextHeights = oldPrev;
+}
+
+void WaveSolver::StepAndWriteRows(const RowWriter& writeRow, float alpha)
+{
+	const UINT m = m_grid.numRows;
+	const UINT n = m_grid.numCols;
+	const UINT numTiles = (m + FusedTileRows - 1) / FusedTileRows;
+
+	BeginActiveStep();
+
+	auto processTiles = [&](UINT tileBegin, UINT tileEnd)
+	{
+		// New heights of the rows just outside a tile, which belong to other tiles.
+		std::vector<float> haloAbove(n, 0.0f);
+		std::vector<float> haloBelow(n, 0.0f);
+
+		// The current solution only becomes the previous one after the sweep.
+		const bool bBlend = alpha != 1.0f;
+		RowBlender blender(bBlend ? n : 0, alpha);
+
+		for (UINT tile = tileBegin; tile < tileEnd; ++tile)
+		{
+			const UINT rowBegin = tile * FusedTileRows;
+			const UINT rowEnd = std::min(rowBegin + FusedTileRows, m);
+
+			// Boundary rows keep their zero heights in every plane.
+			auto isInterior = [m](UINT i) { return i > 0 && i < m - 1; };
+			auto newRow = [&](UINT i) -> const float*
+			{
+				if (i + 1 == rowBegin && isInterior(i))
+					return haloAbove.data();
+				if (i == rowEnd && isInterior(i))
+					return haloBelow.data();
+				return m_nextHeights + i * n;
+			};
+			auto outRow = [&](UINT i) -> const float*
+			{
+				return bBlend ? blender.Blend(i, m_currHeights + i * n, newRow(i)) : newRow(i);
+			};
+			auto emitRow = [&](UINT i)
+			{
+				const float* above = i > 0 ? outRow(i - 1) : nullptr;
+				const float* row = outRow(i);
+				const float* below = i + 1 < m ? outRow(i + 1) : nullptr;
+				writeRow(i, above, row, below);
+			};
+
+			if (rowBegin > 0 && isInterior(rowBegin - 1))
+			{
+				StepRow(rowBegin - 1, haloAbove.data(), true);
+			}
+
+			// Row i-1 is finished as soon as row i has its new heights, so the
+			// rows are written out while they are still in cache.
+			for (UINT i = rowBegin; i < rowEnd; ++i)
+			{
+				if (isInterior(i))
+				{
+					StepRow(i, m_nextHeights + i * n, false);
+				}
+				if (i > rowBegin)
+				{
+					emitRow(i - 1);
+				}
+			}
+
+			if (isInterior(rowEnd))
+			{
+				StepRow(rowEnd, haloBelow.data(), true);
+			}
+			emitRow(rowEnd - 1);
+		}
+	};
+
+	if (m_workerPool)
+	{
+		m_workerPool->ParallelFor(0, numTiles, numTiles, processTiles);
+	}
+	else
+	{
+		processTiles(0, numTiles);
+	}
+
+	SwapSolutions();
+
+	EndActiveStep(true);
+}
+
+void WaveSolver::WriteRows(const RowWriter& writeRow, float alpha) const
+{
+	const UINT m = m_grid.numRows;
+	const UINT n = m_grid.numCols;
+
+	auto writeRows = [&](UINT rowBegin, UINT rowEnd)
+	{
+		if (alpha == 1.0f)
+		{
+			for (UINT i = rowBegin; i < rowEnd; ++i)
+			{
+				const float* row = m_currHeights + i * n;
+				writeRow(i, i > 0 ? row - n : nullptr, row, i + 1 < m ? row + n : nullptr);
+			}
+			return;
+		}
+
+		RowBlender blender(n, alpha);
+		auto outRow = [&](UINT i) { return blender.Blend(i, m_prevHeights + i * n, m_currHeights + i * n); };
+
+		for (UINT i = rowBegin; i < rowEnd; ++i)
+		{
+			const float* above = i > 0 ? outRow(i - 1) : nullptr;
+			const float* row = outRow(i);
+			const float* below = i + 1 < m ? outRow(i + 1) : nullptr;
+			writeRow(i, above, row, below);
+		}
+	};
+
+	if (m_workerPool)
+	{
+		m_workerPool->ParallelFor(0, m, writeRows);
+	}
+	else
+	{
+		writeRows(0, m);
+	}
+}
+
+void WaveSolver::Advance(UINT numSteps, const RowWriter& writeRow, float alpha)
+{
+	// Blocking all steps beats blocking all but the last and fusing that one
+	// with the output.
+	if (numSteps >= MinBlockedSteps && CanBlockSteps())
+	{
+		Step(numSteps);
+
+		if (writeRow)
+		{
+			WriteRows(writeRow, alpha);
+		}
+		return;
+	}
+
+	for (UINT step = 1; step < numSteps; ++step)
+	{
+		Step();
+	}
+
+	if (!writeRow)
+	{
+		if (numSteps > 0)
+		{
+			Step();
+		}
+	}
+	else if (numSteps > 0)
+	{
+		StepAndWriteRows(writeRow, alpha);
+	}
+	else
+	{
+		WriteRows(writeRow, alpha);
+	}
+}
+
+void WaveSolver::ForEachInteriorRowBand(const std::function<void(UINT, UINT)>& task) const
+{
+	// Only update interior points; we use zero boundary conditions.
+	const UINT rowBegin = 1;
+	const UINT rowEnd = m_grid.numRows - 1;
+
+	if (m_workerPool)
+	{
+		m_workerPool->ParallelFor(rowBegin, rowEnd, task);
+	}
+	else
+	{
+		task(rowBegin, rowEnd);
+	}
+}
+
+void WaveSolver::SetKernel(WaveKernel kernel)
+{
+	if (!IsKernelSupported(kernel))
+	{
+		kernel = GetBestKernel();
+	}
+
+	m_kernel = kernel;
+
+	switch (kernel)
+	{
+#if WAVE_KERNEL_AVX2
+	case WaveKernel::AVX2:
+		m_rowKernel = StepRowAVX2;
+		break;
+#endif
+	case WaveKernel::Vector:
+		m_rowKernel = StepRowVector;
+		break;
+	default:
+		m_rowKernel = StepRowScalar;
+		break;
+	}
+}
+
+bool WaveSolver::IsKernelSupported(WaveKernel kernel)
+{
+	switch (kernel)
+	{
+	case WaveKernel::Scalar:
+	case WaveKernel::Vector:
+		return true;
+	case WaveKernel::AVX2:
+#if WAVE_KERNEL_AVX2
+	{
+		static const bool bSupported = IsAVX2Supported();
+		return bSupported;
+	}
+#else
+		return false;
+#endif
+	}
+	return false;
+}
+
+WaveKernel WaveSolver::GetBestKernel()
+{
+	return IsKernelSupported(WaveKernel::AVX2) ? WaveKernel::AVX2 : WaveKernel::Vector;
+}
+
+void WaveSolver::Disturb(UINT i, UINT j, float magnitude)
+{
+	// Don't disturb boundaries.
+	assert(i > 1 && i < m_grid.numRows - 2);
+	assert(j > 1 && j < m_grid.numCols - 2);
+
+	const UINT n = m_grid.numCols;
+
+	WakeTile(i, j);
+	WakeTile(i, j + 1);
+	WakeTile(i, j - 1);
+	WakeTile(i + 1, j);
+	WakeTile(i - 1, j);
+
+	float halfMag = 0.5f*magnitude;
+
+	// Disturb the ijth vertex height and its neighbors.
+	m_currHeights[i*n + j] += magnitude;
+	m_currHeights[i*n + j + 1] += halfMag;
+	m_currHeights[i*n + j - 1] += halfMag;
+	m_currHeights[(i + 1)*n + j] += halfMag;
+	m_currHeights[(i - 1)*n + j] += halfMag;
+}
+
+void WaveSolver::SetHeights(UINT rowBegin, UINT colBegin, UINT numRows, UINT numCols, const float* prev, const float* curr)
+{
+	assert(rowBegin + numRows <= m_grid.numRows);
+	assert(colBegin + numCols <= m_grid.numCols);
+
+	const UINT n = m_grid.numCols;
+
+	for (UINT i = 0; i < numRows; ++i)
+	{
+		const float* prevRow = prev + i * numCols;
+		const float* currRow = curr + i * numCols;
+
+		// Wake tiles before writing: a tile that is falling asleep is
+		// cleared when it wakes.
+		for (UINT j = 0; j < numCols; ++j)
+		{
+			if (prevRow[j] != 0.0f || currRow[j] != 0.0f)
+			{
+				WakeTile(rowBegin + i, colBegin + j);
+			}
+		}
+
+		std::copy(prevRow, prevRow + numCols, m_prevHeights + (rowBegin + i) * n + colBegin);
+		std::copy(currRow, currRow + numCols, m_currHeights + (rowBegin + i) * n + colBegin);
+	}
+}
+
+void WaveSolver::QueueImpulses(const WaveImpulse* impulses, UINT count)
+{
+	std::lock_guard<std::mutex> lock(m_impulseMutex);
+
+	const UINT numFree = GetImpulseCapacity() - static_cast<UINT>(m_queuedImpulses.size());
+	const UINT numQueued = std::min(count, numFree);
+	m_queuedImpulses.insert(m_queuedImpulses.end(), impulses, impulses + numQueued);
+	m_numDroppedImpulses.fetch_add(count - numQueued, std::memory_order_relaxed);
+}
+
+void WaveSolver::SetImpulseCapacity(UINT capacity)
+{
+	std::lock_guard<std::mutex> lock(m_impulseMutex);
+
+	// Impulses beyond the new capacity are dropped.
+	if (m_queuedImpulses.size() > capacity)
+	{
+		m_numDroppedImpulses.fetch_add(m_queuedImpulses.size() - capacity, std::memory_order_relaxed);
+		m_queuedImpulses.resize(capacity);
+	}
+
+	// Both buffers are swapped every step, so they need the same capacity.
+	std::vector<WaveImpulse> queued;
+	queued.reserve(capacity);
+	queued.assign(m_queuedImpulses.begin(), m_queuedImpulses.end());
+	m_queuedImpulses.swap(queued);
+
+	std::vector<WaveImpulse> applied;
+	applied.reserve(capacity);
+	m_appliedImpulses.swap(applied);
+}
+
+void WaveSolver::ApplyQueuedImpulses()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_impulseMutex);
+		if (m_queuedImpulses.empty())
+			return;
+		m_queuedImpulses.swap(m_appliedImpulses);
+	}
+
+	// Sorting on every field makes the sums independent of the order the
+	// producers queued in. Going down the rows also walks the heights in
+	// memory order.
+	std::sort(m_appliedImpulses.begin(), m_appliedImpulses.end(), [](const WaveImpulse& a, const WaveImpulse& b)
+	{
+		if (a.row != b.row) return a.row < b.row;
+		if (a.col != b.col) return a.col < b.col;
+		if (a.radius != b.radius) return a.radius < b.radius;
+		return a.magnitude < b.magnitude;
+	});
+
+	const UINT n = m_grid.numCols;
+	const int lastRow = int(m_grid.numRows) - 2;
+	const int lastCol = int(n) - 2;
+
+	for (auto it = m_appliedImpulses.begin(); it != m_appliedImpulses.end(); ++it)
+	{
+		const float radius = std::max(it->radius, 1.0f);
+		const float invRadiusSq = 1.0f / (radius * radius);
+
+		// Interior cells within the radius.
+		const int rowBegin = std::max(int(ceilf(it->row - radius)), 1);
+		const int rowEnd = std::min(int(floorf(it->row + radius)), lastRow);
+		const int colBegin = std::max(int(ceilf(it->col - radius)), 1);
+		const int colEnd = std::min(int(floorf(it->col + radius)), lastCol);
+		if (rowBegin > rowEnd || colBegin > colEnd)
+			continue;
+
+		for (int tileRow = rowBegin / int(ActiveTileSize); tileRow <= rowEnd / int(ActiveTileSize); ++tileRow)
+		{
+			for (int tileCol = colBegin / int(ActiveTileSize); tileCol <= colEnd / int(ActiveTileSize); ++tileCol)
+			{
+				WakeTile(tileRow * ActiveTileSize, tileCol * ActiveTileSize);
+			}
+		}
+
+		for (int i = rowBegin; i <= rowEnd; ++i)
+		{
+			const float dz = float(i) - it->row;
+			float* row = m_currHeights + i * n;
+
+			for (int j = colBegin; j <= colEnd; ++j)
+			{
+				const float dx = float(j) - it->col;
+				const float falloff = 1.0f - (dx * dx + dz * dz) * invRadiusSq;
+				if (falloff > 0.0f)
+				{
+					row[j] += it->magnitude * falloff * falloff;
+				}
+			}
+		}
+	}
+
+	m_appliedImpulses.clear();
+}
+
+XMFLOAT3 WaveSolver::ComputeNormal(float l, float r, float t, float b, float spatialStep)
+{
+	XMFLOAT3 normal;
+	XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(-r + l, 2.0f*spatialStep, b - t, 0.0f)));
+	return normal;
+}
+
+WaveDisturbanceSequence::Disturbance WaveDisturbanceSequence::Next(const WaveGrid& grid, UINT margin, float minMagnitude, float maxMagnitude)
+{
+	// The raw generator output is specified by the standard; the
+	// distributions are not, so they are done by hand.
+	Disturbance disturbance;
+	disturbance.row = margin + UINT(m_random() % (grid.numRows - 2 * margin));
+	disturbance.col = margin + UINT(m_random() % (grid.numCols - 2 * margin));
+	const float unit = float(m_random() >> 8) * (1.0f / 16777216.0f);
+	disturbance.magnitude = minMagnitude + (maxMagnitude - minMagnitude) * unit;
+	return disturbance;
+}
+
+void WaveDisturbanceSequence::DisturbNext(WaveSolver& solver, UINT margin, float minMagnitude, float maxMagnitude)
+{
+	const Disturbance disturbance = Next(solver.GetGrid(), margin, minMagnitude, maxMagnitude);
+	solver.Disturb(disturbance.row, disturbance.col, disturbance.magnitude);
+}
\ No newline at end of file
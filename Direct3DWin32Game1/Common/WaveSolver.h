@@ -0,0 +1,331 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <vector>
+
+class WorkerPool;
+
+// Constant xz layout of a wave grid. Only the heights change while the
+// simulation runs, so vertex positions are rebuilt from this on demand
+// instead of being carried around in the solver state.
+struct WaveGrid
+{
+	UINT numRows = 0;
+	UINT numCols = 0;
+	float spatialStep = 0.0f;
+	float halfWidth = 0.0f;
+	float halfDepth = 0.0f;
+
+	WaveGrid() = default;
+
+	// Grid of numRows x numCols points centered on the origin.
+	WaveGrid(UINT rows, UINT cols, float step)
+		: numRows(rows)
+		, numCols(cols)
+		, spatialStep(step)
+		, halfWidth((cols - 1)*step*0.5f)
+		, halfDepth((rows - 1)*step*0.5f)
+	{
+	}
+
+	UINT GetVertexCount() const { return numRows * numCols; }
+
+	// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
+	// Moreover, our +z axis goes "down"; this is just to
+	// keep consistent with our row indices going down.
+	float GetX(UINT j) const { return -halfWidth + j * spatialStep; }
+	float GetZ(UINT i) const { return halfDepth - i * spatialStep; }
+};
+
+// Smooth bump added to the heights: magnitude at the fractional row and
+// column, falling off as (1 - d^2/r^2)^2 to zero at radius cells.
+struct WaveImpulse
+{
+	float row;
+	float col;
+	float magnitude;
+	float radius;
+};
+
+// Implementations of the interior stencil sweep. Vector goes through DirectXMath,
+// which compiles to SSE2 on x86/x64 and to NEON on ARM. AVX2 is only available
+// on x86/x64 CPUs that report it at runtime.
+enum class WaveKernel
+{
+	Scalar,
+	Vector,
+	AVX2
+};
+
+// Finite difference solver of the damped wave equation on a regular grid.
+// The previous, current and next solutions are stored as height-only planes
+// of numRows*numCols floats, so a stencil sweep only touches the data it needs.
+//
+// Cells are grouped into ActiveTileSize x ActiveTileSize tiles and only tiles
+// that are active, or next to an active tile, are stepped. A tile falls asleep
+// once its heights stayed below the sleep threshold for several steps in a
+// row; it is zeroed at the start of the next step and skipped until a
+// disturbance lands in it or a neighbor wakes it. Waves entering a quiet tile
+// are kept while they build up, so only waves that stay below the threshold
+// are lost.
+//
+// With a worker pool the stencil and normal sweeps are split into row bands.
+// Every cell is computed by the same code whatever band it falls in, so the
+// output is bit-identical to the single threaded solver for any thread count.
+class WaveSolver
+{
+public:
+	WaveSolver(UINT numRows, UINT numCols, float spatialStep, float timeStep, float speed, float damping);
+	~WaveSolver();
+
+	WaveSolver(const WaveSolver&) = delete;
+	WaveSolver& operator=(const WaveSolver&) = delete;
+
+	// Advances the simulation by exactly one time step.
+	void Step();
+
+	// Advances numSteps time steps. With temporal blocking on, the grid is
+	// cut into tiles that are advanced several steps each while they sit in
+	// cache. Every tile recomputes a halo of one cell per step around it
+	// instead of waiting for its neighbors. For fewer than three steps, or
+	// with blocking off, steps run one by one. Impulses queued during a
+	// blocked run are applied after it.
+	//
+	// The tiles stepped are picked once per block: the active tiles and the
+	// ring of tiles around them. Tiles wake and count quiet steps like with
+	// single steps, but only fall asleep at the end of a block, so with a
+	// sleep threshold above 0 the heights can differ from single steps by
+	// about the threshold. With a threshold of 0 they are the same as
+	// calling Step() numSteps times.
+	void Step(UINT numSteps);
+
+	void SetTemporalBlocking(bool bEnable) { m_bTemporalBlocking = bEnable; }
+	bool IsTemporalBlocking() const { return m_bTemporalBlocking; }
+
+	static const UINT MaxBlockedSteps = 8;
+
+	// Changes the grid to numRows x numCols points spatialStep apart, centered
+	// like before. The current and previous heights, and with them the
+	// velocities, are resampled bilinearly at the new points; water outside
+	// the old grid starts flat. Queued impulses move along to the new cells,
+	// and tiles holding any wave start active. A finer step has to keep
+	// speed*timeStep/spatialStep below 1/sqrt(2), or the solver blows up.
+	//
+	// Not thread safe against stepping; impulses may still be queued.
+	void Resize(UINT numRows, UINT numCols, float spatialStep);
+
+	// Selects the stencil implementation. Unsupported kernels fall back to
+	// the best supported one. The solver starts with GetBestKernel().
+	void SetKernel(WaveKernel kernel);
+	WaveKernel GetKernel() const { return m_kernel; }
+
+	static bool IsKernelSupported(WaveKernel kernel);
+	static WaveKernel GetBestKernel();
+
+	// Heights below threshold count as flat water. 0 never lets a disturbed tile
+	// sleep, which gives exactly the results of stepping every cell.
+	void SetSleepThreshold(float threshold) { m_sleepThreshold = threshold; }
+	float GetSleepThreshold() const { return m_sleepThreshold; }
+
+	// Tile counts after the last step.
+	UINT GetTileCount() const { return m_numTileRows * m_numTileCols; }
+	UINT GetActiveTileCount() const { return m_numActiveTiles; }
+	UINT GetSleepingTileCount() const { return GetTileCount() - m_numActiveTiles; }
+
+	static const UINT ActiveTileSize = 16;
+
+	// Runs the sweeps on pool when set, on the calling thread otherwise.
+	void SetWorkerPool(WorkerPool* pool) { m_workerPool = pool; }
+
+	// Disturbs the ijth height by magnitude and its four neighbors by half of it.
+	void Disturb(UINT i, UINT j, float magnitude);
+
+	// Queues impulses that are added to the heights at the start of the next
+	// step, all in one pass sorted by position. Any number of threads may
+	// queue, also while the solver steps; impulses queued during a step go to
+	// the one after it. The result does not depend on the order impulses
+	// were queued in. Radii below one cell are raised to one cell, and only
+	// interior cells are touched.
+	//
+	// Impulses are copied into a buffer of GetImpulseCapacity() entries, so
+	// queuing never allocates; impulses that do not fit are dropped and counted.
+	void QueueImpulse(const WaveImpulse& impulse) { QueueImpulses(&impulse, 1); }
+	void QueueImpulses(const WaveImpulse* impulses, UINT count);
+
+	// Not thread safe; call while nothing is queuing.
+	void SetImpulseCapacity(UINT capacity);
+	UINT GetImpulseCapacity() const { return static_cast<UINT>(m_queuedImpulses.capacity()); }
+
+	// Safe to call from any thread.
+	UINT64 GetDroppedImpulseCount() const { return m_numDroppedImpulses.load(std::memory_order_relaxed); }
+
+	// Receives row i of the solution together with the rows above and below it
+	// (nullptr on the grid boundary), to turn it into vertices.
+	typedef std::function<void(UINT i, const float* above, const float* row, const float* below)> RowWriter;
+
+	// Advances one time step and hands every row of the new solution to
+	// writeRow in the same cache blocked pass. Tiles of rows are spread over
+	// the worker pool, so writeRow must be safe to call for different rows
+	// at the same time.
+	//
+	// The rows handed out are blended from the previous solution (alpha 0) to
+	// the new one (alpha 1), for output between two time steps.
+	void StepAndWriteRows(const RowWriter& writeRow, float alpha = 1.0f);
+
+	// Hands every row of the current solution to writeRow without stepping,
+	// blended with the previous solution like above.
+	void WriteRows(const RowWriter& writeRow, float alpha = 1.0f) const;
+
+	// Advances numSteps time steps and hands the rows of the resulting solution
+	// to writeRow, fused with the last step. writeRow may be empty.
+	void Advance(UINT numSteps, const RowWriter& writeRow, float alpha = 1.0f);
+
+	// Normal of the height field from the heights left, right, above (-z)
+	// and below (+z) a point, by central differences; the row writers get
+	// their normals from it.
+	static DirectX::XMFLOAT3 ComputeNormal(float l, float r, float t, float b, float spatialStep);
+
+	const WaveGrid& GetGrid() const { return m_grid; }
+	float GetTimeStep() const { return m_timeStep; }
+	float GetSpeed() const { return m_speed; }
+	float GetDamping() const { return m_damping; }
+
+	const float* GetHeights() const { return m_currHeights; }
+	const float* GetPreviousHeights() const { return m_prevHeights; }
+	float GetHeight(UINT i, UINT j) const { return m_currHeights[i*m_grid.numCols + j]; }
+
+	// Overwrites the previous and current heights of numRows x numCols cells
+	// from (rowBegin, colBegin) on, boundary cells included, e.g. to couple
+	// the solver to another grid. prev and curr hold the rows back to back.
+	// Tiles that get a nonzero height wake up.
+	void SetHeights(UINT rowBegin, UINT colBegin, UINT numRows, UINT numCols, const float* prev, const float* curr);
+
+private:
+
+	// Writes next[begin, end) of one row from the previous solution and the
+	// current solution rows above, at and below it. next may alias prev.
+	typedef void(*RowKernel)(float* next, const float* prev, const float* above, const float* curr, const float* below,
+		UINT begin, UINT end, float k1, float k2, float k3);
+
+	// Row band version of Step() over rows [rowBegin, rowEnd).
+	void StepRows(UINT rowBegin, UINT rowEnd);
+
+	// Writes the new heights of interior row i to next, skipping sleeping tiles.
+	// A halo row belongs to another band: it does not count towards the tile
+	// energy and the skipped cells are zeroed, as next is a scratch row then.
+	void StepRow(UINT i, float* next, bool bHalo);
+
+	// Picks the tiles to step before a step and puts tiles to sleep after it.
+	// Tiles that stayed quiet for long enough only fall asleep when bCanSleep
+	// is set; until then they stay active.
+	void BeginActiveStep();
+	void EndActiveStep(bool bCanSleep);
+
+	// Marks the active tiles and their neighbors as stepped.
+	void MarkSteppedTiles();
+
+	// Whether Step(numSteps) can run temporally blocked.
+	bool CanBlockSteps() const { return m_bTemporalBlocking; }
+
+	// Advances every cell numSteps <= MaxBlockedSteps steps in temporal tiles.
+	void StepBlock(UINT numSteps);
+
+	// Advances one temporal tile, using two scratch planes of the tile and its
+	// halo, and writes its last two solutions to m_nextHeights and m_blockHeights.
+	void StepBlockTile(UINT tile, UINT numSteps, float* scratch);
+
+	void WakeTile(UINT i, UINT j);
+	void ClearTile(UINT tile);
+
+	// Stencil coefficients for the current grid spacing.
+	void UpdateCoefficients();
+
+	// Writes plane, sampled on the old grid, bilinearly resampled to the
+	// interior points of m_grid into resampled.
+	void ResamplePlane(const WaveGrid& oldGrid, const float* plane, float* resampled) const;
+
+	// Adds the impulses queued so far to the current heights.
+	void ApplyQueuedImpulses();
+
+	// Makes the next solution current once a step has been written.
+	void SwapSolutions();
+
+	// Runs task over the interior rows, on the worker pool when there is one.
+	void ForEachInteriorRowBand(const std::function<void(UINT, UINT)>& task) const;
+
+	WaveGrid m_grid;
+
+	WaveKernel m_kernel;
+	RowKernel m_rowKernel;
+
+	WorkerPool* m_workerPool = nullptr;
+
+	UINT m_numTileRows;
+	UINT m_numTileCols;
+	std::vector<BYTE> m_tileState;
+	std::vector<BYTE> m_tileStepped;
+	// Largest absolute height of each tile after the last step, and the
+	// steps in a row it stayed below the sleep threshold.
+	std::vector<float> m_tileEnergy;
+	std::vector<BYTE> m_tileQuietSteps;
+	// Tile energies after each step of a block, one plane of tiles per step.
+	std::vector<float> m_blockTileEnergy;
+	float m_sleepThreshold = 1e-4f;
+	UINT m_numActiveTiles = 0;
+
+	// Producers fill m_queuedImpulses; each step swaps it with
+	// m_appliedImpulses under the lock and applies that one outside of it.
+	std::mutex m_impulseMutex;
+	std::vector<WaveImpulse> m_queuedImpulses;
+	std::vector<WaveImpulse> m_appliedImpulses;
+	// Only written under the lock, but read without it.
+	std::atomic<UINT64> m_numDroppedImpulses{ 0 };
+
+	float m_timeStep;
+	float m_speed;
+	float m_damping;
+
+	float mK1;
+	float mK2;
+	float mK3;
+
+	float* m_prevHeights;
+	float* m_currHeights;
+	float* m_nextHeights;
+
+	// Fourth plane for temporally blocked steps, which need two solutions
+	// written while the last two are still read. Allocated on first use.
+	float* m_blockHeights = nullptr;
+	bool m_bTemporalBlocking = true;
+};
+
+// Reproducible stream of random disturbances. Cells and magnitudes depend on
+// the seed only, never on rand() or the standard library in use, so a run can
+// be repeated exactly, with or without a window. Tools/Headless replays a
+// fixed seed against a golden snapshot and benchmarks it.
+class WaveDisturbanceSequence
+{
+public:
+	explicit WaveDisturbanceSequence(UINT seed = 1) : m_random(seed) {}
+
+	void Reset(UINT seed) { m_random.seed(seed); }
+
+	struct Disturbance
+	{
+		UINT row;
+		UINT col;
+		float magnitude;
+	};
+
+	// Picks a cell at least margin cells away from the grid boundary and a
+	// magnitude in [minMagnitude, maxMagnitude).
+	Disturbance Next(const WaveGrid& grid, UINT margin = 5, float minMagnitude = 1.0f, float maxMagnitude = 2.0f);
+
+	// Disturbs solver at the next cell by the next magnitude.
+	void DisturbNext(WaveSolver& solver, UINT margin = 5, float minMagnitude = 1.0f, float maxMagnitude = 2.0f);
+
+private:
+	std::mt19937 m_random;
+};
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "Common/WorkerPool.h"
+
+namespace
+{
+	// Set while a thread is running a band, so nested loops run inline
+	// instead of waiting on workers that are busy with the outer loop.
+	thread_local bool t_bInsideTask = false;
+}
+
+WorkerPool::WorkerPool(UINT numWorkers)
+{
+	if (numWorkers == UINT_MAX)
+	{
+		UINT hardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	m_workers.reserve(numWorkers);
+	for (UINT i = 0; i < numWorkers; ++i)
+	{
+		m_workers.emplace_back(&WorkerPool::WorkerMain, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStop = true;
+	}
+	m_workCondition.notify_all();
+
+	for (auto it = m_workers.begin(); it != m_workers.end(); ++it)
+	{
+		it->join();
+	}
+}
+
+void WorkerPool::ParallelFor(UINT begin, UINT end, UINT maxBands, const std::function<void(UINT, UINT)>& task)
+{
+	if (end <= begin)
+		return;
+
+	const UINT numBands = std::min(std::max(maxBands, 1u), end - begin);
+	if (numBands == 1 || m_workers.empty() || t_bInsideTask)
+	{
+		// Same band boundaries as the threaded path.
+		for (UINT band = 0; band < numBands; ++band)
+		{
+			UINT64 count = end - begin;
+			task(begin + UINT(count * band / numBands), begin + UINT(count * (band + 1) / numBands));
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> submitLock(m_submitMutex);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_task = &task;
+	m_begin = begin;
+	m_end = end;
+	m_numBands = numBands;
+	m_nextBand = 0;
+	m_pendingBands = numBands;
+	++m_generation;
+	m_workCondition.notify_all();
+
+	RunBands(lock);
+
+	m_doneCondition.wait(lock, [this]() { return m_pendingBands == 0; });
+	m_task = nullptr;
+}
+
+WorkerPool& WorkerPool::GetDefault()
+{
+	static WorkerPool pool;
+	return pool;
+}
+
+void WorkerPool::WorkerMain()
+{
+	UINT64 lastGeneration = 0;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		m_workCondition.wait(lock, [&]() { return m_bStop || m_generation != lastGeneration; });
+		if (m_bStop)
+			return;
+
+		lastGeneration = m_generation;
+		RunBands(lock);
+	}
+}
+
+void WorkerPool::RunBands(std::unique_lock<std::mutex>& lock)
+{
+	// Bands are claimed under the lock, so a thread that wakes up late can
+	// never pick up a band of a loop that has already been replaced.
+	while (m_task && m_nextBand < m_numBands)
+	{
+		const UINT band = m_nextBand++;
+		const std::function<void(UINT, UINT)>& task = *m_task;
+		const UINT64 count = m_end - m_begin;
+		const UINT bandBegin = m_begin + UINT(count * band / m_numBands);
+		const UINT bandEnd = m_begin + UINT(count * (band + 1) / m_numBands);
+
+		lock.unlock();
+		t_bInsideTask = true;
+		task(bandBegin, bandEnd);
+		t_bInsideTask = false;
+		lock.lock();
+
+		if (--m_pendingBands == 0)
+		{
+			m_doneCondition.notify_all();
+		}
+	}
+}
\ No newline at end of file
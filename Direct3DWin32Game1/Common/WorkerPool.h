@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that run data parallel loops. The calling
+// thread takes part in every loop, so a pool with no workers simply runs
+// the loop inline.
+class WorkerPool
+{
+public:
+	// numWorkers == UINT_MAX picks one worker per hardware thread besides the caller.
+	explicit WorkerPool(UINT numWorkers = UINT_MAX);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Number of threads taking part in a loop, including the caller.
+	UINT GetThreadCount() const { return static_cast<UINT>(m_workers.size()) + 1; }
+
+	// Splits [begin, end) into at most maxBands contiguous bands and calls
+	// task(bandBegin, bandEnd) for each of them, spread over the pool.
+	// Returns after every band has finished, so consecutive calls are
+	// separated by a barrier. The band boundaries only depend on the range
+	// and the band count, never on timing. Calls made from inside a task
+	// run inline on the calling thread.
+	void ParallelFor(UINT begin, UINT end, UINT maxBands, const std::function<void(UINT, UINT)>& task);
+	void ParallelFor(UINT begin, UINT end, const std::function<void(UINT, UINT)>& task)
+	{
+		ParallelFor(begin, end, GetThreadCount(), task);
+	}
+
+	// Shared pool used by the demos, created on first use.
+	static WorkerPool& GetDefault();
+
+private:
+
+	void WorkerMain();
+
+	// Claims and runs bands of the current loop until none are left.
+	void RunBands(std::unique_lock<std::mutex>& lock);
+
+	std::vector<std::thread> m_workers;
+
+	// Serializes loops submitted from different threads.
+	std::mutex m_submitMutex;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workCondition;
+	std::condition_variable m_doneCondition;
+
+	// State of the current loop, guarded by m_mutex.
+	const std::function<void(UINT, UINT)>* m_task = nullptr;
+	UINT m_begin = 0;
+	UINT m_end = 0;
+	UINT m_numBands = 0;
+	UINT m_nextBand = 0;
+	UINT m_pendingBands = 0;
+	UINT64 m_generation = 0;
+	bool m_bStop = false;
+};
\ No newline at end of file
@@ -1,7 +1,8 @@
 #include "pch.h"
 #include "HillAndWaveGame\HillAndWaveGame.h"
 #include "Common/VertexStructuer.h"
-#include <ctime>
+#include "Common/HillFunction.h"
+#include "Common/WorkerPool.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -27,157 +28,97 @@ void HillAndWaveGame::Initialize(HWND window, int width, int height)
 
 void HillAndWaveGame::AddObjects()
 {
-	m_objects.push_back(new Hill());
-	m_objects.push_back(new Wave());
-}
-
-inline float Hill::GetHeight(float x, float z) const
-{
-	return 0.3f*(z*sinf(0.1f*x) + x * cosf(0.1f*z));
-}
-
-inline XMFLOAT3 Hill::GetHillNormal(float x, float z) const
-{
-	// n = (-df/dx, 1, -df/dz)
-	XMFLOAT3 n(
-		-0.03f*z*cosf(0.1f*x) - 0.3f*cosf(0.1f*z),
-		1.0f,
-		-0.3f*sinf(0.1f*x) + 0.03f*x*sinf(0.1f*z));
+	Wave* wave = new Wave();
+	wave->SetWaveScheduler(&m_waveScheduler);
 
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
-
-	return n;
+	m_objects.push_back(new Hill());
+	m_objects.push_back(wave);
 }
 
 void Hill::BuildShape()
 {
-	// CreateGrid
+	// The grid only depends on the members below, so every Hill shares
+	// one copy of it.
+	const std::string key = MeshCache::MakeKey("Hill", width, depth, m, n);
+	UseSharedMesh(MeshCache::GetDefault().GetMeshBuffers(m_d3dDevice.Get(), key, [this](MeshData& mesh)
+	{
+		// CreateGrid
 
-	const UINT vertexCount = m * n;
-	const UINT faceCount = (m - 1)*(n - 1) * 2;
+		const UINT vertexCount = m * n;
 
-	//
-	// Create the vertices.
-	//
+		//
+		// Create the vertices.
+		//
 
-	float halfWidth = 0.5f*width;
-	float halfDepth = 0.5f*depth;
+		float halfWidth = 0.5f*width;
+		float halfDepth = 0.5f*depth;
 
-	float dx = width / (n - 1);
-	float dz = depth / (m - 1);
+		float dx = width / (n - 1);
+		float dz = depth / (m - 1);
 
-	float du = 1.0f / (n - 1);
-	float dv = 1.0f / (m - 1);
+		float du = 1.0f / (n - 1);
+		float dv = 1.0f / (m - 1);
 
-	VertexType* vertices = new VertexType[vertexCount];
+		std::vector<VertexType> vertices(vertexCount);
 
-	for (UINT i = 0; i < m; ++i)
-	{
-		float z = halfDepth - i * dz;
-		for (UINT j = 0; j < n; ++j)
+		std::vector<XMFLOAT2> points(vertexCount);
+		for (UINT i = 0; i < m; ++i)
 		{
-			float x = -halfWidth + j * dx;
-			float y = GetHeight(x, z);
-
-			vertices[i*n + j].position = XMFLOAT3(x, y, z);
-
-			XMFLOAT4 color;
-			if (y < -10.0f)
-			{
-				// Sandy beach color.
-				color = XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
-			}
-			else if (y < 5.0f)
-			{
-				// Light yellow-green.
-				color = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
-			}
-			else if (y < 12.0f)
+			for (UINT j = 0; j < n; ++j)
 			{
-				// Dark yellow-green.
-				color = XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
+				points[i*n + j] = XMFLOAT2(-halfWidth + j * dx, halfDepth - i * dz);
 			}
-			else if (y < 20.0f)
-			{
-				// Dark brown.
-				color = XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
-			}
-			else
-			{
-				// White snow.
-				color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-			}
-			vertices[i*n + j].color = color;
-
-			vertices[i*n + j].normal = GetHillNormal(x, z);
 		}
-	}
 
-	// Vertex buffer
+		std::vector<float> heights(vertexCount);
+		std::vector<XMFLOAT3> normals(vertexCount);
+		HillFunction::GetDefault().Evaluate(points.data(), vertexCount, heights.data(), normals.data(), &WorkerPool::GetDefault());
 
-	D3D11_BUFFER_DESC vbDesc;
-	vbDesc.ByteWidth = sizeof(VertexType) * vertexCount;;
-	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = 0;
-	vbDesc.MiscFlags = 0;
-	vbDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA vbInitData;
-	vbInitData.pSysMem = vertices;
-	vbInitData.SysMemPitch = 0;
-	vbInitData.SysMemSlicePitch = 0;
-
-	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, &vbInitData, m_vertexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
-
-	//
-	// Create the indices.
-	//
-
-	UINT* indices = new UINT[faceCount * 3];
-
-	// Iterate over each quad and compute indices.
-	UINT k = 0;
-	for (UINT i = 0; i < m - 1; ++i)
-	{
-		for (UINT j = 0; j < n - 1; ++j)
+		for (UINT i = 0; i < m; ++i)
 		{
-			indices[k] = i * n + j;
-			indices[k + 1] = i * n + j + 1;
-			indices[k + 2] = (i + 1)*n + j;
-
-			indices[k + 3] = (i + 1)*n + j;
-			indices[k + 4] = i * n + j + 1;
-			indices[k + 5] = (i + 1)*n + j + 1;
-
-			k += 6; // next quad
+			float z = halfDepth - i * dz;
+			for (UINT j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j * dx;
+				float y = heights[i*n + j];
+
+				vertices[i*n + j].position = XMFLOAT3(x, y, z);
+
+				XMFLOAT4 color;
+				if (y < -10.0f)
+				{
+					// Sandy beach color.
+					color = XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
+				}
+				else if (y < 5.0f)
+				{
+					// Light yellow-green.
+					color = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
+				}
+				else if (y < 12.0f)
+				{
+					// Dark yellow-green.
+					color = XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
+				}
+				else if (y < 20.0f)
+				{
+					// Dark brown.
+					color = XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
+				}
+				else
+				{
+					// White snow.
+					color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+				}
+				vertices[i*n + j].color = color;
+
+				vertices[i*n + j].normal = normals[i*n + j];
+			}
 		}
-	}
-
-	// Index buffer
 
-	m_indexCount = faceCount * 3;
-
-	D3D11_BUFFER_DESC ibDesc;
-	ibDesc.ByteWidth = sizeof(UINT) * m_indexCount;;
-	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.MiscFlags = 0;
-	ibDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA ibInitData;
-	ibInitData.pSysMem = indices;
-	ibInitData.SysMemPitch = 0;
-	ibInitData.SysMemSlicePitch = 0;
-
-	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
-
-	delete[] vertices;
-	delete[] indices;
+		mesh.SetVertices(vertices.data(), vertexCount);
+		mesh.indices = MeshCache::GetDefault().GetGridIndices(m, n)->indices;
+	}));
 }
 
 void Hill::BuildConstantBuffer()
@@ -186,43 +127,14 @@ void Hill::BuildConstantBuffer()
 }
 
 Wave::Wave()
+	: m_solver(m_numRows, m_numCols, m_spatialStep, m_timeStep, m_speed, m_damping)
+	, m_clock(m_timeStep, m_maxSubsteps)
 {
-	float dt = m_timeStep;
-	float dx = m_spatialStep;
-
-	float d = m_damping * dt + 2.0f;
-	float e = (m_speed*m_speed)*(dt*dt) / (dx*dx);
-	mK1 = (m_damping*dt - 2.0f) / d;
-	mK2 = (4.0f - 8.0f*e) / d;
-	mK3 = (2.0f*e) / d;
-
-	m_prevSolution = new XMFLOAT3[m_numRows*m_numCols];
-	m_currSolution = new XMFLOAT3[m_numRows*m_numCols];
-
-	// Generate grid vertices in system memory.
-	UINT m = m_numRows;
-	UINT n = m_numCols;
-
-	float halfWidth = (n - 1)*dx*0.5f;
-	float halfDepth = (m - 1)*dx*0.5f;
-
-	for (UINT i = 0; i < m; ++i)
-	{
-		float z = halfDepth - i * dx;
-		for (UINT j = 0; j < n; ++j)
-		{
-			float x = -halfWidth + j * dx;
-
-			m_prevSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
-			m_currSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
-		}
-	}
+	m_solver.SetWorkerPool(&WorkerPool::GetDefault());
 }
 
 Wave::~Wave()
 {
-	delete[] m_prevSolution;
-	delete[] m_currSolution;
 }
 
 void Wave::BuildShape()
@@ -249,11 +161,16 @@ void Wave::BuildShape()
 	{
 		VertexType* vertices = new VertexType[vertexCount];
 
-		for (UINT i = 0; i < vertexCount; ++i)
+		const WaveGrid& grid = m_solver.GetGrid();
+		for (UINT i = 0; i < grid.numRows; ++i)
 		{
-			vertices[i].position = m_currSolution[i];
-			vertices[i].color = XMFLOAT4(Colors::Red);
-			vertices[i].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			for (UINT j = 0; j < grid.numCols; ++j)
+			{
+				VertexType& vertex = vertices[i*grid.numCols + j];
+				vertex.position = XMFLOAT3(grid.GetX(j), m_solver.GetHeight(i, j), grid.GetZ(i));
+				vertex.color = XMFLOAT4(Colors::Red);
+				vertex.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			}
 		}
 
 		D3D11_SUBRESOURCE_DATA vbInitData;
@@ -267,55 +184,10 @@ void Wave::BuildShape()
 		delete[] vertices;
 	}
 
-	// Create the index buffer.  The index buffer is fixed, so we only 
-	// need to create and set once.
-
-	const UINT triangleCount = (m_numRows - 1)*(m_numCols - 1) * 2;
-	//UINT indices[triangleCount * 3];
-	UINT* indices = new UINT[triangleCount * 3];
-
-	// Iterate over each quad.
-	UINT m = m_numRows;
-	UINT n = m_numCols;
-	int k = 0;
-	for (UINT i = 0; i < m - 1; ++i)
-	{
-		for (DWORD j = 0; j < n - 1; ++j)
-		{
-			indices[k] = i * n + j;
-			indices[k + 1] = i * n + j + 1;
-			indices[k + 2] = (i + 1)*n + j;
-
-			indices[k + 3] = (i + 1)*n + j;
-			indices[k + 4] = i * n + j + 1;
-			indices[k + 5] = (i + 1)*n + j + 1;
-
-			k += 6; // next quad
-		}
-	}
-
-	m_indexCount = triangleCount * 3;
-
-	D3D11_BUFFER_DESC ibDesc;
-	ibDesc.ByteWidth = sizeof(UINT) * m_indexCount;
-	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.MiscFlags = 0;
-	ibDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA ibInitData;
-	ibInitData.pSysMem = indices;
-	ibInitData.SysMemPitch = 0;
-	ibInitData.SysMemSlicePitch = 0;
-
-	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
-
-	delete[] indices;
+	// Create the index buffer.  The index buffer is fixed, and the same for
+	// every grid of this size, so it is shared.
 
-	time_t t;
-	srand((unsigned) time(&t));
+	UseSharedMesh(MeshCache::GetDefault().GetGridIndexBuffer(m_d3dDevice.Get(), m_numRows, m_numCols));
 }
 
 void Wave::BuildConstantBuffer()
@@ -328,92 +200,52 @@ void Wave::Update(DX::StepTimer const & timer)
 	//
 	// Every quarter second, generate a random wave.
 	//
-	static float t_base = 0.0f;
-	if ((timer.GetTotalSeconds() - t_base) >= 0.25f)
+	if ((timer.GetTotalSeconds() - m_disturbTime) >= 0.25f)
 	{
-		t_base += 0.25f;
+		m_disturbTime += 0.25f;
 
-		DWORD i = 5 + rand() % (m_numRows - 10);
-		DWORD j = 5 + rand() % (m_numCols - 10);
-
-		// Don't disturb boundaries.
-		assert(i > 1 && i < m_numRows - 2);
-		assert(j > 1 && j < m_numCols - 2);
-
-		float magnitude = 1.0f + (float)(rand()) / (float)RAND_MAX;
-
-		float halfMag = 0.5f*magnitude;
-
-		// Disturb the ijth vertex height and its neighbors.
-		m_currSolution[i*m_numCols + j].y += magnitude;
-		m_currSolution[i*m_numCols + j + 1].y += halfMag;
-		m_currSolution[i*m_numCols + j - 1].y += halfMag;
-		m_currSolution[(i + 1)*m_numCols + j].y += halfMag;
-		m_currSolution[(i - 1)*m_numCols + j].y += halfMag;
+		m_disturbances.DisturbNext(m_solver);
 	}
 
 	//
-	// Update waves
+	// Update waves and the wave vertex buffer with the new solution.
 	//
 
-	static float t = 0;
+	// Steps that are due, and how far this frame is past the last of them.
+	const UINT numSteps = m_clock.Advance(float(timer.GetElapsedSeconds()));
+	const float alpha = m_clock.GetAlpha();
 
-	// Accumulate time.
-	float dt = float(timer.GetElapsedSeconds());
-	t += dt;
+	D3D11_MAPPED_SUBRESOURCE mappedData;
+	HRESULT hr = m_d3dContext->Map(m_vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	DX::ThrowIfFailed(hr);
 
-	// Only update the simulation at the specified time step.
-	if (t >= m_timeStep)
+	VertexType* v = reinterpret_cast<VertexType*>(mappedData.pData);
+	const WaveGrid grid = m_solver.GetGrid();
+
+	// Rows are written from several threads, possibly after Update returned.
+	auto writeRow = [=](UINT i, const float* above, const float* row, const float* below)
 	{
-		// Only update interior points; we use zero boundary conditions.
-		for (DWORD i = 1; i < m_numRows - 1; ++i)
+		const float z = grid.GetZ(i);
+		VertexType* rowVertices = v + i * grid.numCols;
+
+		for (UINT j = 0; j < grid.numCols; ++j)
 		{
-			for (DWORD j = 1; j < m_numCols - 1; ++j)
-			{
-				// After this update we will be discarding the old previous
-				// buffer, so overwrite that buffer with the new update.
-				// Note how we can do this inplace (read/write to same element) 
-				// because we won't need prev_ij again and the assignment happens last.
-
-				// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
-				// Moreover, our +z axis goes "down"; this is just to 
-				// keep consistent with our row indices going down.
-
-				m_prevSolution[i*m_numCols + j].y =
-					mK1 * m_prevSolution[i*m_numCols + j].y +
-					mK2 * m_currSolution[i*m_numCols + j].y +
-					mK3 * (m_currSolution[(i + 1)*m_numCols + j].y +
-						m_currSolution[(i - 1)*m_numCols + j].y +
-						m_currSolution[i*m_numCols + j + 1].y +
-						m_currSolution[i*m_numCols + j - 1].y);
-			}
+			rowVertices[j].position = XMFLOAT3(grid.GetX(j), row[j], z);
+			rowVertices[j].color = XMFLOAT4(Colors::Blue);
+			rowVertices[j].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
 		}
+	};
 
-		// We just overwrote the previous buffer with the new data, so
-		// this data needs to become the current solution and the old
-		// current solution becomes the new previous solution.
-		std::swap(m_prevSolution, m_currSolution);
-
-		t = 0.0f; // reset time
-	}
-
-	//
-	// Update the wave vertex buffer with the new solution.
-	//
-
-	D3D11_MAPPED_SUBRESOURCE mappedData;
-	HRESULT hr = m_d3dContext->Map(m_vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
-
-	VertexType* v = reinterpret_cast<VertexType*>(mappedData.pData);
-	const UINT vertexCount = m_numRows * m_numCols;
-	for (UINT i = 0; i < vertexCount; ++i)
+	if (m_waveScheduler)
 	{
-		v[i].position = m_currSolution[i];
-		v[i].color = XMFLOAT4(Colors::Blue);
-		v[i].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		m_waveScheduler->Submit(m_solver, numSteps, alpha, writeRow, [this]() { m_d3dContext->Unmap(m_vertexBuffer.Get(), 0); });
 	}
+	else
+	{
+		m_solver.Advance(numSteps, writeRow, alpha);
 
-	m_d3dContext->Unmap(m_vertexBuffer.Get(), 0);
+		m_d3dContext->Unmap(m_vertexBuffer.Get(), 0);
+	}
 
 	Super::Update(timer);
 }
\ No newline at end of file
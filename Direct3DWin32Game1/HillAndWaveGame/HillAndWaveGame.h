@@ -1,5 +1,6 @@
 #pragma once
 #include "Common/Shape.h"
+#include "Common/WaveScheduler.h"
 #include "MultiObjectGame/MultiObjectGame.h"
 
 class HillAndWaveGame : public MultiObjectGame
@@ -25,9 +26,6 @@ protected:
 	virtual void BuildShape();
 	virtual void BuildConstantBuffer();
 
-	inline float GetHeight(float x, float z) const;
-	inline DirectX::XMFLOAT3 GetHillNormal(float x, float z) const;
-
 	float width = 150.f;
 	float depth = 150.f;
 	const UINT m = 50;
@@ -43,17 +41,14 @@ public:
 
 	virtual void Update(DX::StepTimer const& timer);
 
+	// Queues the simulation on scheduler instead of running it during Update.
+	// The vertex buffer stays mapped until the scheduler has run.
+	void SetWaveScheduler(WaveScheduler* scheduler) { m_waveScheduler = scheduler; }
+
 protected:	
 	virtual void BuildShape();
 	virtual void BuildConstantBuffer();
 
-	DirectX::XMFLOAT3* m_prevSolution;
-	DirectX::XMFLOAT3* m_currSolution;
-	
-	float mK1;
-	float mK2;
-	float mK3;
-
 	float m_speed = 3.25f;
 	float m_damping = 0.4f;
 
@@ -63,4 +58,16 @@ protected:
 	const UINT m_numRows = 201;
 	const UINT m_numCols = 201;
 
+	// Most steps taken in one frame; slower frames lose simulated time.
+	const UINT m_maxSubsteps = 4;
+
+	// Declared after the parameters above, which they are constructed from.
+	WaveSolver m_solver;
+	WaveClock m_clock;
+
+	// Time of the last random disturbance.
+	float m_disturbTime = 0.0f;
+	WaveDisturbanceSequence m_disturbances;
+
+	WaveScheduler* m_waveScheduler = nullptr;
 };
\ No newline at end of file
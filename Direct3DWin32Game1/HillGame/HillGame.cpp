@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "HillGame.h"
+#include "Common/HillFunction.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -50,11 +51,6 @@ void HillGame::SetInputLayout()
 	m_d3dContext->PSSetShader(m_pixelShader.Get(), nullptr, 0);
 }
 
-inline float HillGame::GetHeight(float x, float z) const
-{
-	return 0.3f*(z*sinf(0.1f*x) + x * cosf(0.1f*z));
-}
-
 void HillGame::BuildHill()
 {
 	// CreateGrid
@@ -81,13 +77,25 @@ void HillGame::BuildHill()
 
 	HillGameVertex vertices[vertexCount];
 
+	std::vector<XMFLOAT2> points(vertexCount);
+	for (UINT i = 0; i < m; ++i)
+	{
+		for (UINT j = 0; j < n; ++j)
+		{
+			points[i*n + j] = XMFLOAT2(-halfWidth + j * dx, halfDepth - i * dz);
+		}
+	}
+
+	std::vector<float> heights(vertexCount);
+	HillFunction::GetDefault().Evaluate(points.data(), vertexCount, heights.data(), nullptr);
+
 	for (UINT i = 0; i < m; ++i)
 	{
 		float z = halfDepth - i * dz;
 		for (UINT j = 0; j < n; ++j)
 		{
 			float x = -halfWidth + j * dx;
-			float y = GetHeight(x, z);
+			float y = heights[i*n + j];
 
 			vertices[i*n + j].position = XMFLOAT3(x, y, z);
 			
@@ -23,8 +23,6 @@ protected:
 	virtual void SetInputLayout();
 	void BuildHill();
 
-	inline float GetHeight(float x, float z) const;
-
 	Microsoft::WRL::ComPtr<ID3D11InputLayout>	m_inputLayout;
 	Microsoft::WRL::ComPtr<ID3D11Buffer>		m_vertexBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer>		m_indexBuffer;
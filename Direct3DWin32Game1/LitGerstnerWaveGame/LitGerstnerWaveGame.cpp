@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "LitGerstnerWaveGame/LitGerstnerWaveGame.h"
+#include "Common/WorkerPool.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+#ifdef USE_VERTEX_COLOR
+using VertexType = VertexPositionNormalColor; // The color is not using here
+#else
+using VertexType = VertexPositionNormalUV; // The UV is not using here
+#endif
+
+void LitGerstnerWaveGame::AddObjects()
+{
+	AddHill();
+	m_objects.push_back(new LitGerstnerWave());
+}
+
+LitGerstnerWave::LitGerstnerWave()
+{
+	GerstnerWave wave;
+
+	wave.direction = XMFLOAT2(1.0f, 0.3f);
+	wave.amplitude = 0.8f;
+	wave.wavelength = 40.0f;
+	wave.speed = 7.9f;
+	m_gerstnerWaves.AddWave(wave);
+
+	wave.direction = XMFLOAT2(0.6f, 1.0f);
+	wave.amplitude = 0.4f;
+	wave.wavelength = 17.0f;
+	wave.speed = 5.2f;
+	m_gerstnerWaves.AddWave(wave);
+
+	wave.direction = XMFLOAT2(-0.4f, 1.0f);
+	wave.amplitude = 0.2f;
+	wave.wavelength = 9.0f;
+	wave.speed = 3.7f;
+	m_gerstnerWaves.AddWave(wave);
+
+	wave.direction = XMFLOAT2(1.0f, -0.7f);
+	wave.amplitude = 0.1f;
+	wave.wavelength = 4.0f;
+	wave.speed = 2.5f;
+	m_gerstnerWaves.AddWave(wave);
+}
+
+void LitGerstnerWave::Update(DX::StepTimer const & timer)
+{
+	UpdateResize();
+
+	const float totalTime = float(timer.GetTotalSeconds());
+
+	D3D11_MAPPED_SUBRESOURCE mappedData;
+	HRESULT hr = m_d3dContext->Map(m_vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	DX::ThrowIfFailed(hr);
+
+	VertexType* v = reinterpret_cast<VertexType*>(mappedData.pData);
+
+	const WaveGrid& grid = m_solver.GetGrid();
+	const float width = m_numCols * m_spatialStep;
+	const float depth = m_numRows * m_spatialStep;
+	float rateU = 0.05f;
+	float rateV = 0.02f;
+
+	GerstnerVertexLayout layout;
+	layout.stride = sizeof(VertexType);
+	layout.positionOffset = offsetof(VertexType, position);
+	layout.normalOffset = offsetof(VertexType, normal);
+
+	// Each row is built in memory of its own and copied over, as the heights
+	// for the ray pyramid cannot be read back from the mapped buffer. Row i
+	// is evaluated as the first row, moved to its z by the origin.
+	m_heights.resize(grid.GetVertexCount());
+
+	WorkerPool::GetDefault().ParallelFor(0, grid.numRows, [&](UINT rowBegin, UINT rowEnd)
+	{
+		std::vector<VertexType> rowVertices(grid.numCols);
+
+		for (UINT i = rowBegin; i < rowEnd; ++i)
+		{
+			const float z = grid.GetZ(i);
+			m_gerstnerWaves.EvaluateRows(grid, XMFLOAT2(0.0f, z - grid.GetZ(0)), totalTime, rowVertices.data(), layout, 0, 1);
+
+			float* rowHeights = m_heights.data() + i * grid.numCols;
+			for (UINT j = 0; j < grid.numCols; ++j)
+			{
+				const float x = grid.GetX(j);
+#ifdef USE_VERTEX_COLOR
+				rowVertices[j].color = XMFLOAT4(Colors::Blue);
+#else
+				rowVertices[j].textureUV.x = 0.5f + x / width + rateU * totalTime;
+				rowVertices[j].textureUV.y = 0.5f - z / depth + rateV * totalTime;
+#endif
+				rowHeights[j] = rowVertices[j].position.y;
+			}
+
+			memcpy(v + i * grid.numCols, rowVertices.data(), sizeof(VertexType) * grid.numCols);
+		}
+	});
+
+	m_d3dContext->Unmap(m_vertexBuffer.Get(), 0);
+
+	// The points are also displaced in xz, towards the crests, but the
+	// pyramid takes each height at its undisplaced grid point. Hits are off
+	// by up to the horizontal displacement, about a cell at the crests.
+	m_pyramid.Build(grid, m_heights.data());
+
+	m_uploadedBytes = sizeof(VertexType) * grid.GetVertexCount();
+
+	// Skip the simulation of LitWave.
+	LitShape::Update(timer);
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+#include "LitHillGame/LitHillGame.h"
+#include "Common/GerstnerWaves.h"
+
+// LitHillGame with water made of analytic Gerstner waves instead of the
+// simulated wave.
+class LitGerstnerWaveGame : public LitHillGame
+{
+	using Super = LitHillGame;
+
+protected:
+	virtual void AddObjects() override;
+};
+
+// LitWave surface made of analytic Gerstner waves instead of the simulation.
+// Nothing is carried over between frames; every frame evaluates the waves
+// straight into the vertex buffer.
+class LitGerstnerWave : public LitWave
+{
+	using Super = LitWave;
+
+public:
+	LitGerstnerWave();
+
+	virtual void Update(DX::StepTimer const& timer);
+
+protected:
+
+	GerstnerWaves m_gerstnerWaves;
+
+	// Heights of the last Update, which feed m_pyramid.
+	std::vector<float> m_heights;
+};
\ No newline at end of file
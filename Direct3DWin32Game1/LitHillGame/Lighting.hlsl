@@ -22,11 +22,17 @@ cbuffer cbPerObject : register(b1)
 	Material gMaterial;
 };
 
+#ifdef WAVE_STREAM
+#include "WaveStream.hlsl"
+#elif defined(TERRAIN_CDLOD)
+#include "TerrainCDLOD.hlsl"
+#else
 struct VertexIn
 {
 	float3 PosL  : POSITION;
 	float3 NormalL : NORMAL;
 };
+#endif
 
 struct VertexOut
 {
@@ -38,13 +44,25 @@ struct VertexOut
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout;
+
+#ifdef WAVE_STREAM
+	float3 posL, normalL;
+	float2 texUV;
+	GetWaveVertex(vin, posL, normalL, texUV);
+#elif defined(TERRAIN_CDLOD)
+	float3 posL, normalL;
+	GetTerrainVertex(vin, posL, normalL);
+#else
+	float3 posL = vin.PosL;
+	float3 normalL = vin.NormalL;
+#endif
 	
 	// Transform to world space space.
-	vout.PosW    = mul(float4(vin.PosL, 1.0f), gWorld).xyz;
-	vout.NormalW = mul(vin.NormalL, (float3x3)gWorldInvTranspose);
+	vout.PosW    = mul(float4(posL, 1.0f), gWorld).xyz;
+	vout.NormalW = mul(normalL, (float3x3)gWorldInvTranspose);
 		
 	// Transform to homogeneous clip space.
-	vout.PosH = mul(float4(vin.PosL, 1.0f), gWorldViewProj);
+	vout.PosH = mul(float4(posL, 1.0f), gWorldViewProj);
 
 	return vout;
 }
@@ -1,6 +1,6 @@
 #include "pch.h"
 #include "LitHillGame/LitHillGame.h"
-#include <ctime>
+#include "Common/WorkerPool.h"
 
 using namespace DirectX;
 using Microsoft::WRL::ComPtr;
@@ -10,6 +10,27 @@ using VertexType = VertexPositionNormalColor; // The color is not using here
 using VertexType = VertexPositionNormalUV; // The UV is not using here
 #endif
 
+namespace
+{
+	// Octahedral encoding around +y, the inverse of DecodeOctahedralNormal
+	// in WaveStream.hlsl. The lower hemisphere is folded over the diagonals.
+	void PackOctahedralNormal(const XMFLOAT3& normal, SHORT octNormal[2])
+	{
+		const float invL1 = 1.0f / (fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z));
+		float u = normal.x * invL1;
+		float v = normal.z * invL1;
+		if (normal.y < 0.0f)
+		{
+			const float foldedU = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			const float foldedV = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			u = foldedU;
+			v = foldedV;
+		}
+		octNormal[0] = SHORT(lroundf(u * 32767.0f));
+		octNormal[1] = SHORT(lroundf(v * 32767.0f));
+	}
+}
+
 LitHillGame::~LitHillGame()
 {
 	for (auto it = m_objects.begin(); it != m_objects.end(); ++it)
@@ -33,6 +54,58 @@ void LitHillGame::Initialize(HWND window, int width, int height)
 	m_d3dContext->PSSetConstantBuffers(0, 1, m_constantBufferPerFrame.GetAddressOf());
 }
 
+void LitHillGame::OnMouseDown(WPARAM btnState, int x, int y)
+{
+	Super::OnMouseDown(btnState, x, y);
+
+	if ((btnState & MK_MBUTTON) != 0)
+	{
+		Pick(x, y);
+	}
+}
+
+void LitHillGame::Pick(int x, int y)
+{
+	float vx = (+2.0f*x / m_outputWidth - 1.0f) / m_proj(0, 0);
+	float vy = (-2.0f*y / m_outputHeight + 1.0f) / m_proj(1, 1);
+
+	XMMATRIX view = XMLoadFloat4x4(&m_view);
+	XMVECTOR det = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&det, view);
+
+	HeightRay ray;
+	XMStoreFloat3(&ray.origin, XMVector3TransformCoord(XMVectorSet(0.f, 0.f, 0.f, 1.f), invView));
+	XMStoreFloat3(&ray.direction, XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(vx, vy, 1.f, 0.f), invView)));
+
+	// Nearest hit over the hills and waters. The terrains of LitTerrainGame
+	// and LitStreamedTerrainGame draw maps far larger than one uniform grid
+	// and build no pyramid, so they never hit.
+	HeightRayHit nearest;
+	for (auto it = m_objects.begin(); it != m_objects.end(); ++it)
+	{
+		HeightRayHit hit;
+		if (LitHill* hill = dynamic_cast<LitHill*>(*it))
+		{
+			hill->IntersectRay(ray, hit);
+		}
+		else if (LitWave* wave = dynamic_cast<LitWave*>(*it))
+		{
+			wave->IntersectRay(ray, hit);
+		}
+
+		if (hit.bHit && hit.distance < nearest.distance)
+		{
+			nearest = hit;
+		}
+	}
+
+	if (nearest.bHit)
+	{
+		m_spotLight.Position = XMFLOAT3(nearest.position.x, nearest.position.y + 30.0f, nearest.position.z);
+		m_spotLight.Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+	}
+}
+
 void LitHillGame::BuildLight()
 {
 	// Directional light.
@@ -72,14 +145,42 @@ void LitHillGame::Update(DX::StepTimer const & timer)
 {
 	Super::Update(timer);
 
+	if (m_governedWave && m_waveGovernor.Update(float(timer.GetElapsedSeconds())))
+	{
+		m_governedWave->SetDetailLevel(m_waveGovernor.GetLevel());
+	}
+
 	UpdateLightPosition(timer);
 	UpdateConstantBufferPerFrame();
 }
 
 void LitHillGame::AddObjects()
 {
-	m_objects.push_back(new LitHill());
-	m_objects.push_back(new LitWave());
+	AddHill();
+	AddWave(new LitWave(m_waveUploadMode));
+}
+
+void LitHillGame::AddHill()
+{
+	LitHill* hill = new LitHill();
+	if (m_heightmapFile)
+	{
+		m_heightmap.reset(new MappedHeightmap(m_heightmapFile, HeightmapFormat::R16, m_heightmapSize, m_heightmapSize, 150.f, 150.f, 40.f, -20.f));
+		hill->SetHeightField(m_heightmap.get(), 150.f, 150.f);
+	}
+	hill->SetMaxError(m_hillMaxError);
+	m_objects.push_back(hill);
+}
+
+void LitHillGame::AddWave(LitWave* wave)
+{
+	wave->SetWaveScheduler(&m_waveScheduler);
+	m_objects.push_back(wave);
+
+	if (m_bWaveGovernor)
+	{
+		m_governedWave = wave;
+	}
 }
 
 void LitHillGame::UpdateLightPosition(DX::StepTimer const & timer)
@@ -92,7 +193,7 @@ void LitHillGame::UpdateLightPosition(DX::StepTimer const & timer)
 	m_pointLight.Position.z = 70.0f*sinf(0.2f*totalTime);
 	float x = m_pointLight.Position.x;
 	float z = m_pointLight.Position.z;
-	m_pointLight.Position.y = fmaxf(0.3f*(z*sinf(0.1f*x) + x * cosf(0.1f*z)), -3.0f) + 10.0f;
+	m_pointLight.Position.y = fmaxf(HillFunction::GetDefault().GetHeight(x, z), -3.0f) + 10.0f;
 
 
 	// Control the spot light by keyboard.
@@ -208,14 +309,7 @@ void LitHillGame::UpdateConstantBufferPerFrame()
 
 void LitHill::BuildShape()
 {
-	// CreateGrid
-
 	const UINT vertexCount = m * n;
-	const UINT faceCount = (m - 1)*(n - 1) * 2;
-
-	//
-	// Create the vertices.
-	//
 
 	float halfWidth = 0.5f*width;
 	float halfDepth = 0.5f*depth;
@@ -223,120 +317,122 @@ void LitHill::BuildShape()
 	float dx = width / (n - 1);
 	float dz = depth / (m - 1);
 
-	float du = 1.0f / (n - 1);
-	float dv = 1.0f / (m - 1);
-
-	VertexType* vertices = new VertexType[vertexCount];
-
+	std::vector<XMFLOAT2> points(vertexCount);
 	for (UINT i = 0; i < m; ++i)
 	{
-		float z = halfDepth - i * dz;
 		for (UINT j = 0; j < n; ++j)
 		{
-			float x = -halfWidth + j * dx;
-			float y = GetHeight(x, z);
+			points[i*n + j] = XMFLOAT2(-halfWidth + j * dx, halfDepth - i * dz);
+		}
+	}
 
-			vertices[i*n + j].position = XMFLOAT3(x, y, z);
+	std::vector<float> heights(vertexCount);
+	GetHeightField().Evaluate(points.data(), vertexCount, heights.data(), nullptr, &WorkerPool::GetDefault());
 
-#ifdef USE_VERTEX_COLOR
-			XMFLOAT4 color;
-			if (y < -10.0f)
-			{
-				// Sandy beach color.
-				color = XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
-			}
-			else if (y < 5.0f)
-			{
-				// Light yellow-green.
-				color = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
-			}
-			else if (y < 12.0f)
-			{
-				// Dark yellow-green.
-				color = XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
-			}
-			else if (y < 20.0f)
+	// Every object keeps its own pyramid for ray queries; the cells have to be square.
+	assert(fabsf(dx - dz) <= 1e-4f * dx);
+	m_pyramid.Build(WaveGrid(m, n, dx), heights.data());
+
+	// The grid only depends on the members below, so every LitHill over the
+	// same heights shares one copy of it.
+	const std::string key = MeshCache::MakeKey("LitHill", width, depth, m, n, static_cast<const void*>(m_heightField), m_maxError);
+	UseSharedMesh(MeshCache::GetDefault().GetMeshBuffers(m_d3dDevice.Get(), key, [&](MeshData& mesh)
+	{
+		if (m_maxError > 0.0f)
+		{
+			// At least as fine as the uniform grid.
+			UINT gridCells = 2;
+			while (gridCells < std::max(m, n) - 1)
 			{
-				// Dark brown.
-				color = XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
+				gridCells *= 2;
 			}
-			else
+
+			GeometryGenerator::MeshData meshData;
+			HeightFieldMesher mesher(GetHeightField(), width, depth, gridCells, &WorkerPool::GetDefault());
+			mesher.CreateMesh(m_maxError, meshData);
+
+			std::vector<VertexType> vertices(meshData.Vertices.size());
+			for (size_t k = 0; k < vertices.size(); ++k)
 			{
-				// White snow.
-				color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
-			}
-			vertices[i*n + j].color = color;
-			
+				vertices[k].position = meshData.Vertices[k].Position;
+				vertices[k].normal = meshData.Vertices[k].Normal;
+#ifdef USE_VERTEX_COLOR
+				vertices[k].color = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
 #else
-			vertices[i*n + j].textureUV.x = j * du;
-			vertices[i*n + j].textureUV.y = i * dv;
+				vertices[k].textureUV = meshData.Vertices[k].TexC;
 #endif
+			}
 
-			vertices[i*n + j].normal = GetHillNormal(x, z);
+			mesh.SetVertices(vertices.data(), static_cast<UINT>(vertices.size()));
+			mesh.indices = std::move(meshData.Indices);
+			return;
 		}
-	}
-
-	// Vertex buffer
 
-	D3D11_BUFFER_DESC vbDesc;
-	vbDesc.ByteWidth = sizeof(VertexType) * vertexCount;;
-	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = 0;
-	vbDesc.MiscFlags = 0;
-	vbDesc.StructureByteStride = 0;
+		// CreateGrid
 
-	D3D11_SUBRESOURCE_DATA vbInitData;
-	vbInitData.pSysMem = vertices;
-	vbInitData.SysMemPitch = 0;
-	vbInitData.SysMemSlicePitch = 0;
+		//
+		// Create the vertices.
+		//
 
-	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, &vbInitData, m_vertexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
+		float du = 1.0f / (n - 1);
+		float dv = 1.0f / (m - 1);
 
-	//
-	// Create the indices.
-	//
+		std::vector<VertexType> vertices(vertexCount);
 
-	UINT* indices = new UINT[faceCount * 3];
+		std::vector<XMFLOAT3> normals(vertexCount);
+		GetHeightField().Evaluate(points.data(), vertexCount, nullptr, normals.data(), &WorkerPool::GetDefault());
 
-	// Iterate over each quad and compute indices.
-	UINT k = 0;
-	for (UINT i = 0; i < m - 1; ++i)
-	{
-		for (UINT j = 0; j < n - 1; ++j)
+		for (UINT i = 0; i < m; ++i)
 		{
-			indices[k] = i * n + j;
-			indices[k + 1] = i * n + j + 1;
-			indices[k + 2] = (i + 1)*n + j;
-
-			indices[k + 3] = (i + 1)*n + j;
-			indices[k + 4] = i * n + j + 1;
-			indices[k + 5] = (i + 1)*n + j + 1;
-
-			k += 6; // next quad
-		}
-	}
-
-	// Index buffer
+			float z = halfDepth - i * dz;
+			for (UINT j = 0; j < n; ++j)
+			{
+				float x = -halfWidth + j * dx;
+				float y = heights[i*n + j];
 
-	m_indexCount = faceCount * 3;
+				vertices[i*n + j].position = XMFLOAT3(x, y, z);
 
-	D3D11_BUFFER_DESC ibDesc;
-	ibDesc.ByteWidth = sizeof(UINT) * m_indexCount;;
-	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.MiscFlags = 0;
-	ibDesc.StructureByteStride = 0;
+#ifdef USE_VERTEX_COLOR
+				XMFLOAT4 color;
+				if (y < -10.0f)
+				{
+					// Sandy beach color.
+					color = XMFLOAT4(1.0f, 0.96f, 0.62f, 1.0f);
+				}
+				else if (y < 5.0f)
+				{
+					// Light yellow-green.
+					color = XMFLOAT4(0.48f, 0.77f, 0.46f, 1.0f);
+				}
+				else if (y < 12.0f)
+				{
+					// Dark yellow-green.
+					color = XMFLOAT4(0.1f, 0.48f, 0.19f, 1.0f);
+				}
+				else if (y < 20.0f)
+				{
+					// Dark brown.
+					color = XMFLOAT4(0.45f, 0.39f, 0.34f, 1.0f);
+				}
+				else
+				{
+					// White snow.
+					color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+				}
+				vertices[i*n + j].color = color;
+			
+#else
+				vertices[i*n + j].textureUV.x = j * du;
+				vertices[i*n + j].textureUV.y = i * dv;
+#endif
 
-	D3D11_SUBRESOURCE_DATA ibInitData;
-	ibInitData.pSysMem = indices;
-	ibInitData.SysMemPitch = 0;
-	ibInitData.SysMemSlicePitch = 0;
+				vertices[i*n + j].normal = normals[i*n + j];
+			}
+		}
 
-	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
+		mesh.SetVertices(vertices.data(), vertexCount);
+		mesh.indices = MeshCache::GetDefault().GetGridIndices(m, n)->indices;
+	}));
 
 	// Set constant buffer
 	D3D11_BUFFER_DESC cbDesc;
@@ -347,11 +443,8 @@ void LitHill::BuildShape()
 	cbDesc.MiscFlags = 0;
 	cbDesc.StructureByteStride = 0;
 
-	hr = m_d3dDevice->CreateBuffer(&cbDesc, nullptr, m_constantBufferPerObject.GetAddressOf());
+	HRESULT hr = m_d3dDevice->CreateBuffer(&cbDesc, nullptr, m_constantBufferPerObject.GetAddressOf());
 	DX::ThrowIfFailed(hr);
-
-	delete[] vertices;
-	delete[] indices;
 }
 
 void LitHill::BuildMaterial()
@@ -362,88 +455,142 @@ void LitHill::BuildMaterial()
 	m_cbPerObject.material.reflect = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
 }
 
-inline float LitHill::GetHeight(float x, float z) const
+void LitHill::SetHeightField(const HeightField* heightField, float width, float depth)
 {
-	return 0.3f*(z*sinf(0.1f*x) + x * cosf(0.1f*z));
+	m_heightField = heightField;
+	this->width = width;
+	this->depth = depth;
 }
 
-inline DirectX::XMFLOAT3 LitHill::GetHillNormal(float x, float z) const
+bool LitHill::IntersectRay(const HeightRay& ray, HeightRayHit& hit) const
 {
-	// n = (-df/dx, 1, -df/dz)
-	XMFLOAT3 n(
-		-0.03f*z*cosf(0.1f*x) - 0.3f*cosf(0.1f*z),
-		1.0f,
-		-0.3f*sinf(0.1f*x) + 0.03f*x*sinf(0.1f*z));
+	return m_pyramid.Intersect(ray, *m_world, hit);
+}
 
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
+const HeightField& LitHill::GetHeightField() const
+{
+	return m_heightField ? *m_heightField : HillFunction::GetDefault();
+}
 
-	return n;
+LitWave::LitWave(WaveUploadMode uploadMode)
+	: m_solver(m_numRows, m_numCols, m_spatialStep, m_timeStep, m_speed, m_damping)
+	, m_clock(m_timeStep, m_maxSubsteps)
+	, m_baseGrid(m_numRows, m_numCols, m_spatialStep)
+	, m_requestedGrid(m_baseGrid)
+	, m_uploadMode(uploadMode)
+{
+	m_solver.SetWorkerPool(&WorkerPool::GetDefault());
 }
 
-LitWave::LitWave()
+LitWave::~LitWave()
 {
-	float dt = m_timeStep;
-	float dx = m_spatialStep;
+	// The buffers may still be under construction on another thread.
+	if (m_pendingBuffers.valid())
+	{
+		m_pendingBuffers.wait();
+	}
+}
 
-	float d = m_damping * dt + 2.0f;
-	float e = (m_speed*m_speed)*(dt*dt) / (dx*dx);
-	mK1 = (m_damping*dt - 2.0f) / d;
-	mK2 = (4.0f - 8.0f*e) / d;
-	mK3 = (2.0f*e) / d;
+void LitWave::BuildShader()
+{
+	std::vector<D3D_SHADER_MACRO> defines;
+	AppendUploadDefines(defines);
+	defines.push_back({ NULL, NULL });
 
-	m_prevSolution = new XMFLOAT3[m_numRows*m_numCols];
-	m_currSolution = new XMFLOAT3[m_numRows*m_numCols];
-	m_normals = new XMFLOAT3[m_numRows*m_numCols];
-	m_tangentX = new XMFLOAT3[m_numRows*m_numCols];
+	const std::wstring shaderFilename = L"LitHillGame\\Lighting.hlsl";
+	CreateVSAndPSShader(shaderFilename, shaderFilename, defines.data());
+}
 
-	// Generate grid vertices in system memory.
-	UINT m = m_numRows;
-	UINT n = m_numCols;
+void LitWave::AppendUploadDefines(std::vector<D3D_SHADER_MACRO>& defines) const
+{
+	if (m_uploadMode == WaveUploadMode::FullVertex)
+		return;
 
-	float halfWidth = (n - 1)*dx*0.5f;
-	float halfDepth = (m - 1)*dx*0.5f;
+	defines.push_back({ "WAVE_STREAM", "1" });
+	if (m_uploadMode == WaveUploadMode::HeightNormal)
+	{
+		defines.push_back({ "WAVE_OCT_NORMAL", "1" });
+	}
+}
 
-	for (UINT i = 0; i < m; ++i)
+void LitWave::SetInputLayout()
+{
+	if (m_uploadMode == WaveUploadMode::FullVertex)
 	{
-		float z = halfDepth - i * dx;
-		for (UINT j = 0; j < n; ++j)
-		{
-			float x = -halfWidth + j * dx;
+		Super::SetInputLayout();
+		return;
+	}
 
-			m_prevSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
-			m_currSolution[i*n + j] = XMFLOAT3(x, 0.0f, z);
-			m_normals[i*n + j] = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			m_tangentX[i*n + j] = XMFLOAT3(1.0f, 0.0f, 0.0f);
-		}
+	std::vector<D3D11_INPUT_ELEMENT_DESC> vertexDesc =
+	{
+		{"POSITION",0,DXGI_FORMAT_R32G32_FLOAT,0,0,D3D11_INPUT_PER_VERTEX_DATA,0},
+		{"TEXUV",0,DXGI_FORMAT_R32G32_FLOAT,0,8,D3D11_INPUT_PER_VERTEX_DATA,0},
+		{"HEIGHT",0,DXGI_FORMAT_R32_FLOAT,1,0,D3D11_INPUT_PER_VERTEX_DATA,0}
+	};
+	if (m_uploadMode == WaveUploadMode::HeightNormal)
+	{
+		vertexDesc.push_back({"NORMAL",0,DXGI_FORMAT_R16G16_SNORM,1,4,D3D11_INPUT_PER_VERTEX_DATA,0});
 	}
+
+	HRESULT hr = m_d3dDevice->CreateInputLayout(
+		vertexDesc.data(),
+		UINT(vertexDesc.size()),
+		m_VSByteCode->GetBufferPointer(),
+		m_VSByteCode->GetBufferSize(),
+		m_inputLayout.GetAddressOf()
+	);
+	DX::ThrowIfFailed(hr);
 }
 
-LitWave::~LitWave()
+void LitWave::SetVertexBuffers()
 {
-	delete[] m_prevSolution;
-	delete[] m_currSolution;
-	delete[] m_normals;
-	delete[] m_tangentX;
+	if (m_uploadMode == WaveUploadMode::FullVertex)
+	{
+		Super::SetVertexBuffers();
+		return;
+	}
+
+	ID3D11Buffer* buffers[] = { m_vertexBuffer.Get(), m_heightBuffer.Get() };
+	UINT strides[] = { sizeof(VertexPositionXZUV), m_uploadMode == WaveUploadMode::HeightNormal ? sizeof(VertexHeightNormal) : sizeof(float) };
+	UINT offsets[] = { 0, 0 };
+	m_d3dContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	m_d3dContext->VSSetConstantBuffers(2, 1, m_constantBufferWave.GetAddressOf());
+
+	if (m_uploadMode == WaveUploadMode::Height)
+	{
+		m_d3dContext->VSSetShaderResources(2, 1, m_heightView.GetAddressOf());
+	}
 }
 
 void LitWave::BuildShape()
 {
-	// Create the vertex buffer.  Note that we allocate space only, as
-	// we will be updating the data every time step of the simulation.
+	GridBuffers buffers;
+	buffers.grid = m_solver.GetGrid();
+	CreateGridBuffers(buffers);
+	UseGridBuffers(buffers);
 
 	const UINT vertexCount = m_numRows * m_numCols;
+	HRESULT hr;
 
-	D3D11_BUFFER_DESC vbDesc;
-	vbDesc.ByteWidth = sizeof(VertexType) * vertexCount;
-	vbDesc.Usage = D3D11_USAGE_DYNAMIC;
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	vbDesc.MiscFlags = 0;
-	vbDesc.StructureByteStride = 0;
-
-	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, nullptr, m_vertexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
+	if (m_uploadMode != WaveUploadMode::FullVertex)
+	{
+		m_cbWave.texOffset = XMFLOAT2(0.0f, 0.0f);
+		m_cbWave.clipmapOrigin = XMINT2(0, 0);
+		m_cbWave.clipmapScale = 1;
+		m_cbWave.clipmapCells = 0;
+		m_cbWave.pad = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+		D3D11_BUFFER_DESC cbDesc;
+		cbDesc.ByteWidth = sizeof(cbWaveStruct);
+		cbDesc.Usage = D3D11_USAGE_DYNAMIC;
+		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		cbDesc.MiscFlags = 0;
+		cbDesc.StructureByteStride = 0;
+
+		hr = m_d3dDevice->CreateBuffer(&cbDesc, nullptr, m_constantBufferWave.GetAddressOf());
+		DX::ThrowIfFailed(hr);
+	}
 
 	// Test
 	bool bTest = false;
@@ -451,11 +598,16 @@ void LitWave::BuildShape()
 	{
 		VertexType* vertices = new VertexType[vertexCount];
 
-		for (UINT i = 0; i < vertexCount; ++i)
+		const WaveGrid& grid = m_solver.GetGrid();
+		for (UINT i = 0; i < grid.numRows; ++i)
 		{
-			vertices[i].position = m_currSolution[i];
-			vertices[i].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			//vertices[i].color = XMFLOAT4(Colors::Red);
+			for (UINT j = 0; j < grid.numCols; ++j)
+			{
+				VertexType& vertex = vertices[i*grid.numCols + j];
+				vertex.position = XMFLOAT3(grid.GetX(j), m_solver.GetHeight(i, j), grid.GetZ(i));
+				vertex.normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				//vertex.color = XMFLOAT4(Colors::Red);
+			}
 		}
 
 		D3D11_BUFFER_DESC vbDesc2;
@@ -477,67 +629,181 @@ void LitWave::BuildShape()
 		delete[] vertices;
 	}
 
-	// Create the index buffer.  The index buffer is fixed, so we only 
-	// need to create and set once.
+	// Set constant buffer
+	D3D11_BUFFER_DESC cbDesc;
+	cbDesc.ByteWidth = sizeof(cbPerObjectStruct);
+	cbDesc.Usage = D3D11_USAGE_DEFAULT;
+	cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	cbDesc.CPUAccessFlags = 0;
+	cbDesc.MiscFlags = 0;
+	cbDesc.StructureByteStride = 0;
+
+	hr = m_d3dDevice->CreateBuffer(&cbDesc, nullptr, m_constantBufferPerObject.GetAddressOf());
+	DX::ThrowIfFailed(hr);
+}
 
-	const UINT triangleCount = (m_numRows - 1)*(m_numCols - 1) * 2;
-	//UINT indices[triangleCount * 3];
-	UINT* indices = new UINT[triangleCount * 3];
+void LitWave::CreateGridBuffers(GridBuffers& buffers) const
+{
+	const WaveGrid& grid = buffers.grid;
+	const UINT vertexCount = grid.GetVertexCount();
+	HRESULT hr;
 
-	// Iterate over each quad.
-	UINT m = m_numRows;
-	UINT n = m_numCols;
-	int k = 0;
-	for (UINT i = 0; i < m - 1; ++i)
+	if (m_uploadMode == WaveUploadMode::FullVertex)
 	{
-		for (DWORD j = 0; j < n - 1; ++j)
+		// Create the vertex buffer.  Note that we allocate space only, as
+		// we will be updating the data every time step of the simulation.
+
+		D3D11_BUFFER_DESC vbDesc;
+		vbDesc.ByteWidth = sizeof(VertexType) * vertexCount;
+		vbDesc.Usage = D3D11_USAGE_DYNAMIC;
+		vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		vbDesc.MiscFlags = 0;
+		vbDesc.StructureByteStride = 0;
+
+		hr = m_d3dDevice->CreateBuffer(&vbDesc, nullptr, buffers.vertexBuffer.GetAddressOf());
+		DX::ThrowIfFailed(hr);
+	}
+	else
+	{
+		if (m_bGridMesh)
 		{
-			indices[k] = i * n + j;
-			indices[k + 1] = i * n + j + 1;
-			indices[k + 2] = (i + 1)*n + j;
+			// xz and texture coordinates never change, so they are created once
+			// and only the heights are uploaded every frame. The texture scrolls
+			// through the wave constants. They only depend on the grid, so
+			// waves of the same size share them, with the indices.
+
+			const std::string key = MeshCache::MakeKey("LitWaveXZUV", grid.numRows, grid.numCols, grid.spatialStep);
+			buffers.mesh = MeshCache::GetDefault().GetMeshBuffers(m_d3dDevice.Get(), key, [grid, vertexCount](MeshData& mesh)
+			{
+				const float width = grid.numCols * grid.spatialStep;
+				const float depth = grid.numRows * grid.spatialStep;
+
+				std::vector<VertexPositionXZUV> vertices(vertexCount);
+				for (UINT i = 0; i < grid.numRows; ++i)
+				{
+					for (UINT j = 0; j < grid.numCols; ++j)
+					{
+						VertexPositionXZUV& vertex = vertices[i*grid.numCols + j];
+						vertex.positionXZ = XMFLOAT2(grid.GetX(j), grid.GetZ(i));
+						vertex.textureUV.x = 0.5f + vertex.positionXZ.x / width;
+						vertex.textureUV.y = 0.5f - vertex.positionXZ.y / depth;
+					}
+				}
+
+				mesh.SetVertices(vertices.data(), vertexCount);
+				mesh.indices = MeshCache::GetDefault().GetGridIndices(grid.numRows, grid.numCols)->indices;
+			});
+			buffers.vertexBuffer = buffers.mesh->vertexBuffer;
+		}
+
+		// The height only stream is also read through a view, for the
+		// neighbors the normals are computed from.
+		const bool bHeightOnly = m_uploadMode == WaveUploadMode::Height;
+
+		D3D11_BUFFER_DESC hbDesc;
+		hbDesc.ByteWidth = (bHeightOnly ? sizeof(float) : sizeof(VertexHeightNormal)) * vertexCount;
+		hbDesc.Usage = D3D11_USAGE_DYNAMIC;
+		hbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER | (bHeightOnly ? D3D11_BIND_SHADER_RESOURCE : 0);
+		hbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		hbDesc.MiscFlags = 0;
+		hbDesc.StructureByteStride = 0;
 
-			indices[k + 3] = (i + 1)*n + j;
-			indices[k + 4] = i * n + j + 1;
-			indices[k + 5] = (i + 1)*n + j + 1;
+		hr = m_d3dDevice->CreateBuffer(&hbDesc, nullptr, buffers.heightBuffer.GetAddressOf());
+		DX::ThrowIfFailed(hr);
 
-			k += 6; // next quad
+		if (bHeightOnly)
+		{
+			CD3D11_SHADER_RESOURCE_VIEW_DESC srvDesc(D3D11_SRV_DIMENSION_BUFFER, DXGI_FORMAT_R32_FLOAT, 0, vertexCount);
+			hr = m_d3dDevice->CreateShaderResourceView(buffers.heightBuffer.Get(), &srvDesc, buffers.heightView.GetAddressOf());
+			DX::ThrowIfFailed(hr);
 		}
 	}
 
-	m_indexCount = triangleCount * 3;
+	if (!m_bGridMesh)
+		return;
 
-	D3D11_BUFFER_DESC ibDesc;
-	ibDesc.ByteWidth = sizeof(UINT) * m_indexCount;
-	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.MiscFlags = 0;
-	ibDesc.StructureByteStride = 0;
+	// Create the index buffer.  The index buffer is fixed, and the same for
+	// every grid of this size, so it is shared.
 
-	D3D11_SUBRESOURCE_DATA ibInitData;
-	ibInitData.pSysMem = indices;
-	ibInitData.SysMemPitch = 0;
-	ibInitData.SysMemSlicePitch = 0;
+	if (!buffers.mesh)
+	{
+		buffers.mesh = MeshCache::GetDefault().GetGridIndexBuffer(m_d3dDevice.Get(), grid.numRows, grid.numCols);
+	}
+	buffers.indexBuffer = buffers.mesh->indexBuffer;
+	buffers.indexCount = buffers.mesh->indexCount;
+	buffers.indexFormat = buffers.mesh->indexFormat;
+}
 
-	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
+void LitWave::UseGridBuffers(const GridBuffers& buffers)
+{
+	m_numRows = buffers.grid.numRows;
+	m_numCols = buffers.grid.numCols;
+	m_spatialStep = buffers.grid.spatialStep;
 
-	// Set constant buffer
-	D3D11_BUFFER_DESC cbDesc;
-	cbDesc.ByteWidth = sizeof(cbPerObjectStruct);
-	cbDesc.Usage = D3D11_USAGE_DEFAULT;
-	cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbDesc.CPUAccessFlags = 0;
-	cbDesc.MiscFlags = 0;
-	cbDesc.StructureByteStride = 0;
+	if (buffers.vertexBuffer)
+	{
+		m_vertexBuffer = buffers.vertexBuffer;
+	}
+	if (buffers.indexBuffer)
+	{
+		m_indexBuffer = buffers.indexBuffer;
+		m_indexCount = buffers.indexCount;
+		m_indexFormat = buffers.indexFormat;
+		m_sharedMesh = buffers.mesh;
+	}
+	if (buffers.heightBuffer)
+	{
+		m_heightBuffer = buffers.heightBuffer;
+		m_heightView = buffers.heightView;
+	}
 
-	hr = m_d3dDevice->CreateBuffer(&cbDesc, nullptr, m_constantBufferPerObject.GetAddressOf());
-	DX::ThrowIfFailed(hr);
+	m_cbWave.spatialStep = m_spatialStep;
+	m_cbWave.numCols = m_numCols;
+	m_cbWave.numRows = m_numRows;
+}
 
-	delete[] indices;
+void LitWave::Resize(UINT numRows, UINT numCols, float spatialStep)
+{
+	m_requestedGrid = WaveGrid(numRows, numCols, spatialStep);
+}
+
+void LitWave::SetDetailLevel(UINT level)
+{
+	// Cells per side halve every level, down to 16, keeping the outer points.
+	const UINT numRows = std::max((m_baseGrid.numRows - 1) >> level, 16u) + 1;
+	const UINT numCols = std::max((m_baseGrid.numCols - 1) >> level, 16u) + 1;
+	const float spatialStep = m_baseGrid.spatialStep * (m_baseGrid.numCols - 1) / (numCols - 1);
+	Resize(numRows, numCols, spatialStep);
+}
+
+void LitWave::UpdateResize()
+{
+	if (m_pendingBuffers.valid())
+	{
+		if (m_pendingBuffers.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return;
+
+		// Only the resampling is left for this frame, which costs about a
+		// step of the new grid.
+		GridBuffers buffers = m_pendingBuffers.get();
+		m_solver.Resize(buffers.grid.numRows, buffers.grid.numCols, buffers.grid.spatialStep);
+		UseGridBuffers(buffers);
+	}
 
-	time_t t;
-	srand((unsigned)time(&t));
+	const WaveGrid& grid = m_solver.GetGrid();
+	if (m_requestedGrid.numRows != grid.numRows || m_requestedGrid.numCols != grid.numCols ||
+		m_requestedGrid.spatialStep != grid.spatialStep)
+	{
+		const WaveGrid requestedGrid = m_requestedGrid;
+		m_pendingBuffers = std::async(std::launch::async, [this, requestedGrid]()
+		{
+			GridBuffers buffers;
+			buffers.grid = requestedGrid;
+			CreateGridBuffers(buffers);
+			return buffers;
+		});
+	}
 }
 
 void LitWave::BuildMaterial()
@@ -550,144 +816,193 @@ void LitWave::BuildMaterial()
 
 void LitWave::Update(DX::StepTimer const & timer)
 {
+	UpdateResize();
+
 	float elapsedTime = float(timer.GetElapsedSeconds());
 	//
 	// Every quarter second, generate a random wave.
 	//
 
-	static float t_base = 0.0f;
-	if ((timer.GetTotalSeconds() - t_base) >= 0.25f)
+	if ((timer.GetTotalSeconds() - m_disturbTime) >= 0.25f)
 	{
-		t_base += 0.25f;
+		m_disturbTime += 0.25f;
 
 		DisturbWave();
 	}
 
 	//
-	// Update waves
+	// Update waves and the wave vertex buffer with the new solution.
 	//
 
-	UpdateWave(elapsedTime);
-
-	//
-	// Update the wave vertex buffer with the new solution.
-	//
+	UpdateWave(elapsedTime, float(timer.GetTotalSeconds()));
 
-	D3D11_MAPPED_SUBRESOURCE mappedData;
-	HRESULT hr = m_d3dContext->Map(m_vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	Super::Update(timer);
+}
 
-	VertexType* v = reinterpret_cast<VertexType*>(mappedData.pData);
+void LitWave::DisturbWave()
+{
+	m_disturbances.DisturbNext(m_solver);
+}
 
-	const UINT vertexCount = m_numRows * m_numCols;
+WaveSolver::RowWriter LitWave::MakeVertexRowWriter(void* data, const WaveGrid& grid, float totalTime) const
+{
+	// Texture coordinates span the simulated grid, also for grids nested in it.
 	const float width = m_numCols * m_spatialStep;
 	const float depth = m_numRows * m_spatialStep;
-	float totalTime = timer.GetTotalSeconds();
 	float rateU = 0.05f;
 	float rateV = 0.02f;
-	for (UINT i = 0; i < vertexCount; ++i)
+
+	return [=](UINT i, const float* above, const float* row, const float* below)
 	{
-		v[i].position = m_currSolution[i];
+		const float z = grid.GetZ(i);
+		VertexType* rowVertices = reinterpret_cast<VertexType*>(data) + i * grid.numCols;
+
+		for (UINT j = 0; j < grid.numCols; ++j)
+		{
+			const float x = grid.GetX(j);
+			rowVertices[j].position = XMFLOAT3(x, row[j], z);
 #ifdef USE_VERTEX_COLOR
-		v[i].color = XMFLOAT4(Colors::Blue);
+			rowVertices[j].color = XMFLOAT4(Colors::Blue);
 #else
-		v[i].textureUV.x = 0.5 + m_currSolution[i].x / width + rateU * totalTime;
-		v[i].textureUV.y = 0.5 - m_currSolution[i].z / depth + rateV * totalTime;
-
+			rowVertices[j].textureUV.x = 0.5f + x / width + rateU * totalTime;
+			rowVertices[j].textureUV.y = 0.5f - z / depth + rateV * totalTime;
 #endif
-		v[i].normal = m_normals[i];
-	}
-
-	m_d3dContext->Unmap(m_vertexBuffer.Get(), 0);
-
-	Super::Update(timer);
+			// Normals on the boundary stay flat.
+			if (above && below && j > 0 && j < grid.numCols - 1)
+			{
+				rowVertices[j].normal = WaveSolver::ComputeNormal(row[j - 1], row[j + 1], above[j], below[j], grid.spatialStep);
+			}
+			else
+			{
+				rowVertices[j].normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+			}
+		}
+	};
 }
 
-void LitWave::DisturbWave()
+void LitWave::GetEyeGridPosition(float& row, float& col) const
 {
-	DWORD i = 5 + rand() % (m_numRows - 10);
-	DWORD j = 5 + rand() % (m_numCols - 10);
-
-	// Don't disturb boundaries.
-	assert(i > 1 && i < m_numRows - 2);
-	assert(j > 1 && j < m_numCols - 2);
+	XMVECTOR det = XMMatrixDeterminant(XMLoadFloat4x4(m_view));
+	XMMATRIX invView = XMMatrixInverse(&det, XMLoadFloat4x4(m_view));
+	det = XMMatrixDeterminant(XMLoadFloat4x4(m_world));
+	XMMATRIX invWorld = XMMatrixInverse(&det, XMLoadFloat4x4(m_world));
 
-	float magnitude = 1.0f + (float)(rand()) / (float)RAND_MAX;
+	XMFLOAT3 eyeL;
+	XMStoreFloat3(&eyeL, XMVector3TransformCoord(invView.r[3], invWorld));
 
-	float halfMag = 0.5f*magnitude;
-
-	// Disturb the ijth vertex height and its neighbors.
-	m_currSolution[i*m_numCols + j].y += magnitude;
-	m_currSolution[i*m_numCols + j + 1].y += halfMag;
-	m_currSolution[i*m_numCols + j - 1].y += halfMag;
-	m_currSolution[(i + 1)*m_numCols + j].y += halfMag;
-	m_currSolution[(i - 1)*m_numCols + j].y += halfMag;
+	const WaveGrid& grid = m_solver.GetGrid();
+	row = (grid.halfDepth - eyeL.z) / grid.spatialStep;
+	col = (eyeL.x + grid.halfWidth) / grid.spatialStep;
 }
 
-void LitWave::UpdateWave(float dt)
+void LitWave::UpdateWave(float dt, float totalTime)
 {
-	static float t = 0;
+	// Steps that are due, and how far this frame is past the last of them.
+	const UINT numSteps = m_clock.Advance(dt);
+	const float alpha = m_clock.GetAlpha();
+
+	const WaveGrid grid = m_solver.GetGrid();
+	float rateU = 0.05f;
+	float rateV = 0.02f;
+
+	ID3D11Buffer* buffer = m_uploadMode == WaveUploadMode::FullVertex ? m_vertexBuffer.Get() : m_heightBuffer.Get();
+
+	D3D11_MAPPED_SUBRESOURCE mappedData;
+	HRESULT hr = m_d3dContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	DX::ThrowIfFailed(hr);
 
-	// Accumulate time.
-	t += dt;
+	void* data = mappedData.pData;
 
-	// Only update the simulation at the specified time step.
-	if (t >= m_timeStep)
+	// Builds the vertices of row i from the height rows the solver hands over,
+	// so heights and normals go straight into the mapped buffer without
+	// another pass over the grid. Rows are written from several threads, and
+	// possibly after this function returned, so everything is captured by value.
+	WaveSolver::RowWriter writeRow;
+	switch (m_uploadMode)
 	{
-		// Only update interior points; we use zero boundary conditions.
-		for (DWORD i = 1; i < m_numRows - 1; ++i)
+	case WaveUploadMode::FullVertex:
+		writeRow = MakeVertexRowWriter(data, grid, totalTime);
+		m_uploadedBytes = sizeof(VertexType) * grid.GetVertexCount();
+		break;
+
+	case WaveUploadMode::HeightNormal:
+		writeRow = [=](UINT i, const float* above, const float* row, const float* below)
 		{
-			for (DWORD j = 1; j < m_numCols - 1; ++j)
+			VertexHeightNormal* rowVertices = reinterpret_cast<VertexHeightNormal*>(data) + i * grid.numCols;
+
+			for (UINT j = 0; j < grid.numCols; ++j)
 			{
-				// After this update we will be discarding the old previous
-				// buffer, so overwrite that buffer with the new update.
-				// Note how we can do this inplace (read/write to same element) 
-				// because we won't need prev_ij again and the assignment happens last.
-
-				// Note j indexes x and i indexes z: h(x_j, z_i, t_k)
-				// Moreover, our +z axis goes "down"; this is just to 
-				// keep consistent with our row indices going down.
-
-				m_prevSolution[i*m_numCols + j].y =
-					mK1 * m_prevSolution[i*m_numCols + j].y +
-					mK2 * m_currSolution[i*m_numCols + j].y +
-					mK3 * (m_currSolution[(i + 1)*m_numCols + j].y +
-						m_currSolution[(i - 1)*m_numCols + j].y +
-						m_currSolution[i*m_numCols + j + 1].y +
-						m_currSolution[i*m_numCols + j - 1].y);
+				rowVertices[j].height = row[j];
+
+				XMFLOAT3 normal(0.0f, 1.0f, 0.0f);
+				if (above && below && j > 0 && j < grid.numCols - 1)
+				{
+					normal = WaveSolver::ComputeNormal(row[j - 1], row[j + 1], above[j], below[j], grid.spatialStep);
+				}
+				PackOctahedralNormal(normal, rowVertices[j].octNormal);
 			}
-		}
+		};
+		m_uploadedBytes = sizeof(VertexHeightNormal) * grid.GetVertexCount() + sizeof(cbWaveStruct);
+		break;
+
+	case WaveUploadMode::Height:
+		writeRow = [=](UINT i, const float* above, const float* row, const float* below)
+		{
+			memcpy(reinterpret_cast<float*>(data) + i * grid.numCols, row, sizeof(float) * grid.numCols);
+		};
+		m_uploadedBytes = sizeof(float) * grid.GetVertexCount() + sizeof(cbWaveStruct);
+		break;
+	}
 
-		// We just overwrote the previous buffer with the new data, so
-		// this data needs to become the current solution and the old
-		// current solution becomes the new previous solution.
-		std::swap(m_prevSolution, m_currSolution);
+	if (m_uploadMode != WaveUploadMode::FullVertex)
+	{
+		m_cbWave.texOffset = XMFLOAT2(rateU * totalTime, rateV * totalTime);
+		d3dUtil::UpdateDynamicBufferFromData(m_d3dContext, m_constantBufferWave, m_cbWave);
+	}
 
-		t = 0.0f; // reset time
+	// The ray pyramid takes the same rows as the vertices, so it matches the
+	// surface drawn. Its coarser levels follow once all rows are in.
+	writeRow = FeedPyramid(writeRow, grid);
 
-		//
-		// Compute normals using finite difference scheme.
-		//
-		for (UINT i = 1; i < m_numRows - 1; ++i)
+	if (m_waveScheduler)
+	{
+		m_waveScheduler->Submit(m_solver, numSteps, alpha, writeRow, [this, buffer]()
 		{
-			for (UINT j = 1; j < m_numCols - 1; ++j)
-			{
-				float l = m_currSolution[i*m_numCols + j - 1].y;
-				float r = m_currSolution[i*m_numCols + j + 1].y;
-				float t = m_currSolution[(i - 1)*m_numCols + j].y;
-				float b = m_currSolution[(i + 1)*m_numCols + j].y;
-				m_normals[i*m_numCols + j].x = -r + l;
-				m_normals[i*m_numCols + j].y = 2.0f*m_spatialStep;
-				m_normals[i*m_numCols + j].z = b - t;
-
-				XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&m_normals[i*m_numCols + j]));
-				XMStoreFloat3(&m_normals[i*m_numCols + j], n);
-
-				m_tangentX[i*m_numCols + j] = XMFLOAT3(2.0f*m_spatialStep, r - l, 0.0f);
-				XMVECTOR T = XMVector3Normalize(XMLoadFloat3(&m_tangentX[i*m_numCols + j]));
-				XMStoreFloat3(&m_tangentX[i*m_numCols + j], T);
-			}
-		}
+			m_d3dContext->Unmap(buffer, 0);
+			m_pyramid.Refit();
+		});
 	}
+	else
+	{
+		m_solver.Advance(numSteps, writeRow, alpha);
+
+		m_d3dContext->Unmap(buffer, 0);
+		m_pyramid.Refit();
+	}
+}
+
+WaveSolver::RowWriter LitWave::FeedPyramid(const WaveSolver::RowWriter& writeRow, const WaveGrid& grid)
+{
+	const WaveGrid& pyramidGrid = m_pyramid.GetGrid();
+	if (pyramidGrid.numRows != grid.numRows || pyramidGrid.numCols != grid.numCols || pyramidGrid.spatialStep != grid.spatialStep)
+	{
+		m_pyramid.Reset(grid);
+	}
+
+	HeightPyramid* pyramid = &m_pyramid;
+	return [writeRow, pyramid](UINT i, const float* above, const float* row, const float* below)
+	{
+		writeRow(i, above, row, below);
+		if (below)
+		{
+			pyramid->UpdateCellRow(i, row, below);
+		}
+	};
+}
+
+bool LitWave::IntersectRay(const HeightRay& ray, HeightRayHit& hit) const
+{
+	return m_pyramid.Intersect(ray, *m_world, hit);
 }
 
 #if USE_VERTEX_COLOR
@@ -3,6 +3,24 @@
 #include "Common/LitShape.h"
 #include "Common/VertexStructuer.h"
 #include "Common/LightStructuer.h"
+#include "Common/WaveScheduler.h"
+#include "Common/HillFunction.h"
+#include "Common/HeightPyramid.h"
+#include "Common/HeightFieldMesher.h"
+#include <future>
+
+// What LitWave uploads every frame. FullVertex rewrites whole vertices.
+// The other modes keep xz and texture coordinates in an immutable buffer and
+// only upload heights, with octahedral normals (8 bytes per vertex) or
+// without (4 bytes), in which case the vertex shader derives the normals.
+enum class WaveUploadMode
+{
+	FullVertex,
+	HeightNormal,
+	Height
+};
+
+class LitWave;
 
 class LitHillGame : public MultiObjectGame
 {
@@ -21,12 +39,26 @@ public:
 
 	virtual void Initialize(HWND window, int width, int height) override;
 
+	virtual void OnMouseDown(WPARAM btnState, int x, int y) override;
+
 protected:
 
 	virtual void Update(DX::StepTimer const& timer) override;
 
+	// The hill and the simulated wave. The games in the other Lit*Game
+	// folders put other surfaces in their place.
 	virtual void AddObjects() override;
 
+	// Adds the hill, from m_heightmapFile when set.
+	void AddHill();
+
+	// Adds a simulated wave run by the wave scheduler, governed when
+	// m_bWaveGovernor is set. Takes ownership of wave.
+	void AddWave(LitWave* wave);
+
+	// Moves the spot light over the hill or water under the cursor.
+	void Pick(int x, int y);
+
 	virtual void BuildLight();
 
 	virtual void BuildConstantBuffer();  // Remember to override this if you changed cnPerFrame struct
@@ -53,12 +85,49 @@ protected:
 	DirectionalLight m_dirLight;
 	PointLight m_pointLight;
 	SpotLight m_spotLight;
+
+	// Simulated wave whose resolution follows the frame time, if any.
+	LitWave* m_governedWave = nullptr;
+	WaveQualityGovernor m_waveGovernor;
+
+	// Vertex data the simulated wave uploads every frame.
+	WaveUploadMode m_waveUploadMode = WaveUploadMode::FullVertex;
+
+	// Lowers the resolution of the simulated wave when frames run long.
+	bool m_bWaveGovernor = false;
+
+	// Draws the hill as an adaptive triangulation within this height error
+	// when above zero.
+	float m_hillMaxError = 0.0f;
+
+	// Raw 16 bit heightmap of m_heightmapSize x m_heightmapSize samples to
+	// draw instead of the hill function, if any.
+	const wchar_t* m_heightmapFile = nullptr;
+	UINT m_heightmapSize = 4097;
+
+	// Heights of the hill when read from a file. Outlives the objects.
+	std::unique_ptr<MappedHeightmap> m_heightmap;
 };
 
 class LitHill : public LitShape
 {
 	using Super = LitShape;
 
+public:
+	// Takes heights and normals from heightField instead of the hill
+	// function, over width x depth. Must be called before Initialize, and
+	// heightField must outlive the object.
+	void SetHeightField(const HeightField* heightField, float width, float depth);
+
+	// Draws an adaptive triangulation within maxError of the heights instead
+	// of the uniform grid, see HeightFieldMesher. Must be called before
+	// Initialize. Rays are still intersected with the uniform grid.
+	void SetMaxError(float maxError) { m_maxError = maxError; }
+
+	// First hit of a world space ray with the hill as drawn. Always misses
+	// for LitTerrain and LitStreamedTerrain, which build no pyramid.
+	bool IntersectRay(const HeightRay& ray, HeightRayHit& hit) const;
+
 protected:
 
 	virtual void BuildShape();
@@ -69,13 +138,20 @@ protected:
 	virtual void BuildTexture();
 #endif
 
-	inline float GetHeight(float x, float z) const;
-	inline DirectX::XMFLOAT3 GetHillNormal(float x, float z) const;
+	// The height field set with SetHeightField, the hill function otherwise.
+	const HeightField& GetHeightField() const;
 
 	float width = 150.f;
 	float depth = 150.f;
 	const UINT m = 50;
 	const UINT n = 50;
+
+	const HeightField* m_heightField = nullptr;
+
+	// Uniform grid when zero.
+	float m_maxError = 0.0f;
+
+	HeightPyramid m_pyramid;
 	
 };
 
@@ -84,39 +160,152 @@ class LitWave : public LitShape
 	using Super = LitShape;
 
 public:
-	LitWave();
+	explicit LitWave(WaveUploadMode uploadMode = WaveUploadMode::FullVertex);
 	virtual ~LitWave();
 
 	virtual void Update(DX::StepTimer const& timer);
 
+	// Queues the simulation on scheduler instead of running it during Update.
+	// The vertex buffer stays mapped until the scheduler has run.
+	void SetWaveScheduler(WaveScheduler* scheduler) { m_waveScheduler = scheduler; }
+
+	WaveUploadMode GetUploadMode() const { return m_uploadMode; }
+
+	// Bytes of vertex data and wave constants written by the last Update.
+	UINT GetUploadedBytes() const { return m_uploadedBytes; }
+
+	// Changes the resolution of the simulation while it runs, see
+	// WaveSolver::Resize. The buffers of the new size are built on another
+	// thread; once they are ready, the next Update resamples the solver and
+	// swaps them in, so no frame waits for the rebuild. Sizes asked for
+	// while a rebuild is running wait for it; only the last one is built.
+	void Resize(UINT numRows, UINT numCols, float spatialStep);
+
+	// Resizes to the initial grid with 2^level times its spacing over the
+	// same area, for quality levels of a WaveQualityGovernor.
+	void SetDetailLevel(UINT level);
+
+	bool IsResizing() const { return m_pendingBuffers.valid(); }
+
+	// First hit of a world space ray with the water as of the last Update.
+	// LitNestedWave only gives the coarse grid, and LitGerstnerWave the
+	// heights at the undisplaced grid points.
+	bool IntersectRay(const HeightRay& ray, HeightRayHit& hit) const;
+
 protected:
+	virtual void BuildShader();
+	virtual void SetInputLayout();
+	virtual void SetVertexBuffers();
 	virtual void BuildShape();
 	virtual void BuildMaterial();
 
+	// Appends the shader defines of the upload mode, without the terminator.
+	void AppendUploadDefines(std::vector<D3D_SHADER_MACRO>& defines) const;
+
+	// Everything that is sized by the grid.
+	struct GridBuffers
+	{
+		WaveGrid grid;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> heightBuffer;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> heightView;
+		UINT indexCount = 0;
+		DXGI_FORMAT indexFormat = DXGI_FORMAT_R32_UINT;
+
+		// Shared mesh the immutable buffers above come from.
+		MeshCache::BuffersHandle mesh;
+	};
+
+	// Creates the buffers of buffers.grid. Only the device and MeshCache are
+	// used, which are free threaded, so this may run on any thread. The grid vertex and index
+	// buffers are left empty without m_bGridMesh.
+	void CreateGridBuffers(GridBuffers& buffers) const;
+
+	// Makes the buffers current; empty ones keep the buffers in use.
+	void UseGridBuffers(const GridBuffers& buffers);
+
+	// Starts building the buffers of a requested size, and applies a resize
+	// whose buffers are ready.
+	void UpdateResize();
+
 #if USE_VERTEX_COLOR
 #elif USE_TEXTURE_UV
 	virtual void BuildTexture();
 #endif
 
 	void DisturbWave();
-	void UpdateWave(float dt);
 
-	DirectX::XMFLOAT3* m_prevSolution;
-	DirectX::XMFLOAT3* m_currSolution;
-	DirectX::XMFLOAT3* m_normals;
-	DirectX::XMFLOAT3* m_tangentX;
+	// Steps the simulation when due and rewrites the vertex buffer.
+	void UpdateWave(float dt, float totalTime);
+
+	// Writer of full vertices for the rows of grid into data, for
+	// WaveSolver::RowWriter. Captures everything by value.
+	WaveSolver::RowWriter MakeVertexRowWriter(void* data, const WaveGrid& grid, float totalTime) const;
+
+	// writeRow, also handing the rows of grid to m_pyramid; resets the
+	// pyramid when grid changed. Refit m_pyramid once all rows are written.
+	WaveSolver::RowWriter FeedPyramid(const WaveSolver::RowWriter& writeRow, const WaveGrid& grid);
 
-	float mK1;
-	float mK2;
-	float mK3;
+	// Fractional row and column of the simulated grid under the camera.
+	void GetEyeGridPosition(float& row, float& col) const;
 
 	const float m_speed = 3.25f;
 	const float m_damping = 0.4f;
 
 	const float m_timeStep = 0.03f;
-	const float m_spatialStep = 0.75f;
 
-	const UINT m_numRows = 201;
-	const UINT m_numCols = 201;
-	
+	// Current grid, changed by Resize.
+	float m_spatialStep = 0.75f;
+	UINT m_numRows = 201;
+	UINT m_numCols = 201;
+
+	// Most steps taken in one frame; slower frames lose simulated time.
+	const UINT m_maxSubsteps = 4;
+
+	// Declared after the parameters above, which they are constructed from.
+	WaveSolver m_solver;
+	WaveClock m_clock;
+
+	// Grid the simulation started with, for SetDetailLevel.
+	const WaveGrid m_baseGrid;
+
+	// Size asked for by the last Resize, and the buffers being built for it.
+	WaveGrid m_requestedGrid;
+	std::future<GridBuffers> m_pendingBuffers;
+
+	// Time of the last random disturbance.
+	float m_disturbTime = 0.0f;
+	WaveDisturbanceSequence m_disturbances;
+
+	WaveScheduler* m_waveScheduler = nullptr;
+
+	// Bounds of the heights last written, for IntersectRay.
+	HeightPyramid m_pyramid;
+
+	const WaveUploadMode m_uploadMode;
+	UINT m_uploadedBytes = 0;
+
+	// False when a derived class draws its own mesh, which does not depend
+	// on the grid size, instead of the grid vertices.
+	bool m_bGridMesh = true;
+
+	// Per frame heights of the stream modes; m_vertexBuffer then holds the
+	// static xz and texture coordinates.
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_heightBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_heightView;
+
+	struct cbWaveStruct
+	{
+		DirectX::XMFLOAT2 texOffset;
+		float spatialStep;
+		UINT numCols;
+		UINT numRows;
+		DirectX::XMINT2 clipmapOrigin;
+		UINT clipmapScale;
+		UINT clipmapCells;
+		DirectX::XMFLOAT3 pad;
+	} m_cbWave;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_constantBufferWave;
 };
\ No newline at end of file
@@ -0,0 +1,60 @@
+//=============================================================================
+// Vertex input of the hill drawn as a CDLOD terrain, see TerrainQuadtree.
+// Slot 0 holds one patch, a grid of gPatchCells x gPatchCells cells with
+// integer coordinates; slot 1 holds the placement of every selected patch,
+// one per instance. Heights and normals come from the hill function.
+//=============================================================================
+
+#define TERRAIN_MAX_LEVELS 16
+
+cbuffer cbTerrain : register(b2)
+{
+	float3 gTerrainEyeL;
+	float gPatchCells;
+
+	// x: distance where a level starts morphing, y: 1 / length of the morph.
+	float4 gMorphRanges[TERRAIN_MAX_LEVELS];
+};
+
+struct VertexIn
+{
+	float2 GridPos : POSITION;
+
+	// xy: corner with the smallest coordinates, z: side length, w: level.
+	float4 Patch : PATCH;
+};
+
+// LitHill::GetHeight.
+float GetHillHeight(float x, float z)
+{
+	return 0.3f * (z * sin(0.1f * x) + x * cos(0.1f * z));
+}
+
+// LitHill::GetHillNormal.
+float3 GetHillNormal(float x, float z)
+{
+	float3 n = float3(
+		-0.03f * z * cos(0.1f * x) - 0.3f * cos(0.1f * z),
+		1.0f,
+		-0.3f * sin(0.1f * x) + 0.03f * x * sin(0.1f * z));
+	return normalize(n);
+}
+
+void GetTerrainVertex(VertexIn vin, out float3 posL, out float3 normalL)
+{
+	float2 origin = vin.Patch.xy;
+	float spacing = vin.Patch.z / gPatchCells;
+	float4 morphRange = gMorphRanges[uint(vin.Patch.w)];
+
+	float2 xz = origin + vin.GridPos * spacing;
+	float3 pos = float3(xz.x, GetHillHeight(xz.x, xz.y), xz.y);
+	float morph = saturate((distance(pos, gTerrainEyeL) - morphRange.x) * morphRange.y);
+
+	// Odd vertices slide onto their even neighbor, which turns the grid into
+	// the one of the next coarser level at the end of the range.
+	float2 gridPos = vin.GridPos - frac(vin.GridPos * 0.5f) * 2.0f * morph;
+	xz = origin + gridPos * spacing;
+
+	posL = float3(xz.x, GetHillHeight(xz.x, xz.y), xz.y);
+	normalL = GetHillNormal(xz.x, xz.y);
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+//=============================================================================
+// Vertex input of a height field split into two streams: xz and texture
+// coordinates in a static buffer (slot 0), and the per frame height, with
+// an octahedral encoded normal when WAVE_OCT_NORMAL is defined, in a
+// dynamic buffer (slot 1). Without the normal stream, normals are taken
+// from the neighboring heights, read through gWaveHeights.
+//
+// With WAVE_CLIPMAP the only stream is the ring mesh of WaveClipmap, and
+// positions, heights and normals all come from gWaveHeights.
+//=============================================================================
+
+cbuffer cbWave : register(b2)
+{
+	float2 gWaveTexOffset;
+	float gWaveSpatialStep;
+	uint gWaveNumCols;
+	uint gWaveNumRows;
+
+	// Placement of the clipmap level being drawn.
+	int2 gClipmapOrigin;
+	uint gClipmapScale;
+	uint gClipmapCells;
+};
+
+#ifndef WAVE_OCT_NORMAL
+Buffer<float> gWaveHeights : register(t2);
+#endif
+
+#ifdef WAVE_CLIPMAP
+struct VertexIn
+{
+	float2 RingPos : POSITION;
+};
+#else
+struct VertexIn
+{
+	float2 PosXZ : POSITION;
+	float2 TexUV : TEXUV;
+	float Height : HEIGHT;
+#ifdef WAVE_OCT_NORMAL
+	float2 OctNormal : NORMAL;
+#endif
+	uint VertexID : SV_VertexID;
+};
+#endif
+
+// Inverse of the octahedral mapping around +y; the lower hemisphere is
+// folded over the diagonals of the square.
+float3 DecodeOctahedralNormal(float2 e)
+{
+	float3 n = float3(e.x, 1.0f - abs(e.x) - abs(e.y), e.y);
+	if (n.y < 0.0f)
+	{
+		n.xz = (1.0f - abs(n.zx)) * (n.xz >= 0.0f ? 1.0f : -1.0f);
+	}
+	return normalize(n);
+}
+
+#ifdef WAVE_CLIPMAP
+float GetWaveHeight(int row, int col)
+{
+	// Water outside the simulated grid stays flat.
+	if (row < 0 || col < 0 || row >= int(gWaveNumRows) || col >= int(gWaveNumCols))
+	{
+		return 0.0f;
+	}
+	return gWaveHeights[row * gWaveNumCols + col];
+}
+
+void GetWaveVertex(VertexIn vin, out float3 posL, out float3 normalL, out float2 texUV)
+{
+	int2 ring = int2(vin.RingPos);
+	int scale = int(gClipmapScale);
+	int cells = int(gClipmapCells);
+	int col = gClipmapOrigin.x + ring.x * scale;
+	int row = gClipmapOrigin.y + ring.y * scale;
+
+	float l = GetWaveHeight(row, col - scale);
+	float r = GetWaveHeight(row, col + scale);
+	float t = GetWaveHeight(row - scale, col);
+	float b = GetWaveHeight(row + scale, col);
+
+	// Odd vertices on the outer edge lie halfway along an edge of the next
+	// coarser level; they take the height of that edge so no cracks open.
+	float height = GetWaveHeight(row, col);
+	if ((ring.y == 0 || ring.y == cells) && (ring.x & 1))
+	{
+		height = 0.5f * (l + r);
+	}
+	else if ((ring.x == 0 || ring.x == cells) && (ring.y & 1))
+	{
+		height = 0.5f * (t + b);
+	}
+
+	float x = (col - 0.5f * (gWaveNumCols - 1)) * gWaveSpatialStep;
+	float z = (0.5f * (gWaveNumRows - 1) - row) * gWaveSpatialStep;
+	posL = float3(x, height, z);
+	texUV = float2(0.5f + x / (gWaveNumCols * gWaveSpatialStep), 0.5f - z / (gWaveNumRows * gWaveSpatialStep)) + gWaveTexOffset;
+
+	// WaveSolver::ComputeNormal over the spacing of the level.
+	normalL = normalize(float3(-r + l, 2.0f * gWaveSpatialStep * scale, b - t));
+}
+#else
+void GetWaveVertex(VertexIn vin, out float3 posL, out float3 normalL, out float2 texUV)
+{
+	posL = float3(vin.PosXZ.x, vin.Height, vin.PosXZ.y);
+	texUV = vin.TexUV + gWaveTexOffset;
+
+#ifdef WAVE_OCT_NORMAL
+	normalL = DecodeOctahedralNormal(vin.OctNormal);
+#else
+	// Same finite difference as WaveSolver::ComputeNormal; normals on the
+	// boundary stay flat.
+	uint i = vin.VertexID / gWaveNumCols;
+	uint j = vin.VertexID - i * gWaveNumCols;
+	normalL = float3(0.0f, 1.0f, 0.0f);
+	if (i > 0 && i < gWaveNumRows - 1 && j > 0 && j < gWaveNumCols - 1)
+	{
+		float l = gWaveHeights[vin.VertexID - 1];
+		float r = gWaveHeights[vin.VertexID + 1];
+		float t = gWaveHeights[vin.VertexID - gWaveNumCols];
+		float b = gWaveHeights[vin.VertexID + gWaveNumCols];
+		normalL = normalize(float3(-r + l, 2.0f * gWaveSpatialStep, b - t));
+	}
+#endif
+}
+#endif
\ No newline at end of file
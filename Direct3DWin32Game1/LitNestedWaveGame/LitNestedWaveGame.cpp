@@ -0,0 +1,160 @@
+#include "pch.h"
+#include "LitNestedWaveGame/LitNestedWaveGame.h"
+#include "Common/WorkerPool.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+#ifdef USE_VERTEX_COLOR
+using VertexType = VertexPositionNormalColor; // The color is not using here
+#else
+using VertexType = VertexPositionNormalUV; // The UV is not using here
+#endif
+
+void LitNestedWaveGame::AddObjects()
+{
+	AddHill();
+
+	// Steps both of its grids itself, outside the scheduler, and keeps its
+	// grid size, so the governor is left out too.
+	m_objects.push_back(new LitNestedWave());
+}
+
+LitNestedWave::LitNestedWave(UINT numCells)
+	: m_nestedSolver(m_solver, numCells)
+{
+	m_nestedSolver.GetFineSolver().SetWorkerPool(&WorkerPool::GetDefault());
+}
+
+void LitNestedWave::Update(DX::StepTimer const & timer)
+{
+	const float totalTime = float(timer.GetTotalSeconds());
+
+	// The random waves of LitWave, which land on the fine grid inside the window.
+	if ((totalTime - m_disturbTime) >= 0.25f)
+	{
+		m_disturbTime += 0.25f;
+
+		const WaveDisturbanceSequence::Disturbance disturbance = m_disturbances.Next(m_solver.GetGrid());
+		m_nestedSolver.Disturb(disturbance.row, disturbance.col, disturbance.magnitude);
+	}
+
+	// Keep the window around the camera. Every move rewrites the coarse
+	// indices, so it only follows once the camera is a quarter window off.
+	float eyeRow, eyeCol;
+	GetEyeGridPosition(eyeRow, eyeCol);
+
+	const UINT originRow = m_nestedSolver.GetOriginRow();
+	const UINT originCol = m_nestedSolver.GetOriginCol();
+	const float halfCells = 0.5f * m_nestedSolver.GetCellCount();
+	if (fabsf(eyeRow - (originRow + halfCells)) > 0.5f * halfCells ||
+		fabsf(eyeCol - (originCol + halfCells)) > 0.5f * halfCells)
+	{
+		m_nestedSolver.Center(eyeRow, eyeCol);
+		if (m_nestedSolver.GetOriginRow() != originRow || m_nestedSolver.GetOriginCol() != originCol)
+		{
+			UpdateCoarseIndices();
+		}
+	}
+
+	const UINT numSteps = m_clock.Advance(float(timer.GetElapsedSeconds()));
+	for (UINT step = 0; step < numSteps; ++step)
+	{
+		m_nestedSolver.Step();
+	}
+	const float alpha = m_clock.GetAlpha();
+
+	const WaveSolver& fineSolver = m_nestedSolver.GetFineSolver();
+
+	D3D11_MAPPED_SUBRESOURCE mappedData;
+	HRESULT hr = m_d3dContext->Map(m_vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	DX::ThrowIfFailed(hr);
+	// The coarse grid holds the fine heights on its points inside the
+	// window, so the pyramid of the coarse rows covers the whole surface,
+	// without the fine detail between coarse points.
+	m_solver.WriteRows(FeedPyramid(MakeVertexRowWriter(mappedData.pData, m_solver.GetGrid(), totalTime), m_solver.GetGrid()), alpha);
+	m_d3dContext->Unmap(m_vertexBuffer.Get(), 0);
+	m_pyramid.Refit();
+
+	hr = m_d3dContext->Map(m_fineBuffers.vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	DX::ThrowIfFailed(hr);
+	fineSolver.WriteRows(MakeVertexRowWriter(mappedData.pData, m_nestedSolver.GetFineGrid(), totalTime), alpha);
+	m_d3dContext->Unmap(m_fineBuffers.vertexBuffer.Get(), 0);
+
+	m_uploadedBytes = sizeof(VertexType) * (m_solver.GetGrid().GetVertexCount() + fineSolver.GetGrid().GetVertexCount());
+
+	// Skip the simulation of LitWave.
+	LitShape::Update(timer);
+}
+
+void LitNestedWave::BuildShape()
+{
+	Super::BuildShape();
+
+	// The coarse indices change with the window, and are never more than
+	// those of the whole grid.
+	D3D11_BUFFER_DESC ibDesc;
+	ibDesc.ByteWidth = sizeof(UINT) * m_indexCount;
+	ibDesc.Usage = D3D11_USAGE_DYNAMIC;
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ibDesc.MiscFlags = 0;
+	ibDesc.StructureByteStride = 0;
+
+	HRESULT hr = m_d3dDevice->CreateBuffer(&ibDesc, nullptr, m_indexBuffer.ReleaseAndGetAddressOf());
+	DX::ThrowIfFailed(hr);
+	m_indexFormat = DXGI_FORMAT_R32_UINT;
+	m_sharedMesh.reset();
+
+	UpdateCoarseIndices();
+
+	m_fineBuffers.grid = m_nestedSolver.GetFineSolver().GetGrid();
+	CreateGridBuffers(m_fineBuffers);
+}
+
+void LitNestedWave::UpdateCoarseIndices()
+{
+	D3D11_MAPPED_SUBRESOURCE mappedData;
+	HRESULT hr = m_d3dContext->Map(m_indexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	DX::ThrowIfFailed(hr);
+
+	UINT* indices = reinterpret_cast<UINT*>(mappedData.pData);
+
+	// Same triangulation as LitWave::CreateGridBuffers.
+	UINT m = m_numRows;
+	UINT n = m_numCols;
+	UINT k = 0;
+	for (UINT i = 0; i < m - 1; ++i)
+	{
+		for (UINT j = 0; j < n - 1; ++j)
+		{
+			if (m_nestedSolver.CoversCell(i, j))
+				continue;
+
+			indices[k] = i * n + j;
+			indices[k + 1] = i * n + j + 1;
+			indices[k + 2] = (i + 1)*n + j;
+
+			indices[k + 3] = (i + 1)*n + j;
+			indices[k + 4] = i * n + j + 1;
+			indices[k + 5] = (i + 1)*n + j + 1;
+
+			k += 6; // next quad
+		}
+	}
+
+	m_d3dContext->Unmap(m_indexBuffer.Get(), 0);
+
+	m_indexCount = k;
+}
+
+void LitNestedWave::Draw()
+{
+	// Coarse grid around the window, then the fine grid in it.
+	Super::Draw();
+
+	UINT stride = sizeof(VertexType);
+	UINT offset = 0;
+	m_d3dContext->IASetVertexBuffers(0, 1, m_fineBuffers.vertexBuffer.GetAddressOf(), &stride, &offset);
+	m_d3dContext->IASetIndexBuffer(m_fineBuffers.indexBuffer.Get(), m_fineBuffers.indexFormat, 0);
+	m_d3dContext->DrawIndexed(m_fineBuffers.indexCount, 0, 0);
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+#include "LitHillGame/LitHillGame.h"
+#include "Common/NestedWaveSolver.h"
+
+// LitHillGame with a finer grid simulated around the camera, nested in the
+// simulated wave.
+class LitNestedWaveGame : public LitHillGame
+{
+	using Super = LitHillGame;
+
+protected:
+	virtual void AddObjects() override;
+};
+
+// LitWave with a grid of twice the resolution in a window around the camera,
+// nested in the simulated grid and coupled to it both ways, see
+// NestedWaveSolver. The coarse cells under the window are left out of the
+// coarse mesh, and its index buffer is rewritten whenever the window moves.
+// Normals along the window edge are flat, like on the grid boundary. Both
+// grids step on the calling thread, with the worker pool. The grid size is
+// fixed; Resize is ignored.
+class LitNestedWave : public LitWave
+{
+	using Super = LitWave;
+
+public:
+	explicit LitNestedWave(UINT numCells = 40);
+
+	virtual void Update(DX::StepTimer const& timer);
+
+protected:
+	virtual void BuildShape();
+	virtual void Draw();
+
+	// Rewrites the coarse indices without the cells under the window.
+	void UpdateCoarseIndices();
+
+	NestedWaveSolver m_nestedSolver;
+
+	GridBuffers m_fineBuffers;
+};
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "pch.h"
+#include "LitOceanGame/LitOceanGame.h"
+#include "Common/WorkerPool.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+#ifdef USE_VERTEX_COLOR
+using VertexType = VertexPositionNormalColor; // The color is not using here
+#else
+using VertexType = VertexPositionNormalUV; // The UV is not using here
+#endif
+
+void LitOceanGame::AddObjects()
+{
+	AddHill();
+	m_objects.push_back(new LitOcean());
+}
+
+LitOcean::LitOcean(const OceanDesc& desc, UINT numTiles)
+	: m_ocean(desc)
+	, m_numTiles(numTiles)
+{
+	m_ocean.SetWorkerPool(&WorkerPool::GetDefault());
+}
+
+LitOcean::~LitOcean()
+{
+}
+
+void LitOcean::BuildShape()
+{
+	// One more row and column than the patch has points, which repeat the
+	// first ones, so the mesh closes up with its neighbours.
+	const UINT n = m_ocean.GetResolution() + 1;
+	const UINT vertexCount = n * n;
+
+	D3D11_BUFFER_DESC vbDesc;
+	vbDesc.ByteWidth = sizeof(VertexType) * vertexCount;
+	vbDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vbDesc.MiscFlags = 0;
+	vbDesc.StructureByteStride = 0;
+
+	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, nullptr, m_vertexBuffer.GetAddressOf());
+	DX::ThrowIfFailed(hr);
+
+	const UINT triangleCount = (n - 1)*(n - 1) * 2;
+	UINT* indices = new UINT[triangleCount * 3];
+
+	int k = 0;
+	for (UINT i = 0; i < n - 1; ++i)
+	{
+		for (UINT j = 0; j < n - 1; ++j)
+		{
+			indices[k] = i * n + j;
+			indices[k + 1] = i * n + j + 1;
+			indices[k + 2] = (i + 1)*n + j;
+
+			indices[k + 3] = (i + 1)*n + j;
+			indices[k + 4] = i * n + j + 1;
+			indices[k + 5] = (i + 1)*n + j + 1;
+
+			k += 6; // next quad
+		}
+	}
+
+	m_indexCount = triangleCount * 3;
+
+	D3D11_BUFFER_DESC ibDesc;
+	ibDesc.ByteWidth = sizeof(UINT) * m_indexCount;
+	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = 0;
+	ibDesc.MiscFlags = 0;
+	ibDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA ibInitData;
+	ibInitData.pSysMem = indices;
+	ibInitData.SysMemPitch = 0;
+	ibInitData.SysMemSlicePitch = 0;
+
+	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.GetAddressOf());
+	DX::ThrowIfFailed(hr);
+
+	delete[] indices;
+}
+
+void LitOcean::BuildMaterial()
+{
+	m_cbPerObject.material.ambient = XMFLOAT4(0.137f, 0.42f, 0.556f, 1.0f);
+	m_cbPerObject.material.diffuse = XMFLOAT4(0.137f, 0.42f, 0.556f, 1.0f);
+	m_cbPerObject.material.specular = XMFLOAT4(0.8f, 0.8f, 0.8f, 96.0f);
+	m_cbPerObject.material.reflect = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+void LitOcean::Update(DX::StepTimer const & timer)
+{
+	const float totalTime = float(timer.GetTotalSeconds());
+
+	m_ocean.Update(totalTime);
+
+	D3D11_MAPPED_SUBRESOURCE mappedData;
+	HRESULT hr = m_d3dContext->Map(m_vertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+	DX::ThrowIfFailed(hr);
+
+	VertexType* v = reinterpret_cast<VertexType*>(mappedData.pData);
+
+	const UINT resolution = m_ocean.GetResolution();
+	const UINT n = resolution + 1;
+	const float patchSize = m_ocean.GetPatchSize();
+	const float spacing = patchSize / resolution;
+	float rateU = 0.05f;
+	float rateV = 0.02f;
+
+	WorkerPool::GetDefault().ParallelFor(0, n, [&](UINT rowBegin, UINT rowEnd)
+	{
+		for (UINT i = rowBegin; i < rowEnd; ++i)
+		{
+			// Rows run along -z like the LitWave grid.
+			const float z = 0.5f*patchSize - i * spacing;
+
+			for (UINT j = 0; j < n; ++j)
+			{
+				const float x = -0.5f*patchSize + j * spacing;
+				const XMFLOAT3& displacement = m_ocean.GetDisplacement(i, j);
+				const XMFLOAT3& normal = m_ocean.GetNormal(i, j);
+
+				VertexType& vertex = v[i * n + j];
+				vertex.position = XMFLOAT3(x + displacement.x, displacement.y, z - displacement.z);
+				vertex.normal = XMFLOAT3(normal.x, normal.y, -normal.z);
+#ifdef USE_VERTEX_COLOR
+				vertex.color = XMFLOAT4(Colors::Blue);
+#else
+				vertex.textureUV.x = m_textureRepeat * j / resolution + rateU * totalTime;
+				vertex.textureUV.y = m_textureRepeat * i / resolution + rateV * totalTime;
+#endif
+			}
+		}
+	});
+
+	m_d3dContext->Unmap(m_vertexBuffer.Get(), 0);
+
+	Super::Update(timer);
+}
+
+void LitOcean::Render()
+{
+	// The patch is periodic, so copies of it shifted by whole patches line up.
+	// Each tile gets its own world matrix; m_world is shared with the other
+	// objects and stays as it is.
+	const XMMATRIX world = XMLoadFloat4x4(m_world);
+	const float patchSize = m_ocean.GetPatchSize();
+	const float offset = 0.5f * (m_numTiles - 1);
+
+	for (UINT tileZ = 0; tileZ < m_numTiles; ++tileZ)
+	{
+		for (UINT tileX = 0; tileX < m_numTiles; ++tileX)
+		{
+			XMMATRIX translation = XMMatrixTranslation((tileX - offset) * patchSize, 0.0f, (tileZ - offset) * patchSize);
+			XMFLOAT4X4 tileWorld;
+			XMStoreFloat4x4(&tileWorld, XMMatrixMultiply(translation, world));
+			UpdateConstantBufferPerObject(tileWorld);
+
+			Super::Render();
+		}
+	}
+}
+
+#if USE_VERTEX_COLOR
+#elif USE_TEXTURE_UV
+
+void LitOcean::BuildTexture()
+{
+	BuildTextureByName(L"TransparentWaveGame\\water1.dds", m_diffuseMapView);
+}
+
+#endif
\ No newline at end of file
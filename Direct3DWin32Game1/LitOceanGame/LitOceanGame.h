@@ -0,0 +1,43 @@
+#pragma once
+#include "LitHillGame/LitHillGame.h"
+#include "Common/FFTOcean.h"
+
+// LitHillGame with open ocean around the hill, synthesized by FFTOcean,
+// instead of the simulated wave.
+class LitOceanGame : public LitHillGame
+{
+	using Super = LitHillGame;
+
+protected:
+	virtual void AddObjects() override;
+};
+
+// Open water synthesized by FFTOcean, for areas far larger than the LitWave
+// grid. The periodic patch is drawn numTiles x numTiles times around the
+// origin. Uses the vertex layout and shaders of LitWave.
+class LitOcean : public LitShape
+{
+	using Super = LitShape;
+
+public:
+	explicit LitOcean(const OceanDesc& desc = OceanDesc(), UINT numTiles = 3);
+	virtual ~LitOcean();
+
+	virtual void Update(DX::StepTimer const& timer);
+	virtual void Render();
+
+protected:
+	virtual void BuildShape();
+	virtual void BuildMaterial();
+
+#if USE_VERTEX_COLOR
+#elif USE_TEXTURE_UV
+	virtual void BuildTexture();
+#endif
+
+	FFTOcean m_ocean;
+	UINT m_numTiles;
+
+	// Texture repeats across one patch; whole numbers keep the tiles seamless.
+	const float m_textureRepeat = 25.0f;
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "pch.h"
+#include "LitStreamedTerrainGame/LitStreamedTerrainGame.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+void LitStreamedTerrainGame::AddObjects()
+{
+	m_objects.push_back(new LitStreamedTerrain());
+	AddWave(new LitWave(m_waveUploadMode));
+}
+
+LitStreamedTerrain::LitStreamedTerrain(float mapSize, float tileSize, UINT tileCells)
+	: m_mapSize(mapSize)
+	, m_tileSize(tileSize)
+	, m_tileCells(tileCells)
+{
+}
+
+void LitStreamedTerrain::BuildShape()
+{
+	// Tiles come with their own vertex buffers; the indices are the same for all.
+	UseSharedMesh(MeshCache::GetDefault().GetGridIndexBuffer(m_d3dDevice.Get(), m_tileCells + 1, m_tileCells + 1));
+
+	m_streamer.reset(new TileStreamer(GetHeightField(), m_mapSize, m_tileSize, m_tileCells, m_d3dDevice.Get()));
+
+	// Set constant buffer
+	D3D11_BUFFER_DESC cbDesc;
+	cbDesc.ByteWidth = sizeof(cbPerObjectStruct);
+	cbDesc.Usage = D3D11_USAGE_DEFAULT;
+	cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	cbDesc.CPUAccessFlags = 0;
+	cbDesc.MiscFlags = 0;
+	cbDesc.StructureByteStride = 0;
+
+	HRESULT hr = m_d3dDevice->CreateBuffer(&cbDesc, nullptr, m_constantBufferPerObject.GetAddressOf());
+	DX::ThrowIfFailed(hr);
+}
+
+void LitStreamedTerrain::Update(DX::StepTimer const & timer)
+{
+	XMMATRIX world = XMLoadFloat4x4(m_world);
+	XMMATRIX view = XMLoadFloat4x4(m_view);
+
+	// Eye in the space of the map.
+	XMVECTOR det = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&det, view);
+	det = XMMatrixDeterminant(world);
+	XMMATRIX invWorld = XMMatrixInverse(&det, world);
+
+	XMFLOAT3 eyeL;
+	XMStoreFloat3(&eyeL, XMVector3TransformCoord(invView.r[3], invWorld));
+
+	m_streamer->Update(eyeL.x, eyeL.z);
+
+	Super::Update(timer);
+}
+
+void LitStreamedTerrain::SetVertexBuffers()
+{
+	// Every tile binds its own, in Draw.
+}
+
+void LitStreamedTerrain::Draw()
+{
+	UINT stride = sizeof(VertexPositionNormalUV);
+	UINT offset = 0;
+	for (const TerrainTile* tile : m_streamer->GetVisibleTiles())
+	{
+		ID3D11Buffer* vertexBuffer = tile->vertexBuffer.Get();
+		m_d3dContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+		m_d3dContext->DrawIndexed(m_indexCount, 0, 0);
+	}
+}
\ No newline at end of file
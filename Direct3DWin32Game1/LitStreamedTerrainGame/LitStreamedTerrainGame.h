@@ -0,0 +1,40 @@
+#pragma once
+#include "LitHillGame/LitHillGame.h"
+#include "Common/TileStreamer.h"
+
+// LitHillGame with the hill function streamed over a large map in tiles
+// around the camera instead of the hill.
+class LitStreamedTerrainGame : public LitHillGame
+{
+	using Super = LitHillGame;
+
+protected:
+	virtual void AddObjects() override;
+};
+
+// The hill function over a map too large to build up front, streamed in
+// tiles around the camera, see TileStreamer. Every resident tile within the
+// ring is drawn with the same grid indices.
+class LitStreamedTerrain : public LitHill
+{
+	using Super = LitHill;
+
+public:
+	explicit LitStreamedTerrain(float mapSize = 16384.0f, float tileSize = 64.0f, UINT tileCells = 64);
+
+	virtual void Update(DX::StepTimer const& timer);
+
+	const TileStreamer& GetStreamer() const { return *m_streamer; }
+
+protected:
+	virtual void BuildShape();
+	virtual void SetVertexBuffers();
+	virtual void Draw();
+
+	float m_mapSize;
+	float m_tileSize;
+	UINT m_tileCells;
+
+	// Created with the device, in BuildShape.
+	std::unique_ptr<TileStreamer> m_streamer;
+};
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "LitTerrainGame/LitTerrainGame.h"
+#include "Common/WorkerPool.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+void LitTerrainGame::AddObjects()
+{
+	m_objects.push_back(new LitTerrain());
+	AddWave(new LitWave(m_waveUploadMode));
+}
+
+LitTerrain::LitTerrain(float size, UINT numLevels, UINT chunkCells)
+	: m_quadtree(GetHeightField(), size, numLevels, chunkCells, &WorkerPool::GetDefault())
+{
+}
+
+void LitTerrain::BuildShader()
+{
+	D3D_SHADER_MACRO defines[] =
+	{
+		{ "TERRAIN_CDLOD", "1" },
+		{ NULL, NULL }
+	};
+
+	const std::wstring shaderFilename = L"LitHillGame\\Lighting.hlsl";
+	CreateVSAndPSShader(shaderFilename, shaderFilename, defines);
+}
+
+void LitTerrain::SetInputLayout()
+{
+	D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
+	{
+		{"POSITION",0,DXGI_FORMAT_R32G32_FLOAT,0,0,D3D11_INPUT_PER_VERTEX_DATA,0},
+		{"PATCH",0,DXGI_FORMAT_R32G32B32A32_FLOAT,1,0,D3D11_INPUT_PER_INSTANCE_DATA,1}
+	};
+
+	HRESULT hr = m_d3dDevice->CreateInputLayout(
+		vertexDesc,
+		ARRAYSIZE(vertexDesc),
+		m_VSByteCode->GetBufferPointer(),
+		m_VSByteCode->GetBufferSize(),
+		m_inputLayout.GetAddressOf()
+	);
+	DX::ThrowIfFailed(hr);
+}
+
+void LitTerrain::SetVertexBuffers()
+{
+	ID3D11Buffer* buffers[] = { m_vertexBuffer.Get(), m_patchBuffer.Get() };
+	UINT strides[] = { sizeof(XMFLOAT2), sizeof(TerrainPatch) };
+	UINT offsets[] = { 0, 0 };
+	m_d3dContext->IASetVertexBuffers(0, 2, buffers, strides, offsets);
+	m_d3dContext->VSSetConstantBuffers(2, 1, m_constantBufferTerrain.GetAddressOf());
+}
+
+void LitTerrain::BuildShape()
+{
+	// The patch mesh, in grid coordinates; the vertex shader scales and
+	// places it per instance.
+	const UINT cells = m_quadtree.GetPatchCells();
+	const UINT n = cells + 1;
+
+	std::vector<XMFLOAT2> vertices(n * n);
+	for (UINT i = 0; i < n; ++i)
+	{
+		for (UINT j = 0; j < n; ++j)
+		{
+			vertices[i*n + j] = XMFLOAT2(float(j), float(i));
+		}
+	}
+
+	D3D11_BUFFER_DESC vbDesc;
+	vbDesc.ByteWidth = static_cast<UINT>(sizeof(XMFLOAT2) * vertices.size());
+	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbDesc.CPUAccessFlags = 0;
+	vbDesc.MiscFlags = 0;
+	vbDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA vbInitData;
+	vbInitData.pSysMem = vertices.data();
+	vbInitData.SysMemPitch = 0;
+	vbInitData.SysMemSlicePitch = 0;
+
+	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, &vbInitData, m_vertexBuffer.GetAddressOf());
+	DX::ThrowIfFailed(hr);
+
+	// Rows run along +z here, so the triangles are wound the other way round
+	// than in LitHill::BuildShape to face up.
+	std::vector<UINT> indices;
+	indices.reserve(cells * cells * 6);
+	for (UINT i = 0; i < cells; ++i)
+	{
+		for (UINT j = 0; j < cells; ++j)
+		{
+			indices.push_back(i * n + j);
+			indices.push_back((i + 1)*n + j);
+			indices.push_back(i * n + j + 1);
+
+			indices.push_back((i + 1)*n + j);
+			indices.push_back((i + 1)*n + j + 1);
+			indices.push_back(i * n + j + 1);
+		}
+	}
+
+	m_indexCount = static_cast<UINT>(indices.size());
+
+	D3D11_BUFFER_DESC ibDesc;
+	ibDesc.ByteWidth = sizeof(UINT) * m_indexCount;
+	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = 0;
+	ibDesc.MiscFlags = 0;
+	ibDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA ibInitData;
+	ibInitData.pSysMem = indices.data();
+	ibInitData.SysMemPitch = 0;
+	ibInitData.SysMemSlicePitch = 0;
+
+	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.GetAddressOf());
+	DX::ThrowIfFailed(hr);
+
+	m_cbTerrain.eyeL = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	m_cbTerrain.patchCells = float(cells);
+
+	D3D11_BUFFER_DESC cbTerrainDesc;
+	cbTerrainDesc.ByteWidth = sizeof(cbTerrainStruct);
+	cbTerrainDesc.Usage = D3D11_USAGE_DYNAMIC;
+	cbTerrainDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	cbTerrainDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	cbTerrainDesc.MiscFlags = 0;
+	cbTerrainDesc.StructureByteStride = 0;
+
+	hr = m_d3dDevice->CreateBuffer(&cbTerrainDesc, nullptr, m_constantBufferTerrain.GetAddressOf());
+	DX::ThrowIfFailed(hr);
+
+	// Set constant buffer
+	D3D11_BUFFER_DESC cbDesc;
+	cbDesc.ByteWidth = sizeof(cbPerObjectStruct);
+	cbDesc.Usage = D3D11_USAGE_DEFAULT;
+	cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	cbDesc.CPUAccessFlags = 0;
+	cbDesc.MiscFlags = 0;
+	cbDesc.StructureByteStride = 0;
+
+	hr = m_d3dDevice->CreateBuffer(&cbDesc, nullptr, m_constantBufferPerObject.GetAddressOf());
+	DX::ThrowIfFailed(hr);
+}
+
+void LitTerrain::Update(DX::StepTimer const & timer)
+{
+	XMMATRIX world = XMLoadFloat4x4(m_world);
+	XMMATRIX view = XMLoadFloat4x4(m_view);
+	XMMATRIX proj = XMLoadFloat4x4(m_proj);
+
+	// Eye and frustum in the space of the map.
+	XMVECTOR det = XMMatrixDeterminant(view);
+	XMMATRIX invView = XMMatrixInverse(&det, view);
+	det = XMMatrixDeterminant(world);
+	XMMATRIX invWorld = XMMatrixInverse(&det, world);
+
+	XMFLOAT3 eyeL;
+	XMStoreFloat3(&eyeL, XMVector3TransformCoord(invView.r[3], invWorld));
+
+	XMFLOAT4X4 worldViewProj;
+	XMStoreFloat4x4(&worldViewProj, XMMatrixMultiply(XMMatrixMultiply(world, view), proj));
+
+	const UINT patchCount = m_quadtree.Select(eyeL, worldViewProj, m_patches);
+
+	if (patchCount > m_patchCapacity)
+	{
+		// Grows by half again so that a slowly growing selection does not
+		// recreate the buffer every frame.
+		m_patchCapacity = patchCount + patchCount / 2;
+
+		D3D11_BUFFER_DESC patchDesc;
+		patchDesc.ByteWidth = sizeof(TerrainPatch) * m_patchCapacity;
+		patchDesc.Usage = D3D11_USAGE_DYNAMIC;
+		patchDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		patchDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		patchDesc.MiscFlags = 0;
+		patchDesc.StructureByteStride = 0;
+
+		HRESULT hr = m_d3dDevice->CreateBuffer(&patchDesc, nullptr, m_patchBuffer.ReleaseAndGetAddressOf());
+		DX::ThrowIfFailed(hr);
+	}
+
+	if (patchCount > 0)
+	{
+		D3D11_MAPPED_SUBRESOURCE mappedData;
+		HRESULT hr = m_d3dContext->Map(m_patchBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedData);
+		DX::ThrowIfFailed(hr);
+		memcpy(mappedData.pData, m_patches.data(), sizeof(TerrainPatch) * patchCount);
+		m_d3dContext->Unmap(m_patchBuffer.Get(), 0);
+	}
+
+	m_cbTerrain.eyeL = eyeL;
+	for (UINT level = 0; level < m_quadtree.GetLevelCount(); ++level)
+	{
+		// The top level is never morphed.
+		const float morphStart = m_quadtree.GetMorphStart(level);
+		const float lodRange = m_quadtree.GetLodRange(level);
+		const float invMorphLength = level + 1 < m_quadtree.GetLevelCount() ? 1.0f / (lodRange - morphStart) : 0.0f;
+		m_cbTerrain.morphRanges[level] = XMFLOAT4(morphStart, invMorphLength, 0.0f, 0.0f);
+	}
+	d3dUtil::UpdateDynamicBufferFromData(m_d3dContext, m_constantBufferTerrain, m_cbTerrain);
+
+	Super::Update(timer);
+}
+
+void LitTerrain::Draw()
+{
+	if (!m_patches.empty())
+	{
+		m_d3dContext->DrawIndexedInstanced(m_indexCount, static_cast<UINT>(m_patches.size()), 0, 0, 0);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+#include "LitHillGame/LitHillGame.h"
+#include "Common/TerrainQuadtree.h"
+
+// LitHillGame with the hill function drawn over a large map with
+// continuous LOD instead of the hill.
+class LitTerrainGame : public LitHillGame
+{
+	using Super = LitHillGame;
+
+protected:
+	virtual void AddObjects() override;
+};
+
+// The hill function over a large map, drawn as a CDLOD terrain, see
+// TerrainQuadtree. The CPU only selects patches; one patch mesh is drawn
+// instanced once per selected patch, and the vertex shader places it, morphs
+// it between levels and evaluates heights and normals.
+class LitTerrain : public LitHill
+{
+	using Super = LitHill;
+
+public:
+	explicit LitTerrain(float size = 4096.0f, UINT numLevels = 8, UINT chunkCells = 32);
+
+	virtual void Update(DX::StepTimer const& timer);
+
+	UINT GetPatchCount() const { return static_cast<UINT>(m_patches.size()); }
+
+protected:
+	virtual void BuildShader();
+	virtual void SetInputLayout();
+	virtual void SetVertexBuffers();
+	virtual void BuildShape();
+	virtual void Draw();
+
+	TerrainQuadtree m_quadtree;
+
+	// Patches selected this frame, and the instance buffer they go to.
+	std::vector<TerrainPatch> m_patches;
+	UINT m_patchCapacity = 0;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_patchBuffer;
+
+	struct cbTerrainStruct
+	{
+		DirectX::XMFLOAT3 eyeL;
+		float patchCells;
+		DirectX::XMFLOAT4 morphRanges[TerrainQuadtree::MaxLevels];
+	} m_cbTerrain;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_constantBufferTerrain;
+};
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "LitWaveClipmapGame/LitWaveClipmapGame.h"
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+void LitWaveClipmapGame::AddObjects()
+{
+	AddHill();
+	AddWave(new LitWaveClipmap());
+}
+
+LitWaveClipmap::LitWaveClipmap(UINT ringCells, UINT numLevels)
+	: Super(WaveUploadMode::Height)
+	, m_clipmap(ringCells, numLevels)
+{
+	m_bGridMesh = false;
+}
+
+void LitWaveClipmap::Update(DX::StepTimer const & timer)
+{
+	Super::Update(timer);
+
+	// Center the rings on the camera.
+	float eyeRow, eyeCol;
+	GetEyeGridPosition(eyeRow, eyeCol);
+	m_clipmap.Update(eyeRow, eyeCol);
+
+	// Draw() writes the wave constants once per level.
+	m_uploadedBytes += m_clipmap.GetLevelCount() * sizeof(cbWaveStruct);
+}
+
+void LitWaveClipmap::BuildShader()
+{
+	std::vector<D3D_SHADER_MACRO> defines;
+	AppendUploadDefines(defines);
+	defines.push_back({ "WAVE_CLIPMAP", "1" });
+	defines.push_back({ NULL, NULL });
+
+	const std::wstring shaderFilename = L"LitHillGame\\Lighting.hlsl";
+	CreateVSAndPSShader(shaderFilename, shaderFilename, defines.data());
+}
+
+void LitWaveClipmap::SetInputLayout()
+{
+	D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
+	{
+		{"POSITION",0,DXGI_FORMAT_R32G32_FLOAT,0,0,D3D11_INPUT_PER_VERTEX_DATA,0}
+	};
+
+	HRESULT hr = m_d3dDevice->CreateInputLayout(
+		vertexDesc,
+		ARRAYSIZE(vertexDesc),
+		m_VSByteCode->GetBufferPointer(),
+		m_VSByteCode->GetBufferSize(),
+		m_inputLayout.GetAddressOf()
+	);
+	DX::ThrowIfFailed(hr);
+}
+
+void LitWaveClipmap::SetVertexBuffers()
+{
+	UINT stride = sizeof(XMFLOAT2);
+	UINT offset = 0;
+	m_d3dContext->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
+	m_d3dContext->VSSetConstantBuffers(2, 1, m_constantBufferWave.GetAddressOf());
+	m_d3dContext->VSSetShaderResources(2, 1, m_heightView.GetAddressOf());
+}
+
+void LitWaveClipmap::BuildShape()
+{
+	// Height buffer and wave constants of LitWave. The ring mesh below is
+	// drawn instead of the grid, and stays the same when the grid is resized.
+	Super::BuildShape();
+
+	m_cbWave.clipmapCells = m_clipmap.GetRingCells();
+
+	const std::vector<XMFLOAT2>& vertices = m_clipmap.GetVertices();
+	const std::vector<UINT>& indices = m_clipmap.GetIndices();
+
+	D3D11_BUFFER_DESC vbDesc;
+	vbDesc.ByteWidth = static_cast<UINT>(sizeof(XMFLOAT2) * vertices.size());
+	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbDesc.CPUAccessFlags = 0;
+	vbDesc.MiscFlags = 0;
+	vbDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA vbInitData;
+	vbInitData.pSysMem = vertices.data();
+	vbInitData.SysMemPitch = 0;
+	vbInitData.SysMemSlicePitch = 0;
+
+	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, &vbInitData, m_vertexBuffer.ReleaseAndGetAddressOf());
+	DX::ThrowIfFailed(hr);
+
+	m_indexCount = static_cast<UINT>(indices.size());
+
+	D3D11_BUFFER_DESC ibDesc;
+	ibDesc.ByteWidth = sizeof(UINT) * m_indexCount;
+	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = 0;
+	ibDesc.MiscFlags = 0;
+	ibDesc.StructureByteStride = 0;
+
+	D3D11_SUBRESOURCE_DATA ibInitData;
+	ibInitData.pSysMem = indices.data();
+	ibInitData.SysMemPitch = 0;
+	ibInitData.SysMemSlicePitch = 0;
+
+	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.ReleaseAndGetAddressOf());
+	DX::ThrowIfFailed(hr);
+}
+
+void LitWaveClipmap::Draw()
+{
+	for (UINT level = 0; level < m_clipmap.GetLevelCount(); ++level)
+	{
+		const ClipmapLevel& clipmapLevel = m_clipmap.GetLevel(level);
+		m_cbWave.clipmapOrigin = XMINT2(clipmapLevel.originCol, clipmapLevel.originRow);
+		m_cbWave.clipmapScale = clipmapLevel.scale;
+		d3dUtil::UpdateDynamicBufferFromData(m_d3dContext, m_constantBufferWave, m_cbWave);
+
+		WaveClipmap::IndexRange range = m_clipmap.GetLevelRange(level);
+		m_d3dContext->DrawIndexed(range.count, range.start, 0);
+
+		range = m_clipmap.GetTrimRange(level);
+		if (range.count > 0)
+		{
+			m_d3dContext->DrawIndexed(range.count, range.start, 0);
+		}
+	}
+}
\ No newline at end of file
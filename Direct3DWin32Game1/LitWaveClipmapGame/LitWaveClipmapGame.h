@@ -0,0 +1,37 @@
+#pragma once
+#include "LitHillGame/LitHillGame.h"
+#include "Common/WaveClipmap.h"
+
+// LitHillGame with the simulated wave drawn as clipmap rings around the
+// camera.
+class LitWaveClipmapGame : public LitHillGame
+{
+	using Super = LitHillGame;
+
+protected:
+	virtual void AddObjects() override;
+};
+
+// LitWave drawn as clipmap rings centred on the camera instead of one grid
+// at full resolution: full density near the eye, half as dense in every
+// ring further out. The simulation uploads heights only and the vertex
+// shader samples them, so the CPU cost of drawing is a few constants per
+// level whatever the size of the grid.
+class LitWaveClipmap : public LitWave
+{
+	using Super = LitWave;
+
+public:
+	explicit LitWaveClipmap(UINT ringCells = 32, UINT numLevels = 4);
+
+	virtual void Update(DX::StepTimer const& timer);
+
+protected:
+	virtual void BuildShader();
+	virtual void SetInputLayout();
+	virtual void SetVertexBuffers();
+	virtual void BuildShape();
+	virtual void Draw();
+
+	WaveClipmap m_clipmap;
+};
\ No newline at end of file
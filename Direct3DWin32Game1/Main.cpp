@@ -10,6 +10,12 @@
 #include "MultiShapeGame/MultiShapeGame.h"
 #include "HillAndWaveGame/HillAndWaveGame.h"
 #include "LitHillGame/LitHillGame.h"
+#include "LitOceanGame/LitOceanGame.h"
+#include "LitGerstnerWaveGame/LitGerstnerWaveGame.h"
+#include "LitWaveClipmapGame/LitWaveClipmapGame.h"
+#include "LitNestedWaveGame/LitNestedWaveGame.h"
+#include "LitTerrainGame/LitTerrainGame.h"
+#include "LitStreamedTerrainGame/LitStreamedTerrainGame.h"
 #include "TransparentWaveGame/TransparentWaveGame.h"
 #include "MirrorGame/MirrorGame.h"
 #include "TreeBillboardGame/TreeBillboardGame.h"
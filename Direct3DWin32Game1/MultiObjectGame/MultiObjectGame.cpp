@@ -35,6 +35,8 @@ void MultiObjectGame::Tick()
 			(*it)->Update(m_timer);
 		}
 
+		m_waveScheduler.Run();
+
 		PreObjectsRender();
 
 		for (auto it = m_objects.begin(); it != m_objects.end(); ++it)
@@ -2,6 +2,7 @@
 #include "InitGame/InitGame.h"
 #include "Common/d3dUtil.h"
 #include "Common/RenderObject.h"
+#include "Common/WaveScheduler.h"
 #include <vector>
 
 class MultiObjectGame : public InitGame
@@ -24,4 +25,8 @@ protected:
 	virtual void AddObjects() = 0;
 
 	std::vector<RenderObject*> m_objects;
+
+	// Water bodies queue their simulation here during their Update; the batch
+	// runs once all objects have been updated.
+	WaveScheduler m_waveScheduler;
 };
\ No newline at end of file
@@ -442,142 +442,115 @@ void ReflectSphere::BuildShape()
 {
 	using VertexType = VertexPositionNormalUV;
 
-	std::vector<VertexType> vertices;
-	std::vector<UINT> indices;
-
 	float radius = 1.0f * m_scale;
 	UINT sliceCount = 20;
 	UINT stackCount = 20;
 
-	//
-	// Compute the vertices stating at the top pole and moving down the stacks.
-	//
+	// Spheres of the same size share one mesh.
+	const std::string key = MeshCache::MakeKey("ReflectSphere", radius, sliceCount, stackCount);
+	UseSharedMesh(MeshCache::GetDefault().GetMeshBuffers(m_d3dDevice.Get(), key, [=](MeshData& mesh)
+	{
+		std::vector<VertexType> vertices;
+		std::vector<UINT>& indices = mesh.indices;
 
-	// Poles: note that there will be texture coordinate distortion as there is
-	// not a unique point on the texture map to assign to the pole when mapping
-	// a rectangular texture onto a sphere.
-	VertexType topVertex = { XMFLOAT3(0.0f, +radius, 0.0f), XMFLOAT3(0.0f, +1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) };
-	VertexType bottomVertex = { XMFLOAT3(0.0f, -radius, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(0.0f, 1.0f) };
+		//
+		// Compute the vertices stating at the top pole and moving down the stacks.
+		//
 
-	vertices.push_back(topVertex);
+		// Poles: note that there will be texture coordinate distortion as there is
+		// not a unique point on the texture map to assign to the pole when mapping
+		// a rectangular texture onto a sphere.
+		VertexType topVertex = { XMFLOAT3(0.0f, +radius, 0.0f), XMFLOAT3(0.0f, +1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) };
+		VertexType bottomVertex = { XMFLOAT3(0.0f, -radius, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(0.0f, 1.0f) };
 
-	float phiStep = XM_PI / stackCount;
-	float thetaStep = 2.0f*XM_PI / sliceCount;
+		vertices.push_back(topVertex);
 
-	// Compute vertices for each stack ring (do not count the poles as rings).
-	for (UINT i = 1; i <= stackCount - 1; ++i)
-	{
-		float phi = i * phiStep;
+		float phiStep = XM_PI / stackCount;
+		float thetaStep = 2.0f*XM_PI / sliceCount;
 
-		// Vertices of ring.
-		for (UINT j = 0; j <= sliceCount; ++j)
+		// Compute vertices for each stack ring (do not count the poles as rings).
+		for (UINT i = 1; i <= stackCount - 1; ++i)
 		{
-			float theta = j * thetaStep;
-
-			VertexType v;
+			float phi = i * phiStep;
 
-			// spherical to cartesian
-			v.position.x = radius * sinf(phi)*cosf(theta);
-			v.position.y = radius * cosf(phi);
-			v.position.z = radius * sinf(phi)*sinf(theta);
+			// Vertices of ring.
+			for (UINT j = 0; j <= sliceCount; ++j)
+			{
+				float theta = j * thetaStep;
 
-			XMVECTOR p = XMLoadFloat3(&v.position);
-			XMStoreFloat3(&v.normal, XMVector3Normalize(p));
+				VertexType v;
 
-			v.textureUV.x = theta / XM_2PI;
-			v.textureUV.y = phi / XM_PI;
+				// spherical to cartesian
+				v.position.x = radius * sinf(phi)*cosf(theta);
+				v.position.y = radius * cosf(phi);
+				v.position.z = radius * sinf(phi)*sinf(theta);
 
-			vertices.push_back(v);
-		}
-	}
+				XMVECTOR p = XMLoadFloat3(&v.position);
+				XMStoreFloat3(&v.normal, XMVector3Normalize(p));
 
-	vertices.push_back(bottomVertex);
+				v.textureUV.x = theta / XM_2PI;
+				v.textureUV.y = phi / XM_PI;
 
-	//
-	// Compute indices for top stack.  The top stack was written first to the vertex buffer
-	// and connects the top pole to the first ring.
-	//
+				vertices.push_back(v);
+			}
+		}
 
-	for (UINT i = 1; i <= sliceCount; ++i)
-	{
-		indices.push_back(0);
-		indices.push_back(i + 1);
-		indices.push_back(i);
-	}
+		vertices.push_back(bottomVertex);
 
-	//
-	// Compute indices for inner stacks (not connected to poles).
-	//
+		//
+		// Compute indices for top stack.  The top stack was written first to the vertex buffer
+		// and connects the top pole to the first ring.
+		//
 
-	// Offset the indices to the index of the first vertex in the first ring.
-	// This is just skipping the top pole vertex.
-	UINT baseIndex = 1;
-	UINT ringVertexCount = sliceCount + 1;
-	for (UINT i = 0; i < stackCount - 2; ++i)
-	{
-		for (UINT j = 0; j < sliceCount; ++j)
+		for (UINT i = 1; i <= sliceCount; ++i)
 		{
-			indices.push_back(baseIndex + i * ringVertexCount + j);
-			indices.push_back(baseIndex + i * ringVertexCount + j + 1);
-			indices.push_back(baseIndex + (i + 1)*ringVertexCount + j);
-
-			indices.push_back(baseIndex + (i + 1)*ringVertexCount + j);
-			indices.push_back(baseIndex + i * ringVertexCount + j + 1);
-			indices.push_back(baseIndex + (i + 1)*ringVertexCount + j + 1);
+			indices.push_back(0);
+			indices.push_back(i + 1);
+			indices.push_back(i);
 		}
-	}
-
-	//
-	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
-	// and connects the bottom pole to the bottom ring.
-	//
 
-	// South pole vertex was added last.
-	UINT southPoleIndex = (UINT)vertices.size() - 1;
+		//
+		// Compute indices for inner stacks (not connected to poles).
+		//
 
-	// Offset the indices to the index of the first vertex in the last ring.
-	baseIndex = southPoleIndex - ringVertexCount;
-
-	for (UINT i = 0; i < sliceCount; ++i)
-	{
-		indices.push_back(southPoleIndex);
-		indices.push_back(baseIndex + i);
-		indices.push_back(baseIndex + i + 1);
-	}
-
-	D3D11_BUFFER_DESC vbDesc;
-	vbDesc.ByteWidth = sizeof(VertexType) * vertices.size();
-	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = 0;
-	vbDesc.MiscFlags = 0;
-	vbDesc.StructureByteStride = 0;
+		// Offset the indices to the index of the first vertex in the first ring.
+		// This is just skipping the top pole vertex.
+		UINT baseIndex = 1;
+		UINT ringVertexCount = sliceCount + 1;
+		for (UINT i = 0; i < stackCount - 2; ++i)
+		{
+			for (UINT j = 0; j < sliceCount; ++j)
+			{
+				indices.push_back(baseIndex + i * ringVertexCount + j);
+				indices.push_back(baseIndex + i * ringVertexCount + j + 1);
+				indices.push_back(baseIndex + (i + 1)*ringVertexCount + j);
 
-	D3D11_SUBRESOURCE_DATA vbInitData;
-	vbInitData.pSysMem = vertices.data();
-	vbInitData.SysMemPitch = 0;
-	vbInitData.SysMemSlicePitch = 0;
+				indices.push_back(baseIndex + (i + 1)*ringVertexCount + j);
+				indices.push_back(baseIndex + i * ringVertexCount + j + 1);
+				indices.push_back(baseIndex + (i + 1)*ringVertexCount + j + 1);
+			}
+		}
 
-	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, &vbInitData, m_vertexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
+		//
+		// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
+		// and connects the bottom pole to the bottom ring.
+		//
 
-	m_indexCount = indices.size();
+		// South pole vertex was added last.
+		UINT southPoleIndex = (UINT)vertices.size() - 1;
 
-	D3D11_BUFFER_DESC ibDesc;
-	ibDesc.ByteWidth = sizeof(UINT) * indices.size();
-	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.MiscFlags = 0;
-	ibDesc.StructureByteStride = 0;
+		// Offset the indices to the index of the first vertex in the last ring.
+		baseIndex = southPoleIndex - ringVertexCount;
 
-	D3D11_SUBRESOURCE_DATA ibInitData;
-	ibInitData.pSysMem = indices.data();
-	ibInitData.SysMemPitch = 0;
-	ibInitData.SysMemSlicePitch = 0;
+		for (UINT i = 0; i < sliceCount; ++i)
+		{
+			indices.push_back(southPoleIndex);
+			indices.push_back(baseIndex + i);
+			indices.push_back(baseIndex + i + 1);
+		}
 
-	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
+		mesh.SetVertices(vertices.data(), (UINT)vertices.size());
+	}));
 }
 
 void SkySphere::BuildShape()
@@ -30,9 +30,15 @@ void TransparentWaveGame::Update(DX::StepTimer const & timer)
 
 void TransparentWaveGame::AddObjects()
 {
+	// Vertex data the wave uploads every frame.
+	WaveUploadMode waveUploadMode = WaveUploadMode::FullVertex;
+
+	TransparentWave* wave = new TransparentWave(waveUploadMode);
+	wave->SetWaveScheduler(&m_waveScheduler);
+
 	m_objects.push_back(new TextureHill());
 	m_objects.push_back(new Crate());
-	m_objects.push_back(new TransparentWave());
+	m_objects.push_back(wave);
 }
 
 void TransparentWaveGame::UpdateConstantBufferPerFrame()
@@ -70,17 +76,18 @@ void TextureHill::BuildShader()
 
 void TransparentWave::BuildShader()
 {
-	const D3D_SHADER_MACRO alphaTestDefines[] =
+	std::vector<D3D_SHADER_MACRO> alphaTestDefines =
 	{
 #if ENABLEFOG
-		"FOG", "1",
+		{ "FOG", "1" },
 #endif
-		"ALPHA_TEST", "1",
-		NULL, NULL
+		{ "ALPHA_TEST", "1" }
 	};
+	AppendUploadDefines(alphaTestDefines);
+	alphaTestDefines.push_back({ NULL, NULL });
 
 	const std::wstring shaderFilename = L"TransparentWaveGame\\Blending.hlsl";
-	CreateVSAndPSShader(shaderFilename, shaderFilename, alphaTestDefines);
+	CreateVSAndPSShader(shaderFilename, shaderFilename, alphaTestDefines.data());
 }
 
 void TransparentWave::Render()
@@ -157,114 +164,88 @@ void Crate::Render()
 
 void Crate::BuildShape()
 {
-	// Set vertex buffer
-	VertexType vertices[] =
-	{
-		// Front face
-		{ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT2(0.f,0.f) },
-		{ XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT2(1.f,0.f) },
-		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT2(0.f,1.f) },
-		{ XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT2(1.f,1.f) },
-		// Back face
-		{ XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(0.f,0.f) },
-		{ XMFLOAT3(-1.0f, +1.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(1.f,0.f) },
-		{ XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(0.f,1.f) },
-		{ XMFLOAT3(-1.0f, -1.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(1.f,1.f) },
-		// Left face
-		{ XMFLOAT3(-1.0f, +1.0f, +1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT2(0.f,0.f) },
-		{ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT2(1.f,0.f) },
-		{ XMFLOAT3(-1.0f, -1.0f, +1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT2(0.f,1.f) },
-		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT2(1.f,1.f) },
-		// Right face
-		{ XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(0.f,0.f) },
-		{ XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.f,0.f) },
-		{ XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(0.f,1.f) },
-		{ XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.f,1.f) },
-		// Top face
-		{ XMFLOAT3(-1.0f, +1.0f, +1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.f,0.f) },
-		{ XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(1.f,0.f) },
-		{ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.f,1.f) },
-		{ XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(1.f,1.f) },
-		// Bottom face
-		{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(0.f,0.f) },
-		{ XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(1.f,0.f) },
-		{ XMFLOAT3(-1.0f, -1.0f, +1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(0.f,1.f) },
-		{ XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(1.f,1.f) }
-	};
-
-	int vertexCount = ARRAYSIZE(vertices);
-	for (int i = 0; i < vertexCount; ++i)
+	// Crates of the same size share one cube.
+	const std::string key = MeshCache::MakeKey("Crate", m_scale);
+	UseSharedMesh(MeshCache::GetDefault().GetMeshBuffers(m_d3dDevice.Get(), key, [this](MeshData& mesh)
 	{
-		vertices[i].position.x *= m_scale;
-		vertices[i].position.y *= m_scale;
-		vertices[i].position.z *= m_scale;
-	}
-
-	D3D11_BUFFER_DESC vbDesc;
-	vbDesc.ByteWidth = sizeof(vertices);
-	vbDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = 0;
-	vbDesc.MiscFlags = 0;
-	vbDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA vbInitData;
-	vbInitData.pSysMem = vertices;
-	vbInitData.SysMemPitch = 0;
-	vbInitData.SysMemSlicePitch = 0;
-
-	HRESULT hr = m_d3dDevice->CreateBuffer(&vbDesc, &vbInitData, m_vertexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
+		// Set vertex buffer
+		VertexType vertices[] =
+		{
+			// Front face
+			{ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT2(0.f,0.f) },
+			{ XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT2(1.f,0.f) },
+			{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT2(0.f,1.f) },
+			{ XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, 0.0f, -1.0f), XMFLOAT2(1.f,1.f) },
+			// Back face
+			{ XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(0.f,0.f) },
+			{ XMFLOAT3(-1.0f, +1.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(1.f,0.f) },
+			{ XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(0.f,1.f) },
+			{ XMFLOAT3(-1.0f, -1.0f, +1.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), XMFLOAT2(1.f,1.f) },
+			// Left face
+			{ XMFLOAT3(-1.0f, +1.0f, +1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT2(0.f,0.f) },
+			{ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT2(1.f,0.f) },
+			{ XMFLOAT3(-1.0f, -1.0f, +1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT2(0.f,1.f) },
+			{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT2(1.f,1.f) },
+			// Right face
+			{ XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(0.f,0.f) },
+			{ XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.f,0.f) },
+			{ XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(0.f,1.f) },
+			{ XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT2(1.f,1.f) },
+			// Top face
+			{ XMFLOAT3(-1.0f, +1.0f, +1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.f,0.f) },
+			{ XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(1.f,0.f) },
+			{ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.f,1.f) },
+			{ XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(1.f,1.f) },
+			// Bottom face
+			{ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(0.f,0.f) },
+			{ XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(1.f,0.f) },
+			{ XMFLOAT3(-1.0f, -1.0f, +1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(0.f,1.f) },
+			{ XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT2(1.f,1.f) }
+		};
+
+		int vertexCount = ARRAYSIZE(vertices);
+		for (int i = 0; i < vertexCount; ++i)
+		{
+			vertices[i].position.x *= m_scale;
+			vertices[i].position.y *= m_scale;
+			vertices[i].position.z *= m_scale;
+		}
+
+		// Set index buffer
+		UINT indices[] =
+		{
+			// front face
+			0, 1, 2,
+			2, 1, 3,
+
+			// back face
+			4, 5, 6,
+			6, 5, 7,
+
+			// left face
+			8, 9, 10,
+			10, 9, 11,
+
+			// right face
+			12, 13, 14,
+			14, 13, 15,
+
+			// top face
+			16, 17, 18,
+			18, 17, 19,
+
+			// bottom face
+			20, 21, 22,
+			22, 21, 23
+		};
+
+		mesh.SetVertices(vertices, ARRAYSIZE(vertices));
+		mesh.indices.assign(indices, indices + ARRAYSIZE(indices));
+	}));
 
 	UINT stride = sizeof(VertexType);
 	UINT offset = 0;
 	m_d3dContext->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
-
-	// Set index buffer
-	UINT indices[] =
-	{
-		// front face
-		0, 1, 2,
-		2, 1, 3,
-
-		// back face
-		4, 5, 6,
-		6, 5, 7,
-
-		// left face
-		8, 9, 10,
-		10, 9, 11,
-
-		// right face
-		12, 13, 14,
-		14, 13, 15,
-
-		// top face
-		16, 17, 18,
-		18, 17, 19,
-
-		// bottom face
-		20, 21, 22,
-		22, 21, 23
-	};
-
-	m_indexCount = ARRAYSIZE(indices);
-
-	D3D11_BUFFER_DESC ibDesc;
-	ibDesc.ByteWidth = sizeof(indices);
-	ibDesc.Usage = D3D11_USAGE_IMMUTABLE;
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.MiscFlags = 0;
-	ibDesc.StructureByteStride = 0;
-
-	D3D11_SUBRESOURCE_DATA ibInitData;
-	ibInitData.pSysMem = indices;
-	ibInitData.SysMemPitch = 0;
-	ibInitData.SysMemSlicePitch = 0;
-
-	hr = m_d3dDevice->CreateBuffer(&ibDesc, &ibInitData, m_indexBuffer.GetAddressOf());
-	DX::ThrowIfFailed(hr);
 }
 
 void Crate::BuildMaterial()
@@ -47,6 +47,7 @@ class TransparentWave : public LitWave
 	using Super = LitWave;
 
 public:
+	explicit TransparentWave(WaveUploadMode uploadMode = WaveUploadMode::FullVertex) : Super(uploadMode) {}
 
 	virtual void Render();
 
@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "TreeBillboardGame/TreeBillboardGame.h"
+#include "Common/HillFunction.h"
 #include "DDSTextureLoader.h"
 #include <ctime>
 
@@ -70,11 +71,6 @@ void TreeBillboard::SetInputLayout()
 	DX::ThrowIfFailed(hr);
 }
 
-inline float TreeBillboard::GetHeight(float x, float z) const
-{
-	return 0.3f*(z*sinf(0.1f*x) + x * cosf(0.1f*z));
-}
-
 void TreeBillboard::BuildShape()
 {
 	VertexType vertices[m_treeCount];
@@ -83,16 +79,22 @@ void TreeBillboard::BuildShape()
 	srand((unsigned)time(&t));
 
 	float halfRange = m_ForestHalfRange;
+	XMFLOAT2 points[m_treeCount];
 	for (UINT i = 0; i < m_treeCount; ++i)
 	{
-		float x = -halfRange + ((float)(rand()) / (float)RAND_MAX) * halfRange * 2;
-		float z = -halfRange + ((float)(rand()) / (float)RAND_MAX) * halfRange * 2;
-		float y = GetHeight(x, z);
+		points[i].x = -halfRange + ((float)(rand()) / (float)RAND_MAX) * halfRange * 2;
+		points[i].y = -halfRange + ((float)(rand()) / (float)RAND_MAX) * halfRange * 2;
+	}
 
+	float heights[m_treeCount];
+	HillFunction::GetDefault().Evaluate(points, m_treeCount, heights, nullptr);
+
+	for (UINT i = 0; i < m_treeCount; ++i)
+	{
 		// Move tree slightly above land height.
-		y += 10.0f;
+		float y = heights[i] + 10.0f;
 
-		vertices[i].position = XMFLOAT3(x, y, z);
+		vertices[i].position = XMFLOAT3(points[i].x, y, points[i].y);
 		vertices[i].size = XMFLOAT2(m_BillboardWidth, m_BillboardHeight);
 	}
 
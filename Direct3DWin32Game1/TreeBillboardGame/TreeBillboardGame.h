@@ -33,8 +33,6 @@ protected:
 
 	virtual void BuildTexture() override;
 
-	inline float GetHeight(float x, float z) const;
-
 	Microsoft::WRL::ComPtr<ID3DBlob> m_GSByteCode;
 	Microsoft::WRL::ComPtr<ID3D11GeometryShader> m_geometryShader;
 
@@ -0,0 +1,97 @@
+#include "pch.h"
+#include "Harness.h"
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <map>
+#include <time.h>
+
+namespace
+{
+	std::map<std::string, Harness::TestFunction>& GetTests()
+	{
+		static std::map<std::string, Harness::TestFunction> tests;
+		return tests;
+	}
+
+	struct TestFailure
+	{
+	};
+}
+
+bool Harness::RegisterTest(const char* name, TestFunction test)
+{
+	GetTests()[name] = test;
+	return true;
+}
+
+int Harness::RunTests(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		for (auto it = GetTests().begin(); it != GetTests().end(); ++it)
+		{
+			printf("%s\n", it->first.c_str());
+		}
+		return 0;
+	}
+
+	auto test = GetTests().find(argv[1]);
+	if (test == GetTests().end())
+	{
+		fprintf(stderr, "Unknown test %s\n", argv[1]);
+		return 2;
+	}
+
+	try
+	{
+		test->second();
+	}
+	catch (const TestFailure&)
+	{
+		return 1;
+	}
+
+	printf("%s passed\n", argv[1]);
+	return 0;
+}
+
+void Harness::Fail(const char* file, int line, const char* format, ...)
+{
+	fprintf(stderr, "%s(%d): check failed: ", file, line);
+
+	va_list args;
+	va_start(args, format);
+	vfprintf(stderr, format, args);
+	va_end(args);
+
+	fprintf(stderr, "\n");
+	throw TestFailure();
+}
+
+double Harness::GetThreadSeconds()
+{
+	timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return double(time.tv_sec) + double(time.tv_nsec) * 1e-9;
+}
+
+double Harness::GetWallSeconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double Harness::Percentile(std::vector<double> samples, double p)
+{
+	if (samples.empty())
+		return 0.0;
+
+	std::sort(samples.begin(), samples.end());
+	const size_t rank = size_t(ceil(p * double(samples.size())));
+	return samples[std::min(std::max(rank, size_t(1)), samples.size()) - 1];
+}
+
+std::string Harness::GetGoldenPath(const char* name)
+{
+	return std::string(HEADLESS_GOLDEN_DIR) + "/" + name;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+// Minimal test registry and timing helpers of the headless build. Tests
+// register themselves with HARNESS_TEST and ctest runs each one on its own,
+// as "HeadlessTests <name>".
+#define HARNESS_TEST(name) \
+	static void name(); \
+	static const bool name##Registered = Harness::RegisterTest(#name, name); \
+	static void name()
+
+#define HARNESS_CHECK(condition) \
+	do { if (!(condition)) Harness::Fail(__FILE__, __LINE__, "%s", #condition); } while (false)
+
+#define HARNESS_CHECK_MSG(condition, ...) \
+	do { if (!(condition)) Harness::Fail(__FILE__, __LINE__, __VA_ARGS__); } while (false)
+
+namespace Harness
+{
+	typedef void(*TestFunction)();
+
+	bool RegisterTest(const char* name, TestFunction test);
+
+	// Runs the test called name, or lists every test with no name. Returns
+	// the process exit code.
+	int RunTests(int argc, char** argv);
+
+	// Fails the running test with a printf style message.
+	[[noreturn]] void Fail(const char* file, int line, const char* format, ...);
+
+	// Seconds of CPU time the calling thread has used. Unlike wall clock time
+	// it does not count the time the thread was preempted, which keeps short
+	// timings usable on a loaded machine.
+	double GetThreadSeconds();
+
+	// Seconds on a monotonic wall clock.
+	double GetWallSeconds();
+
+	// The p-th percentile, p in [0, 1], of samples by the nearest rank.
+	double Percentile(std::vector<double> samples, double p);
+
+	// Path of a file in Tools/Headless/Golden.
+	std::string GetGoldenPath(const char* name);
+}
\ No newline at end of file
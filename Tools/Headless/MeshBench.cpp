@@ -0,0 +1,107 @@
+#include "pch.h"
+#include "Harness.h"
+#include "TerrainWorkloads.h"
+#include "Common/GeometryGenerator.h"
+#include "Common/HeightFieldMesher.h"
+#include "Common/WorkerPool.h"
+#include <cstdio>
+#include <cstring>
+
+// Benchmarks of the mesh generators. Run without arguments for the list of
+// commands. Times are wall clock, so run on an otherwise idle machine.
+namespace
+{
+	// CreateGeosphere at every depth, each repeated for about half a second.
+	void RunGeosphere()
+	{
+		GeometryGenerator generator;
+
+		printf("geosphere\n");
+		for (UINT depth = 0; depth <= 5; ++depth)
+		{
+			UINT numRuns = 0;
+			size_t numVertices = 0;
+			const double start = Harness::GetWallSeconds();
+			double seconds = 0.0;
+			do
+			{
+				GeometryGenerator::MeshData mesh;
+				generator.CreateGeosphere(1.0f, depth, mesh);
+				numVertices = mesh.Vertices.size();
+				++numRuns;
+				seconds = Harness::GetWallSeconds() - start;
+			} while (seconds < 0.5);
+
+			printf("  depth %u: %6zu vertices, %.4f ms, %.1f ns/vertex\n", depth, numVertices,
+				seconds / numRuns * 1e3, seconds / numRuns / numVertices * 1e9);
+		}
+	}
+
+	// HeightFieldMesher over fractal R16 heightmaps of TerrainWorkloads, at
+	// the size of the test and of LitHillGame: triangles kept at 0.1, 0.5
+	// and 1.0 units of error against the full grid, and the time to build
+	// the errors and each mesh on the default pool.
+	void RunMesher()
+	{
+		printf("mesher, %u threads\n", WorkerPool::GetDefault().GetThreadCount());
+		for (UINT gridCells : { 1024u, 4096u })
+		{
+			const UINT n = gridCells + 1;
+			const char* fileName = "MeshBench.r16";
+			if (!TerrainWorkloads::WriteHeightmap(fileName, n, 1))
+			{
+				fprintf(stderr, "Cannot write %s\n", fileName);
+				return;
+			}
+
+			{
+				const std::unique_ptr<MappedHeightmap> heightmap = TerrainWorkloads::OpenHeightmap(L"MeshBench.r16", n);
+				const float size = TerrainWorkloads::HeightmapWidth;
+
+				double start = Harness::GetWallSeconds();
+				HeightFieldMesher mesher(*heightmap, size, size, gridCells, &WorkerPool::GetDefault());
+				printf("  %u x %u samples, errors in %.1f ms\n", n, n, (Harness::GetWallSeconds() - start) * 1e3);
+
+				const size_t gridTriangles = 2 * size_t(gridCells) * gridCells;
+				for (float maxError : { 0.1f, 0.5f, 1.0f })
+				{
+					GeometryGenerator::MeshData mesh;
+					start = Harness::GetWallSeconds();
+					mesher.CreateMesh(maxError, mesh);
+					const double seconds = Harness::GetWallSeconds() - start;
+
+					const size_t numTriangles = mesh.Indices.size() / 3;
+					printf("    error %.1f: %9zu triangles, %9zu vertices, %5.1fx fewer triangles, %.1f ms\n", maxError,
+						numTriangles, mesh.Vertices.size(), double(gridTriangles) / numTriangles, seconds * 1e3);
+				}
+			}
+			remove(fileName);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc != 2)
+	{
+		printf("usage: MeshBench <command>\n");
+		printf("  geosphere    CreateGeosphere at depths 0 to 5\n");
+		printf("  mesher       HeightFieldMesher on heightmaps at 0.1, 0.5 and 1.0 error\n");
+		return argc < 2 ? 0 : 2;
+	}
+
+	const char* command = argv[1];
+	if (strcmp(command, "geosphere") == 0)
+	{
+		RunGeosphere();
+		return 0;
+	}
+	if (strcmp(command, "mesher") == 0)
+	{
+		RunMesher();
+		return 0;
+	}
+
+	fprintf(stderr, "Unknown command %s\n", command);
+	return 2;
+}
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include "pch.h"
+#include "Harness.h"
+#include "TerrainWorkloads.h"
+#include "Common/GeometryGenerator.h"
+#include "Common/HeightFieldMesher.h"
+#include "Common/WorkerPool.h"
+#include <cstdio>
+#include <set>
+#include <cstdlib>
+#include <tuple>
+
+using namespace DirectX;
+
+// Every subdivision of the geosphere is welded: 10 * 4^d + 2 vertices and
+// 20 * 4^d triangles at depth d, as for a closed icosphere, with no two
+// vertices in the same place and all of them on the sphere.
+HARNESS_TEST(GeosphereVertexCount)
+{
+	GeometryGenerator generator;
+	const float radius = 2.0f;
+
+	for (UINT depth = 0; depth <= 5; ++depth)
+	{
+		GeometryGenerator::MeshData mesh;
+		generator.CreateGeosphere(radius, depth, mesh);
+
+		const size_t expectedVertices = 10 * (size_t(1) << (2 * depth)) + 2;
+		const size_t expectedTriangles = 20 * (size_t(1) << (2 * depth));
+		HARNESS_CHECK_MSG(mesh.Vertices.size() == expectedVertices && mesh.Indices.size() == 3 * expectedTriangles,
+			"depth %u: %zu vertices, %zu indices", depth, mesh.Vertices.size(), mesh.Indices.size());
+
+		std::set<std::tuple<float, float, float>> positions;
+		for (const GeometryGenerator::Vertex& vertex : mesh.Vertices)
+		{
+			const XMFLOAT3& p = vertex.Position;
+			positions.insert(std::make_tuple(p.x, p.y, p.z));
+			HARNESS_CHECK(fabsf(sqrtf(p.x * p.x + p.y * p.y + p.z * p.z) - radius) < 1e-4f);
+		}
+		HARNESS_CHECK_MSG(positions.size() == mesh.Vertices.size(), "depth %u: %zu distinct positions", depth, positions.size());
+
+		for (UINT index : mesh.Indices)
+		{
+			HARNESS_CHECK(index < mesh.Vertices.size());
+		}
+	}
+}
+
+// HeightFieldMesher over a fractal R16 heightmap of the size LitHillGame
+// draws, at the errors the hill can be drawn with. At each of them every
+// sample of the grid is within the error of the triangle over it, the
+// triangles cover the map once, and no vertex lies inside the edge of
+// another triangle, where tiles would crack. Fewer triangles are kept the
+// larger the error.
+HARNESS_TEST(HeightFieldMesherHeightmap)
+{
+	const UINT gridCells = 1024;
+	const UINT n = gridCells + 1;
+	const char* fileName = "HeightFieldMesherHeightmap.r16";
+	HARNESS_CHECK(TerrainWorkloads::WriteHeightmap(fileName, n, 1));
+	const std::unique_ptr<MappedHeightmap> heightmap = TerrainWorkloads::OpenHeightmap(L"HeightFieldMesherHeightmap.r16", n);
+
+	const float size = TerrainWorkloads::HeightmapWidth;
+	const float spacing = size / gridCells;
+	WorkerPool pool(2);
+	HeightFieldMesher mesher(*heightmap, size, size, gridCells, &pool);
+
+	// The samples the mesher works from, at the same points.
+	std::vector<XMFLOAT2> points(n * n);
+	for (UINT i = 0; i < n; ++i)
+	{
+		for (UINT j = 0; j < n; ++j)
+		{
+			points[i * n + j] = XMFLOAT2(-0.5f * size + j * spacing, 0.5f * size - i * spacing);
+		}
+	}
+	std::vector<float> heights(n * n);
+	heightmap->Evaluate(points.data(), n * n, heights.data(), nullptr);
+
+	const size_t gridTriangles = 2 * size_t(gridCells) * gridCells;
+	size_t previousTriangles = gridTriangles + 1;
+	for (float maxError : { 0.1f, 0.5f, 1.0f })
+	{
+		GeometryGenerator::MeshData mesh;
+		mesher.CreateMesh(maxError, mesh);
+		HARNESS_CHECK(mesh.Indices.size() % 3 == 0);
+
+		// Grid coordinates of every vertex, and which grid points are used.
+		std::vector<int> cols(mesh.Vertices.size());
+		std::vector<int> rows(mesh.Vertices.size());
+		std::vector<bool> bUsed(n * n, false);
+		for (size_t k = 0; k < mesh.Vertices.size(); ++k)
+		{
+			const XMFLOAT3& p = mesh.Vertices[k].Position;
+			cols[k] = int(lroundf((p.x + 0.5f * size) / spacing));
+			rows[k] = int(lroundf((0.5f * size - p.z) / spacing));
+			HARNESS_CHECK(cols[k] >= 0 && cols[k] < int(n) && rows[k] >= 0 && rows[k] < int(n));
+			HARNESS_CHECK(p.y == heights[rows[k] * n + cols[k]]);
+			bUsed[rows[k] * n + cols[k]] = true;
+		}
+
+		const size_t numTriangles = mesh.Indices.size() / 3;
+		INT64 doubleArea = 0;
+		float largestError = 0.0f;
+		for (size_t t = 0; t < numTriangles; ++t)
+		{
+			int c[3], r[3];
+			float h[3];
+			for (UINT v = 0; v < 3; ++v)
+			{
+				const UINT index = mesh.Indices[3 * t + v];
+				HARNESS_CHECK(index < mesh.Vertices.size());
+				c[v] = cols[index];
+				r[v] = rows[index];
+				h[v] = heights[r[v] * n + c[v]];
+			}
+
+			// All triangles wind the same way, so summing their areas
+			// counts overlaps and gaps.
+			const INT64 area = INT64(c[1] - c[0]) * (r[2] - r[0]) - INT64(c[2] - c[0]) * (r[1] - r[0]);
+			HARNESS_CHECK_MSG(area > 0, "triangle %zu has area %lld", t, (long long)area);
+			doubleArea += area;
+
+			// Samples within the triangle against the plane through its corners.
+			const int minC = std::min({ c[0], c[1], c[2] }), maxC = std::max({ c[0], c[1], c[2] });
+			const int minR = std::min({ r[0], r[1], r[2] }), maxR = std::max({ r[0], r[1], r[2] });
+			for (int y = minR; y <= maxR; ++y)
+			{
+				for (int x = minC; x <= maxC; ++x)
+				{
+					const INT64 w0 = INT64(c[2] - c[1]) * (y - r[1]) - INT64(x - c[1]) * (r[2] - r[1]);
+					const INT64 w1 = INT64(c[0] - c[2]) * (y - r[2]) - INT64(x - c[2]) * (r[0] - r[2]);
+					const INT64 w2 = area - w0 - w1;
+					if (w0 < 0 || w1 < 0 || w2 < 0)
+						continue;
+
+					const float plane = (w0 * h[0] + w1 * h[1] + w2 * h[2]) / float(area);
+					largestError = std::max(largestError, fabsf(heights[y * n + x] - plane));
+				}
+			}
+
+			// No used grid point strictly inside an edge.
+			for (UINT v = 0; v < 3; ++v)
+			{
+				const UINT w = (v + 1) % 3;
+				const int dc = c[w] - c[v];
+				const int dr = r[w] - r[v];
+				int steps = std::max(abs(dc), abs(dr));
+				if (dc != 0 && dr != 0)
+				{
+					HARNESS_CHECK(abs(dc) == abs(dr));
+				}
+				for (int k = 1; k < steps; ++k)
+				{
+					const int x = c[v] + dc / steps * k;
+					const int y = r[v] + dr / steps * k;
+					HARNESS_CHECK_MSG(!bUsed[y * n + x], "vertex (%d, %d) inside an edge at error %.1f", y, x, maxError);
+				}
+			}
+		}
+
+		printf("error %.1f: %zu of %zu triangles (%.1fx fewer), largest error %.4f\n", maxError, numTriangles, gridTriangles,
+			double(gridTriangles) / numTriangles, largestError);
+
+		HARNESS_CHECK(doubleArea == 2 * INT64(gridCells) * gridCells);
+		HARNESS_CHECK_MSG(largestError <= maxError * (1.0f + 1e-4f), "largest error %.5f at %.1f", largestError, maxError);
+		HARNESS_CHECK(numTriangles < previousTriangles);
+		previousTriangles = numTriangles;
+	}
+
+	remove(fileName);
+}
\ No newline at end of file
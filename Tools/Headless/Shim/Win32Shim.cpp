@@ -0,0 +1,134 @@
+#include "pch.h"
+#include <cerrno>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace
+{
+	thread_local DWORD t_lastError = 0;
+
+	std::atomic<bool> s_bFailMapViews{ false };
+
+	// munmap needs the length of the view, which UnmapViewOfFile does not get.
+	std::mutex s_viewMutex;
+	std::unordered_map<const void*, size_t> s_viewBytes;
+
+	int GetDescriptor(HANDLE handle)
+	{
+		return static_cast<int>(reinterpret_cast<intptr_t>(handle));
+	}
+
+	HANDLE MakeHandle(int descriptor)
+	{
+		return reinterpret_cast<HANDLE>(static_cast<intptr_t>(descriptor));
+	}
+
+	void SetLastErrorFromErrno()
+	{
+		t_lastError = errno != 0 ? DWORD(errno) : DWORD(EIO);
+	}
+}
+
+DWORD GetLastError()
+{
+	return t_lastError;
+}
+
+void GetSystemInfo(SYSTEM_INFO* info)
+{
+	info->dwAllocationGranularity = DWORD(sysconf(_SC_PAGESIZE));
+}
+
+HANDLE CreateFileW(const wchar_t* fileName, DWORD, DWORD, void*, DWORD, DWORD, HANDLE)
+{
+	// Test files have plain ASCII names.
+	std::string name;
+	for (const wchar_t* c = fileName; *c; ++c)
+	{
+		name.push_back(char(*c));
+	}
+
+	const int descriptor = open(name.c_str(), O_RDONLY);
+	if (descriptor < 0)
+	{
+		SetLastErrorFromErrno();
+		return INVALID_HANDLE_VALUE;
+	}
+	return MakeHandle(descriptor);
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size)
+{
+	struct stat status;
+	if (fstat(GetDescriptor(file), &status) != 0)
+	{
+		SetLastErrorFromErrno();
+		return 0;
+	}
+	size->QuadPart = status.st_size;
+	return 1;
+}
+
+BOOL CloseHandle(HANDLE handle)
+{
+	return close(GetDescriptor(handle)) == 0;
+}
+
+HANDLE CreateFileMappingW(HANDLE file, void*, DWORD, DWORD, DWORD, const wchar_t*)
+{
+	const int descriptor = dup(GetDescriptor(file));
+	if (descriptor < 0)
+	{
+		SetLastErrorFromErrno();
+		return nullptr;
+	}
+	return MakeHandle(descriptor);
+}
+
+void* MapViewOfFile(HANDLE mapping, DWORD, DWORD offsetHigh, DWORD offsetLow, size_t bytes)
+{
+	if (s_bFailMapViews)
+	{
+		t_lastError = ENOMEM;
+		return nullptr;
+	}
+
+	const off_t offset = off_t((UINT64(offsetHigh) << 32) | offsetLow);
+	void* view = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, GetDescriptor(mapping), offset);
+	if (view == MAP_FAILED)
+	{
+		SetLastErrorFromErrno();
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(s_viewMutex);
+	s_viewBytes[view] = bytes;
+	return view;
+}
+
+BOOL UnmapViewOfFile(const void* view)
+{
+	size_t bytes;
+	{
+		std::lock_guard<std::mutex> lock(s_viewMutex);
+		auto it = s_viewBytes.find(view);
+		if (it == s_viewBytes.end())
+			return 0;
+		bytes = it->second;
+		s_viewBytes.erase(it);
+	}
+	return munmap(const_cast<void*>(view), bytes) == 0;
+}
+
+namespace Shim
+{
+	void SetMapViewFailure(bool bFail)
+	{
+		s_bFailMapViews = bFail;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+//
+// Win32Shim.h
+// The Win32 file mapping calls of MappedHeightmap on top of POSIX, and the
+// few Direct3D 11 types that code in Common names without drawing. Included
+// by the stand-in pch.h.
+//
+
+#pragma once
+
+#include <atomic>
+
+typedef void* HANDLE;
+typedef long long LONGLONG;
+typedef uint32_t ULONG;
+
+union LARGE_INTEGER
+{
+	LONGLONG QuadPart;
+};
+
+struct SYSTEM_INFO
+{
+	DWORD dwAllocationGranularity;
+};
+
+const HRESULT S_OK = 0;
+const HRESULT E_FAIL = HRESULT(0x80004005);
+
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+
+const DWORD GENERIC_READ = 0x80000000;
+const DWORD FILE_SHARE_READ = 0x00000001;
+const DWORD OPEN_EXISTING = 3;
+const DWORD FILE_ATTRIBUTE_NORMAL = 0x00000080;
+const DWORD FILE_FLAG_RANDOM_ACCESS = 0x10000000;
+const DWORD PAGE_READONLY = 0x02;
+const DWORD FILE_MAP_READ = 0x0004;
+const DWORD ERROR_HANDLE_EOF = 38;
+
+inline HRESULT HRESULT_FROM_WIN32(DWORD error)
+{
+	return error == 0 ? 0 : HRESULT((error & 0x0000FFFF) | 0x80070000);
+}
+
+// Errors are errno values rather than Win32 codes; only their being nonzero matters.
+DWORD GetLastError();
+void GetSystemInfo(SYSTEM_INFO* info);
+
+HANDLE CreateFileW(const wchar_t* fileName, DWORD access, DWORD shareMode, void* security, DWORD creation, DWORD flags, HANDLE templateFile);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size);
+BOOL CloseHandle(HANDLE handle);
+
+// The mapping is a second descriptor of the file; views are read only.
+HANDLE CreateFileMappingW(HANDLE file, void* security, DWORD protect, DWORD sizeHigh, DWORD sizeLow, const wchar_t* name);
+void* MapViewOfFile(HANDLE mapping, DWORD access, DWORD offsetHigh, DWORD offsetLow, size_t bytes);
+BOOL UnmapViewOfFile(const void* view);
+
+namespace Shim
+{
+	// Makes every MapViewOfFile fail while set, as when the address space
+	// runs out, for tests of the callers' error handling.
+	void SetMapViewFailure(bool bFail);
+}
+
+// Reference counted like COM objects, enough for ComPtr.
+struct IUnknown
+{
+	virtual ~IUnknown() = default;
+
+	ULONG AddRef() { return ++m_refs; }
+	ULONG Release()
+	{
+		const ULONG refs = --m_refs;
+		if (refs == 0)
+		{
+			delete this;
+		}
+		return refs;
+	}
+
+private:
+	std::atomic<ULONG> m_refs{ 1 };
+};
+
+enum D3D11_USAGE
+{
+	D3D11_USAGE_DEFAULT,
+	D3D11_USAGE_IMMUTABLE,
+	D3D11_USAGE_DYNAMIC,
+	D3D11_USAGE_STAGING
+};
+
+const UINT D3D11_BIND_VERTEX_BUFFER = 0x1;
+const UINT D3D11_BIND_INDEX_BUFFER = 0x2;
+
+struct D3D11_BUFFER_DESC
+{
+	UINT ByteWidth;
+	D3D11_USAGE Usage;
+	UINT BindFlags;
+	UINT CPUAccessFlags;
+	UINT MiscFlags;
+	UINT StructureByteStride;
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+	const void* pSysMem;
+	UINT SysMemPitch;
+	UINT SysMemSlicePitch;
+};
+
+struct ID3D11Buffer : IUnknown
+{
+};
+
+// Tests implement the calls they need.
+struct ID3D11Device : IUnknown
+{
+	virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) = 0;
+};
+
+namespace Microsoft
+{
+	namespace WRL
+	{
+		template<typename T>
+		class ComPtr
+		{
+		public:
+			ComPtr() = default;
+			ComPtr(T* p) : m_p(p) { if (m_p) m_p->AddRef(); }
+			ComPtr(const ComPtr& other) : ComPtr(other.m_p) {}
+			ComPtr(ComPtr&& other) : m_p(other.m_p) { other.m_p = nullptr; }
+			~ComPtr() { Reset(); }
+
+			ComPtr& operator=(ComPtr other)
+			{
+				std::swap(m_p, other.m_p);
+				return *this;
+			}
+
+			T* Get() const { return m_p; }
+			T* operator->() const { return m_p; }
+			explicit operator bool() const { return m_p != nullptr; }
+
+			T** GetAddressOf() { return &m_p; }
+			T** ReleaseAndGetAddressOf() { Reset(); return &m_p; }
+
+			void Reset()
+			{
+				if (m_p)
+				{
+					m_p->Release();
+					m_p = nullptr;
+				}
+			}
+
+		private:
+			T* m_p = nullptr;
+		};
+	}
+}
\ No newline at end of file
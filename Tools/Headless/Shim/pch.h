@@ -0,0 +1,292 @@
+//
+// pch.h
+// Linux stand-in for Direct3DWin32Game1/pch.h, used by the headless build.
+// It provides the Windows types, the Win32 and Direct3D pieces of
+// Win32Shim.h, and the part of DirectXMath that the simulation and terrain
+// code in Common uses, as plain scalar code with the semantics of
+// DirectXMath's _XM_NO_INTRINSICS_ path.
+//
+
+#pragma once
+
+#include <cassert>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+
+typedef unsigned char BYTE;
+typedef short SHORT;
+typedef unsigned short USHORT;
+typedef int INT;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef int32_t LONG;
+typedef uint32_t DWORD;
+typedef int32_t HRESULT;
+typedef uint16_t UINT16;
+typedef uint32_t UINT32;
+typedef int64_t INT64;
+typedef uint64_t UINT64;
+
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+
+#include "Win32Shim.h"
+
+namespace DirectX
+{
+	const float XM_PI = 3.141592654f;
+	const float XM_2PI = 6.283185307f;
+	const float XM_PIDIV2 = 1.570796327f;
+
+	struct XMFLOAT2
+	{
+		float x, y;
+		XMFLOAT2() = default;
+		XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+		XMFLOAT3() = default;
+		XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+		XMFLOAT4() = default;
+		XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct alignas(16) XMVECTOR
+	{
+		float f[4];
+	};
+
+	typedef const XMVECTOR FXMVECTOR;
+	typedef const XMVECTOR GXMVECTOR;
+	typedef const XMVECTOR HXMVECTOR;
+	typedef const XMVECTOR& CXMVECTOR;
+
+#define XM_CALLCONV
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+	inline XMVECTOR XMVectorReplicate(float value) { return { { value, value, value, value } }; }
+	inline XMVECTOR XMVectorZero() { return { { 0.0f, 0.0f, 0.0f, 0.0f } }; }
+
+	inline float XMVectorGetX(FXMVECTOR v) { return v.f[0]; }
+	inline float XMVectorGetY(FXMVECTOR v) { return v.f[1]; }
+	inline float XMVectorGetZ(FXMVECTOR v) { return v.f[2]; }
+	inline float XMVectorGetW(FXMVECTOR v) { return v.f[3]; }
+
+	inline XMVECTOR XMVectorAdd(FXMVECTOR a, FXMVECTOR b)
+	{
+		return { { a.f[0] + b.f[0], a.f[1] + b.f[1], a.f[2] + b.f[2], a.f[3] + b.f[3] } };
+	}
+
+	inline XMVECTOR XMVectorSubtract(FXMVECTOR a, FXMVECTOR b)
+	{
+		return { { a.f[0] - b.f[0], a.f[1] - b.f[1], a.f[2] - b.f[2], a.f[3] - b.f[3] } };
+	}
+
+	inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b)
+	{
+		return { { a.f[0] * b.f[0], a.f[1] * b.f[1], a.f[2] * b.f[2], a.f[3] * b.f[3] } };
+	}
+
+	inline XMVECTOR XMVectorScale(FXMVECTOR v, float s)
+	{
+		return { { v.f[0] * s, v.f[1] * s, v.f[2] * s, v.f[3] * s } };
+	}
+
+	inline XMVECTOR XMVectorNegate(FXMVECTOR v)
+	{
+		return { { -v.f[0], -v.f[1], -v.f[2], -v.f[3] } };
+	}
+
+	// a * b + c
+	inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c)
+	{
+		return XMVectorAdd(XMVectorMultiply(a, b), c);
+	}
+
+	// c - a * b
+	inline XMVECTOR XMVectorNegativeMultiplySubtract(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c)
+	{
+		return XMVectorSubtract(c, XMVectorMultiply(a, b));
+	}
+
+	inline XMVECTOR XMVectorReciprocalSqrt(FXMVECTOR v)
+	{
+		return { { 1.0f / sqrtf(v.f[0]), 1.0f / sqrtf(v.f[1]), 1.0f / sqrtf(v.f[2]), 1.0f / sqrtf(v.f[3]) } };
+	}
+
+	inline void XMVectorSinCos(XMVECTOR* sin, XMVECTOR* cos, FXMVECTOR v)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			sin->f[i] = sinf(v.f[i]);
+			cos->f[i] = cosf(v.f[i]);
+		}
+	}
+
+	const UINT XM_PERMUTE_0X = 0;
+	const UINT XM_PERMUTE_0Y = 1;
+	const UINT XM_PERMUTE_0Z = 2;
+	const UINT XM_PERMUTE_0W = 3;
+	const UINT XM_PERMUTE_1X = 4;
+	const UINT XM_PERMUTE_1Y = 5;
+	const UINT XM_PERMUTE_1Z = 6;
+	const UINT XM_PERMUTE_1W = 7;
+
+	template<UINT X, UINT Y, UINT Z, UINT W>
+	inline XMVECTOR XMVectorPermute(FXMVECTOR a, FXMVECTOR b)
+	{
+		const float* lanes[2] = { a.f, b.f };
+		return { { lanes[X / 4][X % 4], lanes[Y / 4][Y % 4], lanes[Z / 4][Z % 4], lanes[W / 4][W % 4] } };
+	}
+
+	inline XMVECTOR operator+(FXMVECTOR a, FXMVECTOR b) { return XMVectorAdd(a, b); }
+	inline XMVECTOR operator-(FXMVECTOR a, FXMVECTOR b) { return XMVectorSubtract(a, b); }
+	inline XMVECTOR operator*(FXMVECTOR a, FXMVECTOR b) { return XMVectorMultiply(a, b); }
+	inline XMVECTOR operator*(FXMVECTOR v, float s) { return XMVectorScale(v, s); }
+	inline XMVECTOR operator*(float s, FXMVECTOR v) { return XMVectorScale(v, s); }
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p) { return { { p->x, p->y, p->z, 0.0f } }; }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p) { return { { p->x, p->y, p->z, p->w } }; }
+
+	inline void XMStoreFloat3(XMFLOAT3* p, FXMVECTOR v) { p->x = v.f[0]; p->y = v.f[1]; p->z = v.f[2]; }
+	inline void XMStoreFloat4(XMFLOAT4* p, FXMVECTOR v) { p->x = v.f[0]; p->y = v.f[1]; p->z = v.f[2]; p->w = v.f[3]; }
+
+	inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorReplicate(a.f[0] * b.f[0] + a.f[1] * b.f[1] + a.f[2] * b.f[2]);
+	}
+
+	inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b)
+	{
+		return XMVectorSet(
+			a.f[1] * b.f[2] - a.f[2] * b.f[1],
+			a.f[2] * b.f[0] - a.f[0] * b.f[2],
+			a.f[0] * b.f[1] - a.f[1] * b.f[0],
+			0.0f);
+	}
+
+	inline XMVECTOR XMVector3Length(FXMVECTOR v)
+	{
+		return XMVectorReplicate(sqrtf(XMVectorGetX(XMVector3Dot(v, v))));
+	}
+
+	inline XMVECTOR XMVector3Normalize(FXMVECTOR v)
+	{
+		float length = XMVectorGetX(XMVector3Length(v));
+		if (length > 0.0f)
+		{
+			length = 1.0f / length;
+		}
+		return XMVectorScale(v, length);
+	}
+
+	struct XMFLOAT4X4
+	{
+		float m[4][4];
+	};
+
+	// Rows, for row vectors: v' = v * M.
+	struct alignas(16) XMMATRIX
+	{
+		XMVECTOR r[4];
+	};
+
+	typedef const XMMATRIX FXMMATRIX;
+	typedef const XMMATRIX& CXMMATRIX;
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* p)
+	{
+		XMMATRIX result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.r[i] = XMVectorSet(p->m[i][0], p->m[i][1], p->m[i][2], p->m[i][3]);
+		}
+		return result;
+	}
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4* p, FXMMATRIX m)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+			{
+				p->m[i][j] = m.r[i].f[j];
+			}
+		}
+	}
+
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		return { { XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f),
+			XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f) } };
+	}
+
+	inline XMMATRIX XMMatrixMultiply(FXMMATRIX a, CXMMATRIX b)
+	{
+		XMMATRIX result;
+		for (int i = 0; i < 4; ++i)
+		{
+			result.r[i] = a.r[i].f[0] * b.r[0] + a.r[i].f[1] * b.r[1] + a.r[i].f[2] * b.r[2] + a.r[i].f[3] * b.r[3];
+		}
+		return result;
+	}
+
+	// (x, y, z, 1) * M, divided by w.
+	inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m)
+	{
+		const XMVECTOR result = v.f[0] * m.r[0] + v.f[1] * m.r[1] + v.f[2] * m.r[2] + m.r[3];
+		return XMVectorScale(result, 1.0f / result.f[3]);
+	}
+
+	inline XMMATRIX XMMatrixPerspectiveFovLH(float fovAngleY, float aspectRatio, float nearZ, float farZ)
+	{
+		const float height = cosf(0.5f * fovAngleY) / sinf(0.5f * fovAngleY);
+		const float width = height / aspectRatio;
+		const float range = farZ / (farZ - nearZ);
+		return { { XMVectorSet(width, 0.0f, 0.0f, 0.0f), XMVectorSet(0.0f, height, 0.0f, 0.0f),
+			XMVectorSet(0.0f, 0.0f, range, 1.0f), XMVectorSet(0.0f, 0.0f, -range * nearZ, 0.0f) } };
+	}
+
+	inline XMMATRIX XMMatrixLookAtLH(FXMVECTOR eyePosition, FXMVECTOR focusPosition, FXMVECTOR upDirection)
+	{
+		const XMVECTOR r2 = XMVector3Normalize(focusPosition - eyePosition);
+		const XMVECTOR r0 = XMVector3Normalize(XMVector3Cross(upDirection, r2));
+		const XMVECTOR r1 = XMVector3Cross(r2, r0);
+		const XMVECTOR negEye = XMVectorNegate(eyePosition);
+		return { { XMVectorSet(r0.f[0], r1.f[0], r2.f[0], 0.0f), XMVectorSet(r0.f[1], r1.f[1], r2.f[1], 0.0f),
+			XMVectorSet(r0.f[2], r1.f[2], r2.f[2], 0.0f),
+			XMVectorSet(XMVectorGetX(XMVector3Dot(r0, negEye)), XMVectorGetX(XMVector3Dot(r1, negEye)), XMVectorGetX(XMVector3Dot(r2, negEye)), 1.0f) } };
+	}
+}
+
+namespace DX
+{
+	inline void ThrowIfFailed(HRESULT hr)
+	{
+		if (FAILED(hr))
+		{
+			throw std::exception();
+		}
+	}
+	template<typename T>
+	inline T Clamp(const T& x, const T& low, const T& high)
+	{
+		return x < low ? low : (x > high ? high : x);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,422 @@
+#include "pch.h"
+#include "Harness.h"
+#include "Common/Heightmap.h"
+#include "Common/HillFunction.h"
+#include "Common/PatchTessellator.h"
+#include "Common/TerrainQuadtree.h"
+#include "Common/TileStreamer.h"
+#include "Common/WorkerPool.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	// Creates empty buffers, failing every failPeriod-th one when not 0.
+	class TestDevice : public ID3D11Device
+	{
+	public:
+		explicit TestDevice(UINT failPeriod = 0) : m_failPeriod(failPeriod) {}
+
+		virtual HRESULT CreateBuffer(const D3D11_BUFFER_DESC*, const D3D11_SUBRESOURCE_DATA*, ID3D11Buffer** buffer) override
+		{
+			const UINT count = ++m_numCalls;
+			if (m_failPeriod && count % m_failPeriod == 0)
+			{
+				*buffer = nullptr;
+				return E_FAIL;
+			}
+
+			*buffer = new ID3D11Buffer();
+			return S_OK;
+		}
+
+	private:
+		UINT m_failPeriod;
+		std::atomic<UINT> m_numCalls{ 0 };
+	};
+
+	// Updates streamer at (x, z) until every wanted tile arrived or failed,
+	// for at most a few seconds.
+	void WaitForRing(TileStreamer& streamer, float x, float z)
+	{
+		for (UINT frame = 0; frame < 5000; ++frame)
+		{
+			streamer.Update(x, z);
+			if (streamer.GetPendingTileCount() == 0 &&
+				streamer.GetVisibleTiles().size() + streamer.GetFailedTileCount() >= streamer.GetWantedTileCount())
+				return;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+namespace
+{
+	// Flies across the 16384 x 16384 map of LitStreamedTerrain at 300 m/s
+	// and 60 frames a second, and returns the longest Update in thread CPU
+	// time, so the loader thread sharing the core does not count.
+	double FlyThrough()
+	{
+		TestDevice* device = new TestDevice();
+		TileStreamer streamer(HillFunction::GetDefault(), 16384.0f, 64.0f, 64, device);
+		device->Release();
+
+		const UINT numFrames = 3000;
+		const float speed = 5.0f;
+		std::vector<double> updateTimes;
+		UINT numArrivals = 0;
+		for (UINT frame = 0; frame < numFrames; ++frame)
+		{
+			const float position = -6000.0f + speed * frame;
+
+			const double start = Harness::GetThreadSeconds();
+			streamer.Update(position, 0.5f * position);
+			updateTimes.push_back(Harness::GetThreadSeconds() - start);
+
+			numArrivals += streamer.GetArrivalCount();
+			std::this_thread::sleep_for(std::chrono::microseconds(500));
+		}
+
+		printf("%u updates, %u tiles arrived, ms: p50 %.4f  p99 %.4f  max %.4f\n", numFrames, numArrivals,
+			Harness::Percentile(updateTimes, 0.5) * 1e3, Harness::Percentile(updateTimes, 0.99) * 1e3,
+			Harness::Percentile(updateTimes, 1.0) * 1e3);
+
+		HARNESS_CHECK(numArrivals > 0);
+		HARNESS_CHECK(streamer.GetResidentBytes() <= streamer.GetResidentBudget());
+		HARNESS_CHECK(Harness::Percentile(updateTimes, 0.99) <= 0.1e-3);
+		return Harness::Percentile(updateTimes, 1.0);
+	}
+}
+
+// No Update of a fly-through takes more than 0.2 ms, as TileStreamer.h
+// states. An interrupt landing in one update of thousands counts towards
+// its CPU time too, so one of three flights has to stay under.
+HARNESS_TEST(TileStreamerFlyThrough)
+{
+	double longest = FlyThrough();
+	for (UINT retry = 0; retry < 2 && longest > 0.2e-3; ++retry)
+	{
+		longest = FlyThrough();
+	}
+	HARNESS_CHECK_MSG(longest <= 0.2e-3, "longest update %.4f ms", longest * 1e3);
+}
+
+// Tiles whose vertex buffer cannot be created come back failed instead of
+// ending the loader thread, and are not asked for again.
+HARNESS_TEST(TileStreamerLoadFailure)
+{
+	TestDevice* device = new TestDevice(3);
+	TileStreamer streamer(HillFunction::GetDefault(), 16384.0f, 64.0f, 64, device);
+	device->Release();
+	streamer.SetLoadRadius(256.0f);
+
+	WaitForRing(streamer, 0.0f, 0.0f);
+
+	const UINT numFailed = streamer.GetFailedTileCount();
+	printf("%u of %u tiles failed\n", numFailed, streamer.GetWantedTileCount());
+	HARNESS_CHECK(numFailed > 0);
+	HARNESS_CHECK(streamer.GetVisibleTiles().size() + numFailed == streamer.GetWantedTileCount());
+
+	streamer.Update(0.0f, 0.0f);
+	HARNESS_CHECK(streamer.GetPendingTileCount() == 0 && streamer.GetFailedTileCount() == numFailed);
+
+	// The loader still serves new parts of the map.
+	WaitForRing(streamer, 2000.0f, 0.0f);
+	HARNESS_CHECK(streamer.GetPendingTileCount() == 0);
+	HARNESS_CHECK(streamer.GetFailedTileCount() > numFailed);
+	HARNESS_CHECK(streamer.GetVisibleTiles().size() + streamer.GetFailedTileCount() >= streamer.GetWantedTileCount());
+}
+
+
+// Pages that cannot be mapped read as zero samples on the threads querying
+// them, instead of throwing there, and map once they can again.
+HARNESS_TEST(HeightmapMapFailure)
+{
+	// Three pages of R16 samples, each sample 1 + its row modulo 1000.
+	const UINT numRows = 1536;
+	const UINT numCols = 4096;
+	const char* fileName = "HeightmapMapFailure.r16";
+	{
+		FILE* file = fopen(fileName, "wb");
+		HARNESS_CHECK(file);
+		std::vector<USHORT> row(numCols);
+		for (UINT i = 0; i < numRows; ++i)
+		{
+			std::fill(row.begin(), row.end(), USHORT(1 + i % 1000));
+			fwrite(row.data(), sizeof(USHORT), numCols, file);
+		}
+		fclose(file);
+	}
+
+	// Heights are the samples, less 1, so zero samples read -1.
+	MappedHeightmap heightmap(L"HeightmapMapFailure.r16", HeightmapFormat::R16, numRows, numCols,
+		float(numCols), float(numRows), 65535.0f, -1.0f, MappedHeightmap::TargetPageBytes);
+	HARNESS_CHECK(fabsf(heightmap.GetSample(0, 0)) < 1e-3f);
+
+	Shim::SetMapViewFailure(true);
+
+	// Page 0 stays mapped; the others fail on every pool thread.
+	WorkerPool pool(3);
+	std::atomic<UINT> numWrong{ 0 };
+	pool.ParallelFor(0, numRows, [&](UINT rowBegin, UINT rowEnd)
+	{
+		for (UINT i = rowBegin; i < rowEnd; ++i)
+		{
+			const float expected = i < 512 ? float(i % 1000) : -1.0f;
+			if (fabsf(heightmap.GetSample(i, i) - expected) > 1e-3f)
+			{
+				++numWrong;
+			}
+		}
+	});
+
+	Shim::SetMapViewFailure(false);
+
+	HARNESS_CHECK(numWrong == 0);
+	HARNESS_CHECK(heightmap.HasMapFailed());
+	HARNESS_CHECK(fabsf(heightmap.GetSample(1200, 7) - 200.0f) < 1e-3f);
+	HARNESS_CHECK(heightmap.GetResidentPageCount() == 1);
+
+	remove(fileName);
+}
+
+namespace
+{
+	// View projection of a camera at eye looking along direction, with the
+	// field of view of InitGame and a 1280 x 720 viewport.
+	XMFLOAT4X4 GetViewProj(const XMFLOAT3& eye, const XMFLOAT3& direction, float farZ)
+	{
+		const XMVECTOR eyePosition = XMLoadFloat3(&eye);
+		const XMMATRIX view = XMMatrixLookAtLH(eyePosition, eyePosition + XMLoadFloat3(&direction), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		const XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 1280.0f / 720.0f, 1.0f, farZ);
+
+		XMFLOAT4X4 viewProj;
+		XMStoreFloat4x4(&viewProj, XMMatrixMultiply(view, proj));
+		return viewProj;
+	}
+
+	// Flies low over the 4096 x 4096 map of LitTerrain, turning, and returns
+	// the longest Select in thread CPU time.
+	double FlyOverQuadtree(const TerrainQuadtree& quadtree)
+	{
+		const HeightField& hill = HillFunction::GetDefault();
+		std::vector<TerrainPatch> patches;
+		std::vector<double> selectTimes;
+		UINT maxPatches = 0;
+		for (UINT frame = 0; frame < 2000; ++frame)
+		{
+			const float heading = 0.002f * frame;
+			const float x = -1800.0f + 1.8f * frame;
+			const float z = 1500.0f * sinf(heading);
+			const XMFLOAT3 eye(x, hill.GetHeight(x, z) + 30.0f, z);
+			const XMFLOAT3 direction(cosf(3.0f * heading), -0.2f, sinf(3.0f * heading));
+			const XMFLOAT4X4 viewProj = GetViewProj(eye, direction, 1000.0f);
+
+			const double start = Harness::GetThreadSeconds();
+			const UINT patchCount = quadtree.Select(eye, viewProj, patches);
+			selectTimes.push_back(Harness::GetThreadSeconds() - start);
+
+			HARNESS_CHECK(patchCount > 0);
+			maxPatches = std::max(maxPatches, patchCount);
+		}
+
+		printf("%zu selections, up to %u patches, ms: p50 %.4f  p99 %.4f  max %.4f\n", selectTimes.size(), maxPatches,
+			Harness::Percentile(selectTimes, 0.5) * 1e3, Harness::Percentile(selectTimes, 0.99) * 1e3,
+			Harness::Percentile(selectTimes, 1.0) * 1e3);
+
+		HARNESS_CHECK(Harness::Percentile(selectTimes, 0.99) <= 0.1e-3);
+		return Harness::Percentile(selectTimes, 1.0);
+	}
+}
+
+// Selection over the 4096 x 4096 map of LitTerrain, about 16 square km,
+// stays under 0.2 ms of CPU time a frame with the projection of InitGame. As for the fly-through of
+// the streamer, one of three flights has to stay under.
+HARNESS_TEST(TerrainQuadtreeSelect)
+{
+	WorkerPool pool(2);
+	const TerrainQuadtree quadtree(HillFunction::GetDefault(), 4096.0f, 8, 32, &pool);
+
+	double longest = FlyOverQuadtree(quadtree);
+	for (UINT retry = 0; retry < 2 && longest > 0.2e-3; ++retry)
+	{
+		longest = FlyOverQuadtree(quadtree);
+	}
+	HARNESS_CHECK_MSG(longest <= 0.2e-3, "longest selection %.4f ms", longest * 1e3);
+
+	// Nothing behind the camera is selected: looking straight up from
+	// above the highest node sees no terrain.
+	std::vector<TerrainPatch> patches;
+	const XMFLOAT3 eye(0.0f, 5000.0f, 0.0f);
+	HARNESS_CHECK(quadtree.Select(eye, GetViewProj(eye, XMFLOAT3(0.01f, 1.0f, 0.0f), 6000.0f), patches) == 0);
+}
+
+namespace
+{
+	// Whether world point p is inside the clip volume of viewProj.
+	bool IsInFrustum(const XMFLOAT4X4& viewProj, float x, float y, float z)
+	{
+		float clip[4];
+		for (UINT j = 0; j < 4; ++j)
+		{
+			clip[j] = x * viewProj.m[0][j] + y * viewProj.m[1][j] + z * viewProj.m[2][j] + viewProj.m[3][j];
+		}
+		return fabsf(clip[0]) <= clip[3] && fabsf(clip[1]) <= clip[3] && clip[2] >= 0.0f && clip[2] <= clip[3];
+	}
+}
+
+// The 16 x 16 patches of TessellationHill: a camera looking away from the
+// hill gets an empty patch list, so nothing is drawn for them; patches left
+// out from other views have no point of the surface in the frustum; and
+// neighbouring patches agree on the factor of their shared edge.
+HARNESS_TEST(PatchTessellatorCulling)
+{
+	const HeightField& hill = HillFunction::GetDefault();
+	const UINT numPatches = 16;
+	const float size = 150.0f;
+	PatchTessellator tessellator(numPatches, numPatches, size, size);
+	tessellator.SetHeights(hill);
+
+	XMFLOAT4X4 world;
+	XMStoreFloat4x4(&world, XMMatrixIdentity());
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&proj, XMMatrixPerspectiveFovLH(0.25f * XM_PI, 1280.0f / 720.0f, 1.0f, 1000.0f));
+
+	std::vector<UINT> controlPoints;
+	std::vector<PatchTessFactors> factors;
+	auto update = [&](const XMFLOAT3& eye, const XMFLOAT3& target, XMFLOAT4X4& viewProj)
+	{
+		XMFLOAT4X4 view;
+		XMStoreFloat4x4(&view, XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+		XMStoreFloat4x4(&viewProj, XMMatrixMultiply(XMLoadFloat4x4(&view), XMLoadFloat4x4(&proj)));
+		return tessellator.Update(world, view, proj, 720.0f, controlPoints, factors);
+	};
+
+	XMFLOAT4X4 viewProj;
+	HARNESS_CHECK(update(XMFLOAT3(0.0f, 40.0f, -200.0f), XMFLOAT3(0.0f, 40.0f, -400.0f), viewProj) == 0);
+	HARNESS_CHECK(controlPoints.empty() && factors.empty());
+
+	// Around the hill looking at its center, and over it looking along it.
+	const UINT pitch = numPatches + 1;
+	UINT minVisible = UINT_MAX;
+	UINT maxVisible = 0;
+	for (UINT view = 0; view < 64; ++view)
+	{
+		const float angle = view * XM_2PI / 64;
+		const float radius = view % 2 ? 40.0f : 160.0f;
+		const XMFLOAT3 eye(radius * cosf(angle), 30.0f + (view % 3) * 15.0f, radius * sinf(angle));
+		const XMFLOAT3 target = view % 2 ? XMFLOAT3(eye.x - 100.0f * sinf(angle), 0.0f, eye.z + 100.0f * cosf(angle)) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		const UINT patchCount = update(eye, target, viewProj);
+		HARNESS_CHECK(controlPoints.size() == 4 * patchCount && factors.size() == patchCount);
+		minVisible = std::min(minVisible, patchCount);
+		maxVisible = std::max(maxVisible, patchCount);
+
+		// Factor of every visible patch, by patch.
+		std::vector<const PatchTessFactors*> patches(numPatches * numPatches, nullptr);
+		for (UINT k = 0; k < patchCount; ++k)
+		{
+			const UINT topLeft = controlPoints[4 * k];
+			patches[(topLeft / pitch) * numPatches + topLeft % pitch] = &factors[k];
+		}
+
+		for (UINT i = 0; i < numPatches; ++i)
+		{
+			for (UINT j = 0; j < numPatches; ++j)
+			{
+				const PatchTessFactors* patch = patches[i * numPatches + j];
+				if (!patch)
+				{
+					// Densely sampled, the surface of a culled patch misses the frustum.
+					const XMFLOAT3 topLeft = tessellator.GetControlPoint(i, j);
+					const float step = size / numPatches / 32;
+					for (UINT r = 0; r <= 32; ++r)
+					{
+						for (UINT c = 0; c <= 32; ++c)
+						{
+							const float x = topLeft.x + c * step;
+							const float z = topLeft.z - r * step;
+							HARNESS_CHECK_MSG(!IsInFrustum(viewProj, x, hill.GetHeight(x, z), z), "view %u: patch (%u, %u) culled but visible", view, i, j);
+						}
+					}
+					continue;
+				}
+
+				for (float factor : patch->edges)
+				{
+					HARNESS_CHECK(factor >= 1.0f && factor <= 64.0f);
+				}
+
+				// Right edge against the left edge of the next patch, bottom
+				// edge against the top edge of the patch below.
+				const PatchTessFactors* right = j + 1 < numPatches ? patches[i * numPatches + j + 1] : nullptr;
+				const PatchTessFactors* below = i + 1 < numPatches ? patches[(i + 1) * numPatches + j] : nullptr;
+				HARNESS_CHECK(!right || memcmp(&patch->edges[2], &right->edges[0], sizeof(float)) == 0);
+				HARNESS_CHECK(!below || memcmp(&patch->edges[3], &below->edges[1], sizeof(float)) == 0);
+			}
+		}
+	}
+
+	printf("%u to %u of %u patches visible\n", minVisible, maxVisible, tessellator.GetPatchCount());
+	HARNESS_CHECK(minVisible < tessellator.GetPatchCount());
+}
+
+namespace
+{
+	// Largest error of the batched heights against the hill in double
+	// precision, and of the batched normals against GetNormal, over random
+	// points of a size x size map.
+	void MeasureHillError(float size, float& heightError, float& normalError)
+	{
+		const HillFunction& hill = HillFunction::GetDefault();
+		const UINT count = 100000;
+
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> coordinate(-0.5f * size, 0.5f * size);
+		std::vector<XMFLOAT2> points(count);
+		for (XMFLOAT2& point : points)
+		{
+			point = XMFLOAT2(coordinate(random), coordinate(random));
+		}
+
+		std::vector<float> heights(count);
+		std::vector<XMFLOAT3> normals(count);
+		hill.Evaluate(points.data(), count, heights.data(), normals.data());
+
+		heightError = 0.0f;
+		normalError = 0.0f;
+		for (UINT k = 0; k < count; ++k)
+		{
+			const double x = points[k].x;
+			const double z = points[k].y;
+			const double height = 0.3 * (z * sin(0.1 * x) + x * cos(0.1 * z));
+			heightError = std::max(heightError, float(fabs(heights[k] - height)));
+
+			const XMFLOAT3 normal = hill.GetNormal(points[k].x, points[k].y);
+			normalError = std::max(normalError, fabsf(normals[k].x - normal.x));
+			normalError = std::max(normalError, fabsf(normals[k].y - normal.y));
+			normalError = std::max(normalError, fabsf(normals[k].z - normal.z));
+		}
+
+		printf("%g x %g: heights within %g of exact, normals within %g of GetNormal\n", size, size, heightError, normalError);
+	}
+}
+
+// The error bounds stated in HillFunction.h, on the 150 x 150 hill and the
+// 4096 x 4096 map of LitTerrain. The shim runs XMVectorSinCos through sinf
+// and cosf, so this checks the float rounding of the angles and the sums,
+// not the polynomials of DirectXMath.
+HARNESS_TEST(HillFunctionAccuracy)
+{
+	float heightError, normalError;
+	MeasureHillError(150.0f, heightError, normalError);
+	HARNESS_CHECK(heightError <= 1.2e-5f);
+	HARNESS_CHECK(normalError <= 5e-4f);
+
+	MeasureHillError(4096.0f, heightError, normalError);
+	HARNESS_CHECK(heightError <= 0.014f);
+	HARNESS_CHECK(normalError <= 5e-4f);
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "TerrainWorkloads.h"
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	// xorshift32, so the terrain does not depend on the standard library.
+	class Random
+	{
+	public:
+		explicit Random(UINT seed) : m_state(seed * 2654435761u + 1) {}
+
+		// Uniform in [-1, 1].
+		float Next()
+		{
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 17;
+			m_state ^= m_state << 5;
+			return float(m_state >> 8) / float(1 << 23) - 1.0f;
+		}
+
+	private:
+		UINT m_state;
+	};
+}
+
+bool TerrainWorkloads::WriteHeightmap(const char* fileName, UINT size, UINT seed)
+{
+	assert(size >= 3 && ((size - 1) & (size - 2)) == 0);
+
+	// Diamond-square.
+	Random random(seed);
+	std::vector<float> heights(size * size, 0.0f);
+	auto at = [&](UINT i, UINT j) -> float& { return heights[i * size + j]; };
+
+	float amplitude = 1.0f;
+	for (UINT step = size - 1; step > 1; step /= 2)
+	{
+		const UINT half = step / 2;
+
+		// Square centers from their corners.
+		for (UINT i = half; i < size; i += step)
+		{
+			for (UINT j = half; j < size; j += step)
+			{
+				const float mean = 0.25f * (at(i - half, j - half) + at(i - half, j + half) + at(i + half, j - half) + at(i + half, j + half));
+				at(i, j) = mean + amplitude * random.Next();
+			}
+		}
+
+		// Side midpoints from the neighbours within the map.
+		for (UINT i = 0; i < size; i += half)
+		{
+			for (UINT j = (i / half) % 2 ? 0 : half; j < size; j += step)
+			{
+				float sum = 0.0f;
+				UINT count = 0;
+				if (i >= half) { sum += at(i - half, j); ++count; }
+				if (i + half < size) { sum += at(i + half, j); ++count; }
+				if (j >= half) { sum += at(i, j - half); ++count; }
+				if (j + half < size) { sum += at(i, j + half); ++count; }
+				at(i, j) = sum / count + amplitude * random.Next();
+			}
+		}
+
+		amplitude *= 0.535887f;
+	}
+
+	const auto range = std::minmax_element(heights.begin(), heights.end());
+	const float minHeight = *range.first;
+	const float scale = 65535.0f / (*range.second - minHeight);
+
+	FILE* file = fopen(fileName, "wb");
+	if (!file)
+		return false;
+
+	std::vector<USHORT> row(size);
+	bool bWritten = true;
+	for (UINT i = 0; i < size && bWritten; ++i)
+	{
+		for (UINT j = 0; j < size; ++j)
+		{
+			row[j] = USHORT((at(i, j) - minHeight) * scale + 0.5f);
+		}
+		bWritten = fwrite(row.data(), sizeof(USHORT), size, file) == size;
+	}
+	return fclose(file) == 0 && bWritten;
+}
+
+std::unique_ptr<MappedHeightmap> TerrainWorkloads::OpenHeightmap(const wchar_t* fileName, UINT size)
+{
+	return std::unique_ptr<MappedHeightmap>(new MappedHeightmap(fileName, HeightmapFormat::R16, size, size, HeightmapWidth, HeightmapWidth,
+		HeightmapHeightScale, HeightmapHeightOffset));
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+#include "Common/Heightmap.h"
+
+// Workloads shared by the terrain tests and MeshBench.
+namespace TerrainWorkloads
+{
+	// The heightmap path of LitHillGame: R16 samples over 150 x 150 units,
+	// from -20 to 20 high.
+	const float HeightmapWidth = 150.0f;
+	const float HeightmapHeightScale = 40.0f;
+	const float HeightmapHeightOffset = -20.0f;
+
+	// Writes a size x size R16 heightmap of fractal terrain, size one more
+	// than a power of two: midpoint displacement with the displacement
+	// shrinking by 2^-0.9 a level, which keeps the slopes of real terrain
+	// rather than of noise, stretched over the whole sample range. The
+	// same seed writes the same file everywhere.
+	bool WriteHeightmap(const char* fileName, UINT size, UINT seed);
+
+	// MappedHeightmap over a file of WriteHeightmap with the settings above.
+	std::unique_ptr<MappedHeightmap> OpenHeightmap(const wchar_t* fileName, UINT size);
+}
\ No newline at end of file
@@ -0,0 +1,7 @@
+#include "pch.h"
+#include "Harness.h"
+
+int main(int argc, char** argv)
+{
+	return Harness::RunTests(argc, argv);
+}
\ No newline at end of file
@@ -0,0 +1,430 @@
+#include "pch.h"
+#include "Harness.h"
+#include "WaveWorkloads.h"
+#include "Common/GerstnerWaves.h"
+#include "Common/VertexStructuer.h"
+#include "Common/WaveSolver.h"
+#include "Common/WorkerPool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+using namespace DirectX;
+
+// Benchmarks of the wave solver. Run without arguments for the list of
+// commands. Times are wall clock, so run on an otherwise idle machine.
+namespace
+{
+	struct Options
+	{
+		UINT numSteps = 2000;
+		UINT numThreads = 1;
+		UINT seed = WaveWorkloads::GoldenSeed;
+		WaveKernel kernel = WaveSolver::GetBestKernel();
+		WaveWorkloads::Settings settings;
+	};
+
+	std::unique_ptr<WaveSolver> CreateSolver(const Options& options)
+	{
+		const WaveWorkloads::Settings& s = options.settings;
+		std::unique_ptr<WaveSolver> solver(new WaveSolver(s.numRows, s.numCols, s.spatialStep, s.timeStep, s.speed, s.damping));
+		solver->SetKernel(options.kernel);
+		return solver;
+	}
+
+	UINT64 GetInteriorCellCount(const WaveSolver& solver)
+	{
+		const WaveGrid& grid = solver.GetGrid();
+		return UINT64(grid.numRows - 2) * (grid.numCols - 2);
+	}
+
+	// Cells per second over all steps and percentiles of the step latency.
+	void PrintStepTimes(const WaveSolver& solver, const std::vector<double>& stepTimes)
+	{
+		double total = 0.0;
+		for (double time : stepTimes)
+		{
+			total += time;
+		}
+
+		const double cells = double(GetInteriorCellCount(solver)) * double(stepTimes.size());
+		printf("  %.3g cells/s, %.3f ns/cell\n", cells / total, total / cells * 1e9);
+		printf("  step latency ms: p50 %.3f  p90 %.3f  p99 %.3f  max %.3f\n",
+			Harness::Percentile(stepTimes, 0.5) * 1e3,
+			Harness::Percentile(stepTimes, 0.9) * 1e3,
+			Harness::Percentile(stepTimes, 0.99) * 1e3,
+			Harness::Percentile(stepTimes, 1.0) * 1e3);
+	}
+
+	// Seconds per step of a size x size swell, stepped until about minCells
+	// cells were computed. Nothing sleeps, even once the swell died down.
+	double TimeSwellSteps(const Options& options, UINT size, UINT64 minCells)
+	{
+		Options sized = options;
+		sized.settings.numRows = sized.settings.numCols = size;
+
+		std::unique_ptr<WaveSolver> solver = CreateSolver(sized);
+		std::unique_ptr<WorkerPool> pool(sized.numThreads > 1 ? new WorkerPool(sized.numThreads - 1) : nullptr);
+		solver->SetWorkerPool(pool.get());
+		solver->SetSleepThreshold(0.0f);
+		WaveWorkloads::SetSwell(*solver);
+
+		// One step first, so page faults of the planes are not timed.
+		solver->Step();
+
+		const UINT numSteps = UINT(std::max<UINT64>(minCells / GetInteriorCellCount(*solver), 4));
+		const double start = Harness::GetWallSeconds();
+		for (UINT step = 0; step < numSteps; ++step)
+		{
+			solver->Step();
+		}
+		return (Harness::GetWallSeconds() - start) / numSteps;
+	}
+
+	// ns/cell of fully active grids from the demo size up to 4096 x 4096.
+	void RunGridSizes(const Options& options, bool bSizeSet)
+	{
+		const UINT defaultSizes[] = { 201, 512, 1024, 2048, 4096 };
+		std::vector<UINT> sizes(std::begin(defaultSizes), std::end(defaultSizes));
+		if (bSizeSet)
+		{
+			sizes.assign(1, options.settings.numRows);
+		}
+
+		printf("gridsizes, %s kernel, %u threads\n", WaveWorkloads::GetKernelName(options.kernel), options.numThreads);
+		for (UINT size : sizes)
+		{
+			const double seconds = TimeSwellSteps(options, size, 1000000000ull);
+			const double cells = double(size - 2) * double(size - 2);
+			printf("  %4ux%-4u  %.3f ms/step, %.3f ns/cell, %.3g cells/s\n", size, size, seconds * 1e3, seconds / cells * 1e9, cells / seconds);
+		}
+	}
+
+	// Speedup of 1 to maxThreads threads on fully active 1024 and 4096 grids.
+	void RunScaling(const Options& options, bool bSizeSet, UINT maxThreads)
+	{
+		const UINT defaultSizes[] = { 1024, 4096 };
+		std::vector<UINT> sizes(std::begin(defaultSizes), std::end(defaultSizes));
+		if (bSizeSet)
+		{
+			sizes.assign(1, options.settings.numRows);
+		}
+
+		for (UINT size : sizes)
+		{
+			printf("scaling %ux%u, %s kernel, 1 to %u threads\n", size, size, WaveWorkloads::GetKernelName(options.kernel), maxThreads);
+
+			double baseline = 0.0;
+			for (UINT numThreads = 1; numThreads <= maxThreads; ++numThreads)
+			{
+				Options threaded = options;
+				threaded.numThreads = numThreads;
+				const double seconds = TimeSwellSteps(threaded, size, 1000000000ull);
+				if (numThreads == 1)
+				{
+					baseline = seconds;
+				}
+				printf("  %2u threads: %.3f ms/step, %.2fx\n", numThreads, seconds * 1e3, baseline / seconds);
+			}
+		}
+	}
+
+	// Cost of a frame of water at equal vertex counts: a step of the PDE
+	// solver writing vertices with finite difference normals, as LitWave
+	// does, against the four Gerstner waves of LitGerstnerWave evaluated
+	// into the same vertices. Both on one thread.
+	void RunGerstner(const Options& options, bool bSizeSet)
+	{
+		const UINT defaultSizes[] = { 201, 512, 1024 };
+		std::vector<UINT> sizes(std::begin(defaultSizes), std::end(defaultSizes));
+		if (bSizeSet)
+		{
+			sizes.assign(1, options.settings.numRows);
+		}
+
+		GerstnerWaves gerstnerWaves;
+		const float waves[4][5] =
+		{
+			// direction x, z, amplitude, wavelength, speed
+			{ 1.0f, 0.3f, 0.8f, 40.0f, 7.9f },
+			{ 0.6f, 1.0f, 0.4f, 17.0f, 5.2f },
+			{ -0.4f, 1.0f, 0.2f, 9.0f, 3.7f },
+			{ 1.0f, -0.7f, 0.1f, 4.0f, 2.5f },
+		};
+		for (const auto& parameters : waves)
+		{
+			GerstnerWave wave;
+			wave.direction = XMFLOAT2(parameters[0], parameters[1]);
+			wave.amplitude = parameters[2];
+			wave.wavelength = parameters[3];
+			wave.speed = parameters[4];
+			gerstnerWaves.AddWave(wave);
+		}
+
+		GerstnerVertexLayout layout;
+		layout.stride = sizeof(VertexPositionNormalUV);
+		layout.positionOffset = offsetof(VertexPositionNormalUV, position);
+		layout.normalOffset = offsetof(VertexPositionNormalUV, normal);
+
+		printf("gerstner vs PDE, %s kernel for the PDE, one thread\n", WaveWorkloads::GetKernelName(options.kernel));
+		for (UINT size : sizes)
+		{
+			Options sized = options;
+			sized.settings.numRows = sized.settings.numCols = size;
+			std::unique_ptr<WaveSolver> solver = CreateSolver(sized);
+			solver->SetSleepThreshold(0.0f);
+			WaveWorkloads::SetSwell(*solver);
+
+			const WaveGrid grid = solver->GetGrid();
+			std::vector<VertexPositionNormalUV> vertices(grid.GetVertexCount());
+			VertexPositionNormalUV* data = vertices.data();
+
+			const WaveSolver::RowWriter writeRow = [data, grid](UINT i, const float* above, const float* row, const float* below)
+			{
+				const float z = grid.GetZ(i);
+				VertexPositionNormalUV* rowVertices = data + i * grid.numCols;
+				for (UINT j = 0; j < grid.numCols; ++j)
+				{
+					rowVertices[j].position = XMFLOAT3(grid.GetX(j), row[j], z);
+					rowVertices[j].normal = above && below && j > 0 && j < grid.numCols - 1 ?
+						WaveSolver::ComputeNormal(row[j - 1], row[j + 1], above[j], below[j], grid.spatialStep) : XMFLOAT3(0.0f, 1.0f, 0.0f);
+				}
+			};
+
+			// About 50 million vertices each, after a frame that is not timed.
+			const UINT numFrames = std::max(UINT(50000000ull / grid.GetVertexCount()), 4u);
+
+			solver->Advance(1, writeRow);
+			double start = Harness::GetWallSeconds();
+			for (UINT frame = 0; frame < numFrames; ++frame)
+			{
+				solver->Advance(1, writeRow);
+			}
+			const double pdeSeconds = (Harness::GetWallSeconds() - start) / numFrames;
+
+			gerstnerWaves.Evaluate(grid, XMFLOAT2(0.0f, 0.0f), 0.0f, data, layout);
+			start = Harness::GetWallSeconds();
+			for (UINT frame = 0; frame < numFrames; ++frame)
+			{
+				gerstnerWaves.Evaluate(grid, XMFLOAT2(0.0f, 0.0f), frame * sized.settings.timeStep, data, layout);
+			}
+			const double gerstnerSeconds = (Harness::GetWallSeconds() - start) / numFrames;
+
+			const double numVertices = grid.GetVertexCount();
+			printf("  %4ux%-4u  PDE %.3f ms, %.2f ns/vertex   Gerstner %.3f ms, %.2f ns/vertex   %.2fx\n", size, size,
+				pdeSeconds * 1e3, pdeSeconds / numVertices * 1e9, gerstnerSeconds * 1e3, gerstnerSeconds / numVertices * 1e9,
+				gerstnerSeconds / pdeSeconds);
+		}
+	}
+
+	// The fixed seed disturbance sequence of the demos.
+	void RunSequence(const Options& options)
+	{
+		std::unique_ptr<WaveSolver> solver = CreateSolver(options);
+		std::unique_ptr<WorkerPool> pool(options.numThreads > 1 ? new WorkerPool(options.numThreads - 1) : nullptr);
+		solver->SetWorkerPool(pool.get());
+
+		std::vector<double> stepTimes;
+		WaveWorkloads::RunDisturbanceSequence(*solver, options.numSteps, options.seed, &stepTimes);
+
+		printf("sequence %ux%u, %u steps, seed %u, %s kernel, %u threads\n",
+			options.settings.numRows, options.settings.numCols, options.numSteps, options.seed,
+			WaveWorkloads::GetKernelName(solver->GetKernel()), options.numThreads);
+		PrintStepTimes(*solver, stepTimes);
+	}
+
+	// Fully active grids stepped one step at a time and in temporal blocks of
+	// 2, 4 and 8 steps. Two steps run one by one, see MinBlockedSteps.
+	void RunBlocking(const Options& options, bool bSizeSet)
+	{
+		const UINT defaultSizes[] = { 1025, 2049 };
+		const UINT numSteps = 64;
+
+		for (UINT size : defaultSizes)
+		{
+			Options sized = options;
+			if (!bSizeSet)
+			{
+				sized.settings.numRows = sized.settings.numCols = size;
+			}
+
+			printf("blocking %ux%u, %u steps, %s kernel, %u threads\n", sized.settings.numRows, sized.settings.numCols,
+				numSteps, WaveWorkloads::GetKernelName(sized.kernel), sized.numThreads);
+
+			const UINT blockSizes[] = { 1, 2, 4, 8 };
+			for (UINT blockSize : blockSizes)
+			{
+				std::unique_ptr<WaveSolver> solver = CreateSolver(sized);
+				std::unique_ptr<WorkerPool> pool(sized.numThreads > 1 ? new WorkerPool(sized.numThreads - 1) : nullptr);
+				solver->SetWorkerPool(pool.get());
+				WaveWorkloads::SetSwell(*solver);
+
+				const double start = Harness::GetWallSeconds();
+				for (UINT step = 0; step < numSteps; step += blockSize)
+				{
+					solver->Step(blockSize);
+				}
+				const double seconds = Harness::GetWallSeconds() - start;
+
+				const double cells = double(GetInteriorCellCount(*solver)) * numSteps;
+				printf("  %u steps per call: %.3f ms/step, %.3f ns/cell\n", blockSize, seconds / numSteps * 1e3, seconds / cells * 1e9);
+			}
+
+			if (bSizeSet)
+				break;
+		}
+	}
+
+	// The disturbance sequence as rain on a grid larger than the drops cover,
+	// with sleeping tiles and with every tile stepped (threshold 0).
+	void RunSleeping(const Options& options, bool bSizeSet)
+	{
+		Options sized = options;
+		if (!bSizeSet)
+		{
+			sized.settings.numRows = sized.settings.numCols = 1025;
+		}
+
+		printf("sleeping %ux%u, %u steps, seed %u, %s kernel, %u threads\n", sized.settings.numRows, sized.settings.numCols,
+			sized.numSteps, sized.seed, WaveWorkloads::GetKernelName(sized.kernel), sized.numThreads);
+
+		const float thresholds[] = { 0.0f, 1e-4f };
+		double baseline = 0.0;
+		for (float threshold : thresholds)
+		{
+			std::unique_ptr<WaveSolver> solver = CreateSolver(sized);
+			std::unique_ptr<WorkerPool> pool(sized.numThreads > 1 ? new WorkerPool(sized.numThreads - 1) : nullptr);
+			solver->SetWorkerPool(pool.get());
+			solver->SetSleepThreshold(threshold);
+
+			std::vector<double> stepTimes;
+			WaveWorkloads::RunDisturbanceSequence(*solver, sized.numSteps, sized.seed, &stepTimes);
+
+			double total = 0.0;
+			for (double time : stepTimes)
+			{
+				total += time;
+			}
+			if (threshold == 0.0f)
+			{
+				baseline = total;
+			}
+
+			printf("  threshold %g: %.3f ms/step, %u of %u tiles active at the end, %.2fx\n", threshold,
+				total / stepTimes.size() * 1e3, solver->GetActiveTileCount(), solver->GetTileCount(), baseline / total);
+		}
+	}
+
+	// Rewrites the golden snapshot after an intended change of the results.
+	int WriteGolden()
+	{
+		const WaveWorkloads::Settings settings;
+		WaveSolver solver(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, settings.damping);
+		WaveWorkloads::RunDisturbanceSequence(solver, WaveWorkloads::GoldenSteps, WaveWorkloads::GoldenSeed);
+
+		const std::string path = Harness::GetGoldenPath(WaveWorkloads::GoldenFile);
+		if (!WaveWorkloads::WriteSnapshot(path, WaveWorkloads::TakeSnapshot(solver, WaveWorkloads::GoldenStride)))
+		{
+			fprintf(stderr, "cannot write %s\n", path.c_str());
+			return 1;
+		}
+
+		printf("wrote %s\n", path.c_str());
+		return 0;
+	}
+
+	bool ParseOptions(int argc, char** argv, Options& options, bool& bSizeSet)
+	{
+		bSizeSet = false;
+		for (int arg = 2; arg + 1 < argc; arg += 2)
+		{
+			const char* name = argv[arg];
+			const char* value = argv[arg + 1];
+
+			if (strcmp(name, "--steps") == 0)
+				options.numSteps = UINT(atoi(value));
+			else if (strcmp(name, "--threads") == 0)
+				options.numThreads = std::max(UINT(atoi(value)), 1u);
+			else if (strcmp(name, "--seed") == 0)
+				options.seed = UINT(atoi(value));
+			else if (strcmp(name, "--size") == 0)
+			{
+				options.settings.numRows = options.settings.numCols = UINT(atoi(value));
+				bSizeSet = true;
+			}
+			else if (strcmp(name, "--kernel") == 0)
+			{
+				if (strcmp(value, "scalar") == 0)
+					options.kernel = WaveKernel::Scalar;
+				else if (strcmp(value, "vector") == 0)
+					options.kernel = WaveKernel::Vector;
+				else if (strcmp(value, "avx2") == 0)
+					options.kernel = WaveKernel::AVX2;
+				else
+					return false;
+			}
+			else
+				return false;
+		}
+		return (argc % 2) == 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	bool bSizeSet;
+	if (argc < 2 || !ParseOptions(argc, argv, options, bSizeSet))
+	{
+		printf("usage: WaveBench <command> [--steps n] [--threads n] [--seed n] [--size n] [--kernel scalar|vector|avx2]\n");
+		printf("  sequence     fixed seed disturbance sequence: cells/s and step latency\n");
+		printf("  gridsizes    ns/cell of fully active grids from 201 to 4096 a side\n");
+		printf("  scaling      1 to --threads threads, all cores by default, on fully active grids\n");
+		printf("  gerstner     PDE solver against Gerstner waves at equal vertex counts\n");
+		printf("  blocking     1, 2, 4 and 8 steps per call on fully active grids\n");
+		printf("  sleeping     disturbance sequence as rain with and without sleeping tiles\n");
+		printf("  golden       rewrite Golden/%s\n", WaveWorkloads::GoldenFile);
+		return argc < 2 ? 0 : 2;
+	}
+
+	const char* command = argv[1];
+	if (strcmp(command, "sequence") == 0)
+	{
+		RunSequence(options);
+		return 0;
+	}
+	if (strcmp(command, "gridsizes") == 0)
+	{
+		RunGridSizes(options, bSizeSet);
+		return 0;
+	}
+	if (strcmp(command, "scaling") == 0)
+	{
+		RunScaling(options, bSizeSet, options.numThreads > 1 ? options.numThreads : std::max(std::thread::hardware_concurrency(), 1u));
+		return 0;
+	}
+	if (strcmp(command, "gerstner") == 0)
+	{
+		RunGerstner(options, bSizeSet);
+		return 0;
+	}
+	if (strcmp(command, "blocking") == 0)
+	{
+		RunBlocking(options, bSizeSet);
+		return 0;
+	}
+	if (strcmp(command, "sleeping") == 0)
+	{
+		RunSleeping(options, bSizeSet);
+		return 0;
+	}
+	if (strcmp(command, "golden") == 0)
+	{
+		return WriteGolden();
+	}
+
+	fprintf(stderr, "Unknown command %s\n", command);
+	return 2;
+}
\ No newline at end of file
@@ -0,0 +1,403 @@
+#include "pch.h"
+#include "Harness.h"
+#include "WaveWorkloads.h"
+#include "Common/NestedWaveSolver.h"
+#include "Common/WaveSolver.h"
+#include "Common/WorkerPool.h"
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	void CheckGolden(WorkerPool* pool)
+	{
+		WaveWorkloads::Snapshot golden;
+		const std::string path = Harness::GetGoldenPath(WaveWorkloads::GoldenFile);
+		HARNESS_CHECK_MSG(WaveWorkloads::ReadSnapshot(path, golden), "cannot read %s", path.c_str());
+
+		const WaveWorkloads::Settings settings;
+		WaveSolver solver(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, settings.damping);
+		solver.SetWorkerPool(pool);
+		WaveWorkloads::RunDisturbanceSequence(solver, WaveWorkloads::GoldenSteps, WaveWorkloads::GoldenSeed);
+
+		const WaveWorkloads::Snapshot snapshot = WaveWorkloads::TakeSnapshot(solver, WaveWorkloads::GoldenStride);
+		HARNESS_CHECK(snapshot.numRows == golden.numRows && snapshot.numCols == golden.numCols);
+
+		// Every kernel and thread count gives the same bits, but allow for a
+		// compiler that reorders the float math.
+		for (size_t k = 0; k < golden.heights.size(); ++k)
+		{
+			HARNESS_CHECK_MSG(fabsf(snapshot.heights[k] - golden.heights[k]) <= 1e-5f,
+				"height %zu is %.9g, golden %.9g", k, snapshot.heights[k], golden.heights[k]);
+		}
+	}
+}
+
+// The fixed seed disturbance sequence reproduces the checked in snapshot.
+HARNESS_TEST(WaveGolden)
+{
+	CheckGolden(nullptr);
+}
+
+HARNESS_TEST(WaveGoldenPooled)
+{
+	WorkerPool pool(3);
+	CheckGolden(&pool);
+}
+
+namespace
+{
+	// Runs the disturbance sequence for numSteps steps with kernel, stepping
+	// blockSize steps at a time, and returns every height.
+	std::vector<float> RunKernel(WaveKernel kernel, UINT numSteps, UINT blockSize, float sleepThreshold)
+	{
+		const WaveWorkloads::Settings settings;
+		WaveSolver solver(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, settings.damping);
+		solver.SetKernel(kernel);
+		solver.SetSleepThreshold(sleepThreshold);
+
+		WaveDisturbanceSequence disturbances(WaveWorkloads::GoldenSeed);
+		for (UINT step = 0; step < numSteps; step += blockSize)
+		{
+			disturbances.DisturbNext(solver);
+			solver.Step(blockSize);
+		}
+
+		const float* heights = solver.GetHeights();
+		return std::vector<float>(heights, heights + solver.GetGrid().GetVertexCount());
+	}
+
+	void CheckKernelsAgree(UINT blockSize, float sleepThreshold)
+	{
+		const UINT numSteps = 4000;
+		const std::vector<float> reference = RunKernel(WaveKernel::Scalar, numSteps, blockSize, sleepThreshold);
+
+		const WaveKernel kernels[] = { WaveKernel::Vector, WaveKernel::AVX2 };
+		for (WaveKernel kernel : kernels)
+		{
+			if (!WaveSolver::IsKernelSupported(kernel))
+			{
+				printf("%s kernel not supported, skipped\n", WaveWorkloads::GetKernelName(kernel));
+				continue;
+			}
+
+			// The kernels evaluate the stencil in the same order, so anything
+			// beyond rounding noise is a bug in one of them.
+			const std::vector<float> heights = RunKernel(kernel, numSteps, blockSize, sleepThreshold);
+			for (size_t k = 0; k < reference.size(); ++k)
+			{
+				HARNESS_CHECK_MSG(fabsf(heights[k] - reference[k]) <= 1e-5f,
+					"%s kernel height %zu is %.9g, scalar %.9g", WaveWorkloads::GetKernelName(kernel), k, heights[k], reference[k]);
+			}
+		}
+	}
+}
+
+// Scalar, vector and AVX2 kernels agree over thousands of steps.
+HARNESS_TEST(WaveKernelsAgree)
+{
+	CheckKernelsAgree(1, 1e-4f);
+}
+
+// Same through temporally blocked steps, which call the kernels on the
+// scratch planes of a tile.
+HARNESS_TEST(WaveKernelsAgreeBlocked)
+{
+	CheckKernelsAgree(4, 0.0f);
+}
+
+
+namespace
+{
+	// Sets both planes of solver to a resting Gaussian bump of height 1 and
+	// the given radius in cells around point (row, col).
+	void SetBump(WaveSolver& solver, float row, float col, float radius)
+	{
+		const UINT m = solver.GetGrid().numRows;
+		const UINT n = solver.GetGrid().numCols;
+
+		std::vector<float> heights(m * n, 0.0f);
+		for (UINT i = 1; i < m - 1; ++i)
+		{
+			for (UINT j = 1; j < n - 1; ++j)
+			{
+				const float distanceSq = ((i - row) * (i - row) + (j - col) * (j - col)) / (radius * radius);
+				heights[i * n + j] = expf(-distanceSq);
+			}
+		}
+		solver.SetHeights(0, 0, m, n, heights.data(), heights.data());
+	}
+
+	// Sum of squared heights over the coarse points inside the window, and of
+	// the squared differences to the reference grid, which has twice the
+	// resolution everywhere.
+	void MeasureWindow(const NestedWaveSolver& nested, const WaveSolver& coarse, const WaveSolver& reference,
+		double& energy, double& referenceEnergy, double& errorEnergy)
+	{
+		energy = referenceEnergy = errorEnergy = 0.0;
+
+		for (UINT i = nested.GetOriginRow() + 1; i < nested.GetOriginRow() + nested.GetCellCount(); ++i)
+		{
+			for (UINT j = nested.GetOriginCol() + 1; j < nested.GetOriginCol() + nested.GetCellCount(); ++j)
+			{
+				const double height = coarse.GetHeight(i, j);
+				const double referenceHeight = reference.GetHeight(2 * i, 2 * j);
+				energy += height * height;
+				referenceEnergy += referenceHeight * referenceHeight;
+				errorEnergy += (height - referenceHeight) * (height - referenceHeight);
+			}
+		}
+	}
+
+	// Starts a bump in the middle of the window and lets it run out across
+	// the window edge. What is left in the window once the pulse is gone,
+	// beyond what a uniform grid at the fine resolution keeps, was reflected
+	// at the edge. Returns that energy relative to the pulse.
+	double MeasureReflection(float radius)
+	{
+		const WaveWorkloads::Settings settings;
+		const UINT numCells = 40;
+		const UINT numSteps = 300;
+
+		// Undamped, and nothing sleeps, so the energy is all the coupling's.
+		WaveSolver coarse(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, 0.0f);
+		coarse.SetSleepThreshold(0.0f);
+		NestedWaveSolver nested(coarse, numCells);
+		nested.GetFineSolver().SetSleepThreshold(0.0f);
+
+		WaveSolver reference(2 * settings.numRows - 1, 2 * settings.numCols - 1, 0.5f * settings.spatialStep, settings.timeStep, settings.speed, 0.0f);
+		reference.SetSleepThreshold(0.0f);
+
+		const float center = 0.5f * (settings.numRows - 1);
+		SetBump(nested.GetFineSolver(), 2.0f * (center - nested.GetOriginRow()), 2.0f * (center - nested.GetOriginCol()), 2.0f * radius);
+		SetBump(reference, 2.0f * center, 2.0f * center, 2.0f * radius);
+
+		double energy, pulseEnergy, errorEnergy;
+		MeasureWindow(nested, coarse, reference, energy, pulseEnergy, errorEnergy);
+
+		for (UINT step = 0; step < numSteps; ++step)
+		{
+			nested.Step();
+			reference.Step();
+		}
+
+		double referenceEnergy;
+		MeasureWindow(nested, coarse, reference, energy, referenceEnergy, errorEnergy);
+		printf("radius %.1f: window energy %.4g, reference %.4g, reflected %.3g of the pulse\n",
+			radius, energy, referenceEnergy, errorEnergy / pulseEnergy);
+		return errorEnergy / pulseEnergy;
+	}
+}
+
+// A pulse crossing the edge of a nested window leaves about what a uniform
+// grid would. A smooth pulse passes the edge almost untouched; one of a few
+// fine cells, which the coarse grid cannot carry, is partly reflected.
+HARNESS_TEST(NestedWaveReflection)
+{
+	HARNESS_CHECK(MeasureReflection(3.0f) < 1e-4);
+	HARNESS_CHECK(MeasureReflection(1.5f) < 1e-2);
+}
+
+
+namespace
+{
+	// Largest height difference between the disturbance sequence stepped one
+	// step at a time and blockSize steps at a time.
+	float CompareBlocked(UINT blockSize, float sleepThreshold, UINT& numBlockedActiveTiles, UINT& numActiveTiles)
+	{
+		const WaveWorkloads::Settings settings;
+		WaveSolver single(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, settings.damping);
+		WaveSolver blocked(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, settings.damping);
+		single.SetSleepThreshold(sleepThreshold);
+		blocked.SetSleepThreshold(sleepThreshold);
+
+		WaveDisturbanceSequence singleDisturbances(WaveWorkloads::GoldenSeed);
+		WaveDisturbanceSequence blockedDisturbances(WaveWorkloads::GoldenSeed);
+		for (UINT step = 0; step < 2000; step += blockSize)
+		{
+			singleDisturbances.DisturbNext(single);
+			blockedDisturbances.DisturbNext(blocked);
+
+			for (UINT k = 0; k < blockSize; ++k)
+			{
+				single.Step();
+			}
+			blocked.Step(blockSize);
+		}
+
+		float difference = 0.0f;
+		for (UINT k = 0; k < single.GetGrid().GetVertexCount(); ++k)
+		{
+			difference = std::max(difference, fabsf(single.GetHeights()[k] - blocked.GetHeights()[k]));
+		}
+
+		numActiveTiles = single.GetActiveTileCount();
+		numBlockedActiveTiles = blocked.GetActiveTileCount();
+		return difference;
+	}
+}
+
+// Blocked steps with a sleep threshold of 0 are single steps, bit for bit.
+// Above 0, tiles only fall asleep at the end of a block, which may only
+// change heights by about the threshold.
+HARNESS_TEST(WaveBlockedSleeping)
+{
+	const UINT blockSizes[] = { 3, 4, 8 };
+	for (UINT blockSize : blockSizes)
+	{
+		UINT numBlockedActiveTiles, numActiveTiles;
+		float difference = CompareBlocked(blockSize, 0.0f, numBlockedActiveTiles, numActiveTiles);
+		HARNESS_CHECK_MSG(difference == 0.0f && numBlockedActiveTiles == numActiveTiles,
+			"%u steps per block differ by %g", blockSize, difference);
+
+		const float threshold = 1e-4f;
+		difference = CompareBlocked(blockSize, threshold, numBlockedActiveTiles, numActiveTiles);
+		printf("%u steps per block: heights differ by %g, %u active tiles, %u with single steps\n",
+			blockSize, difference, numBlockedActiveTiles, numActiveTiles);
+		HARNESS_CHECK_MSG(difference <= 10.0f * threshold, "%u steps per block differ by %g", blockSize, difference);
+	}
+}
+
+// A single disturbance on a large grid wakes only the tiles its waves reach,
+// whether it is stepped in blocks or one step at a time. Tiles ahead of the
+// wave are stepped by a block but must not stay awake, and tiles its front
+// just left must not fall asleep at once.
+HARNESS_TEST(WaveBlockedActiveTiles)
+{
+	const WaveWorkloads::Settings settings;
+	const UINT size = 1025;
+	const UINT numFrames = 100;
+
+	const UINT blockSizes[] = { 4, 8 };
+	for (UINT blockSize : blockSizes)
+	{
+		WaveSolver single(size, size, settings.spatialStep, settings.timeStep, settings.speed, settings.damping);
+		WaveSolver blocked(size, size, settings.spatialStep, settings.timeStep, settings.speed, settings.damping);
+		single.Disturb(size / 2, size / 2, 1.0f);
+		blocked.Disturb(size / 2, size / 2, 1.0f);
+
+		for (UINT frame = 0; frame < numFrames; ++frame)
+		{
+			for (UINT k = 0; k < blockSize; ++k)
+			{
+				single.Step();
+			}
+			blocked.Step(blockSize);
+
+			// Tiles falling asleep and waking again at the wavefront are
+			// counted at different steps.
+			const UINT numActiveTiles = single.GetActiveTileCount();
+			const UINT numBlockedActiveTiles = blocked.GetActiveTileCount();
+			const UINT margin = 8 + numActiveTiles / 4;
+			HARNESS_CHECK_MSG(numBlockedActiveTiles <= numActiveTiles + margin && numBlockedActiveTiles + margin >= numActiveTiles,
+				"%u steps per block, frame %u: %u active tiles, %u with single steps", blockSize, frame, numBlockedActiveTiles, numActiveTiles);
+		}
+
+		float difference = 0.0f;
+		for (UINT k = 0; k < single.GetGrid().GetVertexCount(); ++k)
+		{
+			difference = std::max(difference, fabsf(single.GetHeights()[k] - blocked.GetHeights()[k]));
+		}
+
+		printf("%u steps per block on %ux%u: %u active tiles, %u with single steps, heights differ by %g\n",
+			blockSize, size, size, blocked.GetActiveTileCount(), single.GetActiveTileCount(), difference);
+		HARNESS_CHECK_MSG(difference <= 10.0f * single.GetSleepThreshold(), "%u steps per block differ by %g", blockSize, difference);
+	}
+}
+
+
+namespace
+{
+	// Lets a unit bump run out over an undamped grid with the given sleep
+	// threshold, and returns the squared height difference to never sleeping,
+	// relative to the energy of the pulse that far.
+	double MeasureSleepLoss(float sleepThreshold, UINT numSteps)
+	{
+		const WaveWorkloads::Settings settings;
+		WaveSolver sleeping(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, 0.0f);
+		WaveSolver reference(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, 0.0f);
+		sleeping.SetSleepThreshold(sleepThreshold);
+		reference.SetSleepThreshold(0.0f);
+
+		const float center = 0.5f * (settings.numRows - 1);
+		SetBump(sleeping, center, center, 2.0f);
+		SetBump(reference, center, center, 2.0f);
+
+		for (UINT step = 0; step < numSteps; ++step)
+		{
+			sleeping.Step();
+			reference.Step();
+		}
+
+		double referenceEnergy = 0.0;
+		double errorEnergy = 0.0;
+		for (UINT k = 0; k < reference.GetGrid().GetVertexCount(); ++k)
+		{
+			const double height = sleeping.GetHeights()[k];
+			const double referenceHeight = reference.GetHeights()[k];
+			referenceEnergy += referenceHeight * referenceHeight;
+			errorEnergy += (height - referenceHeight) * (height - referenceHeight);
+		}
+
+		printf("threshold %g after %u steps: %.3g of the energy lost, %u active tiles\n",
+			sleepThreshold, numSteps, errorEnergy / referenceEnergy, sleeping.GetActiveTileCount());
+		return errorEnergy / referenceEnergy;
+	}
+}
+
+// Sleeping tiles lose little of a spreading pulse: its front enters quiet
+// tiles far below the threshold and has to survive until it builds up.
+HARNESS_TEST(WaveSleepEnergyLoss)
+{
+	const UINT stepCounts[] = { 50, 100, 150 };
+	for (UINT numSteps : stepCounts)
+	{
+		HARNESS_CHECK(MeasureSleepLoss(1e-4f, numSteps) < 1e-5);
+		HARNESS_CHECK(MeasureSleepLoss(1e-2f, numSteps) < 1e-2);
+	}
+}
+
+// Impulses queued past the capacity are counted while other threads queue,
+// step and read the count.
+HARNESS_TEST(WaveImpulseDrops)
+{
+	const WaveWorkloads::Settings settings;
+	WaveSolver solver(settings.numRows, settings.numCols, settings.spatialStep, settings.timeStep, settings.speed, settings.damping);
+	solver.SetImpulseCapacity(64);
+
+	const UINT numThreads = 4;
+	const UINT numImpulses = 1000;
+	std::vector<std::thread> producers;
+	for (UINT thread = 0; thread < numThreads; ++thread)
+	{
+		producers.emplace_back([&solver, thread]()
+		{
+			const WaveImpulse impulse = { 50.0f + thread, 50.0f, 0.01f, 2.0f };
+			for (UINT k = 0; k < numImpulses; ++k)
+			{
+				solver.QueueImpulse(impulse);
+			}
+		});
+	}
+
+	// Counts only ever grow.
+	UINT64 lastCount = 0;
+	for (UINT step = 0; step < 50; ++step)
+	{
+		solver.Step();
+		const UINT64 count = solver.GetDroppedImpulseCount();
+		HARNESS_CHECK(count >= lastCount);
+		lastCount = count;
+	}
+
+	for (std::thread& producer : producers)
+	{
+		producer.join();
+	}
+
+	// Every impulse was either queued for a step or dropped; the ones still
+	// queued are applied by one more step.
+	solver.Step();
+	HARNESS_CHECK(solver.GetDroppedImpulseCount() <= UINT64(numThreads) * numImpulses);
+	HARNESS_CHECK(solver.GetDroppedImpulseCount() >= UINT64(numThreads) * numImpulses - 64 * 52);
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "WaveWorkloads.h"
+#include "Harness.h"
+#include <cstdio>
+
+void WaveWorkloads::RunDisturbanceSequence(WaveSolver& solver, UINT numSteps, UINT seed, std::vector<double>* stepTimes)
+{
+	WaveDisturbanceSequence disturbances(seed);
+
+	for (UINT step = 0; step < numSteps; ++step)
+	{
+		if (step % DisturbancePeriod == 0)
+		{
+			disturbances.DisturbNext(solver);
+		}
+
+		const double start = stepTimes ? Harness::GetWallSeconds() : 0.0;
+		solver.Step();
+		if (stepTimes)
+		{
+			stepTimes->push_back(Harness::GetWallSeconds() - start);
+		}
+	}
+}
+
+void WaveWorkloads::SetSwell(WaveSolver& solver)
+{
+	const WaveGrid& grid = solver.GetGrid();
+	const UINT m = grid.numRows;
+	const UINT n = grid.numCols;
+
+	std::vector<float> heights(m * n, 0.0f);
+	for (UINT i = 1; i < m - 1; ++i)
+	{
+		for (UINT j = 1; j < n - 1; ++j)
+		{
+			const float x = grid.GetX(j);
+			const float z = grid.GetZ(i);
+			heights[i * n + j] = 0.3f * sinf(0.21f * x + 0.05f * z) + 0.15f * sinf(0.13f * z - 0.3f * x) + 0.05f * sinf(0.7f * (x + z));
+		}
+	}
+	solver.SetHeights(0, 0, m, n, heights.data(), heights.data());
+}
+
+WaveWorkloads::Snapshot WaveWorkloads::TakeSnapshot(const WaveSolver& solver, UINT stride)
+{
+	const WaveGrid& grid = solver.GetGrid();
+
+	Snapshot snapshot;
+	for (UINT i = 0; i < grid.numRows; i += stride)
+	{
+		++snapshot.numRows;
+		for (UINT j = 0; j < grid.numCols; j += stride)
+		{
+			snapshot.heights.push_back(solver.GetHeight(i, j));
+		}
+	}
+	snapshot.numCols = snapshot.numRows ? UINT(snapshot.heights.size()) / snapshot.numRows : 0;
+	return snapshot;
+}
+
+bool WaveWorkloads::WriteSnapshot(const std::string& path, const Snapshot& snapshot)
+{
+	FILE* file = fopen(path.c_str(), "w");
+	if (!file)
+		return false;
+
+	// Nine significant digits round trip every float.
+	fprintf(file, "%u %u\n", snapshot.numRows, snapshot.numCols);
+	for (UINT i = 0; i < snapshot.numRows; ++i)
+	{
+		for (UINT j = 0; j < snapshot.numCols; ++j)
+		{
+			fprintf(file, j + 1 < snapshot.numCols ? "%.9g " : "%.9g\n", snapshot.heights[i * snapshot.numCols + j]);
+		}
+	}
+
+	return fclose(file) == 0;
+}
+
+bool WaveWorkloads::ReadSnapshot(const std::string& path, Snapshot& snapshot)
+{
+	FILE* file = fopen(path.c_str(), "r");
+	if (!file)
+		return false;
+
+	bool bRead = fscanf(file, "%u %u", &snapshot.numRows, &snapshot.numCols) == 2;
+	snapshot.heights.resize(bRead ? snapshot.numRows * snapshot.numCols : 0);
+	for (float& height : snapshot.heights)
+	{
+		bRead = bRead && fscanf(file, "%g", &height) == 1;
+	}
+
+	fclose(file);
+	return bRead;
+}
+
+const char* WaveWorkloads::GetKernelName(WaveKernel kernel)
+{
+	switch (kernel)
+	{
+	case WaveKernel::Scalar:
+		return "scalar";
+	case WaveKernel::Vector:
+		return "vector";
+	case WaveKernel::AVX2:
+		return "avx2";
+	}
+	return "unknown";
+}
\ No newline at end of file
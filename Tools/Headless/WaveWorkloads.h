@@ -0,0 +1,55 @@
+#pragma once
+#include "Common/WaveSolver.h"
+#include <string>
+#include <vector>
+
+// Workloads shared by the wave tests and WaveBench.
+namespace WaveWorkloads
+{
+	// Water of LitHillGame and HillAndWaveGame.
+	struct Settings
+	{
+		UINT numRows = 201;
+		UINT numCols = 201;
+		float spatialStep = 0.75f;
+		float timeStep = 0.03f;
+		float speed = 3.25f;
+		float damping = 0.4f;
+	};
+
+	// Steps between two disturbances, about the quarter second of the demos.
+	const UINT DisturbancePeriod = 8;
+
+	// Runs numSteps steps of the demo workload: a disturbance from a
+	// WaveDisturbanceSequence seeded with seed every DisturbancePeriod steps,
+	// starting before the first step. stepTimes, when given, receives the
+	// wall clock seconds of every step.
+	void RunDisturbanceSequence(WaveSolver& solver, UINT numSteps, UINT seed, std::vector<double>* stepTimes = nullptr);
+
+	// Sets both planes to a resting swell of a few crossing sine waves of
+	// about half a unit over the whole interior, so every tile is active.
+	void SetSwell(WaveSolver& solver);
+
+	// Every stride-th row and column of the current heights, boundary included.
+	struct Snapshot
+	{
+		UINT numRows = 0;
+		UINT numCols = 0;
+		std::vector<float> heights;
+	};
+
+	Snapshot TakeSnapshot(const WaveSolver& solver, UINT stride);
+
+	// Text files of the snapshot, exact to the last bit of every height.
+	bool WriteSnapshot(const std::string& path, const Snapshot& snapshot);
+	bool ReadSnapshot(const std::string& path, Snapshot& snapshot);
+
+	// Golden run: the demo settings, seed 1, GoldenSteps steps, every
+	// GoldenStride-th cell.
+	const UINT GoldenSeed = 1;
+	const UINT GoldenSteps = 1000;
+	const UINT GoldenStride = 4;
+	const char* const GoldenFile = "WaveSequence.txt";
+
+	const char* GetKernelName(WaveKernel kernel);
+}
\ No newline at end of file